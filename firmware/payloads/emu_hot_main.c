@@ -0,0 +1,229 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Hot emulation site demo payload
+ *
+ * Registers a handler for SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE, enables
+ * reporting through FWFT and then keeps executing a trapping sh2add.
+ * Once the site gets reported, the handler rewrites it into slli + add
+ * so that the loop finishes without further traps.
+ *
+ * Build with CONFIG_SBI_INSN_EMU_HOT_SITES=y on a HART without Zba and
+ * boot it through FW_PAYLOAD_PATH=<build>/firmware/payloads/emu_hot.bin.
+ */
+
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_string.h>
+
+#define HOT_THRESHOLD		1000
+#define HOT_ITERATIONS		100000
+
+/* shNadd rd, rs1, rs2 with N in 1..3 */
+#define INSN_MASK_SHXADD	0xfe00107f
+#define INSN_MATCH_SHXADD	0x20000033
+#define INSN_NOP		0x00000013
+
+struct sbiret {
+	unsigned long error;
+	unsigned long value;
+};
+
+struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
+			unsigned long arg1, unsigned long arg2,
+			unsigned long arg3, unsigned long arg4,
+			unsigned long arg5)
+{
+	struct sbiret ret;
+
+	register unsigned long a0 asm ("a0") = (unsigned long)(arg0);
+	register unsigned long a1 asm ("a1") = (unsigned long)(arg1);
+	register unsigned long a2 asm ("a2") = (unsigned long)(arg2);
+	register unsigned long a3 asm ("a3") = (unsigned long)(arg3);
+	register unsigned long a4 asm ("a4") = (unsigned long)(arg4);
+	register unsigned long a5 asm ("a5") = (unsigned long)(arg5);
+	register unsigned long a6 asm ("a6") = (unsigned long)(fid);
+	register unsigned long a7 asm ("a7") = (unsigned long)(ext);
+	asm volatile ("ecall"
+		      : "+r" (a0), "+r" (a1)
+		      : "r" (a2), "r" (a3), "r" (a4), "r" (a5), "r" (a6), "r" (a7)
+		      : "memory");
+	ret.error = a0;
+	ret.value = a1;
+
+	return ret;
+}
+
+static inline void sbi_ecall_console_puts(const char *str)
+{
+	sbi_ecall(SBI_EXT_DBCN, SBI_EXT_DBCN_CONSOLE_WRITE,
+		  sbi_strlen(str), (unsigned long)str, 0, 0, 0, 0);
+}
+
+static inline void sbi_ecall_shutdown(void)
+{
+	sbi_ecall(SBI_EXT_SRST, SBI_EXT_SRST_RESET,
+		  SBI_SRST_RESET_TYPE_SHUTDOWN, SBI_SRST_RESET_REASON_NONE,
+		  0, 0, 0, 0);
+}
+
+static void puthex(const char *prefix, unsigned long val)
+{
+	char buf[2 + 2 * sizeof(val) + 1];
+	int i;
+
+	buf[0] = '0';
+	buf[1] = 'x';
+	for (i = 0; i < 2 * sizeof(val); i++)
+		buf[2 + i] = "0123456789abcdef"[
+			(val >> (4 * (2 * sizeof(val) - 1 - i))) & 0xf];
+	buf[2 + i] = '\0';
+
+	sbi_ecall_console_puts(prefix);
+	sbi_ecall_console_puts(buf);
+}
+
+void emu_hot_sse_entry(void);
+
+static unsigned char sse_stack[4096] __attribute__((aligned(16)));
+static struct sbi_isa_emu_hot_site report;
+static unsigned long reports, rewrites;
+
+/*
+ * Rewrite "shNadd rd, rs1, rs2; nop" into "slli rd, rs1, N; add rd, rd, rs2"
+ *
+ * The reported instruction has already been emulated when the event
+ * arrives, so the interrupted context resumes in the second slot and
+ * must skip the new add.
+ */
+static int rewrite_site(unsigned long pc, unsigned long insn)
+{
+	volatile unsigned int *site = (volatile unsigned int *)pc;
+	unsigned int rd = (insn >> 7) & 0x1f;
+	unsigned int rs1 = (insn >> 15) & 0x1f;
+	unsigned int rs2 = (insn >> 20) & 0x1f;
+	unsigned int shamt = (insn >> 13) & 0x3;
+	static unsigned long sepc;
+	struct sbiret ret;
+
+	if ((insn & INSN_MASK_SHXADD) != INSN_MATCH_SHXADD || !shamt ||
+	    rd == rs2 || (pc & 3) || site[0] != insn || site[1] != INSN_NOP)
+		return -1;
+
+	ret = sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_READ_ATTR,
+			SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE,
+			SBI_SSE_ATTR_INTERRUPTED_SEPC, 1,
+			(unsigned long)&sepc, 0, 0);
+	if (ret.error)
+		return -1;
+
+	if (sepc == pc + 4) {
+		sepc += 4;
+		ret = sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_WRITE_ATTR,
+				SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE,
+				SBI_SSE_ATTR_INTERRUPTED_SEPC, 1,
+				(unsigned long)&sepc, 0, 0);
+		if (ret.error)
+			return -1;
+	}
+
+	site[1] = 0x00000033 | (rs2 << 20) | (rd << 15) | (rd << 7);
+	site[0] = 0x00001013 | (shamt << 20) | (rs1 << 15) | (rd << 7);
+	asm volatile ("fence.i" ::: "memory");
+
+	return 0;
+}
+
+void emu_hot_sse_handler(void)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_ISA_EMU, SBI_EXT_ISA_EMU_READ_HOT_SITE,
+			(unsigned long)&report, 0, 0, 0, 0, 0);
+	if (ret.error)
+		return;
+
+	reports++;
+	puthex("Hot site: pc=", report.pc);
+	puthex(" insn=", report.insn);
+	puthex(" group=", report.group);
+	puthex(" count=", report.count);
+	sbi_ecall_console_puts("\n");
+
+	if (!rewrite_site(report.pc, report.insn)) {
+		rewrites++;
+		sbi_ecall_console_puts("Hot site rewritten to slli + add\n");
+	}
+}
+
+static unsigned long hot_sh2add(unsigned long base, unsigned long index)
+{
+	register unsigned long a0 asm ("a0");
+	register unsigned long a1 asm ("a1") = index;
+	register unsigned long a2 asm ("a2") = base;
+
+	/* sh2add a0, a1, a2 followed by a nop slot for the rewrite */
+	asm volatile (".balign 4\n\t"
+		      ".4byte 0x20c5c533\n\t"
+		      ".4byte 0x00000013\n\t"
+		      : "=r" (a0) : "r" (a1), "r" (a2));
+
+	return a0;
+}
+
+static int emu_hot_setup(void)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_REGISTER,
+			SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE,
+			(unsigned long)emu_hot_sse_entry,
+			(unsigned long)&sse_stack[sizeof(sse_stack)], 0, 0, 0);
+	if (ret.error)
+		return ret.error;
+
+	ret = sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_ENABLE,
+			SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE, 0, 0, 0, 0, 0);
+	if (ret.error)
+		return ret.error;
+
+	ret = sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_HART_UNMASK,
+			0, 0, 0, 0, 0, 0);
+	if (ret.error)
+		return ret.error;
+
+	ret = sbi_ecall(SBI_EXT_FWFT, SBI_EXT_FWFT_SET,
+			SBI_FWFT_ISA_EMU_HOT_THRESHOLD, HOT_THRESHOLD,
+			0, 0, 0, 0);
+
+	return ret.error;
+}
+
+void test_main(unsigned long a0, unsigned long a1)
+{
+	unsigned long i, sum = 0;
+
+	sbi_ecall_console_puts("\nHot emulation site demo running\n");
+
+	if (emu_hot_setup()) {
+		sbi_ecall_console_puts("Hot site reporting not available\n");
+		sbi_ecall_shutdown();
+	}
+
+	for (i = 0; i < HOT_ITERATIONS; i++)
+		sum = hot_sh2add(sum, i);
+
+	puthex("Result: ", sum);
+	puthex(" reports=", reports);
+	puthex(" rewrites=", rewrites);
+	sbi_ecall_console_puts("\n");
+
+	sbi_ecall_shutdown();
+	sbi_ecall_console_puts("sbi_ecall_shutdown failed to execute.\n");
+}
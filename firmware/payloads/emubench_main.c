@@ -0,0 +1,1030 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Emulation benchmark payload
+ *
+ * Times every class of emulated instruction with rdcycle and rdtime,
+ * both from S-mode and, for the cases whose emulation path depends on
+ * the privilege level, from U-mode. The SBI ecall round trip of the
+ * TIME, IPI and RFENCE extensions is timed as well, together with the
+ * base extension and of an unknown extension ID, i.e. of a failing
+ * extension lookup.
+ *
+ * timer.reprogram times sbi_set_timer() with a deadline in the future, as
+ * a tickless kernel calls it on context switches. timer.expiry gives the
+ * time and cycles from a deadline until STIP is pending in S-mode, i.e.
+ * the latency of the M-mode timer interrupt forwarding.
+ *
+ * rfence.range.<granularity>.<count> times a remote SFENCE.VMA of this
+ * HART for a range of count mappings of 4 KiB, or of 2 MiB through the
+ * RFENCE hint extension, i.e. the local flush cost versus range size.
+ *
+ * Each case runs a loop generated at runtime around EMUBENCH_UNROLL
+ * copies of a single instruction encoding. Instructions that trap to
+ * the payload, i.e. are neither implemented nor emulated, make the
+ * case report status=skip instead of a timing. The base.nop case
+ * gives the loop overhead of each mode.
+ *
+ * Results are printed as one line per case:
+ *
+ *   emubench: name=<class>.<insn> mode=<s|u> ops=<n> cycles=<n> time=<n>
+ *
+ * zbb.sext.b and zcb.c.sext.b do the same work, so their difference is the
+ * extra cost of the compressed path, i.e. of fetching the encoding on
+ * HARTs that do not report it in mtval.
+ *
+ * The throughput.aes128 cases encrypt a buffer with the Zkne AES
+ * instructions and with a software implementation, counting bytes as
+ * ops, to show where emulating the instructions pays off.
+ *
+ * cycles is omitted if the cycle counter is not accessible. Use
+ * scripts/emubench-diff.sh to compare the logs of two firmware builds.
+ *
+ * The pointer masking cases need Sv39 and a platform that does not
+ * delegate page faults to S-mode, otherwise they are skipped.
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_string.h>
+
+#ifndef EMUBENCH_ITERS
+#define EMUBENCH_ITERS		1000
+#endif
+#define EMUBENCH_UNROLL		8
+
+/* Integer operands: rd = a5, rs1 = a1, rs2 = a2 */
+#define RD			(15 << 7)
+#define RS1			(11 << 15)
+#define RS2			(12 << 20)
+/* Same registers for the 3-bit fields of the compressed formats */
+#define CRD			(7 << 2)
+#define CRS1			(3 << 7)
+#define CRS2			(4 << 2)
+#define CRDRS1			(7 << 7)
+/* Offset bits of the Zcb loads and stores */
+#define CUIMM0			(1 << 6)
+#define CUIMM1			(1 << 5)
+
+#define INSN_MATCH_AMOADD_W	0x0000202f
+#define INSN_MATCH_AMOADD_D	0x0000302f
+#define INSN_MATCH_AMOSWAP_W	0x0800202f
+#define INSN_MATCH_VSETVLI	0x00007057
+#define INSN_NOP		0x00000013
+#define INSN_ADDI_A0_M1		0xfff50513
+#define INSN_BNEZ_A0		0x00051063
+#define INSN_RET		0x00008067
+
+/* fld fa1, 0(a3) and fld fa2, 8(a3) */
+#define INSN_FLD_FA1		(INSN_MATCH_FLD | (11 << 7) | (13 << 15))
+#define INSN_FLD_FA2		(INSN_MATCH_FLD | (12 << 7) | (13 << 15) | \
+				 (8 << 20))
+
+/* vsetvli a5, zero, e<16|32>, m<lmul>, ta, ma */
+#define VTYPE_E16_TA_MA		0xc8
+#define VTYPE_E32_TA_MA		0xd0
+#define INSN_VSETVLI_E16(lmul)	(INSN_MATCH_VSETVLI | RD | \
+				 ((VTYPE_E16_TA_MA | (lmul)) << 20))
+#define INSN_VSETVLI_E32(lmul)	(INSN_MATCH_VSETVLI | RD | \
+				 ((VTYPE_E32_TA_MA | (lmul)) << 20))
+
+/* Vector operands: vd = v8, vs2 = v16, vs1 = v24, unmasked */
+#define VD			(8 << 7)
+#define VS1			(24 << 15)
+#define VS2			(16 << 20)
+#define VM			(1 << 25)
+
+#define EB_S			(1 << 0)
+#define EB_U			(1 << 1)
+#define EB_RVC			(1 << 2)
+#define EB_BUF			(1 << 3)
+#define EB_FP			(1 << 4)
+#define EB_VEC			(1 << 5)
+#define EB_PM			(1 << 6)
+#define EB_RV64			(1 << 7)
+#define EB_E16			(1 << 8)
+#define EB_SU			(EB_S | EB_U)
+
+struct emubench_case {
+	const char *name;
+	unsigned int insn;
+	unsigned int flags;
+	/* Buffer offset with EB_BUF, value of a1 otherwise */
+	unsigned long arg1;
+	unsigned long arg2;
+	/* LMUL with EB_VEC, PMLEN with EB_PM, FP operand pair with EB_FP */
+	unsigned long arg3;
+};
+
+struct sbiret {
+	unsigned long error;
+	unsigned long value;
+};
+
+struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
+			unsigned long arg1, unsigned long arg2,
+			unsigned long arg3, unsigned long arg4,
+			unsigned long arg5)
+{
+	struct sbiret ret;
+
+	register unsigned long a0 asm ("a0") = (unsigned long)(arg0);
+	register unsigned long a1 asm ("a1") = (unsigned long)(arg1);
+	register unsigned long a2 asm ("a2") = (unsigned long)(arg2);
+	register unsigned long a3 asm ("a3") = (unsigned long)(arg3);
+	register unsigned long a4 asm ("a4") = (unsigned long)(arg4);
+	register unsigned long a5 asm ("a5") = (unsigned long)(arg5);
+	register unsigned long a6 asm ("a6") = (unsigned long)(fid);
+	register unsigned long a7 asm ("a7") = (unsigned long)(ext);
+	asm volatile ("ecall"
+		      : "+r" (a0), "+r" (a1)
+		      : "r" (a2), "r" (a3), "r" (a4), "r" (a5), "r" (a6), "r" (a7)
+		      : "memory");
+	ret.error = a0;
+	ret.value = a1;
+
+	return ret;
+}
+
+static inline void sbi_ecall_console_puts(const char *str)
+{
+	sbi_ecall(SBI_EXT_DBCN, SBI_EXT_DBCN_CONSOLE_WRITE,
+		  sbi_strlen(str), (unsigned long)str, 0, 0, 0, 0);
+}
+
+static inline void sbi_ecall_shutdown(void)
+{
+	sbi_ecall(SBI_EXT_SRST, SBI_EXT_SRST_RESET,
+		  SBI_SRST_RESET_TYPE_SHUTDOWN, SBI_SRST_RESET_REASON_NONE,
+		  0, 0, 0, 0);
+}
+
+typedef unsigned long (*emubench_fn)(unsigned long iters, unsigned long a1,
+				     unsigned long a2, unsigned long a3);
+
+void emubench_trap(void);
+unsigned long emubench_run_umode(emubench_fn fn, unsigned long a0,
+				 unsigned long a1, unsigned long a2,
+				 unsigned long a3);
+
+/* Exceptions taken by emubench_trap(), except for ecalls from U-mode */
+extern volatile unsigned long emubench_traps;
+
+static unsigned short kernel[64] __attribute__((aligned(64)));
+static unsigned char buf[256] __attribute__((aligned(64)));
+static bool have_cycle;
+static unsigned long hartid;
+
+static const unsigned long long fp_half[2] = {
+	0xffffffffffff3e00ULL, 0xffffffffffffc100ULL	/* 1.5, -2.5 */
+};
+static const unsigned long long fp_single[2] = {
+	0xffffffff3fc00000ULL, 0xffffffffc0200000ULL	/* 1.5, -2.5 */
+};
+static const unsigned long long fp_double[2] = {
+	0x3ff8000000000000ULL, 0xc004000000000000ULL	/* 1.5, -2.5 */
+};
+
+#define FPH			((unsigned long)fp_half)
+#define FPS			((unsigned long)fp_single)
+#define FPD			((unsigned long)fp_double)
+
+static const struct emubench_case cases[] = {
+	{ "base.nop", INSN_NOP, EB_SU },
+
+	{ "zba.sh1add", INSN_MATCH_SH1ADD | RD | RS1 | RS2, EB_SU, 3, 5 },
+	{ "zba.add.uw", INSN_MATCH_ADD_UW | RD | RS1 | RS2, EB_S | EB_RV64,
+	  -3UL, 5 },
+
+	{ "zbb.andn", INSN_MATCH_ANDN | RD | RS1 | RS2, EB_S, 0xf0f0, 0xff },
+	{ "zbb.clz", INSN_MATCH_CLZ | RD | RS1, EB_S, 0x1234 },
+	{ "zbb.cpop", INSN_MATCH_CPOP | RD | RS1, EB_S, 0x1234 },
+	{ "zbb.max", INSN_MATCH_MAX | RD | RS1 | RS2, EB_S, -7UL, 3 },
+	{ "zbb.rol", INSN_MATCH_ROL | RD | RS1 | RS2, EB_S, 0x1234, 13 },
+	{ "zbb.orc.b", INSN_MATCH_ORC_B | RD | RS1, EB_S, 0x10203 },
+	{ "zbb.rev8", INSN_MATCH_REV8_RV64 | RD | RS1, EB_S | EB_RV64,
+	  0x1234 },
+	{ "zbb.sext.b", INSN_MATCH_SEXT_B | RD | RS1, EB_SU, 0x80 },
+
+	{ "zbc.clmul", INSN_MATCH_CLMUL | RD | RS1 | RS2, EB_S, 0x1234, 0x87 },
+	{ "zbc.clmulh", INSN_MATCH_CLMULH | RD | RS1 | RS2, EB_S,
+	  -0x1234UL, 0x87 },
+
+	{ "zbs.bset", INSN_MATCH_BSET | RD | RS1 | RS2, EB_S, 0x1234, 17 },
+	{ "zbs.bext", INSN_MATCH_BEXT | RD | RS1 | RS2, EB_S, 0x1234, 4 },
+
+	{ "zicond.czero.eqz", INSN_MATCH_CZERO_EQZ | RD | RS1 | RS2, EB_SU,
+	  0x1234, 1 },
+
+	{ "zcb.c.lbu", INSN_MATCH_C_LBU | CRD | CRS1, EB_SU | EB_RVC | EB_BUF },
+	{ "zcb.c.lh", INSN_MATCH_C_LH | CRD | CRS1 | CUIMM1, EB_SU | EB_RVC |
+	  EB_BUF },
+	{ "zcb.c.sb", INSN_MATCH_C_SB | CRS2 | CRS1 | CUIMM0, EB_S | EB_RVC |
+	  EB_BUF, 0, 0x12 },
+	{ "zcb.c.sext.b", INSN_MATCH_C_SEXT_B | CRDRS1, EB_SU | EB_RVC },
+	{ "zcb.c.sh", INSN_MATCH_C_SH | CRS2 | CRS1, EB_S | EB_RVC | EB_BUF,
+	  0, 0x1234 },
+	{ "zcb.c.zext.b", INSN_MATCH_C_ZEXT_B | CRDRS1, EB_S | EB_RVC },
+	{ "zcb.c.mul", INSN_MATCH_C_MUL | CRDRS1 | CRS2, EB_S | EB_RVC,
+	  0, 3 },
+
+	{ "zfhmin.fcvt.s.h", INSN_MATCH_FCVT_S_H | RD | RS1, EB_S | EB_FP,
+	  0, 0, FPH },
+	{ "zfhmin.fcvt.h.s", INSN_MATCH_FCVT_H_S | RD | RS1, EB_S | EB_FP,
+	  0, 0, FPS },
+	{ "zfhmin.flh", INSN_MATCH_FLH | RD | RS1, EB_SU | EB_BUF },
+	{ "zfhmin.fsh", INSN_MATCH_FSH | RS1 | RS2, EB_SU | EB_BUF | EB_FP,
+	  0, 0, FPH },
+
+	{ "zfa.fli.d", INSN_MATCH_FLI_D | RD | (16 << 15), EB_S },
+	{ "zfa.fround.d", INSN_MATCH_FROUND_D | RD | RS1, EB_S | EB_FP,
+	  0, 0, FPD },
+	{ "zfa.fminm.d", INSN_MATCH_FMINM_D | RD | RS1 | RS2, EB_S | EB_FP,
+	  0, 0, FPD },
+	{ "zfa.fcvtmod.w.d", INSN_MATCH_FCVTMOD_W_D | RD | RS1, EB_S | EB_FP,
+	  0, 0, FPD },
+
+	{ "zvbb.vandn.vv.m1", INSN_MATCH_VANDNVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 0 },
+	{ "zvbb.vandn.vv.m2", INSN_MATCH_VANDNVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 1 },
+	{ "zvbb.vandn.vv.m4", INSN_MATCH_VANDNVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 2 },
+	{ "zvbb.vandn.vv.m8", INSN_MATCH_VANDNVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 3 },
+	{ "zvbb.vbrev.v.m1", INSN_MATCH_VBREVV | VD | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 0 },
+	{ "zvbb.vbrev.v.m2", INSN_MATCH_VBREVV | VD | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 1 },
+	{ "zvbb.vbrev.v.m4", INSN_MATCH_VBREVV | VD | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 2 },
+	{ "zvbb.vbrev.v.m8", INSN_MATCH_VBREVV | VD | VS2 | VM,
+	  EB_S | EB_VEC, 0, 0, 3 },
+
+	{ "zvfh.vfadd.vv.m1", INSN_MATCH_VFADDVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 0 },
+	{ "zvfh.vfadd.vv.m2", INSN_MATCH_VFADDVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 1 },
+	{ "zvfh.vfadd.vv.m4", INSN_MATCH_VFADDVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 2 },
+	{ "zvfh.vfadd.vv.m8", INSN_MATCH_VFADDVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 3 },
+	{ "zvfh.vfmacc.vv.m1", INSN_MATCH_VFMACCVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 0 },
+	{ "zvfh.vfmacc.vv.m8", INSN_MATCH_VFMACCVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 3 },
+	{ "zvfh.vfwadd.vv.m1", INSN_MATCH_VFWADDVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 0 },
+	{ "zvfh.vfwadd.vv.m4", INSN_MATCH_VFWADDVV | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 2 },
+	{ "zvfh.vfredusum.vs.m1",
+	  INSN_MATCH_VFREDUSUMVS | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 0 },
+	{ "zvfh.vfredusum.vs.m8",
+	  INSN_MATCH_VFREDUSUMVS | VD | VS1 | VS2 | VM,
+	  EB_S | EB_VEC | EB_E16, 0, 0, 3 },
+
+	{ "zkne.aes64esm", INSN_MATCH_AES64ESM | RD | RS1 | RS2, EB_S | EB_RV64,
+	  0x01234567, -0x89abcdefUL },
+	{ "zknd.aes64dsm", INSN_MATCH_AES64DSM | RD | RS1 | RS2, EB_S | EB_RV64,
+	  0x01234567, -0x89abcdefUL },
+	{ "zkne.aes32esmi", INSN_MATCH_AES32ESMI | RD | RS1 | RS2, EB_S,
+	  0x01234567, 0x89abcdef },
+	{ "zknd.aes32dsmi", INSN_MATCH_AES32DSMI | RD | RS1 | RS2, EB_S,
+	  0x01234567, 0x89abcdef },
+	{ "zknh.sha256sig0", INSN_MATCH_SHA256SIG0 | RD | RS1, EB_S, 0x1234 },
+	{ "zknh.sha512sum0", INSN_MATCH_SHA512SUM0 | RD | RS1, EB_S | EB_RV64,
+	  0x1234 },
+
+	{ "cbo.zero", INSN_MATCH_CBO_ZERO | RS1, EB_S | EB_BUF },
+	{ "cbo.clean", INSN_MATCH_CBO_CLEAN | RS1, EB_S | EB_BUF },
+	{ "cbo.flush", INSN_MATCH_CBO_FLUSH | RS1, EB_S | EB_BUF },
+	{ "cbo.inval", INSN_MATCH_CBO_INVAL | RS1, EB_S | EB_BUF },
+
+	{ "misaligned.lh", INSN_MATCH_LH | RD | RS1, EB_SU | EB_BUF, 1 },
+	{ "misaligned.lw", INSN_MATCH_LW | RD | RS1, EB_SU | EB_BUF, 1 },
+	{ "misaligned.ld", INSN_MATCH_LD | RD | RS1, EB_SU | EB_BUF | EB_RV64,
+	  1 },
+	{ "misaligned.sh", INSN_MATCH_SH | RS1 | RS2, EB_SU | EB_BUF, 1 },
+	{ "misaligned.sw", INSN_MATCH_SW | RS1 | RS2, EB_SU | EB_BUF, 1 },
+	{ "misaligned.sd", INSN_MATCH_SD | RS1 | RS2, EB_SU | EB_BUF | EB_RV64,
+	  1 },
+
+	{ "amo.amoadd.w", INSN_MATCH_AMOADD_W | RD | RS1 | RS2,
+	  EB_SU | EB_BUF, 0, 1 },
+	{ "amo.amoswap.w", INSN_MATCH_AMOSWAP_W | RD | RS1 | RS2,
+	  EB_SU | EB_BUF, 0, 1 },
+	{ "amo.amoadd.d", INSN_MATCH_AMOADD_D | RD | RS1 | RS2,
+	  EB_SU | EB_BUF | EB_RV64, 0, 1 },
+
+	{ "pm.ld.pmlen7", INSN_MATCH_LD | RD | RS1,
+	  EB_S | EB_BUF | EB_PM | EB_RV64, 0, 0, 7 },
+	{ "pm.sd.pmlen7", INSN_MATCH_SD | RS1 | RS2,
+	  EB_S | EB_BUF | EB_PM | EB_RV64, 0, 0, 7 },
+	{ "pm.ld.pmlen16", INSN_MATCH_LD | RD | RS1,
+	  EB_S | EB_BUF | EB_PM | EB_RV64, 0, 0, 16 },
+	{ "pm.sd.pmlen16", INSN_MATCH_SD | RS1 | RS2,
+	  EB_S | EB_BUF | EB_PM | EB_RV64, 0, 0, 16 },
+};
+
+static char line[160];
+static int line_len;
+
+static void line_str(const char *str)
+{
+	while (*str && line_len < sizeof(line) - 2)
+		line[line_len++] = *str++;
+}
+
+static void line_dec(unsigned long val)
+{
+	char tmp[3 * sizeof(val) + 1];
+	int i = sizeof(tmp) - 1;
+
+	tmp[i] = '\0';
+	do {
+		tmp[--i] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+
+	line_str(&tmp[i]);
+}
+
+static void line_flush(void)
+{
+	line[line_len++] = '\n';
+	line[line_len] = '\0';
+	sbi_ecall_console_puts(line);
+	line_len = 0;
+}
+
+static void report(const char *name, char mode, unsigned long ops,
+		   unsigned long cycles, unsigned long time)
+{
+	char m[2] = { mode, '\0' };
+
+	line_str("emubench: name=");
+	line_str(name);
+	line_str(" mode=");
+	line_str(m);
+	if (!ops) {
+		line_str(" status=skip");
+	} else {
+		line_str(" ops=");
+		line_dec(ops);
+		if (have_cycle) {
+			line_str(" cycles=");
+			line_dec(cycles);
+		}
+		line_str(" time=");
+		line_dec(time);
+	}
+	line_flush();
+}
+
+static void kernel_put16(int *pos, unsigned int insn)
+{
+	kernel[(*pos)++] = insn & 0xffff;
+}
+
+static void kernel_put32(int *pos, unsigned int insn)
+{
+	kernel[(*pos)++] = insn & 0xffff;
+	kernel[(*pos)++] = insn >> 16;
+}
+
+static unsigned int insn_bnez_a0(long off)
+{
+	return INSN_BNEZ_A0 |
+	       (((off >> 12) & 0x1) << 31) | (((off >> 5) & 0x3f) << 25) |
+	       (((off >> 1) & 0xf) << 8) | (((off >> 11) & 0x1) << 7);
+}
+
+/*
+ * Generate "[prologue]; 1: insn x EMUBENCH_UNROLL; addi a0, a0, -1;
+ * bnez a0, 1b; ret" with the prologue loading FP operands or setting
+ * the vector type.
+ */
+static emubench_fn build_kernel(const struct emubench_case *c)
+{
+	int i, loop, pos = 0;
+
+	if (c->flags & EB_FP) {
+		kernel_put32(&pos, INSN_FLD_FA1);
+		kernel_put32(&pos, INSN_FLD_FA2);
+	}
+	if (c->flags & EB_E16)
+		kernel_put32(&pos, INSN_VSETVLI_E16(c->arg3));
+	else if (c->flags & EB_VEC)
+		kernel_put32(&pos, INSN_VSETVLI_E32(c->arg3));
+
+	loop = pos;
+	for (i = 0; i < EMUBENCH_UNROLL; i++) {
+		if (c->flags & EB_RVC)
+			kernel_put16(&pos, c->insn);
+		else
+			kernel_put32(&pos, c->insn);
+	}
+	kernel_put32(&pos, INSN_ADDI_A0_M1);
+	kernel_put32(&pos, insn_bnez_a0(2L * (loop - pos)));
+	kernel_put32(&pos, INSN_RET);
+
+	asm volatile ("fence.i" ::: "memory");
+
+	return (emubench_fn)(unsigned long)kernel;
+}
+
+static unsigned long run_kernel(emubench_fn fn, char mode, unsigned long iters,
+				unsigned long a1, unsigned long a2,
+				unsigned long a3)
+{
+	if (mode == 'u')
+		return emubench_run_umode(fn, iters, a1, a2, a3);
+
+	return fn(iters, a1, a2, a3);
+}
+
+#if __riscv_xlen == 64
+/* Sv39 identity map of the lower 256 GiB with 1 GiB supervisor pages */
+static unsigned long sv39_root[512] __attribute__((aligned(4096)));
+
+static bool enable_sv39(void)
+{
+	unsigned long i, satp;
+
+	for (i = 0; i < 256; i++)
+		sv39_root[i] = ((i << 30) >> 2) | 0xcf;
+
+	satp = (SATP_MODE_SV39 << 60) | ((unsigned long)sv39_root >> 12);
+	csr_write(CSR_SATP, satp);
+	asm volatile ("sfence.vma" ::: "memory");
+
+	return csr_read(CSR_SATP) == satp;
+}
+
+static void disable_sv39(void)
+{
+	csr_write(CSR_SATP, 0);
+	asm volatile ("sfence.vma" ::: "memory");
+}
+
+/* Tag the bits that PMLEN ignores */
+static unsigned long pm_tag(unsigned long ptr, unsigned long pmlen)
+{
+	return ptr | (0x5aUL << (64 - pmlen));
+}
+
+static bool pm_enable(unsigned long pmlen)
+{
+	struct sbiret ret;
+
+	if (!enable_sv39())
+		return false;
+
+	ret = sbi_ecall(SBI_EXT_FWFT, SBI_EXT_FWFT_SET,
+			SBI_FWFT_POINTER_MASKING_PMLEN, pmlen, 0, 0, 0, 0);
+	if (ret.error) {
+		disable_sv39();
+		return false;
+	}
+
+	return true;
+}
+
+static void pm_disable(void)
+{
+	sbi_ecall(SBI_EXT_FWFT, SBI_EXT_FWFT_SET,
+		  SBI_FWFT_POINTER_MASKING_PMLEN, 0, 0, 0, 0, 0);
+	disable_sv39();
+}
+#else
+static bool pm_enable(unsigned long pmlen)
+{
+	return false;
+}
+
+static void pm_disable(void)
+{
+}
+#endif
+
+static void bench_case(const struct emubench_case *c, char mode)
+{
+	unsigned long a1 = c->arg1, a3 = c->arg3, traps;
+	unsigned long cycle0 = 0, cycle1 = 0, time0, time1;
+	emubench_fn fn;
+
+	if ((c->flags & EB_RV64) && __riscv_xlen != 64)
+		goto skip;
+
+	if (c->flags & EB_BUF)
+		a1 += (unsigned long)buf;
+	if (c->flags & EB_PM) {
+		if (!pm_enable(c->arg3))
+			goto skip;
+#if __riscv_xlen == 64
+		a1 = pm_tag(a1, c->arg3);
+#endif
+	}
+
+	fn = build_kernel(c);
+
+	/* Probe with a single iteration, which also warms up the caches */
+	traps = emubench_traps;
+	run_kernel(fn, mode, 1, a1, c->arg2, a3);
+	if (emubench_traps != traps) {
+		if (c->flags & EB_PM)
+			pm_disable();
+		goto skip;
+	}
+
+	if (have_cycle)
+		cycle0 = csr_read(CSR_CYCLE);
+	time0 = csr_read(CSR_TIME);
+	run_kernel(fn, mode, EMUBENCH_ITERS, a1, c->arg2, a3);
+	time1 = csr_read(CSR_TIME);
+	if (have_cycle)
+		cycle1 = csr_read(CSR_CYCLE);
+
+	if (c->flags & EB_PM)
+		pm_disable();
+
+	report(c->name, mode, EMUBENCH_ITERS * EMUBENCH_UNROLL,
+	       cycle1 - cycle0, time1 - time0);
+	return;
+
+skip:
+	report(c->name, mode, 0, 0, 0);
+}
+
+/*
+ * AES-128 throughput over buf in ECB mode, once with the Zkne round
+ * instructions and once with the byte-oriented software implementation
+ * that crypto libraries fall back to without them. ops counts bytes, so
+ * the two costs compare directly.
+ */
+static unsigned char aes_sbox[256];
+static unsigned int aes_rk[44] __attribute__((aligned(8)));
+
+static unsigned char aes_xtime(unsigned char x)
+{
+	return (x << 1) ^ ((x & 0x80) ? 0x1b : 0);
+}
+
+static unsigned char rol8(unsigned char x, int n)
+{
+	return (x << n) | (x >> (8 - n));
+}
+
+static unsigned int aes_subword(unsigned int w)
+{
+	return aes_sbox[w & 0xff] | aes_sbox[(w >> 8) & 0xff] << 8 |
+	       aes_sbox[(w >> 16) & 0xff] << 16 |
+	       (unsigned int)aes_sbox[w >> 24] << 24;
+}
+
+static void aes_init(void)
+{
+	unsigned char p = 1, q = 1, rcon = 1;
+	unsigned int t;
+	int i;
+
+	/* Walk the multiplicative group with generator 3 and its inverse */
+	do {
+		p ^= aes_xtime(p);
+		q ^= q << 1;
+		q ^= q << 2;
+		q ^= q << 4;
+		if (q & 0x80)
+			q ^= 0x09;
+		aes_sbox[p] = q ^ rol8(q, 1) ^ rol8(q, 2) ^ rol8(q, 3) ^
+			      rol8(q, 4) ^ 0x63;
+	} while (p != 1);
+	aes_sbox[0] = 0x63;
+
+	/* Key expansion of the FIPS-197 example key 00 01 .. 0f */
+	for (i = 0; i < 4; i++)
+		aes_rk[i] = 0x03020100 + 0x04040404 * i;
+	for (i = 4; i < array_size(aes_rk); i++) {
+		t = aes_rk[i - 1];
+		if (!(i % 4)) {
+			t = aes_subword((t >> 8) | (t << 24)) ^ rcon;
+			rcon = aes_xtime(rcon);
+		}
+		aes_rk[i] = aes_rk[i - 4] ^ t;
+	}
+}
+
+static void aes_sw_block(unsigned char *s)
+{
+	const unsigned char *rk = (const unsigned char *)aes_rk;
+	unsigned char t[16], a;
+	int r, c, i;
+
+	for (i = 0; i < 16; i++)
+		s[i] ^= rk[i];
+
+	for (r = 1; r <= 10; r++) {
+		/* SubBytes and ShiftRows */
+		for (i = 0; i < 16; i++)
+			t[i] = aes_sbox[s[(i + 4 * (i % 4)) % 16]];
+		/* MixColumns, skipped by the last round */
+		for (c = 0; r < 10 && c < 16; c += 4) {
+			a = t[c] ^ t[c + 1] ^ t[c + 2] ^ t[c + 3];
+			s[c] = t[c] ^ a ^ aes_xtime(t[c] ^ t[c + 1]);
+			s[c + 1] = t[c + 1] ^ a ^ aes_xtime(t[c + 1] ^ t[c + 2]);
+			s[c + 2] = t[c + 2] ^ a ^ aes_xtime(t[c + 2] ^ t[c + 3]);
+			s[c + 3] = t[c + 3] ^ a ^ aes_xtime(t[c + 3] ^ t[c]);
+		}
+		if (r == 10)
+			sbi_memcpy(s, t, 16);
+		for (i = 0; i < 16; i++)
+			s[i] ^= rk[16 * r + i];
+	}
+}
+
+#if __riscv_xlen == 64
+/* aes64es and aes64esm */
+#define AES64(funct7, rd, rs1, rs2)					\
+	asm volatile (".insn r 0x33, 0, " #funct7 ", %0, %1, %2"	\
+		      : "=r" (rd) : "r" (rs1), "r" (rs2))
+
+static void aes_zkn_block(unsigned char *s)
+{
+	const unsigned long *rk = (const unsigned long *)aes_rk;
+	unsigned long *p = (unsigned long *)s;
+	unsigned long lo = p[0] ^ rk[0], hi = p[1] ^ rk[1], t0, t1;
+	int r;
+
+	for (r = 1; r < 10; r++) {
+		AES64(0x1b, t0, lo, hi);
+		AES64(0x1b, t1, hi, lo);
+		lo = t0 ^ rk[2 * r];
+		hi = t1 ^ rk[2 * r + 1];
+	}
+	AES64(0x19, t0, lo, hi);
+	AES64(0x19, t1, hi, lo);
+
+	p[0] = t0 ^ rk[20];
+	p[1] = t1 ^ rk[21];
+}
+#else
+/* aes32esi and aes32esmi, with the byte select in funct7[6:5] */
+#define AES32(funct7, rd, rs2)						\
+	asm volatile (".insn r 0x33, 0, %2, %0, %0, %1"			\
+		      : "+r" (rd) : "r" (rs2), "i" (funct7))
+
+#define AES32_COLUMN(funct7, y, x, c)					\
+	do {								\
+		AES32((funct7), y[c], x[(c) & 3]);			\
+		AES32((funct7) | 0x20, y[c], x[((c) + 1) & 3]);		\
+		AES32((funct7) | 0x40, y[c], x[((c) + 2) & 3]);		\
+		AES32((funct7) | 0x60, y[c], x[((c) + 3) & 3]);		\
+	} while (0)
+
+static void aes_zkn_block(unsigned char *s)
+{
+	unsigned int *p = (unsigned int *)s, x[4], y[4];
+	int r, c;
+
+	for (c = 0; c < 4; c++)
+		x[c] = p[c] ^ aes_rk[c];
+
+	for (r = 1; r <= 10; r++) {
+		for (c = 0; c < 4; c++)
+			y[c] = aes_rk[4 * r + c];
+		if (r < 10) {
+			AES32_COLUMN(0x13, y, x, 0);
+			AES32_COLUMN(0x13, y, x, 1);
+			AES32_COLUMN(0x13, y, x, 2);
+			AES32_COLUMN(0x13, y, x, 3);
+		} else {
+			AES32_COLUMN(0x11, y, x, 0);
+			AES32_COLUMN(0x11, y, x, 1);
+			AES32_COLUMN(0x11, y, x, 2);
+			AES32_COLUMN(0x11, y, x, 3);
+		}
+		sbi_memcpy(x, y, sizeof(x));
+	}
+
+	sbi_memcpy(p, x, sizeof(x));
+}
+#endif
+
+static void aes_encrypt(const char *name, void (*block)(unsigned char *))
+{
+	unsigned long cycle0 = 0, cycle1 = 0, time0, time1, traps;
+	unsigned long i, j;
+
+	traps = emubench_traps;
+	if (have_cycle)
+		cycle0 = csr_read(CSR_CYCLE);
+	time0 = csr_read(CSR_TIME);
+	for (i = 0; i < EMUBENCH_ITERS; i++)
+		for (j = 0; j < sizeof(buf); j += 16)
+			block(&buf[j]);
+	time1 = csr_read(CSR_TIME);
+	if (have_cycle)
+		cycle1 = csr_read(CSR_CYCLE);
+
+	report(name, 's', (emubench_traps == traps) ?
+	       EMUBENCH_ITERS * sizeof(buf) : 0, cycle1 - cycle0,
+	       time1 - time0);
+}
+
+static void bench_aes(void)
+{
+	static const unsigned char expect[16] = {
+		0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+		0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+	};
+	unsigned char block[16];
+	unsigned long traps;
+	int i;
+
+	aes_init();
+
+	/* The FIPS-197 example, which also catches a broken emulation */
+	for (i = 0; i < 16; i++)
+		block[i] = i * 0x11;
+	traps = emubench_traps;
+	aes_zkn_block(block);
+	if (emubench_traps == traps && sbi_memcmp(block, expect, 16)) {
+		line_str("emubench: name=throughput.aes128.zkne mode=s "
+			 "status=mismatch");
+		line_flush();
+	} else {
+		aes_encrypt("throughput.aes128.zkne", aes_zkn_block);
+	}
+
+	aes_encrypt("throughput.aes128.sw", aes_sw_block);
+}
+
+struct emubench_ecall {
+	const char *name;
+	int ext;
+	int fid;
+	/* Arguments, with hart masks targeting this HART only */
+	unsigned long arg0, arg1, arg2, arg3;
+	bool self_mask;
+	/* Time the call even though it returns an error */
+	bool error_ok;
+};
+
+/*
+ * Above the firmware range (0x0A000000 to 0x0AFFFFFF) and not allocated
+ * to any standard, experimental, vendor or firmware extension
+ */
+#define EMUBENCH_EXT_UNKNOWN	0x0b000000
+
+static const struct emubench_ecall ecalls[] = {
+	{ "ecall.base.get_spec_version", SBI_EXT_BASE,
+	  SBI_EXT_BASE_GET_SPEC_VERSION },
+	{ "ecall.base.probe_extension", SBI_EXT_BASE,
+	  SBI_EXT_BASE_PROBE_EXT, SBI_EXT_RFENCE },
+	{ "ecall.unknown", EMUBENCH_EXT_UNKNOWN, 0, 0, 0, 0, 0, false,
+	  true },
+	{ "ecall.time.set_timer", SBI_EXT_TIME, SBI_EXT_TIME_SET_TIMER,
+	  -1UL },
+	{ "ecall.ipi.send_ipi", SBI_EXT_IPI, SBI_EXT_IPI_SEND_IPI,
+	  1, 0, 0, 0, true },
+	{ "ecall.rfence.remote_fence_i", SBI_EXT_RFENCE,
+	  SBI_EXT_RFENCE_REMOTE_FENCE_I, 1, 0, 0, 0, true },
+	{ "ecall.rfence.remote_sfence_vma", SBI_EXT_RFENCE,
+	  SBI_EXT_RFENCE_REMOTE_SFENCE_VMA, 1, 0, 0, 4096, true },
+};
+
+static void bench_ecall(const struct emubench_ecall *e)
+{
+	unsigned long i, arg1 = e->self_mask ? hartid : e->arg1;
+	unsigned long cycle0 = 0, cycle1 = 0, time0, time1;
+	struct sbiret ret;
+
+	ret = sbi_ecall(e->ext, e->fid, e->arg0, arg1, e->arg2, e->arg3, 0, 0);
+	csr_clear(CSR_SIP, SIP_SSIP);
+	if (ret.error && !e->error_ok) {
+		report(e->name, 's', 0, 0, 0);
+		return;
+	}
+
+	if (have_cycle)
+		cycle0 = csr_read(CSR_CYCLE);
+	time0 = csr_read(CSR_TIME);
+	for (i = 0; i < EMUBENCH_ITERS; i++)
+		sbi_ecall(e->ext, e->fid, e->arg0, arg1, e->arg2, e->arg3,
+			  0, 0);
+	time1 = csr_read(CSR_TIME);
+	if (have_cycle)
+		cycle1 = csr_read(CSR_CYCLE);
+
+	/* The self-IPIs leave SSIP pending */
+	csr_clear(CSR_SIP, SIP_SSIP);
+
+	report(e->name, 's', EMUBENCH_ITERS, cycle1 - cycle0, time1 - time0);
+}
+
+/* Deadline of the timer.expiry cases, far enough to return from the ecall */
+#define EMUBENCH_TIMER_DELTA	1000
+#define EMUBENCH_TIMER_TIMEOUT	(100 * EMUBENCH_TIMER_DELTA)
+#define EMUBENCH_TIMER_ITERS	100
+
+static unsigned long long timer_now(void)
+{
+#if __riscv_xlen == 32
+	unsigned long hi, lo;
+
+	do {
+		hi = csr_read(CSR_TIMEH);
+		lo = csr_read(CSR_TIME);
+	} while (hi != csr_read(CSR_TIMEH));
+
+	return ((unsigned long long)hi << 32) | lo;
+#else
+	return csr_read(CSR_TIME);
+#endif
+}
+
+static struct sbiret timer_set(unsigned long long next)
+{
+#if __riscv_xlen == 32
+	return sbi_ecall(SBI_EXT_TIME, SBI_EXT_TIME_SET_TIMER, next,
+			 next >> 32, 0, 0, 0, 0);
+#else
+	return sbi_ecall(SBI_EXT_TIME, SBI_EXT_TIME_SET_TIMER, next, 0, 0, 0,
+			 0, 0);
+#endif
+}
+
+/* Wait for STIP after the deadline, return false on a timeout */
+static bool timer_wait(unsigned long long deadline, unsigned long *cycles,
+		       unsigned long *time)
+{
+	unsigned long cycle0 = 0;
+	long long late;
+	bool due = false;
+
+	while (!(csr_read(CSR_SIP) & SIP_STIP)) {
+		late = timer_now() - deadline;
+		if (late > EMUBENCH_TIMER_TIMEOUT)
+			return false;
+		if (late >= 0 && !due) {
+			due = true;
+			if (have_cycle)
+				cycle0 = csr_read(CSR_CYCLE);
+		}
+	}
+
+	if (due && have_cycle)
+		*cycles += csr_read(CSR_CYCLE) - cycle0;
+	late = timer_now() - deadline;
+	*time += late > 0 ? late : 0;
+
+	return true;
+}
+
+static void bench_timer(void)
+{
+	unsigned long i, cycle0 = 0, cycle1 = 0, time0, time1;
+	unsigned long cycles = 0, time = 0;
+	unsigned long long deadline;
+
+	if (timer_set(-1ULL).error) {
+		report("timer.reprogram", 's', 0, 0, 0);
+		report("timer.expiry", 's', 0, 0, 0);
+		return;
+	}
+
+	if (have_cycle)
+		cycle0 = csr_read(CSR_CYCLE);
+	time0 = csr_read(CSR_TIME);
+	for (i = 0; i < EMUBENCH_ITERS; i++)
+		timer_set(timer_now() + EMUBENCH_TIMER_TIMEOUT);
+	time1 = csr_read(CSR_TIME);
+	if (have_cycle)
+		cycle1 = csr_read(CSR_CYCLE);
+	report("timer.reprogram", 's', EMUBENCH_ITERS, cycle1 - cycle0,
+	       time1 - time0);
+
+	/* STIP is only polled, S-mode interrupts stay disabled */
+	for (i = 0; i < EMUBENCH_TIMER_ITERS; i++) {
+		deadline = timer_now() + EMUBENCH_TIMER_DELTA;
+		timer_set(deadline);
+		if (!timer_wait(deadline, &cycles, &time))
+			break;
+	}
+	timer_set(-1ULL);
+
+	report("timer.expiry", 's', i < EMUBENCH_TIMER_ITERS ? 0 : i, cycles,
+	       time);
+}
+
+struct emubench_rfence {
+	const char *name;
+	unsigned long count;
+	unsigned long stride;
+};
+
+#define EMUBENCH_RFENCE_VA	0x40000000UL
+#define EMUBENCH_4K		0x1000UL
+#define EMUBENCH_2M		0x200000UL
+
+static const struct emubench_rfence rfences[] = {
+	{ "rfence.range.4k.1", 1, EMUBENCH_4K },
+	{ "rfence.range.4k.4", 4, EMUBENCH_4K },
+	{ "rfence.range.4k.16", 16, EMUBENCH_4K },
+	{ "rfence.range.4k.64", 64, EMUBENCH_4K },
+	{ "rfence.range.4k.256", 256, EMUBENCH_4K },
+	{ "rfence.range.2m.1", 1, EMUBENCH_2M },
+	{ "rfence.range.2m.4", 4, EMUBENCH_2M },
+	{ "rfence.range.2m.16", 16, EMUBENCH_2M },
+	{ "rfence.range.2m.64", 64, EMUBENCH_2M },
+};
+
+static struct sbiret rfence_range(const struct emubench_rfence *r)
+{
+	unsigned long size = r->count * r->stride;
+
+	/* 4 KiB mappings need no hint */
+	if (r->stride == EMUBENCH_4K)
+		return sbi_ecall(SBI_EXT_RFENCE,
+				 SBI_EXT_RFENCE_REMOTE_SFENCE_VMA, 1, hartid,
+				 EMUBENCH_RFENCE_VA, size, 0, 0);
+
+	return sbi_ecall(SBI_EXT_RFENCE_HINT,
+			 SBI_EXT_RFENCE_HINT_REMOTE_SFENCE_VMA, 1, hartid,
+			 EMUBENCH_RFENCE_VA, size, r->stride, 0);
+}
+
+static void bench_rfence(const struct emubench_rfence *r)
+{
+	unsigned long i, cycle0 = 0, cycle1 = 0, time0, time1;
+
+	if (rfence_range(r).error) {
+		report(r->name, 's', 0, 0, 0);
+		return;
+	}
+
+	if (have_cycle)
+		cycle0 = csr_read(CSR_CYCLE);
+	time0 = csr_read(CSR_TIME);
+	for (i = 0; i < EMUBENCH_ITERS; i++)
+		rfence_range(r);
+	time1 = csr_read(CSR_TIME);
+	if (have_cycle)
+		cycle1 = csr_read(CSR_CYCLE);
+
+	report(r->name, 's', EMUBENCH_ITERS, cycle1 - cycle0, time1 - time0);
+}
+
+void test_main(unsigned long a0, unsigned long a1)
+{
+	unsigned long traps;
+	int i;
+
+	hartid = a0;
+	csr_write(CSR_STVEC, (unsigned long)emubench_trap);
+	csr_set(CSR_SSTATUS, SSTATUS_FS | SSTATUS_VS);
+
+	traps = emubench_traps;
+	csr_read(CSR_CYCLE);
+	have_cycle = emubench_traps == traps;
+
+	line_str("emubench: begin version=1 xlen=");
+	line_dec(__riscv_xlen);
+	line_str(" iters=");
+	line_dec(EMUBENCH_ITERS);
+	line_str(" unroll=");
+	line_dec(EMUBENCH_UNROLL);
+	line_flush();
+
+	for (i = 0; i < array_size(cases); i++) {
+		if (cases[i].flags & EB_S)
+			bench_case(&cases[i], 's');
+		if (cases[i].flags & EB_U)
+			bench_case(&cases[i], 'u');
+	}
+
+	bench_aes();
+
+	for (i = 0; i < array_size(ecalls); i++)
+		bench_ecall(&ecalls[i]);
+
+	bench_timer();
+
+	for (i = 0; i < array_size(rfences); i++)
+		bench_rfence(&rfences[i]);
+
+	line_str("emubench: end");
+	line_flush();
+
+	sbi_ecall_shutdown();
+	sbi_ecall_console_puts("sbi_ecall_shutdown failed to execute.\n");
+}
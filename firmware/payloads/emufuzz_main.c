@@ -0,0 +1,1166 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Differential fuzzing payload for the instruction emulators
+ *
+ * Every case generates a random stream of Zba, Zbb, Zbc, Zbs, Zicond,
+ * Zcb, Zfa, Zfh and Zvbb instructions with random register, FP and
+ * vector state, runs it and prints a hash of the resulting state:
+ *
+ *   emufuzz: case=<n> hash=<hex> traps=<n>
+ *
+ * The stream and state of a case only depend on the seed and the case
+ * number, so running the payload once on a QEMU CPU that implements
+ * the extensions and once on a CPU without them, where OpenSBI
+ * emulates them, must give the same hashes. The dump option prints
+ * the instructions and the full input and output state of one case
+ * to narrow down a divergence. Afterwards every instruction is timed
+ * in a loop, which gives the emulation slowdown per instruction:
+ *
+ *   emufuzz: insn=<ext>.<insn> ops=<n> time=<n>
+ *
+ * The options are read from the QEMU fw_cfg file opt/org.opensbi.emufuzz
+ * as "seed=<n> cases=<n> len=<n> dump=<n> bench=<0|1>". The defaults
+ * are used on platforms without fw_cfg. Use scripts/emufuzz.sh to run
+ * both configurations and compare them.
+ *
+ * Memory accessing instructions (cbo.*, the Zcb loads and stores,
+ * flh and fsh) are not generated.
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_string.h>
+
+#ifndef EMUFUZZ_FW_CFG_BASE
+#define EMUFUZZ_FW_CFG_BASE	0x10100000UL
+#endif
+#define EMUFUZZ_FW_CFG_FILE	"opt/org.opensbi.emufuzz"
+
+#ifndef EMUFUZZ_ITERS
+#define EMUFUZZ_ITERS		1000
+#endif
+#define EMUFUZZ_UNROLL		8
+#define EMUFUZZ_MAX_LEN		16
+
+/* Bytes of state per vector register, larger VLEN disables vectors */
+#define EMUFUZZ_VLENB_MAX	32
+
+#define FW_CFG_SIGNATURE	0x0000
+#define FW_CFG_FILE_DIR		0x0019
+
+#define REG_A0			10
+#define REG_A1			11
+#define REG_T0			5
+#define REG_T1			6
+
+#if __riscv_xlen == 64
+#define INSN_MATCH_LOAD_X	INSN_MATCH_LD
+#define INSN_MATCH_STORE_X	INSN_MATCH_SD
+#else
+#define INSN_MATCH_LOAD_X	INSN_MATCH_LW
+#define INSN_MATCH_STORE_X	INSN_MATCH_SW
+#endif
+#define INSN_MATCH_ADDI		0x00000013
+#define INSN_MATCH_CSRRW	0x00001073
+#define INSN_MATCH_CSRRS	0x00002073
+#define INSN_MATCH_VSETVL	0x80007057
+#define INSN_FMV_D_X_FT0	0xf2000053
+#define INSN_BNEZ_A1		0x00059063
+#define INSN_RET		0x00008067
+
+/* Integer operands, a0 and a1 are reserved for the generated code */
+static const unsigned char xpool[] = {
+	0, 5, 6, 7, 12, 13, 14, 15, 16, 17, 28, 29, 30, 31
+};
+
+/* Registers of the 3-bit compressed fields that are in xpool */
+static const unsigned char cpool[] = { 4, 5, 6, 7 };
+
+/* Vector operands, v0 is only used as mask */
+#define VPOOL_FIRST		8
+#define VPOOL_COUNT		8
+#define VSTATE_COUNT		(1 + VPOOL_COUNT)
+
+enum emufuzz_kind {
+	K_R3,		/* rd, rs1, rs2 */
+	K_R2,		/* rd, rs1 */
+	K_SHAMT,	/* rd, rs1, shamt < XLEN */
+	K_SHAMTW,	/* rd, rs1, shamt < 32 */
+	K_C1,		/* rd'/rs1' */
+	K_C2,		/* rd'/rs1', rs2' */
+	K_F2RM,		/* fd, fs1, rm */
+	K_F3,		/* fd, fs1, fs2 */
+	K_XF2,		/* rd, fs1, fs2 */
+	K_XF1,		/* rd, fs1 */
+	K_FX1,		/* fd, rs1 */
+	K_FLI,		/* fd, imm */
+	K_V1,		/* vd, vs2, vm */
+	K_VVV,		/* vd, vs2, vs1, vm */
+	K_VVX,		/* vd, vs2, rs1, vm */
+	K_VVI,		/* vd, vs2, uimm, vm */
+	K_VVF,		/* vd, vs2, fs1, vm */
+};
+
+#define EF_RV64			(1 << 0)
+#define EF_RV32			(1 << 1)
+#define EF_RVC			(1 << 2)
+#define EF_FP			(1 << 3)
+#define EF_VEC			(1 << 4)
+/* Widening vector instruction, needs SEW < 64 and aligned groups */
+#define EF_WIDE			(1 << 5)
+/* Six bit vector immediate */
+#define EF_UIMM6		(1 << 6)
+
+struct emufuzz_insn {
+	const char *name;
+	unsigned int match;
+	unsigned char kind;
+	unsigned char flags;
+};
+
+static const struct emufuzz_insn insns[] = {
+	{ "zba.add.uw", INSN_MATCH_ADD_UW, K_R3, EF_RV64 },
+	{ "zba.sh1add", INSN_MATCH_SH1ADD, K_R3, 0 },
+	{ "zba.sh2add", INSN_MATCH_SH2ADD, K_R3, 0 },
+	{ "zba.sh3add", INSN_MATCH_SH3ADD, K_R3, 0 },
+	{ "zba.sh1add.uw", INSN_MATCH_SH1ADD_UW, K_R3, EF_RV64 },
+	{ "zba.sh2add.uw", INSN_MATCH_SH2ADD_UW, K_R3, EF_RV64 },
+	{ "zba.sh3add.uw", INSN_MATCH_SH3ADD_UW, K_R3, EF_RV64 },
+	{ "zba.slli.uw", INSN_MATCH_SLLI_UW, K_SHAMT, EF_RV64 },
+	{ "zbb.andn", INSN_MATCH_ANDN, K_R3, 0 },
+	{ "zbb.orn", INSN_MATCH_ORN, K_R3, 0 },
+	{ "zbb.xnor", INSN_MATCH_XNOR, K_R3, 0 },
+	{ "zbb.clz", INSN_MATCH_CLZ, K_R2, 0 },
+	{ "zbb.ctz", INSN_MATCH_CTZ, K_R2, 0 },
+	{ "zbb.cpop", INSN_MATCH_CPOP, K_R2, 0 },
+	{ "zbb.clzw", INSN_MATCH_CLZW, K_R2, EF_RV64 },
+	{ "zbb.ctzw", INSN_MATCH_CTZW, K_R2, EF_RV64 },
+	{ "zbb.cpopw", INSN_MATCH_CPOPW, K_R2, EF_RV64 },
+	{ "zbb.max", INSN_MATCH_MAX, K_R3, 0 },
+	{ "zbb.maxu", INSN_MATCH_MAXU, K_R3, 0 },
+	{ "zbb.min", INSN_MATCH_MIN, K_R3, 0 },
+	{ "zbb.minu", INSN_MATCH_MINU, K_R3, 0 },
+	{ "zbb.sext.b", INSN_MATCH_SEXT_B, K_R2, 0 },
+	{ "zbb.sext.h", INSN_MATCH_SEXT_H, K_R2, 0 },
+	{ "zbb.zext.h", INSN_MATCH_ZEXT_H_RV32, K_R2, EF_RV32 },
+	{ "zbb.zext.h", INSN_MATCH_ZEXT_H_RV64, K_R2, EF_RV64 },
+	{ "zbb.rol", INSN_MATCH_ROL, K_R3, 0 },
+	{ "zbb.ror", INSN_MATCH_ROR, K_R3, 0 },
+	{ "zbb.rori", INSN_MATCH_RORI, K_SHAMT, 0 },
+	{ "zbb.rolw", INSN_MATCH_ROLW, K_R3, EF_RV64 },
+	{ "zbb.rorw", INSN_MATCH_RORW, K_R3, EF_RV64 },
+	{ "zbb.roriw", INSN_MATCH_RORIW, K_SHAMTW, EF_RV64 },
+	{ "zbb.orc.b", INSN_MATCH_ORC_B, K_R2, 0 },
+	{ "zbb.rev8", INSN_MATCH_REV8_RV32, K_R2, EF_RV32 },
+	{ "zbb.rev8", INSN_MATCH_REV8_RV64, K_R2, EF_RV64 },
+	{ "zbc.clmul", INSN_MATCH_CLMUL, K_R3, 0 },
+	{ "zbc.clmulh", INSN_MATCH_CLMULH, K_R3, 0 },
+	{ "zbc.clmulr", INSN_MATCH_CLMULR, K_R3, 0 },
+	{ "zbs.bclr", INSN_MATCH_BCLR, K_R3, 0 },
+	{ "zbs.bclri", INSN_MATCH_BCLRI, K_SHAMT, 0 },
+	{ "zbs.bext", INSN_MATCH_BEXT, K_R3, 0 },
+	{ "zbs.bexti", INSN_MATCH_BEXTI, K_SHAMT, 0 },
+	{ "zbs.binv", INSN_MATCH_BINV, K_R3, 0 },
+	{ "zbs.binvi", INSN_MATCH_BINVI, K_SHAMT, 0 },
+	{ "zbs.bset", INSN_MATCH_BSET, K_R3, 0 },
+	{ "zbs.bseti", INSN_MATCH_BSETI, K_SHAMT, 0 },
+	{ "zicond.czero.eqz", INSN_MATCH_CZERO_EQZ, K_R3, 0 },
+	{ "zicond.czero.nez", INSN_MATCH_CZERO_NEZ, K_R3, 0 },
+	{ "zknd.aes64ds", INSN_MATCH_AES64DS, K_R3, EF_RV64 },
+	{ "zknd.aes64dsm", INSN_MATCH_AES64DSM, K_R3, EF_RV64 },
+	{ "zknd.aes64im", INSN_MATCH_AES64IM, K_R2, EF_RV64 },
+	{ "zknd.aes32dsi", INSN_MATCH_AES32DSI | (1 << 30), K_R3, EF_RV32 },
+	{ "zknd.aes32dsmi", INSN_MATCH_AES32DSMI | (3U << 30), K_R3, EF_RV32 },
+	{ "zkne.aes64es", INSN_MATCH_AES64ES, K_R3, EF_RV64 },
+	{ "zkne.aes64esm", INSN_MATCH_AES64ESM, K_R3, EF_RV64 },
+	{ "zkne.aes64ks1i", INSN_MATCH_AES64KS1I | (3 << 20), K_R2, EF_RV64 },
+	{ "zkne.aes64ks2", INSN_MATCH_AES64KS2, K_R3, EF_RV64 },
+	{ "zkne.aes32esi", INSN_MATCH_AES32ESI | (2 << 30), K_R3, EF_RV32 },
+	{ "zkne.aes32esmi", INSN_MATCH_AES32ESMI, K_R3, EF_RV32 },
+	{ "zknh.sha256sig0", INSN_MATCH_SHA256SIG0, K_R2, 0 },
+	{ "zknh.sha256sig1", INSN_MATCH_SHA256SIG1, K_R2, 0 },
+	{ "zknh.sha256sum0", INSN_MATCH_SHA256SUM0, K_R2, 0 },
+	{ "zknh.sha256sum1", INSN_MATCH_SHA256SUM1, K_R2, 0 },
+	{ "zknh.sha512sig0", INSN_MATCH_SHA512SIG0, K_R2, EF_RV64 },
+	{ "zknh.sha512sig1", INSN_MATCH_SHA512SIG1, K_R2, EF_RV64 },
+	{ "zknh.sha512sum0", INSN_MATCH_SHA512SUM0, K_R2, EF_RV64 },
+	{ "zknh.sha512sum1", INSN_MATCH_SHA512SUM1, K_R2, EF_RV64 },
+	{ "zknh.sha512sig0h", INSN_MATCH_SHA512SIG0H, K_R3, EF_RV32 },
+	{ "zknh.sha512sig0l", INSN_MATCH_SHA512SIG0L, K_R3, EF_RV32 },
+	{ "zknh.sha512sig1h", INSN_MATCH_SHA512SIG1H, K_R3, EF_RV32 },
+	{ "zknh.sha512sig1l", INSN_MATCH_SHA512SIG1L, K_R3, EF_RV32 },
+	{ "zknh.sha512sum0r", INSN_MATCH_SHA512SUM0R, K_R3, EF_RV32 },
+	{ "zknh.sha512sum1r", INSN_MATCH_SHA512SUM1R, K_R3, EF_RV32 },
+	{ "zcb.c.zext.b", INSN_MATCH_C_ZEXT_B, K_C1, EF_RVC },
+	{ "zcb.c.zext.h", INSN_MATCH_C_ZEXT_H, K_C1, EF_RVC },
+	{ "zcb.c.zext.w", INSN_MATCH_C_ZEXT_W, K_C1, EF_RVC | EF_RV64 },
+	{ "zcb.c.sext.b", INSN_MATCH_C_SEXT_B, K_C1, EF_RVC },
+	{ "zcb.c.sext.h", INSN_MATCH_C_SEXT_H, K_C1, EF_RVC },
+	{ "zcb.c.not", INSN_MATCH_C_NOT, K_C1, EF_RVC },
+	{ "zcb.c.mul", INSN_MATCH_C_MUL, K_C2, EF_RVC },
+	{ "zfa.fli.s", INSN_MATCH_FLI_S, K_FLI, EF_FP },
+	{ "zfa.fli.d", INSN_MATCH_FLI_D, K_FLI, EF_FP },
+	{ "zfa.fli.h", INSN_MATCH_FLI_H, K_FLI, EF_FP },
+	{ "zfa.fminm.s", INSN_MATCH_FMINM_S, K_F3, EF_FP },
+	{ "zfa.fminm.d", INSN_MATCH_FMINM_D, K_F3, EF_FP },
+	{ "zfa.fminm.h", INSN_MATCH_FMINM_H, K_F3, EF_FP },
+	{ "zfa.fmaxm.s", INSN_MATCH_FMAXM_S, K_F3, EF_FP },
+	{ "zfa.fmaxm.d", INSN_MATCH_FMAXM_D, K_F3, EF_FP },
+	{ "zfa.fmaxm.h", INSN_MATCH_FMAXM_H, K_F3, EF_FP },
+	{ "zfa.fround.s", INSN_MATCH_FROUND_S, K_F2RM, EF_FP },
+	{ "zfa.fround.d", INSN_MATCH_FROUND_D, K_F2RM, EF_FP },
+	{ "zfa.fround.h", INSN_MATCH_FROUND_H, K_F2RM, EF_FP },
+	{ "zfa.froundnx.s", INSN_MATCH_FROUNDNX_S, K_F2RM, EF_FP },
+	{ "zfa.froundnx.d", INSN_MATCH_FROUNDNX_D, K_F2RM, EF_FP },
+	{ "zfa.froundnx.h", INSN_MATCH_FROUNDNX_H, K_F2RM, EF_FP },
+	{ "zfa.fcvtmod.w.d", INSN_MATCH_FCVTMOD_W_D, K_XF1, EF_FP },
+	{ "zfa.fleq.s", INSN_MATCH_FLEQ_S, K_XF2, EF_FP },
+	{ "zfa.fleq.d", INSN_MATCH_FLEQ_D, K_XF2, EF_FP },
+	{ "zfa.fleq.h", INSN_MATCH_FLEQ_H, K_XF2, EF_FP },
+	{ "zfa.fltq.s", INSN_MATCH_FLTQ_S, K_XF2, EF_FP },
+	{ "zfa.fltq.d", INSN_MATCH_FLTQ_D, K_XF2, EF_FP },
+	{ "zfa.fltq.h", INSN_MATCH_FLTQ_H, K_XF2, EF_FP },
+	{ "zfh.fcvt.s.h", INSN_MATCH_FCVT_S_H, K_F2RM, EF_FP },
+	{ "zfh.fcvt.h.s", INSN_MATCH_FCVT_H_S, K_F2RM, EF_FP },
+	{ "zfh.fcvt.d.h", INSN_MATCH_FCVT_D_H, K_F2RM, EF_FP },
+	{ "zfh.fcvt.h.d", INSN_MATCH_FCVT_H_D, K_F2RM, EF_FP },
+	{ "zfh.fmv.x.h", INSN_MATCH_FMV_X_H, K_XF1, EF_FP },
+	{ "zfh.fmv.h.x", INSN_MATCH_FMV_H_X, K_FX1, EF_FP },
+	{ "zvbb.vandn.vv", INSN_MATCH_VANDNVV, K_VVV, EF_VEC },
+	{ "zvbb.vandn.vx", INSN_MATCH_VANDNVX, K_VVX, EF_VEC },
+	{ "zvbb.vbrev.v", INSN_MATCH_VBREVV, K_V1, EF_VEC },
+	{ "zvbb.vbrev8.v", INSN_MATCH_VBREV8V, K_V1, EF_VEC },
+	{ "zvbb.vrev8.v", INSN_MATCH_VREV8V, K_V1, EF_VEC },
+	{ "zvbb.vclz.v", INSN_MATCH_VCLZV, K_V1, EF_VEC },
+	{ "zvbb.vctz.v", INSN_MATCH_VCTZV, K_V1, EF_VEC },
+	{ "zvbb.vcpop.v", INSN_MATCH_VCPOPV, K_V1, EF_VEC },
+	{ "zvbb.vrol.vv", INSN_MATCH_VROLVV, K_VVV, EF_VEC },
+	{ "zvbb.vrol.vx", INSN_MATCH_VROLVX, K_VVX, EF_VEC },
+	{ "zvbb.vror.vv", INSN_MATCH_VRORVV, K_VVV, EF_VEC },
+	{ "zvbb.vror.vx", INSN_MATCH_VRORVX, K_VVX, EF_VEC },
+	{ "zvbb.vror.vi", INSN_MATCH_VRORVI, K_VVI, EF_VEC | EF_UIMM6 },
+	{ "zvbb.vwsll.vv", INSN_MATCH_VWSLLVV, K_VVV, EF_VEC | EF_WIDE },
+	{ "zvbb.vwsll.vx", INSN_MATCH_VWSLLVX, K_VVX, EF_VEC | EF_WIDE },
+	{ "zvbb.vwsll.vi", INSN_MATCH_VWSLLVI, K_VVI, EF_VEC | EF_WIDE },
+	{ "zvfh.vfadd.vv", INSN_MATCH_VFADDVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfadd.vf", INSN_MATCH_VFADDVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfsub.vv", INSN_MATCH_VFSUBVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfsub.vf", INSN_MATCH_VFSUBVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfrsub.vf", INSN_MATCH_VFRSUBVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfmul.vv", INSN_MATCH_VFMULVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfmul.vf", INSN_MATCH_VFMULVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfdiv.vv", INSN_MATCH_VFDIVVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfdiv.vf", INSN_MATCH_VFDIVVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfrdiv.vf", INSN_MATCH_VFRDIVVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfmin.vv", INSN_MATCH_VFMINVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfmin.vf", INSN_MATCH_VFMINVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfmax.vv", INSN_MATCH_VFMAXVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfmax.vf", INSN_MATCH_VFMAXVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfsgnj.vv", INSN_MATCH_VFSGNJVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfsgnj.vf", INSN_MATCH_VFSGNJVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfsgnjn.vv", INSN_MATCH_VFSGNJNVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfsgnjn.vf", INSN_MATCH_VFSGNJNVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfsgnjx.vv", INSN_MATCH_VFSGNJXVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfsgnjx.vf", INSN_MATCH_VFSGNJXVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfsqrt.v", INSN_MATCH_VFSQRTV, K_V1, EF_VEC | EF_FP },
+	{ "zvfh.vfclass.v", INSN_MATCH_VFCLASSV, K_V1, EF_VEC | EF_FP },
+	{ "zvfh.vfslide1down.vf", INSN_MATCH_VFSLIDE1DOWNVF,
+	  K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfmacc.vv", INSN_MATCH_VFMACCVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfmacc.vf", INSN_MATCH_VFMACCVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfnmacc.vv", INSN_MATCH_VFNMACCVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfnmacc.vf", INSN_MATCH_VFNMACCVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfmsac.vv", INSN_MATCH_VFMSACVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfmsac.vf", INSN_MATCH_VFMSACVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfnmsac.vv", INSN_MATCH_VFNMSACVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfnmsac.vf", INSN_MATCH_VFNMSACVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfmadd.vv", INSN_MATCH_VFMADDVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfmadd.vf", INSN_MATCH_VFMADDVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfnmadd.vv", INSN_MATCH_VFNMADDVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfnmadd.vf", INSN_MATCH_VFNMADDVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfmsub.vv", INSN_MATCH_VFMSUBVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfmsub.vf", INSN_MATCH_VFMSUBVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfnmsub.vv", INSN_MATCH_VFNMSUBVV, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfnmsub.vf", INSN_MATCH_VFNMSUBVF, K_VVF, EF_VEC | EF_FP },
+	{ "zvfh.vfwadd.vv", INSN_MATCH_VFWADDVV,
+	  K_VVV, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwadd.vf", INSN_MATCH_VFWADDVF,
+	  K_VVF, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwsub.vv", INSN_MATCH_VFWSUBVV,
+	  K_VVV, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwsub.vf", INSN_MATCH_VFWSUBVF,
+	  K_VVF, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwmul.vv", INSN_MATCH_VFWMULVV,
+	  K_VVV, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwmul.vf", INSN_MATCH_VFWMULVF,
+	  K_VVF, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwmacc.vv", INSN_MATCH_VFWMACCVV,
+	  K_VVV, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwmacc.vf", INSN_MATCH_VFWMACCVF,
+	  K_VVF, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwnmacc.vv", INSN_MATCH_VFWNMACCVV,
+	  K_VVV, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwnmacc.vf", INSN_MATCH_VFWNMACCVF,
+	  K_VVF, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwmsac.vv", INSN_MATCH_VFWMSACVV,
+	  K_VVV, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwmsac.vf", INSN_MATCH_VFWMSACVF,
+	  K_VVF, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwnmsac.vv", INSN_MATCH_VFWNMSACVV,
+	  K_VVV, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfwnmsac.vf", INSN_MATCH_VFWNMSACVF,
+	  K_VVF, EF_VEC | EF_FP | EF_WIDE },
+	{ "zvfh.vfredusum.vs", INSN_MATCH_VFREDUSUMVS, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfredosum.vs", INSN_MATCH_VFREDOSUMVS, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfredmin.vs", INSN_MATCH_VFREDMINVS, K_VVV, EF_VEC | EF_FP },
+	{ "zvfh.vfredmax.vs", INSN_MATCH_VFREDMAXVS, K_VVV, EF_VEC | EF_FP },
+};
+
+/* Register state loaded before and stored after the generated code */
+struct emufuzz_state {
+	unsigned long x[32];
+	unsigned long long f[32];
+	unsigned long fcsr;
+	unsigned long vl;
+	unsigned long vtype;
+	unsigned long iters;
+	unsigned char v[VSTATE_COUNT][EMUFUZZ_VLENB_MAX];
+};
+
+struct emufuzz_opts {
+	unsigned long seed;
+	unsigned long cases;
+	unsigned long len;
+	unsigned long dump;
+	bool do_dump;
+	bool bench;
+};
+
+struct sbiret {
+	unsigned long error;
+	unsigned long value;
+};
+
+struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
+			unsigned long arg1, unsigned long arg2,
+			unsigned long arg3, unsigned long arg4,
+			unsigned long arg5)
+{
+	struct sbiret ret;
+
+	register unsigned long a0 asm ("a0") = (unsigned long)(arg0);
+	register unsigned long a1 asm ("a1") = (unsigned long)(arg1);
+	register unsigned long a2 asm ("a2") = (unsigned long)(arg2);
+	register unsigned long a3 asm ("a3") = (unsigned long)(arg3);
+	register unsigned long a4 asm ("a4") = (unsigned long)(arg4);
+	register unsigned long a5 asm ("a5") = (unsigned long)(arg5);
+	register unsigned long a6 asm ("a6") = (unsigned long)(fid);
+	register unsigned long a7 asm ("a7") = (unsigned long)(ext);
+	asm volatile ("ecall"
+		      : "+r" (a0), "+r" (a1)
+		      : "r" (a2), "r" (a3), "r" (a4), "r" (a5), "r" (a6), "r" (a7)
+		      : "memory");
+	ret.error = a0;
+	ret.value = a1;
+
+	return ret;
+}
+
+static inline void sbi_ecall_console_puts(const char *str)
+{
+	sbi_ecall(SBI_EXT_DBCN, SBI_EXT_DBCN_CONSOLE_WRITE,
+		  sbi_strlen(str), (unsigned long)str, 0, 0, 0, 0);
+}
+
+static inline void sbi_ecall_shutdown(void)
+{
+	sbi_ecall(SBI_EXT_SRST, SBI_EXT_SRST_RESET,
+		  SBI_SRST_RESET_TYPE_SHUTDOWN, SBI_SRST_RESET_REASON_NONE,
+		  0, 0, 0, 0);
+}
+
+typedef void (*emufuzz_fn)(struct emufuzz_state *state);
+
+void emubench_trap(void);
+
+/* Exceptions taken by emubench_trap() */
+extern volatile unsigned long emubench_traps;
+
+static unsigned short code[512] __attribute__((aligned(64)));
+static struct emufuzz_state in, out;
+static unsigned int stream[EMUFUZZ_MAX_LEN];
+static bool have_fp, have_vec;
+static unsigned long vlenb;
+static unsigned long long rng;
+
+static char line[160];
+static int line_len;
+
+static void line_str(const char *str)
+{
+	while (*str && line_len < sizeof(line) - 2)
+		line[line_len++] = *str++;
+}
+
+static void line_dec(unsigned long val)
+{
+	char tmp[3 * sizeof(val) + 1];
+	int i = sizeof(tmp) - 1;
+
+	tmp[i] = '\0';
+	do {
+		tmp[--i] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+
+	line_str(&tmp[i]);
+}
+
+static void line_hex(unsigned long long val, int digits)
+{
+	char tmp[17];
+	int i;
+
+	for (i = digits - 1; i >= 0; i--) {
+		tmp[i] = "0123456789abcdef"[val & 0xf];
+		val >>= 4;
+	}
+	tmp[digits] = '\0';
+
+	line_str(tmp);
+}
+
+static void line_flush(void)
+{
+	line[line_len++] = '\n';
+	line[line_len] = '\0';
+	sbi_ecall_console_puts(line);
+	line_len = 0;
+}
+
+/* QEMU fw_cfg access through the MMIO data and selector registers */
+static void fw_cfg_select(unsigned int key)
+{
+	volatile unsigned short *sel =
+		(volatile unsigned short *)(EMUFUZZ_FW_CFG_BASE + 8);
+
+	*sel = ((key & 0xff) << 8) | ((key >> 8) & 0xff);
+}
+
+static unsigned int fw_cfg_read(int bytes)
+{
+	volatile unsigned char *data =
+		(volatile unsigned char *)EMUFUZZ_FW_CFG_BASE;
+	unsigned int val = 0;
+
+	while (bytes--)
+		val = (val << 8) | *data;
+
+	return val;
+}
+
+/* Reads the fw_cfg file name into buf and returns its size, or -1 */
+static int fw_cfg_file(const char *name, char *buf, int size)
+{
+	unsigned long traps = emubench_traps;
+	unsigned int i, j, count, fsize, fsel;
+	char fname[56];
+
+	fw_cfg_select(FW_CFG_SIGNATURE);
+	if (fw_cfg_read(4) != 0x51454d55 || emubench_traps != traps)
+		return -1;
+
+	fw_cfg_select(FW_CFG_FILE_DIR);
+	count = fw_cfg_read(4);
+	for (i = 0; i < count; i++) {
+		fsize = fw_cfg_read(4);
+		fsel = fw_cfg_read(2);
+		fw_cfg_read(2);
+		for (j = 0; j < sizeof(fname); j++)
+			fname[j] = fw_cfg_read(1);
+		fname[sizeof(fname) - 1] = '\0';
+		if (sbi_strncmp(fname, name, sizeof(fname)))
+			continue;
+
+		if (fsize > size - 1)
+			fsize = size - 1;
+		fw_cfg_select(fsel);
+		for (j = 0; j < fsize; j++)
+			buf[j] = fw_cfg_read(1);
+		buf[fsize] = '\0';
+		return fsize;
+	}
+
+	return -1;
+}
+
+static unsigned long parse_num(const char **str)
+{
+	const char *s = *str;
+	unsigned long val = 0;
+	int base = 10, d;
+
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+		base = 16;
+		s += 2;
+	}
+	for (;; s++) {
+		if (*s >= '0' && *s <= '9')
+			d = *s - '0';
+		else if (base == 16 && *s >= 'a' && *s <= 'f')
+			d = *s - 'a' + 10;
+		else if (base == 16 && *s >= 'A' && *s <= 'F')
+			d = *s - 'A' + 10;
+		else
+			break;
+		val = val * base + d;
+	}
+	*str = s;
+
+	return val;
+}
+
+static void parse_opts(struct emufuzz_opts *opts)
+{
+	static const char *const keys[] = {
+		"seed=", "cases=", "len=", "dump=", "bench=",
+	};
+	const char *s;
+	char buf[128];
+	unsigned long val;
+	int i, len;
+
+	opts->seed = 1;
+	opts->cases = 1000;
+	opts->len = 8;
+	opts->dump = 0;
+	opts->do_dump = false;
+	opts->bench = true;
+
+	if (fw_cfg_file(EMUFUZZ_FW_CFG_FILE, buf, sizeof(buf)) < 0)
+		return;
+
+	s = buf;
+	while (*s) {
+		for (i = 0; i < array_size(keys); i++) {
+			len = sbi_strlen(keys[i]);
+			if (!sbi_strncmp(s, keys[i], len))
+				break;
+		}
+		if (i == array_size(keys)) {
+			s++;
+			continue;
+		}
+
+		s += len;
+		val = parse_num(&s);
+		switch (i) {
+		case 0:
+			opts->seed = val;
+			break;
+		case 1:
+			opts->cases = val;
+			break;
+		case 2:
+			if (val >= 1 && val <= EMUFUZZ_MAX_LEN)
+				opts->len = val;
+			break;
+		case 3:
+			opts->dump = val;
+			opts->do_dump = true;
+			break;
+		case 4:
+			opts->bench = val != 0;
+			break;
+		}
+	}
+}
+
+/* splitmix64 for seeding and xorshift64* for the stream */
+static void rng_seed(unsigned long long seed)
+{
+	seed += 0x9e3779b97f4a7c15ULL;
+	seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+	rng = (seed ^ (seed >> 31)) | 1;
+}
+
+static unsigned long long rng_next(void)
+{
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+
+	return rng * 0x2545f4914f6cdd1dULL;
+}
+
+static unsigned int rng_below(unsigned int n)
+{
+	return (rng_next() >> 32) % n;
+}
+
+static const unsigned long x_special[] = {
+	0, 1, -1UL, -2UL, 0x7f, 0x80, 0xff, 0x7fff, 0x8000, 0xffff,
+	0x7fffffffUL, 0x80000000UL, 0xffffffffUL,
+	-1UL >> 1, ~(-1UL >> 1),
+};
+
+static const unsigned short h_special[] = {
+	0x0000, 0x8000, 0x7c00, 0xfc00, 0x7e00, 0x7c01, 0x0001, 0x03ff,
+	0x0400, 0x7bff, 0x3c00, 0xbc00, 0x3800, 0x3e00, 0x4100,
+};
+
+static const unsigned int s_special[] = {
+	0x00000000, 0x80000000, 0x7f800000, 0xff800000, 0x7fc00000,
+	0x7f800001, 0x00000001, 0x007fffff, 0x00800000, 0x7f7fffff,
+	0x3f800000, 0xbf800000, 0x3f000000, 0x3fc00000, 0x40200000,
+	0x477ff000, 0x33800000,
+};
+
+static const unsigned long long d_special[] = {
+	0x0000000000000000ULL, 0x8000000000000000ULL, 0x7ff0000000000000ULL,
+	0xfff0000000000000ULL, 0x7ff8000000000000ULL, 0x7ff0000000000001ULL,
+	0x0000000000000001ULL, 0x000fffffffffffffULL, 0x0010000000000000ULL,
+	0x7fefffffffffffffULL, 0x3ff0000000000000ULL, 0xbff0000000000000ULL,
+	0x41e0000000000000ULL, 0xc1e0000000000000ULL, 0x41f0000000000000ULL,
+	0x3ff8000000000000ULL, 0x4004000000000000ULL,
+};
+
+#define BOX_H			0xffffffffffff0000ULL
+#define BOX_S			0xffffffff00000000ULL
+
+static unsigned long rand_x(void)
+{
+	switch (rng_below(4)) {
+	case 0:
+		return x_special[rng_below(array_size(x_special))];
+	case 1:
+		return (long)rng_below(64) - 32;
+	default:
+		return rng_next();
+	}
+}
+
+/* Mostly NaN-boxed halves and singles, special values and doubles */
+static unsigned long long rand_f(void)
+{
+	unsigned long long v = rng_next();
+
+	switch (rng_below(8)) {
+	case 0:
+		return v;
+	case 1:
+		return BOX_H | (v & 0xffff);
+	case 2:
+		return BOX_H | h_special[rng_below(array_size(h_special))];
+	case 3:
+		return BOX_S | (v & 0xffffffff);
+	case 4:
+		return BOX_S | s_special[rng_below(array_size(s_special))];
+	case 5:
+		return d_special[rng_below(array_size(d_special))];
+	case 6:
+		/* Doubles around 1.0 with a fraction, for the roundings */
+		return (v & 0x800fffffffffffffULL) |
+		       ((0x3ffULL - 8 + rng_below(64)) << 52);
+	default:
+		/* Singles around 1.0 with a fraction */
+		return BOX_S | (v & 0x807fffff) |
+		       ((0x7fULL - 8 + rng_below(40)) << 23);
+	}
+}
+
+static void rand_state(struct emufuzz_state *s)
+{
+	unsigned long sew, vlmax;
+	int i, j;
+
+	sbi_memset(s, 0, sizeof(*s));
+	for (i = 1; i < array_size(xpool); i++)
+		s->x[xpool[i]] = rand_x();
+	for (i = 0; i < 32; i++)
+		s->f[i] = rand_f();
+	s->fcsr = (rng_below(5) << 5) | rng_below(32);
+
+	/* LMUL=1 and undisturbed tail and mask elements */
+	sew = rng_below(4);
+	vlmax = vlenb >> sew;
+	s->vtype = sew << 3;
+	s->vl = rng_below(vlmax + 1);
+	for (i = 0; i < VSTATE_COUNT; i++)
+		for (j = 0; j < EMUFUZZ_VLENB_MAX; j++)
+			s->v[i][j] = rng_next();
+}
+
+static bool insn_enabled(const struct emufuzz_insn *t)
+{
+	if ((t->flags & EF_RV64) && __riscv_xlen != 64)
+		return false;
+	if ((t->flags & EF_RV32) && __riscv_xlen != 32)
+		return false;
+	if ((t->flags & EF_FP) && !have_fp)
+		return false;
+	if ((t->flags & EF_VEC) && !have_vec)
+		return false;
+
+	return true;
+}
+
+static unsigned int rand_xreg(void)
+{
+	return xpool[rng_below(array_size(xpool))];
+}
+
+static unsigned int rand_vreg(void)
+{
+	return VPOOL_FIRST + rng_below(VPOOL_COUNT);
+}
+
+/* Static rounding mode or dynamic one, which fcsr always holds valid */
+static unsigned int rand_rm(void)
+{
+	unsigned int rm = rng_below(6);
+
+	return rm == 5 ? 7 : rm;
+}
+
+static unsigned int gen_insn(const struct emufuzz_insn *t)
+{
+	unsigned int insn = t->match, vd, vs2, vs1;
+
+	switch (t->kind) {
+	case K_R3:
+		insn |= rand_xreg() << 7 | rand_xreg() << 15 |
+			rand_xreg() << 20;
+		break;
+	case K_R2:
+		insn |= rand_xreg() << 7 | rand_xreg() << 15;
+		break;
+	case K_SHAMT:
+		insn |= rand_xreg() << 7 | rand_xreg() << 15 |
+			rng_below(__riscv_xlen) << 20;
+		break;
+	case K_SHAMTW:
+		insn |= rand_xreg() << 7 | rand_xreg() << 15 |
+			rng_below(32) << 20;
+		break;
+	case K_C1:
+		insn |= cpool[rng_below(array_size(cpool))] << 7;
+		break;
+	case K_C2:
+		insn |= cpool[rng_below(array_size(cpool))] << 7 |
+			cpool[rng_below(array_size(cpool))] << 2;
+		break;
+	case K_F2RM:
+		insn |= rng_below(32) << 7 | rand_rm() << 12 |
+			rng_below(32) << 15;
+		break;
+	case K_F3:
+		insn |= rng_below(32) << 7 | rng_below(32) << 15 |
+			rng_below(32) << 20;
+		break;
+	case K_XF2:
+		insn |= rand_xreg() << 7 | rng_below(32) << 15 |
+			rng_below(32) << 20;
+		break;
+	case K_XF1:
+		insn |= rand_xreg() << 7 | rng_below(32) << 15;
+		break;
+	case K_FX1:
+		insn |= rng_below(32) << 7 | rand_xreg() << 15;
+		break;
+	case K_FLI:
+		insn |= rng_below(32) << 7 | rng_below(32) << 15;
+		break;
+	default:
+		/* Widening: even vd group, sources outside of it */
+		vd = rand_vreg();
+		if (t->flags & EF_WIDE)
+			vd &= ~1;
+		do {
+			vs2 = rand_vreg();
+			vs1 = rand_vreg();
+		} while ((t->flags & EF_WIDE) &&
+			 ((vs2 & ~1) == vd || (vs1 & ~1) == vd));
+		if (t->kind == K_VVX)
+			vs1 = rand_xreg();
+		else if (t->kind == K_VVI || t->kind == K_VVF)
+			vs1 = rng_below(32);
+		else if (t->kind == K_V1)
+			vs1 = 0;
+		if (t->kind == K_VVI && (t->flags & EF_UIMM6))
+			insn |= rng_below(2) << 26;
+		insn |= vd << 7 | vs1 << 15 | vs2 << 20 |
+			rng_below(2) << 25;
+		break;
+	}
+
+	return insn;
+}
+
+static void code_put16(int *pos, unsigned int insn)
+{
+	code[(*pos)++] = insn & 0xffff;
+}
+
+static void code_put32(int *pos, unsigned int insn)
+{
+	code[(*pos)++] = insn & 0xffff;
+	code[(*pos)++] = insn >> 16;
+}
+
+static unsigned int insn_i(unsigned int match, int rd, int rs1, long imm)
+{
+	return match | rd << 7 | rs1 << 15 | (imm & 0xfff) << 20;
+}
+
+static unsigned int insn_s(unsigned int match, int rs2, int rs1, long imm)
+{
+	return match | (imm & 0x1f) << 7 | rs1 << 15 | rs2 << 20 |
+	       ((imm >> 5) & 0x7f) << 25;
+}
+
+static unsigned int insn_bnez_a1(long off)
+{
+	return INSN_BNEZ_A1 |
+	       (((off >> 12) & 0x1) << 31) | (((off >> 5) & 0x3f) << 25) |
+	       (((off >> 1) & 0xf) << 8) | (((off >> 11) & 0x1) << 7);
+}
+
+#define STATE_X(n)	(offsetof(struct emufuzz_state, x) + (n) * sizeof(long))
+#define STATE_F(n)	(offsetof(struct emufuzz_state, f) + (n) * 8)
+#define STATE_FIELD(m)	offsetof(struct emufuzz_state, m)
+
+/*
+ * Generate "load state from a0; [ld a1, iters; 1:] stream x unroll;
+ * [addi a1, a1, -1; bnez a1, 1b;] store state to a0; ret"
+ */
+static emufuzz_fn build_code(int len, int unroll, bool loop)
+{
+	int i, j, start, pos = 0;
+
+	if (have_vec) {
+		code_put32(&pos, insn_i(INSN_MATCH_ADDI, REG_A1, REG_A0,
+					STATE_FIELD(v)));
+		for (i = 0; i < VSTATE_COUNT; i++) {
+			code_put32(&pos, INSN_MATCH_VL1RE8V |
+				   (i ? VPOOL_FIRST + i - 1 : 0) << 7 |
+				   REG_A1 << 15);
+			code_put32(&pos, insn_i(INSN_MATCH_ADDI, REG_A1, REG_A1,
+						EMUFUZZ_VLENB_MAX));
+		}
+		code_put32(&pos, insn_i(INSN_MATCH_LOAD_X, REG_T0, REG_A0,
+					STATE_FIELD(vl)));
+		code_put32(&pos, insn_i(INSN_MATCH_LOAD_X, REG_T1, REG_A0,
+					STATE_FIELD(vtype)));
+		code_put32(&pos, INSN_MATCH_VSETVL | REG_T0 << 15 |
+				 REG_T1 << 20);
+	}
+	if (have_fp) {
+		code_put32(&pos, insn_i(INSN_MATCH_LOAD_X, REG_T0, REG_A0,
+					STATE_FIELD(fcsr)));
+		code_put32(&pos, insn_i(INSN_MATCH_CSRRW, 0, REG_T0,
+					CSR_FCSR));
+		for (i = 0; i < 32; i++)
+			code_put32(&pos, insn_i(INSN_MATCH_FLD, i, REG_A0,
+						STATE_F(i)));
+	}
+	for (i = 1; i < array_size(xpool); i++)
+		code_put32(&pos, insn_i(INSN_MATCH_LOAD_X, xpool[i], REG_A0,
+					STATE_X(xpool[i])));
+
+	if (loop)
+		code_put32(&pos, insn_i(INSN_MATCH_LOAD_X, REG_A1, REG_A0,
+					STATE_FIELD(iters)));
+	start = pos;
+	for (j = 0; j < unroll; j++) {
+		for (i = 0; i < len; i++) {
+			if ((stream[i] & 3) != 3)
+				code_put16(&pos, stream[i]);
+			else
+				code_put32(&pos, stream[i]);
+		}
+	}
+	if (loop) {
+		code_put32(&pos, insn_i(INSN_MATCH_ADDI, REG_A1, REG_A1, -1));
+		code_put32(&pos, insn_bnez_a1(2L * (start - pos)));
+	}
+
+	for (i = 1; i < array_size(xpool); i++)
+		code_put32(&pos, insn_s(INSN_MATCH_STORE_X, xpool[i], REG_A0,
+					STATE_X(xpool[i])));
+	if (have_fp) {
+		for (i = 0; i < 32; i++)
+			code_put32(&pos, insn_s(INSN_MATCH_FSD, i, REG_A0,
+						STATE_F(i)));
+		code_put32(&pos, insn_i(INSN_MATCH_CSRRS, REG_T0, 0,
+					CSR_FCSR));
+		code_put32(&pos, insn_s(INSN_MATCH_STORE_X, REG_T0, REG_A0,
+					STATE_FIELD(fcsr)));
+	}
+	if (have_vec) {
+		code_put32(&pos, insn_i(INSN_MATCH_CSRRS, REG_T0, 0, CSR_VL));
+		code_put32(&pos, insn_s(INSN_MATCH_STORE_X, REG_T0, REG_A0,
+					STATE_FIELD(vl)));
+		code_put32(&pos, insn_i(INSN_MATCH_CSRRS, REG_T0, 0,
+					CSR_VTYPE));
+		code_put32(&pos, insn_s(INSN_MATCH_STORE_X, REG_T0, REG_A0,
+					STATE_FIELD(vtype)));
+		code_put32(&pos, insn_i(INSN_MATCH_ADDI, REG_A1, REG_A0,
+					STATE_FIELD(v)));
+		for (i = 0; i < VSTATE_COUNT; i++) {
+			code_put32(&pos, INSN_MATCH_VS1RV |
+				   (i ? VPOOL_FIRST + i - 1 : 0) << 7 |
+				   REG_A1 << 15);
+			code_put32(&pos, insn_i(INSN_MATCH_ADDI, REG_A1, REG_A1,
+						EMUFUZZ_VLENB_MAX));
+		}
+	}
+	code_put32(&pos, INSN_RET);
+
+	asm volatile ("fence.i" ::: "memory");
+
+	return (emufuzz_fn)(unsigned long)code;
+}
+
+static bool probe_insn(unsigned int insn)
+{
+	unsigned long traps = emubench_traps;
+	int pos = 0;
+
+	code_put32(&pos, insn);
+	code_put32(&pos, INSN_RET);
+	asm volatile ("fence.i" ::: "memory");
+	((emufuzz_fn)(unsigned long)code)(&out);
+
+	return emubench_traps == traps;
+}
+
+static void probe(void)
+{
+	unsigned long traps = emubench_traps;
+
+	have_fp = probe_insn(INSN_FMV_D_X_FT0);
+
+	vlenb = csr_read(CSR_VLENB);
+	have_vec = emubench_traps == traps && vlenb &&
+		   vlenb <= EMUFUZZ_VLENB_MAX;
+	if (!have_vec)
+		vlenb = 0;
+}
+
+/* FNV-1a over the whole output state */
+static unsigned long long state_hash(const struct emufuzz_state *s)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	unsigned long long h = 0xcbf29ce484222325ULL;
+	int i;
+
+	for (i = 0; i < sizeof(*s); i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+static void dump_prefix(const char *dir, unsigned long n)
+{
+	line_str("emufuzz: dump case=");
+	line_dec(n);
+	line_str(" ");
+	line_str(dir);
+	line_str(" ");
+}
+
+static void dump_state(const char *dir, unsigned long n,
+		       const struct emufuzz_state *s)
+{
+	int i, j;
+
+	for (i = 1; i < array_size(xpool); i++) {
+		dump_prefix(dir, n);
+		line_str("x");
+		line_dec(xpool[i]);
+		line_str("=");
+		line_hex(s->x[xpool[i]], 2 * sizeof(long));
+		line_flush();
+	}
+	if (have_fp) {
+		for (i = 0; i < 32; i++) {
+			dump_prefix(dir, n);
+			line_str("f");
+			line_dec(i);
+			line_str("=");
+			line_hex(s->f[i], 16);
+			line_flush();
+		}
+		dump_prefix(dir, n);
+		line_str("fcsr=");
+		line_hex(s->fcsr, 2);
+		line_flush();
+	}
+	if (have_vec) {
+		dump_prefix(dir, n);
+		line_str("vl=");
+		line_dec(s->vl);
+		line_str(" vtype=");
+		line_hex(s->vtype, 2 * sizeof(long));
+		line_flush();
+		for (i = 0; i < VSTATE_COUNT; i++) {
+			dump_prefix(dir, n);
+			line_str("v");
+			line_dec(i ? VPOOL_FIRST + i - 1 : 0);
+			line_str("=");
+			/* Highest byte first, like a wide integer */
+			for (j = vlenb - 1; j >= 0; j--)
+				line_hex(s->v[i][j], 2);
+			line_flush();
+		}
+	}
+}
+
+static const struct emufuzz_insn *pick_insn(unsigned long vtype)
+{
+	const struct emufuzz_insn *t;
+
+	do {
+		t = &insns[rng_below(array_size(insns))];
+	} while (!insn_enabled(t) ||
+		 ((t->flags & EF_WIDE) && ((vtype >> 3) & 7) == 3));
+
+	return t;
+}
+
+static void run_case(const struct emufuzz_opts *opts, unsigned long n,
+		     bool dump)
+{
+	unsigned long traps;
+	int i, len;
+
+	rng_seed(opts->seed * 0x100000001b3ULL + n);
+	rand_state(&in);
+	len = 1 + rng_below(opts->len);
+	for (i = 0; i < len; i++)
+		stream[i] = gen_insn(pick_insn(in.vtype));
+
+	sbi_memcpy(&out, &in, sizeof(out));
+	traps = emubench_traps;
+	build_code(len, 1, false)(&out);
+	traps = emubench_traps - traps;
+
+	if (dump) {
+		for (i = 0; i < len; i++) {
+			dump_prefix("insn", n);
+			line_dec(i);
+			line_str("=");
+			line_hex(stream[i], (stream[i] & 3) == 3 ? 8 : 4);
+			line_flush();
+		}
+		dump_state("in", n, &in);
+		dump_state("out", n, &out);
+	}
+
+	line_str("emufuzz: case=");
+	line_dec(n);
+	line_str(" hash=");
+	line_hex(state_hash(&out), 16);
+	line_str(" traps=");
+	line_dec(traps);
+	line_flush();
+}
+
+static void bench_insn(const struct emufuzz_insn *t, int idx)
+{
+	unsigned long traps, time0, time1;
+	emufuzz_fn fn;
+
+	/* Fixed operands and e32 with VLMAX, same in both runs */
+	rng_seed(0x5eed0000 + idx);
+	rand_state(&in);
+	in.vtype = 2 << 3;
+	in.vl = vlenb >> 2;
+	stream[0] = gen_insn(t);
+	fn = build_code(1, EMUFUZZ_UNROLL, true);
+
+	line_str("emufuzz: insn=");
+	line_str(t->name);
+
+	sbi_memcpy(&out, &in, sizeof(out));
+	out.iters = 1;
+	traps = emubench_traps;
+	fn(&out);
+	if (emubench_traps != traps) {
+		line_str(" status=trap");
+		line_flush();
+		return;
+	}
+
+	sbi_memcpy(&out, &in, sizeof(out));
+	out.iters = EMUFUZZ_ITERS;
+	time0 = csr_read(CSR_TIME);
+	fn(&out);
+	time1 = csr_read(CSR_TIME);
+
+	line_str(" ops=");
+	line_dec(EMUFUZZ_ITERS * EMUFUZZ_UNROLL);
+	line_str(" time=");
+	line_dec(time1 - time0);
+	line_flush();
+}
+
+void test_main(unsigned long a0, unsigned long a1)
+{
+	struct emufuzz_opts opts;
+	unsigned long n, traps;
+	int i;
+
+	csr_write(CSR_STVEC, (unsigned long)emubench_trap);
+	csr_set(CSR_SSTATUS, SSTATUS_FS | SSTATUS_VS);
+
+	parse_opts(&opts);
+	probe();
+
+	line_str("emufuzz: begin version=1 xlen=");
+	line_dec(__riscv_xlen);
+	line_str(" seed=");
+	line_dec(opts.seed);
+	line_str(" cases=");
+	line_dec(opts.cases);
+	line_str(" len=");
+	line_dec(opts.len);
+	line_str(" fp=");
+	line_dec(have_fp);
+	line_str(" vlenb=");
+	line_dec(vlenb);
+	line_flush();
+
+	traps = emubench_traps;
+	if (opts.do_dump)
+		run_case(&opts, opts.dump, true);
+	for (n = 0; n < opts.cases; n++)
+		run_case(&opts, n, false);
+	traps = emubench_traps - traps;
+
+	if (opts.bench) {
+		for (i = 0; i < array_size(insns); i++)
+			if (insn_enabled(&insns[i]))
+				bench_insn(&insns[i], i);
+	}
+
+	line_str("emufuzz: end traps=");
+	line_dec(traps);
+	line_flush();
+
+	sbi_ecall_shutdown();
+	sbi_ecall_console_puts("sbi_ecall_shutdown failed to execute.\n");
+}
@@ -17,3 +17,51 @@ test-y += test_main.o
 
 %/test.dep: $(foreach dep,$(test-y:.o=.dep),%/$(dep))
 	$(call merge_deps,$@,$^)
+
+firmware-bins-$(FW_PAYLOAD) += payloads/emu_hot.bin
+
+emu_hot-y += test_head.o
+emu_hot-y += emu_hot_sse.o
+emu_hot-y += emu_hot_main.o
+
+%/emu_hot.o: $(foreach obj,$(emu_hot-y),%/$(obj))
+	$(call merge_objs,$@,$^)
+
+%/emu_hot.dep: $(foreach dep,$(emu_hot-y:.o=.dep),%/$(dep))
+	$(call merge_deps,$@,$^)
+
+firmware-bins-$(FW_PAYLOAD) += payloads/emubench.bin
+
+emubench-y += test_head.o
+emubench-y += emubench_trap.o
+emubench-y += emubench_main.o
+
+%/emubench.o: $(foreach obj,$(emubench-y),%/$(obj))
+	$(call merge_objs,$@,$^)
+
+%/emubench.dep: $(foreach dep,$(emubench-y:.o=.dep),%/$(dep))
+	$(call merge_deps,$@,$^)
+
+firmware-bins-$(FW_PAYLOAD) += payloads/emufuzz.bin
+
+emufuzz-y += test_head.o
+emufuzz-y += emubench_trap.o
+emufuzz-y += emufuzz_main.o
+
+%/emufuzz.o: $(foreach obj,$(emufuzz-y),%/$(obj))
+	$(call merge_objs,$@,$^)
+
+%/emufuzz.dep: $(foreach dep,$(emufuzz-y:.o=.dep),%/$(dep))
+	$(call merge_deps,$@,$^)
+
+firmware-bins-$(FW_PAYLOAD) += payloads/tlbstorm.bin
+
+tlbstorm-y += test_head.o
+tlbstorm-y += tlbstorm_head.o
+tlbstorm-y += tlbstorm_main.o
+
+%/tlbstorm.o: $(foreach obj,$(tlbstorm-y),%/$(obj))
+	$(call merge_objs,$@,$^)
+
+%/tlbstorm.dep: $(foreach dep,$(tlbstorm-y:.o=.dep),%/$(dep))
+	$(call merge_deps,$@,$^)
@@ -0,0 +1,238 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Remote fence storm payload
+ *
+ * The boot HART starts all other HARTs through HSM, then every HART
+ * issues TLBSTORM_ITERS remote SFENCE.VMA requests to all HARTs at the
+ * same time, as a kernel does when the threads of a process unmap
+ * memory on every HART. The requests use one of TLBSTORM_ASIDS ASIDs
+ * and a random range of 1 to TLBSTORM_MAX_PAGES pages, so that the
+ * requests of different HARTs overlap and can be coalesced.
+ *
+ * The result is printed by the boot HART:
+ *
+ *   tlbstorm: harts=<n> ops=<n> errors=<n> time=<n> max=<n>
+ *
+ * time is the wall time of the whole storm and max the longest time a
+ * single HART needed for its requests, both in timer ticks. Use
+ * scripts/tlbstorm.sh to run it with different numbers of HARTs.
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_string.h>
+
+#ifndef TLBSTORM_ITERS
+#define TLBSTORM_ITERS		1000
+#endif
+#define TLBSTORM_MAX_HARTS	128
+#define TLBSTORM_STACK_SIZE	4096
+#define TLBSTORM_ASIDS		4
+#define TLBSTORM_MAX_PAGES	16
+/* Pages of the virtual address window the ranges are taken from */
+#define TLBSTORM_WINDOW		64
+#define TLBSTORM_VA_BASE	0x40000000UL
+#define TLBSTORM_PAGE_SIZE	4096UL
+
+struct sbiret {
+	unsigned long error;
+	unsigned long value;
+};
+
+struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
+			unsigned long arg1, unsigned long arg2,
+			unsigned long arg3, unsigned long arg4,
+			unsigned long arg5)
+{
+	struct sbiret ret;
+
+	register unsigned long a0 asm ("a0") = (unsigned long)(arg0);
+	register unsigned long a1 asm ("a1") = (unsigned long)(arg1);
+	register unsigned long a2 asm ("a2") = (unsigned long)(arg2);
+	register unsigned long a3 asm ("a3") = (unsigned long)(arg3);
+	register unsigned long a4 asm ("a4") = (unsigned long)(arg4);
+	register unsigned long a5 asm ("a5") = (unsigned long)(arg5);
+	register unsigned long a6 asm ("a6") = (unsigned long)(fid);
+	register unsigned long a7 asm ("a7") = (unsigned long)(ext);
+	asm volatile ("ecall"
+		      : "+r" (a0), "+r" (a1)
+		      : "r" (a2), "r" (a3), "r" (a4), "r" (a5), "r" (a6), "r" (a7)
+		      : "memory");
+	ret.error = a0;
+	ret.value = a1;
+
+	return ret;
+}
+
+static inline void sbi_ecall_console_puts(const char *str)
+{
+	sbi_ecall(SBI_EXT_DBCN, SBI_EXT_DBCN_CONSOLE_WRITE,
+		  sbi_strlen(str), (unsigned long)str, 0, 0, 0, 0);
+}
+
+static inline void sbi_ecall_shutdown(void)
+{
+	sbi_ecall(SBI_EXT_SRST, SBI_EXT_SRST_RESET,
+		  SBI_SRST_RESET_TYPE_SHUTDOWN, SBI_SRST_RESET_REASON_NONE,
+		  0, 0, 0, 0);
+}
+
+void tlbstorm_secondary_entry(void);
+
+static unsigned char stacks[TLBSTORM_MAX_HARTS][TLBSTORM_STACK_SIZE]
+	__attribute__((aligned(16)));
+
+/* Written by every HART, read by the boot HART */
+static unsigned long hart_time[TLBSTORM_MAX_HARTS];
+static unsigned int ready;
+static unsigned int done;
+static unsigned int errors;
+static unsigned int go;
+
+static char line[160];
+static int line_len;
+
+static void line_str(const char *str)
+{
+	while (*str && line_len < sizeof(line) - 2)
+		line[line_len++] = *str++;
+}
+
+static void line_dec(unsigned long val)
+{
+	char tmp[3 * sizeof(val) + 1];
+	int i = sizeof(tmp) - 1;
+
+	tmp[i] = '\0';
+	do {
+		tmp[--i] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+
+	line_str(&tmp[i]);
+}
+
+static void line_flush(void)
+{
+	line[line_len++] = '\n';
+	line[line_len] = '\0';
+	sbi_ecall_console_puts(line);
+	line_len = 0;
+}
+
+static unsigned long rand_next(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+
+	return x;
+}
+
+static void storm(unsigned long hartid)
+{
+	unsigned long i, r, start, size, seed, time0, fails = 0;
+	struct sbiret ret;
+
+	seed = 0x9e3779b9UL * (hartid + 1);
+	__atomic_fetch_add(&ready, 1, __ATOMIC_RELEASE);
+	while (!__atomic_load_n(&go, __ATOMIC_ACQUIRE))
+		;
+
+	time0 = csr_read(CSR_TIME);
+	for (i = 0; i < TLBSTORM_ITERS; i++) {
+		r = rand_next(&seed);
+		start = TLBSTORM_VA_BASE +
+			(r % TLBSTORM_WINDOW) * TLBSTORM_PAGE_SIZE;
+		size = (1 + (r >> 8) % TLBSTORM_MAX_PAGES) *
+			TLBSTORM_PAGE_SIZE;
+		ret = sbi_ecall(SBI_EXT_RFENCE,
+				SBI_EXT_RFENCE_REMOTE_SFENCE_VMA_ASID,
+				0, -1UL, start, size,
+				(r >> 16) % TLBSTORM_ASIDS, 0);
+		if (ret.error)
+			fails++;
+	}
+	if (hartid < TLBSTORM_MAX_HARTS)
+		hart_time[hartid] = csr_read(CSR_TIME) - time0;
+
+	if (fails)
+		__atomic_fetch_add(&errors, fails, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&done, 1, __ATOMIC_RELEASE);
+}
+
+void tlbstorm_secondary(unsigned long hartid)
+{
+	storm(hartid);
+}
+
+void test_main(unsigned long a0, unsigned long a1)
+{
+	unsigned long i, harts = 1, time0, time, max = 0;
+	struct sbiret ret;
+
+	for (i = 0; i < TLBSTORM_MAX_HARTS; i++) {
+		if (i == a0)
+			continue;
+		ret = sbi_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_START, i,
+				(unsigned long)tlbstorm_secondary_entry,
+				(unsigned long)&stacks[i][TLBSTORM_STACK_SIZE],
+				0, 0, 0);
+		if (!ret.error)
+			harts++;
+		else if (ret.error != SBI_ERR_ALREADY_AVAILABLE &&
+			 ret.error != SBI_ERR_ALREADY_STARTED)
+			break;
+	}
+
+	line_str("tlbstorm: begin harts=");
+	line_dec(harts);
+	line_str(" iters=");
+	line_dec(TLBSTORM_ITERS);
+	line_flush();
+
+	while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) != harts - 1)
+		;
+
+	time0 = csr_read(CSR_TIME);
+	__atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+	storm(a0);
+	while (__atomic_load_n(&done, __ATOMIC_ACQUIRE) != harts)
+		;
+	time = csr_read(CSR_TIME) - time0;
+
+	for (i = 0; i < TLBSTORM_MAX_HARTS; i++) {
+		if (hart_time[i] > max)
+			max = hart_time[i];
+	}
+
+	line_str("tlbstorm: harts=");
+	line_dec(harts);
+	line_str(" ops=");
+	line_dec(harts * TLBSTORM_ITERS);
+	line_str(" errors=");
+	line_dec(errors);
+	line_str(" time=");
+	line_dec(time);
+	line_str(" max=");
+	line_dec(max);
+	line_flush();
+
+	line_str("tlbstorm: end");
+	line_flush();
+
+	sbi_ecall_shutdown();
+	sbi_ecall_console_puts("sbi_ecall_shutdown failed to execute.\n");
+}
@@ -908,13 +908,13 @@
 #define INSN_MASK_C_GENERIC_RXS		0xfc7f
 
 #define INSN_MATCH_C_LBU		0x8000
-#define INSN_MASK_C_LBU			0xfc43
+#define INSN_MASK_C_LBU			0xfc03
 #define INSN_MATCH_C_LHU		0x8400
 #define INSN_MASK_C_LHU			0xfc43
 #define INSN_MATCH_C_LH			0x8440
 #define INSN_MASK_C_LH			0xfc43
 #define INSN_MATCH_C_SB			0x8800
-#define INSN_MASK_C_SB			0xfc43
+#define INSN_MASK_C_SB			0xfc03
 #define INSN_MATCH_C_SH			0x8c00
 #define INSN_MASK_C_SH			0xfc43
 
@@ -995,6 +995,38 @@
 #define INSN_MATCH_PACK			0x08004033
 #define INSN_MATCH_PACKH		0x08007033
 
+/* Zkne, Zknd (aes64ks1i and aes64ks2 are part of both) */
+#define INSN_MASK_AES32			0x3e00707f
+#define INSN_MASK_AES64KS1I		0xff00707f
+
+#define INSN_MATCH_AES32ESI		0x22000033
+#define INSN_MATCH_AES32ESMI		0x26000033
+#define INSN_MATCH_AES32DSI		0x2a000033
+#define INSN_MATCH_AES32DSMI		0x2e000033
+#define INSN_MATCH_AES64ES		0x32000033
+#define INSN_MATCH_AES64ESM		0x36000033
+#define INSN_MATCH_AES64DS		0x3a000033
+#define INSN_MATCH_AES64DSM		0x3e000033
+#define INSN_MATCH_AES64IM		0x30001013
+#define INSN_MATCH_AES64KS1I		0x31001013
+#define INSN_MATCH_AES64KS2		0x7e000033
+
+/* Zknh */
+#define INSN_MATCH_SHA256SIG0		0x10201013
+#define INSN_MATCH_SHA256SIG1		0x10301013
+#define INSN_MATCH_SHA256SUM0		0x10001013
+#define INSN_MATCH_SHA256SUM1		0x10101013
+#define INSN_MATCH_SHA512SIG0		0x10601013
+#define INSN_MATCH_SHA512SIG1		0x10701013
+#define INSN_MATCH_SHA512SUM0		0x10401013
+#define INSN_MATCH_SHA512SUM1		0x10501013
+#define INSN_MATCH_SHA512SIG0H		0x5c000033
+#define INSN_MATCH_SHA512SIG0L		0x54000033
+#define INSN_MATCH_SHA512SIG1H		0x5e000033
+#define INSN_MATCH_SHA512SIG1L		0x56000033
+#define INSN_MATCH_SHA512SUM0R		0x50000033
+#define INSN_MATCH_SHA512SUM1R		0x52000033
+
 /* Zba word instructions */
 #define INSN_MASK_SLLI_UW		0xfc00707f
 
@@ -1071,6 +1103,15 @@
 #define INSN_MATCH_CZERO_EQZ		0x0e005033
 #define INSN_MATCH_CZERO_NEZ		0x0e007033
 
+/* Instructions that complete fused idioms, see sbi_insn_emu_fuse.c */
+#define INSN_MATCH_OR			0x00006033
+#define INSN_MATCH_C_OR			0x8c41
+#define INSN_MASK_C_OR			0xfc63
+
+/* XTheadCondMov */
+#define INSN_MATCH_TH_MVEQZ		0x4000100b
+#define INSN_MATCH_TH_MVNEZ		0x4200100b
+
 #define INSN_MASK_VECTOR_UNIT_STRIDE		0xfdf0707f
 #define INSN_MASK_VECTOR_FAULT_ONLY_FIRST	0xfdf0707f
 #define INSN_MASK_VECTOR_STRIDE			0xfc00707f
@@ -1164,6 +1205,100 @@
 #define INSN_MATCH_VWSLLVX		0xd4004057
 #define INSN_MATCH_VWSLLVI		0xd4003057
 
+/* RVV 1.0 configuration-setting and move instructions */
+#define INSN_MASK_VSETVLI		0x8000707f
+#define INSN_MATCH_VSETVLI		0x00007057
+#define INSN_MASK_VSETIVLI		0xc000707f
+#define INSN_MATCH_VSETIVLI		0xc0007057
+#define INSN_MASK_VSETVL		0xfe00707f
+#define INSN_MATCH_VSETVL		0x80007057
+#define INSN_MASK_VMVXS			0xfe0ff07f
+#define INSN_MATCH_VMVXS		0x42002057
+#define INSN_MATCH_VFMVFS		0x42001057
+#define INSN_MASK_VMVSX			0xfff0707f
+#define INSN_MATCH_VMVSX		0x42006057
+#define INSN_MATCH_VFMVSF		0x42005057
+#define INSN_MASK_VMVNRV		0xfe00707f
+#define INSN_MATCH_VMVNRV		0x9e003057
+
+/* Zvfh arithmetic, matched with INSN_MASK_VVBINARY0 */
+#define INSN_MATCH_VFADDVV		0x00001057
+#define INSN_MATCH_VFADDVF		0x00005057
+#define INSN_MATCH_VFREDUSUMVS		0x04001057
+#define INSN_MATCH_VFSUBVV		0x08001057
+#define INSN_MATCH_VFSUBVF		0x08005057
+#define INSN_MATCH_VFREDOSUMVS		0x0c001057
+#define INSN_MATCH_VFMINVV		0x10001057
+#define INSN_MATCH_VFMINVF		0x10005057
+#define INSN_MATCH_VFREDMINVS		0x14001057
+#define INSN_MATCH_VFMAXVV		0x18001057
+#define INSN_MATCH_VFMAXVF		0x18005057
+#define INSN_MATCH_VFREDMAXVS		0x1c001057
+#define INSN_MATCH_VFSGNJVV		0x20001057
+#define INSN_MATCH_VFSGNJVF		0x20005057
+#define INSN_MATCH_VFSGNJNVV		0x24001057
+#define INSN_MATCH_VFSGNJNVF		0x24005057
+#define INSN_MATCH_VFSGNJXVV		0x28001057
+#define INSN_MATCH_VFSGNJXVF		0x28005057
+#define INSN_MATCH_VFDIVVV		0x80001057
+#define INSN_MATCH_VFDIVVF		0x80005057
+#define INSN_MATCH_VFRDIVVF		0x84005057
+#define INSN_MATCH_VFMULVV		0x90001057
+#define INSN_MATCH_VFMULVF		0x90005057
+#define INSN_MATCH_VFRSUBVF		0x9c005057
+#define INSN_MATCH_VFMADDVV		0xa0001057
+#define INSN_MATCH_VFMADDVF		0xa0005057
+#define INSN_MATCH_VFNMADDVV		0xa4001057
+#define INSN_MATCH_VFNMADDVF		0xa4005057
+#define INSN_MATCH_VFMSUBVV		0xa8001057
+#define INSN_MATCH_VFMSUBVF		0xa8005057
+#define INSN_MATCH_VFNMSUBVV		0xac001057
+#define INSN_MATCH_VFNMSUBVF		0xac005057
+#define INSN_MATCH_VFMACCVV		0xb0001057
+#define INSN_MATCH_VFMACCVF		0xb0005057
+#define INSN_MATCH_VFNMACCVV		0xb4001057
+#define INSN_MATCH_VFNMACCVF		0xb4005057
+#define INSN_MATCH_VFMSACVV		0xb8001057
+#define INSN_MATCH_VFMSACVF		0xb8005057
+#define INSN_MATCH_VFNMSACVV		0xbc001057
+#define INSN_MATCH_VFNMSACVF		0xbc005057
+#define INSN_MATCH_VFWADDVV		0xc0001057
+#define INSN_MATCH_VFWADDVF		0xc0005057
+#define INSN_MATCH_VFWSUBVV		0xc8001057
+#define INSN_MATCH_VFWSUBVF		0xc8005057
+#define INSN_MATCH_VFWADDWV		0xd0001057
+#define INSN_MATCH_VFWADDWF		0xd0005057
+#define INSN_MATCH_VFWSUBWV		0xd8001057
+#define INSN_MATCH_VFWSUBWF		0xd8005057
+#define INSN_MATCH_VFWMULVV		0xe0001057
+#define INSN_MATCH_VFWMULVF		0xe0005057
+#define INSN_MATCH_VFWMACCVV		0xf0001057
+#define INSN_MATCH_VFWMACCVF		0xf0005057
+#define INSN_MATCH_VFWNMACCVV		0xf4001057
+#define INSN_MATCH_VFWNMACCVF		0xf4005057
+#define INSN_MATCH_VFWMSACVV		0xf8001057
+#define INSN_MATCH_VFWMSACVF		0xf8005057
+#define INSN_MATCH_VFWNMSACVV		0xfc001057
+#define INSN_MATCH_VFWNMSACVF		0xfc005057
+#define INSN_MATCH_VFSLIDE1UPVF		0x38005057
+#define INSN_MATCH_VFSLIDE1DOWNVF	0x3c005057
+#define INSN_MATCH_VWFUNARY0		0x40001057	/* vfmv.f.s */
+#define INSN_MATCH_VRFUNARY0		0x40005057	/* vfmv.s.f */
+#define INSN_MATCH_VFMERGEVFM		0x5c005057	/* also vfmv.v.f */
+#define INSN_MATCH_VMFEQVV		0x60001057
+#define INSN_MATCH_VMFEQVF		0x60005057
+#define INSN_MATCH_VMFLEVV		0x64001057
+#define INSN_MATCH_VMFLEVF		0x64005057
+#define INSN_MATCH_VMFLTVV		0x6c001057
+#define INSN_MATCH_VMFLTVF		0x6c005057
+#define INSN_MATCH_VMFNEVV		0x70001057
+#define INSN_MATCH_VMFNEVF		0x70005057
+#define INSN_MATCH_VMFGTVF		0x74005057
+#define INSN_MATCH_VMFGEVF		0x7c005057
+/* matched with INSN_MASK_VXUNARY0 */
+#define INSN_MATCH_VFSQRTV		0x4c001057
+#define INSN_MATCH_VFCLASSV		0x4c081057
+
 #define INSN_OPCODE_MASK		0x7f
 #define INSN_OPCODE_VECTOR_LOAD		0x07
 #define INSN_OPCODE_VECTOR_STORE	0x27
@@ -86,7 +86,7 @@
 	({                                                              \
 		u64 value = GET_F64_REG(insn, pos, regs);               \
 		if ((value & 0xffffffffffff0000) != 0xffffffffffff0000) \
-			value = 0x7c00;                                 \
+			value = 0x7e00;                                 \
 		(u16) value;                                            \
 	})
 
@@ -58,6 +58,30 @@ void sbi_console_set_device(const struct sbi_console_device *dev);
 
 struct sbi_scratch;
 
+#ifdef CONFIG_CONSOLE_BUFFER
+
+/** Start buffering the console output of each HART */
+int sbi_console_buffer_init(struct sbi_scratch *scratch);
+
+/** Write a bounded part of the buffer of this HART to the console */
+void sbi_console_drain(void);
+
+/** Write the buffers of all HARTs to the console */
+void sbi_console_flush(void);
+
+#else
+
+static inline int sbi_console_buffer_init(struct sbi_scratch *scratch)
+{
+	return 0;
+}
+
+static inline void sbi_console_drain(void) { }
+
+static inline void sbi_console_flush(void) { }
+
+#endif
+
 #define SBI_ASSERT(cond, args) do { \
 	if (unlikely(!(cond))) \
 		sbi_panic args; \
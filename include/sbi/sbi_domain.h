@@ -160,6 +160,9 @@ struct sbi_domain_memregion {
 	unsigned long flags;
 };
 
+/* Opaque declaration of the sorted memory region index */
+struct sbi_domain_memindex;
+
 /** Representation of OpenSBI domain */
 struct sbi_domain {
 	/** Node in linked list of domains */
@@ -178,6 +181,10 @@ struct sbi_domain {
 	const struct sbi_hartmask *possible_harts;
 	/** Array of memory regions terminated by a region with order zero */
 	struct sbi_domain_memregion *regions;
+	/** Sorted disjoint intervals of the regions, built when sanitized */
+	struct sbi_domain_memindex *memindex;
+	/** Number of entries in memindex */
+	u32 memindex_count;
 	/** HART id of the HART booting this domain */
 	u32 boot_hartid;
 	/** Arg1 (or 'a1' register) of next booting stage for this domain */
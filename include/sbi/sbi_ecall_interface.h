@@ -12,7 +12,9 @@
 
 /* clang-format off */
 
+#ifndef __ASSEMBLER__
 #include <sbi/sbi_types.h>
+#endif
 
 /* SBI Extension IDs */
 #define SBI_EXT_0_1_SET_TIMER			0x0
@@ -126,6 +128,9 @@
 #define SBI_EXT_FWFT_SET		0x0
 #define SBI_EXT_FWFT_GET		0x1
 
+/* The IDs above and the error codes below are usable from assembly */
+#ifndef __ASSEMBLER__
+
 enum sbi_fwft_feature_t {
 	SBI_FWFT_MISALIGNED_EXC_DELEG		= 0x0,
 	SBI_FWFT_LANDING_PAD			= 0x1,
@@ -144,6 +149,10 @@ enum sbi_fwft_feature_t {
 	SBI_FWFT_GLOBAL_PLATFORM_END		= 0xffffffff,
 };
 
+/* Firmware specific features in the local platform range */
+#define SBI_FWFT_ISA_EMU_GROUPS			SBI_FWFT_LOCAL_PLATFORM_START
+#define SBI_FWFT_ISA_EMU_HOT_THRESHOLD		(SBI_FWFT_LOCAL_PLATFORM_START + 1)
+
 #define SBI_FWFT_GLOBAL_FEATURE_BIT		(1 << 31)
 #define SBI_FWFT_PLATFORM_FEATURE_BIT		(1 << 30)
 
@@ -403,6 +412,9 @@ enum sbi_sse_state {
 #define SBI_SSE_EVENT_LOCAL_PLAT_0_START	0x00004000
 #define SBI_SSE_EVENT_LOCAL_PLAT_0_END		0x00007fff
 
+/* Firmware specific events in the local platform range */
+#define SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE	SBI_SSE_EVENT_LOCAL_PLAT_0_START
+
 #define SBI_SSE_EVENT_GLOBAL_HIGH_PRIO_RAS	0x00008000
 #define SBI_SSE_EVENT_GLOBAL_RESERVED_0_START	0x00008001
 #define SBI_SSE_EVENT_GLOBAL_RESERVED_0_END	0x0000bfff
@@ -460,6 +472,51 @@ enum sbi_sse_state {
 #define SBI_EXT_MPXY_SEND_MSG_WITHOUT_RESP	0x6
 #define SBI_EXT_MPXY_GET_NOTIFICATION_EVENTS	0x7
 
+/*
+ * SBI function IDs for RFENCE hint extension, which take the arguments of
+ * the RFENCE functions of the same name followed by the size in bytes of
+ * the leaf mappings of the range, e.g. 2 MiB for a range of huge pages
+ */
+#define SBI_EXT_RFENCE_HINT_REMOTE_SFENCE_VMA		0x0
+#define SBI_EXT_RFENCE_HINT_REMOTE_SFENCE_VMA_ASID	0x1
+
+/* SBI function IDs for ISA emulation extension */
+#define SBI_EXT_ISA_EMU_GET_TRAP_COST		0x0
+#define SBI_EXT_ISA_EMU_GET_COST		0x1
+#define SBI_EXT_ISA_EMU_READ_HOT_SITE		0x2
+
+enum sbi_isa_emu_group_id {
+	SBI_ISA_EMU_GROUP_ZBA		= 0,
+	SBI_ISA_EMU_GROUP_ZBB		= 1,
+	SBI_ISA_EMU_GROUP_ZBC		= 2,
+	SBI_ISA_EMU_GROUP_ZBS		= 3,
+	SBI_ISA_EMU_GROUP_ZICOND	= 4,
+	SBI_ISA_EMU_GROUP_ZIMOP		= 5,
+	SBI_ISA_EMU_GROUP_ZCMOP		= 6,
+	SBI_ISA_EMU_GROUP_ZCB		= 7,
+	SBI_ISA_EMU_GROUP_ZAWRS		= 8,
+	SBI_ISA_EMU_GROUP_ZICBOM	= 9,
+	SBI_ISA_EMU_GROUP_ZICBOZ	= 10,
+	SBI_ISA_EMU_GROUP_ZFHMIN	= 11,
+	SBI_ISA_EMU_GROUP_ZFA		= 12,
+	SBI_ISA_EMU_GROUP_ZVBB		= 13,
+	SBI_ISA_EMU_GROUP_ZKND		= 14,
+	SBI_ISA_EMU_GROUP_ZKNE		= 15,
+	SBI_ISA_EMU_GROUP_ZKNH		= 16,
+	SBI_ISA_EMU_GROUP_ZVFH		= 17,
+	SBI_ISA_EMU_GROUP_MAX,
+};
+
+/** Hot emulation site report, see SBI_EXT_ISA_EMU_READ_HOT_SITE */
+struct sbi_isa_emu_hot_site {
+	unsigned long pc;
+	unsigned long insn;
+	unsigned long group;
+	unsigned long count;
+};
+
+#endif
+
 /* SBI base specification related macros */
 #define SBI_SPEC_VERSION_MAJOR_OFFSET		24
 #define SBI_SPEC_VERSION_MAJOR_MASK		0x7f
@@ -471,6 +528,10 @@ enum sbi_sse_state {
 #define SBI_EXT_FIRMWARE_START			0x0A000000
 #define SBI_EXT_FIRMWARE_END			0x0AFFFFFF
 
+/* Firmware specific extensions (low 24 bits hold the SBI implementation ID) */
+#define SBI_EXT_ISA_EMU				0x0A000001
+#define SBI_EXT_RFENCE_HINT			0x0A000002
+
 /* SBI return error codes */
 #define SBI_SUCCESS				0
 #define SBI_ERR_FAILED				-1
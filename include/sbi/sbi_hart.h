@@ -81,6 +81,12 @@ enum sbi_hart_extensions {
 	SBI_HART_EXT_SSCTR,
 	/** HART has Ssstateen extension **/
 	SBI_HART_EXT_SSSTATEEN,
+	/** Hart has T-Head vector extension (RVV 0.7.1) */
+	SBI_HART_EXT_XTHEADVECTOR,
+	/** Hart has T-Head conditional move extension */
+	SBI_HART_EXT_XTHEADCONDMOV,
+	/** Hart has Svinval extension */
+	SBI_HART_EXT_SVINVAL,
 
 	/** Maximum index of Hart extension */
 	SBI_HART_EXT_MAX,
@@ -128,6 +134,12 @@ struct sbi_hart_features {
 	unsigned int pmp_log2gran;
 	unsigned int mhpm_mask;
 	unsigned int mhpm_bits;
+	/* Bitmap of emulated extension groups implemented in hardware */
+	unsigned long emu_groups_native;
+	/* MTVAL holds the encoding of illegal 16-bit instructions */
+	bool tval_insn16;
+	/* Single letter extensions, BIT(0) is 'A', also without MISA CSR */
+	unsigned long misa;
 };
 
 struct sbi_scratch;
@@ -158,6 +170,10 @@ bool sbi_hart_has_extension(struct sbi_scratch *scratch,
 void sbi_hart_get_extensions_str(struct sbi_scratch *scratch,
 				 char *extension_str, int nestr);
 bool sbi_hart_has_csr(struct sbi_scratch *scratch, enum sbi_hart_csrs csr);
+unsigned long sbi_hart_emu_groups_native(struct sbi_scratch *scratch);
+bool sbi_hart_tval_insn16(struct sbi_scratch *scratch);
+bool sbi_hart_features_detected(struct sbi_scratch *scratch);
+bool sbi_hart_has_misa_extension(struct sbi_scratch *scratch, char ext);
 
 void __attribute__((noreturn)) sbi_hart_hang(void);
 
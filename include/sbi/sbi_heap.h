@@ -76,6 +76,14 @@ static inline unsigned long sbi_heap_free_space(void)
 	return sbi_heap_free_space_from(&global_hpctrl);
 }
 
+/** Amount (in bytes) of free slab objects kept for their size class */
+unsigned long sbi_heap_cached_space_from(struct sbi_heap_control *hpctrl);
+
+static inline unsigned long sbi_heap_cached_space(void)
+{
+	return sbi_heap_cached_space_from(&global_hpctrl);
+}
+
 /** Amount (in bytes) of used space in the heap area */
 unsigned long sbi_heap_used_space_from(struct sbi_heap_control *hpctrl);
 
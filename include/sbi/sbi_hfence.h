@@ -36,4 +36,16 @@ void __sbi_hfence_vvma_va(unsigned long va);
 /** Invalidate all possible Stage2 TLBs */
 void __sbi_hfence_vvma_all(void);
 
+/** Order earlier stores before the following SINVAL.VMA (Svinval) */
+void __sbi_sfence_w_inval(void);
+
+/** Order the preceding SINVAL.VMA before later implicit references */
+void __sbi_sfence_inval_ir(void);
+
+/** Invalidate TLB entries for given ASID and virtual address (Svinval) */
+void __sbi_sinval_vma_asid_va(unsigned long va, unsigned long asid);
+
+/** Invalidate TLB entries for given virtual address (Svinval) */
+void __sbi_sinval_vma_va(unsigned long va);
+
 #endif
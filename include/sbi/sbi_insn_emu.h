@@ -10,8 +10,44 @@
 #ifndef __SBI_INSN_EMU_H__
 #define __SBI_INSN_EMU_H__
 
+#include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_types.h>
 
+struct sbi_scratch;
+struct sbi_trap_regs;
+
+/** Bitmap of all emulated extension groups */
+#define SBI_ISA_EMU_GROUP_ALL	((1UL << SBI_ISA_EMU_GROUP_MAX) - 1)
+
+/** Get the ISA string name of an emulated extension group */
+const char *sbi_insn_emu_group_name(u32 group);
+
+/**
+ * Get the emulated extension group of an instruction
+ *
+ * @return group ID or SBI_ISA_EMU_GROUP_MAX if the instruction is not
+ * part of any group
+ */
+u32 sbi_insn_emu_group_of(ulong insn);
+
+/** Get the enabled extension groups of the current domain on this HART */
+unsigned long sbi_insn_emu_get_groups(void);
+
+/** Set the enabled extension groups of the current domain on this HART */
+int sbi_insn_emu_set_groups(unsigned long value);
+
+/**
+ * Get the extension groups which trap and get emulated on the HART of
+ * scratch for the domain of that HART, i.e. enabled ones that are not
+ * native. The HART must have detected its features.
+ */
+unsigned long sbi_insn_emu_groups_emulated(struct sbi_scratch *scratch);
+
+/** Check whether an instruction may be emulated on this HART */
+bool sbi_insn_emu_allowed(ulong insn);
+
+int sbi_insn_emu_init(struct sbi_scratch *scratch, bool cold_boot);
+
 int sbi_insn_emu_op_imm(ulong insn, struct sbi_trap_regs *regs);
 int sbi_insn_emu_op(ulong insn, struct sbi_trap_regs *regs);
 int sbi_insn_emu_op_32(ulong insn, struct sbi_trap_regs *regs);
@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __SBI_INSN_EMU_CALIB_H__
+#define __SBI_INSN_EMU_CALIB_H__
+
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_types.h>
+
+struct sbi_scratch;
+
+#ifdef CONFIG_SBI_INSN_EMU_CALIBRATION
+
+/**
+ * Measure the average emulation cost of each extension group on the
+ * calling HART and store the results in its scratch space
+ */
+int sbi_insn_emu_calib_init(struct sbi_scratch *scratch, bool cold_boot);
+
+/** Print the cost table of a HART */
+void sbi_insn_emu_calib_dump(struct sbi_scratch *scratch, const char *prefix);
+
+/** Get the round-trip cost of an M-mode trap in cycles */
+int sbi_insn_emu_calib_trap_cost(u32 hartid, unsigned long *out_cycles);
+
+/** Get the average handler cost of an emulated extension group in cycles */
+int sbi_insn_emu_calib_cost(u32 hartid, u32 group, unsigned long *out_cycles);
+
+#else
+
+static inline int sbi_insn_emu_calib_init(struct sbi_scratch *scratch,
+					  bool cold_boot)
+{
+	return 0;
+}
+
+static inline void sbi_insn_emu_calib_dump(struct sbi_scratch *scratch,
+					   const char *prefix) { }
+
+static inline int sbi_insn_emu_calib_trap_cost(u32 hartid,
+					       unsigned long *out_cycles)
+{
+	return SBI_ENOTSUPP;
+}
+
+static inline int sbi_insn_emu_calib_cost(u32 hartid, u32 group,
+					  unsigned long *out_cycles)
+{
+	return SBI_ENOTSUPP;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __SBI_INSN_EMU_CRYPTO_H__
+#define __SBI_INSN_EMU_CRYPTO_H__
+
+#include <sbi/sbi_types.h>
+
+struct sbi_trap_regs;
+
+int sbi_insn_emu_crypto_op_imm(ulong insn, struct sbi_trap_regs *regs);
+int sbi_insn_emu_crypto_op(ulong insn, struct sbi_trap_regs *regs);
+
+#endif
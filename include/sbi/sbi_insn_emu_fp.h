@@ -12,6 +12,30 @@
 
 #include <sbi/sbi_types.h>
 
+struct sbi_trap_regs;
+
+#define RM_FIELD_RNE 0
+#define RM_FIELD_RTZ 1
+#define RM_FIELD_RDN 2
+#define RM_FIELD_RUP 3
+#define RM_FIELD_RMM 4
+#define RM_FIELD_DYN 7
+
+#define FFLAG_INEXACT 0x01
+#define FFLAG_UNDERFLOW 0x02
+#define FFLAG_OVERFLOW 0x04
+#define FFLAG_DIVIDE_BY_ZERO 0x08
+#define FFLAG_INVALID_OPERATION 0x10
+
+/*
+ * Half-precision conversions shared with the vector emulation. The
+ * exception flags are ORed into *fcsr and rm must be a static rounding
+ * mode (RM_FIELD_RNE to RM_FIELD_RMM).
+ */
+u32 convert_f16_to_f32(u16 val, u32 *fcsr);
+u64 convert_f16_to_f64(u16 val, u32 *fcsr);
+u16 convert_f64_to_f16(u64 val, u32 *fcsr, int rm);
+
 int sbi_insn_emu_load_fp(ulong insn, struct sbi_trap_regs *regs);
 int sbi_insn_emu_store_fp(ulong insn, struct sbi_trap_regs *regs);
 int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs);
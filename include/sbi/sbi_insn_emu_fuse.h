@@ -0,0 +1,51 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __SBI_INSN_EMU_FUSE_H__
+#define __SBI_INSN_EMU_FUSE_H__
+
+#include <sbi/sbi_types.h>
+
+struct sbi_trap_regs;
+
+#ifdef CONFIG_SBI_INSN_EMU_FUSION
+
+/**
+ * Retire an idiom that starts with the trapping instruction at mepc
+ *
+ * Fetches the instructions following mepc when the trapping instruction
+ * can start an idiom and retires all of them at once.
+ *
+ * @return true if the idiom was retired and false if the caller has to
+ * emulate the trapping instruction on its own
+ */
+bool sbi_insn_emu_fuse(ulong insn, struct sbi_trap_regs *regs);
+
+/**
+ * Retire an idiom from a window of already fetched instructions
+ *
+ * @param insn the instructions starting at mepc
+ * @param count number of instructions in the window
+ *
+ * @return true if the leading instructions of the window form an idiom,
+ * which was retired, and false otherwise
+ */
+bool sbi_insn_emu_fuse_window(const ulong *insn, int count,
+			      struct sbi_trap_regs *regs);
+
+#else
+
+static inline bool sbi_insn_emu_fuse(ulong insn, struct sbi_trap_regs *regs)
+{
+	return false;
+}
+
+#endif
+
+#endif
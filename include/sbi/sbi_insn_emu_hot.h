@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __SBI_INSN_EMU_HOT_H__
+#define __SBI_INSN_EMU_HOT_H__
+
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_types.h>
+
+struct sbi_scratch;
+
+#ifdef CONFIG_SBI_INSN_EMU_HOT_SITES
+
+/** Allocate the per-HART site table and register the SSE event */
+int sbi_insn_emu_hot_init(struct sbi_scratch *scratch, bool cold_boot);
+
+/**
+ * Count one successful emulation of an instruction at a given PC and
+ * inject SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE when the site crosses the
+ * threshold of this HART
+ */
+void sbi_insn_emu_hot_record(ulong pc, ulong insn);
+
+/** Set the hot site threshold of this HART, zero disables counting */
+int sbi_insn_emu_hot_set_threshold(unsigned long threshold);
+
+/** Get the hot site threshold of this HART */
+int sbi_insn_emu_hot_get_threshold(unsigned long *threshold);
+
+/**
+ * Copy the pending hot site report of this HART to supervisor memory
+ * and acknowledge it
+ */
+int sbi_insn_emu_hot_read(unsigned long phys_lo, unsigned long phys_hi);
+
+#else
+
+static inline int sbi_insn_emu_hot_init(struct sbi_scratch *scratch,
+					bool cold_boot)
+{
+	return 0;
+}
+
+static inline void sbi_insn_emu_hot_record(ulong pc, ulong insn) { }
+
+static inline int sbi_insn_emu_hot_set_threshold(unsigned long threshold)
+{
+	return SBI_ENOTSUPP;
+}
+
+static inline int sbi_insn_emu_hot_get_threshold(unsigned long *threshold)
+{
+	return SBI_ENOTSUPP;
+}
+
+static inline int sbi_insn_emu_hot_read(unsigned long phys_lo,
+					unsigned long phys_hi)
+{
+	return SBI_ENOTSUPP;
+}
+
+#endif
+
+#endif
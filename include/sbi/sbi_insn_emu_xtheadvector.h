@@ -0,0 +1,63 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __SBI_INSN_EMU_XTHEADVECTOR_H__
+#define __SBI_INSN_EMU_XTHEADVECTOR_H__
+
+#include <sbi/sbi_types.h>
+
+struct sbi_scratch;
+struct sbi_trap_regs;
+
+#if defined(CONFIG_SBI_INSN_EMU_XTHEADVECTOR) && __riscv_xlen == 64
+
+/** Check whether RVV 1.0 instructions are translated on the given HART */
+bool sbi_insn_emu_xtheadvector_hart_active(struct sbi_scratch *scratch);
+
+/** Check whether RVV 1.0 instructions are translated on the calling HART */
+bool sbi_insn_emu_xtheadvector_active(void);
+
+/**
+ * Translate a trapping RVV 1.0 instruction to XTheadVector
+ *
+ * Handles OP-V as well as LOAD-FP/STORE-FP with a vector width. Vector
+ * instructions that trap because the preceding vsetvli/vsetvl left vill
+ * set are resumed after replaying the vsetvli with a translated vtype.
+ *
+ * @return 0 on success and the result of truly_illegal_insn() otherwise
+ */
+int sbi_insn_emu_xtheadvector(ulong insn, struct sbi_trap_regs *regs);
+
+int sbi_insn_emu_xtheadvector_init(struct sbi_scratch *scratch,
+				   bool cold_boot);
+
+#else
+
+static inline bool sbi_insn_emu_xtheadvector_hart_active(
+					struct sbi_scratch *scratch)
+{
+	return false;
+}
+
+static inline bool sbi_insn_emu_xtheadvector_active(void)
+{
+	return false;
+}
+
+#define sbi_insn_emu_xtheadvector truly_illegal_insn
+
+static inline int sbi_insn_emu_xtheadvector_init(struct sbi_scratch *scratch,
+						 bool cold_boot)
+{
+	return 0;
+}
+
+#endif
+
+#endif
@@ -11,6 +11,7 @@
 #define __SBI_IPI_H__
 
 #include <sbi/sbi_types.h>
+#include <sbi/sbi_hartmask.h>
 
 /* clang-format off */
 
@@ -26,6 +27,13 @@ struct sbi_ipi_device {
 	/** Send IPI to a target HART index */
 	void (*ipi_send)(u32 hart_index);
 
+	/**
+	 * Send IPI to all HART indices of a mask (optional)
+	 * Note: Called instead of ipi_send() for multicasts, so the device
+	 * can issue the writes back to back.
+	 */
+	void (*ipi_send_many)(const struct sbi_hartmask *mask);
+
 	/** Clear IPI for the current hart */
 	void (*ipi_clear)(void);
 };
@@ -34,6 +42,7 @@ enum sbi_ipi_update_type {
 	SBI_IPI_UPDATE_SUCCESS,
 	SBI_IPI_UPDATE_BREAK,
 	SBI_IPI_UPDATE_RETRY,
+	SBI_IPI_UPDATE_COALESCED,
 };
 
 struct sbi_scratch;
@@ -51,6 +60,8 @@ struct sbi_ipi_event_ops {
 	 * @return SBI_IPI_UPDATE_SUCCESS, success
 	 * @return SBI_IPI_UPDATE_BREAK, break IPI, done on local hart
 	 * @return SBI_IPI_UPDATE_RETRY, need retry
+	 * @return SBI_IPI_UPDATE_COALESCED, merged into data that the
+	 * remote HART has not processed yet, no new IPI needed
 	 */
 	int (* update)(struct sbi_scratch *scratch,
 			struct sbi_scratch *remote_scratch,
@@ -85,8 +96,20 @@ int sbi_ipi_send_halt(ulong hmask, ulong hbase);
 
 void sbi_ipi_process(void);
 
+#ifdef CONFIG_SBI_IPI_FANOUT
+/*
+ * Raise the IPIs this HART forwards as a fanout leader. HARTs waiting for
+ * other HARTs in M-mode must call this, as they do not take the IPI.
+ */
+void sbi_ipi_forward_pending(void);
+#else
+static inline void sbi_ipi_forward_pending(void) { }
+#endif
+
 int sbi_ipi_raw_send(u32 hartindex);
 
+int sbi_ipi_raw_send_many(const struct sbi_hartmask *mask);
+
 void sbi_ipi_raw_clear(void);
 
 const struct sbi_ipi_device *sbi_ipi_get_device(void);
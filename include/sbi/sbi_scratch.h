@@ -48,8 +48,12 @@
 #define SBI_SCRATCH_SW_PM			(15 * __SIZEOF_POINTER__)
 /** Offset of emulated SENVCFG CSR */
 #define SBI_SCRATCH_SW_SENVCFG			(16 * __SIZEOF_POINTER__)
+/** Offset of ecall_fast_timecmp member in sbi_scratch */
+#define SBI_SCRATCH_ECALL_FAST_TIMECMP_OFFSET	(17 * __SIZEOF_POINTER__)
+/** Offset of ecall_fast_defer member in sbi_scratch */
+#define SBI_SCRATCH_ECALL_FAST_DEFER_OFFSET	(18 * __SIZEOF_POINTER__)
 /** Offset of extra space in sbi_scratch */
-#define SBI_SCRATCH_EXTRA_SPACE_OFFSET		(17 * __SIZEOF_POINTER__)
+#define SBI_SCRATCH_EXTRA_SPACE_OFFSET		(19 * __SIZEOF_POINTER__)
 /** Maximum size of sbi_scratch (4KB) */
 #define SBI_SCRATCH_SIZE			(0x1000)
 
@@ -95,6 +99,10 @@ struct sbi_scratch {
 	unsigned long sw_pm;
 	/** Emulated SENVCFG CSR */
 	unsigned long sw_senvcfg;
+	/** Time compare register of the ecall fast path (0 if disabled) */
+	unsigned long ecall_fast_timecmp;
+	/** Non-zero if work for the trap exit of the C path is pending */
+	unsigned long ecall_fast_defer;
 };
 
 /**
@@ -118,6 +126,8 @@ assert_member_offset(struct sbi_scratch, options, SBI_SCRATCH_OPTIONS_OFFSET);
 assert_member_offset(struct sbi_scratch, hartindex, SBI_SCRATCH_HARTINDEX_OFFSET);
 assert_member_offset(struct sbi_scratch, sw_pm, SBI_SCRATCH_SW_PM);
 assert_member_offset(struct sbi_scratch, sw_senvcfg, SBI_SCRATCH_SW_SENVCFG);
+assert_member_offset(struct sbi_scratch, ecall_fast_timecmp, SBI_SCRATCH_ECALL_FAST_TIMECMP_OFFSET);
+assert_member_offset(struct sbi_scratch, ecall_fast_defer, SBI_SCRATCH_ECALL_FAST_DEFER_OFFSET);
 
 /** Possible options for OpenSBI library */
 enum sbi_scratch_options {
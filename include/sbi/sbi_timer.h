@@ -92,6 +92,15 @@ void sbi_timer_event_start(u64 next_event);
 /** Process timer event for current HART */
 void sbi_timer_process(void);
 
+/**
+ * Set the MMIO time compare register of current HART for the ecall
+ * fast path, or NULL if the timer device can not be programmed directly
+ */
+void sbi_timer_set_fast_timecmp(volatile u64 *timecmp);
+
+/** Disable the ecall fast path of a HART while its ecalls must be counted */
+void sbi_timer_fast_inhibit(struct sbi_scratch *scratch, bool inhibit);
+
 /** Get current timer device */
 const struct sbi_timer_device *sbi_timer_get_device(void);
 
@@ -36,6 +36,8 @@ enum sbi_tlb_type {
 struct sbi_tlb_info {
 	unsigned long start;
 	unsigned long size;
+	/* Mapping granularity of the range in bytes, 0 for PAGE_SIZE */
+	unsigned long stride;
 	uint16_t asid;
 	uint16_t vmid;
 	enum sbi_tlb_type type;
@@ -46,6 +48,7 @@ struct sbi_tlb_info {
 do { \
 	(__p)->start = (__start); \
 	(__p)->size = (__size); \
+	(__p)->stride = 0; \
 	(__p)->asid = (__asid); \
 	(__p)->vmid = (__vmid); \
 	(__p)->type = (__type); \
@@ -54,6 +57,15 @@ do { \
 
 #define SBI_TLB_INFO_SIZE		sizeof(struct sbi_tlb_info)
 
+/** Entry of the per-HART queue of remote fence requests */
+struct sbi_tlb_slot {
+	/* Queue position and state of the entry */
+	unsigned long seq;
+	struct sbi_tlb_info info;
+};
+
+#define SBI_TLB_SLOT_SIZE		sizeof(struct sbi_tlb_slot)
+
 int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo);
 
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot);
@@ -14,6 +14,8 @@
 struct sbiunit_test_case {
 	const char *name;
 	bool failed;
+	/* The preconditions of the test were not met */
+	bool skipped;
 	void (*test_func)(struct sbiunit_test_case *test);
 };
 
@@ -27,6 +29,7 @@ struct sbiunit_test_suite {
 	{				\
 		.name = #func,		\
 		.failed = false,	\
+		.skipped = false,	\
 		.test_func = (func)	\
 	}
 
@@ -45,6 +48,11 @@ struct sbiunit_test_suite {
 #define SBIUNIT_INFO(test, msg) sbi_printf(_sbiunit_msg(test, msg))
 #define SBIUNIT_PANIC(test, msg) sbi_panic(_sbiunit_msg(test, msg))
 
+#define SBIUNIT_SKIP(test, msg) do {	\
+	test->skipped = true;		\
+	SBIUNIT_INFO(test, msg);	\
+} while (0)
+
 #define SBIUNIT_EXPECT(test, cond) do {							\
 	if (!(cond)) {									\
 		test->failed = true;							\
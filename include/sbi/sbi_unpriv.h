@@ -38,4 +38,28 @@ DECLARE_UNPRIVILEGED_LOAD_FUNCTION(ulong)
 
 ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap);
 
+#define SBI_UNPRIV_STORE		(1 << 0)
+#define SBI_UNPRIV_SIGNED		(1 << 1)
+
+/** One access of sbi_unpriv_batch() */
+struct sbi_unpriv_access {
+	ulong addr;
+	/* Value to store, or the loaded value extended to XLEN */
+	ulong val;
+	/* Size in bytes, up to sizeof(ulong) */
+	u8 size;
+	/* SBI_UNPRIV_STORE and SBI_UNPRIV_SIGNED */
+	u8 flags;
+};
+
+/**
+ * Perform unprivileged accesses in order, switching MTVEC only once
+ *
+ * Stops at the first access that faults, which is described by trap.
+ *
+ * @return number of completed accesses
+ */
+int sbi_unpriv_batch(struct sbi_unpriv_access *acc, int count,
+		     struct sbi_trap_info *trap);
+
 #endif
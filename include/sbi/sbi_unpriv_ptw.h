@@ -0,0 +1,71 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __SBI_UNPRIV_PTW_H__
+#define __SBI_UNPRIV_PTW_H__
+
+#include <sbi/sbi_types.h>
+
+struct sbi_scratch;
+struct sbi_trap_info;
+
+/** Access types of software translated unprivileged accesses */
+#define SBI_UNPRIV_PTW_READ		(1UL << 0)
+#define SBI_UNPRIV_PTW_WRITE		(1UL << 1)
+/** Read with MXR forced on, as done for instruction fetches */
+#define SBI_UNPRIV_PTW_MXR		(1UL << 2)
+
+#if defined(CONFIG_SBI_UNPRIV_PTW) && __riscv_xlen == 64
+
+/**
+ * Translate the address of an unprivileged access in software
+ *
+ * The translation follows what an access with MSTATUS_MPRV set would do
+ * for the privilege mode in MSTATUS_MPP. Only naturally aligned accesses
+ * to memory that the current domain grants to S/U-mode are handled,
+ * everything the walker cannot decide with certainty (MMIO, Svpbmt,
+ * Svnapot, A/D updates, virtualization, pointer masking) is left to the
+ * MPRV path.
+ *
+ * @return true if either *paddr or a page fault in trap is valid and
+ * false if the caller has to use the MPRV path
+ */
+bool sbi_unpriv_ptw_translate(ulong vaddr, ulong size, ulong access,
+			      ulong *paddr, struct sbi_trap_info *trap);
+
+/** Invalidate the micro-TLB of the calling HART */
+void sbi_unpriv_ptw_flush(void);
+
+/** Enable or disable software translation on the calling HART */
+void sbi_unpriv_ptw_enable(bool enable);
+
+int sbi_unpriv_ptw_init(struct sbi_scratch *scratch, bool cold_boot);
+
+#else
+
+static inline bool sbi_unpriv_ptw_translate(ulong vaddr, ulong size,
+					    ulong access, ulong *paddr,
+					    struct sbi_trap_info *trap)
+{
+	return false;
+}
+
+static inline void sbi_unpriv_ptw_flush(void) { }
+
+static inline void sbi_unpriv_ptw_enable(bool enable) { }
+
+static inline int sbi_unpriv_ptw_init(struct sbi_scratch *scratch,
+				      bool cold_boot)
+{
+	return 0;
+}
+
+#endif
+
+#endif
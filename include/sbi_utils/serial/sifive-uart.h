@@ -12,6 +12,7 @@
 
 #include <sbi/sbi_types.h>
 
-int sifive_uart_init(unsigned long base, u32 in_freq, u32 baudrate);
+int sifive_uart_init(unsigned long base, u32 in_freq, u32 baudrate,
+		     u32 fifo_size);
 
 #endif
@@ -15,6 +15,6 @@
 #define UART_CAP_UUE	BIT(0)	/* Check UUE capability for XScale PXA UARTs */
 
 int uart8250_init(unsigned long base, u32 in_freq, u32 baudrate, u32 reg_shift,
-		  u32 reg_width, u32 reg_offset, u32 caps);
+		  u32 reg_width, u32 reg_offset, u32 caps, u32 fifo_size);
 
 #endif
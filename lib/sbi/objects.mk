@@ -64,6 +64,12 @@ libsbi-objs-$(CONFIG_SBI_ECALL_SSE) += sbi_ecall_sse.o
 carray-sbi_ecall_exts-$(CONFIG_SBI_ECALL_MPXY) += ecall_mpxy
 libsbi-objs-$(CONFIG_SBI_ECALL_MPXY) += sbi_ecall_mpxy.o
 
+carray-sbi_ecall_exts-$(CONFIG_SBI_ECALL_ISA_EMU) += ecall_isa_emu
+libsbi-objs-$(CONFIG_SBI_ECALL_ISA_EMU) += sbi_ecall_isa_emu.o
+
+carray-sbi_ecall_exts-$(CONFIG_SBI_ECALL_RFENCE_HINT) += ecall_rfence_hint
+libsbi-objs-$(CONFIG_SBI_ECALL_RFENCE_HINT) += sbi_ecall_rfence_hint.o
+
 libsbi-objs-y += sbi_bitmap.o
 libsbi-objs-y += sbi_bitops.o
 libsbi-objs-y += sbi_console.o
@@ -82,8 +88,13 @@ libsbi-objs-y += sbi_hsm.o
 libsbi-objs-y += sbi_illegal_atomic.o
 libsbi-objs-y += sbi_illegal_insn.o
 libsbi-objs-y += sbi_insn_emu.o
+libsbi-objs-y += sbi_insn_emu_crypto.o
 libsbi-objs-y += sbi_insn_emu_fp.o
 libsbi-objs-y += sbi_insn_emu_v.o
+libsbi-objs-$(CONFIG_SBI_INSN_EMU_CALIBRATION) += sbi_insn_emu_calib.o
+libsbi-objs-$(CONFIG_SBI_INSN_EMU_FUSION) += sbi_insn_emu_fuse.o
+libsbi-objs-$(CONFIG_SBI_INSN_EMU_HOT_SITES) += sbi_insn_emu_hot.o
+libsbi-objs-$(CONFIG_SBI_INSN_EMU_XTHEADVECTOR) += sbi_insn_emu_xtheadvector.o
 libsbi-objs-y += sbi_init.o
 libsbi-objs-y += sbi_ipi.o
 libsbi-objs-y += sbi_irqchip.o
@@ -101,5 +112,6 @@ libsbi-objs-y += sbi_trap.o
 libsbi-objs-y += sbi_trap_ldst.o
 libsbi-objs-y += sbi_trap_v_ldst.o
 libsbi-objs-y += sbi_unpriv.o
+libsbi-objs-$(CONFIG_SBI_UNPRIV_PTW) += sbi_unpriv_ptw.o
 libsbi-objs-y += sbi_expected_trap.o
 libsbi-objs-y += sbi_cppc.o
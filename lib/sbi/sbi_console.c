@@ -9,8 +9,11 @@
 
 #include <sbi/riscv_locks.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_error.h>
 #include <sbi/sbi_fifo.h>
 #include <sbi/sbi_hart.h>
+#include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_heap.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_string.h>
@@ -31,6 +34,186 @@ static char console_early_buffer[CONSOLE_EARLY_BUFFER_SIZE] = { 0 };
 static SBI_FIFO_DEFINE(console_early_fifo, console_early_buffer, \
 		       CONSOLE_EARLY_BUFFER_SIZE, sizeof(char));
 
+#ifdef CONFIG_CONSOLE_BUFFER
+
+#define CONSOLE_BUFFER_SIZE		CONFIG_CONSOLE_BUFFER_SIZE
+#if CONSOLE_BUFFER_SIZE & (CONSOLE_BUFFER_SIZE - 1)
+#error "CONFIG_CONSOLE_BUFFER_SIZE must be a power of two"
+#endif
+
+/*
+ * Output of one HART. Only the owning HART writes data and head, the
+ * data is written to the console device with console_out_lock held.
+ */
+struct console_buffer {
+	/* Free running indices into data */
+	u32 head;
+	u32 tail;
+	/* Format buffer of print(), used instead of console_tbuf */
+	u32 tbuf_len;
+	char tbuf[CONSOLE_TBUF_MAX];
+	char data[CONSOLE_BUFFER_SIZE];
+};
+
+/* Scratch offset of the buffer pointers, zero until buffering starts */
+static unsigned long console_buffer_offset;
+
+static struct console_buffer *console_buffer_thishart(void)
+{
+	if (!console_buffer_offset)
+		return NULL;
+
+	return sbi_scratch_read_type(sbi_scratch_thishart_ptr(), void *,
+				     console_buffer_offset);
+}
+
+static unsigned long console_buffer_put(struct console_buffer *cb,
+					const char *str, unsigned long len)
+{
+	u32 head = cb->head, off, chunk;
+	unsigned long i, n;
+
+	n = CONSOLE_BUFFER_SIZE -
+	    (head - __atomic_load_n(&cb->tail, __ATOMIC_ACQUIRE));
+	n = MIN(n, len);
+	for (i = 0; i < n; i += chunk) {
+		off = (head + i) % CONSOLE_BUFFER_SIZE;
+		chunk = MIN(n - i, CONSOLE_BUFFER_SIZE - off);
+		sbi_memcpy(&cb->data[off], &str[i], chunk);
+	}
+	__atomic_store_n(&cb->head, head + n, __ATOMIC_RELEASE);
+	/* Drained on the trap exit of the C path, see sbi_console_drain() */
+	sbi_scratch_thishart_ptr()->ecall_fast_defer = 1;
+
+	return n;
+}
+
+static void nputs_all(const char *str, unsigned long len);
+
+/*
+ * Write up to max bytes of a buffer to the console device, stopping
+ * after the last complete line if there is one. Called with
+ * console_out_lock held.
+ */
+static void console_buffer_out(struct console_buffer *cb, u32 max)
+{
+	u32 tail = cb->tail, off, chunk, i;
+	u32 n = __atomic_load_n(&cb->head, __ATOMIC_ACQUIRE) - tail;
+
+	if (n > max) {
+		for (i = max; i; i--) {
+			if (cb->data[(tail + i - 1) % CONSOLE_BUFFER_SIZE] == '\n')
+				break;
+		}
+		n = i ? i : max;
+	}
+
+	while (n) {
+		off = tail % CONSOLE_BUFFER_SIZE;
+		chunk = MIN(n, CONSOLE_BUFFER_SIZE - off);
+		nputs_all(&cb->data[off], chunk);
+		tail += chunk;
+		n -= chunk;
+	}
+	__atomic_store_n(&cb->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void console_buffer_put_all(struct console_buffer *cb,
+				   const char *str, unsigned long len)
+{
+	unsigned long n;
+
+	while (len) {
+		n = console_buffer_put(cb, str, len);
+		if (!n) {
+			/* Full, so write it out on this HART */
+			spin_lock(&console_out_lock);
+			console_buffer_out(cb, CONSOLE_BUFFER_SIZE);
+			spin_unlock(&console_out_lock);
+		}
+		str += n;
+		len -= n;
+	}
+}
+
+void sbi_console_drain(void)
+{
+	struct console_buffer *cb = console_buffer_thishart();
+
+	if (!cb || cb->tail == __atomic_load_n(&cb->head, __ATOMIC_ACQUIRE))
+		return;
+
+	/* Leave it to a later trap if another HART is writing */
+	if (spin_trylock(&console_out_lock)) {
+		console_buffer_out(cb, CONFIG_CONSOLE_BUFFER_DRAIN);
+		spin_unlock(&console_out_lock);
+	}
+
+	if (cb->tail != __atomic_load_n(&cb->head, __ATOMIC_ACQUIRE))
+		sbi_scratch_thishart_ptr()->ecall_fast_defer = 1;
+}
+
+void sbi_console_flush(void)
+{
+	struct console_buffer *cb;
+
+	if (!console_buffer_offset)
+		return;
+
+	spin_lock(&console_out_lock);
+	sbi_for_each_hartindex(i) {
+		cb = sbi_scratch_read_type(sbi_hartindex_to_scratch(i),
+					   void *, console_buffer_offset);
+		if (cb)
+			console_buffer_out(cb, CONSOLE_BUFFER_SIZE);
+	}
+	spin_unlock(&console_out_lock);
+}
+
+int sbi_console_buffer_init(struct sbi_scratch *scratch)
+{
+	struct sbi_scratch *rscratch;
+	struct console_buffer *cb;
+	unsigned long offset;
+
+	/* Without a console device the early FIFO keeps the output */
+	if (!console_dev || console_buffer_offset)
+		return 0;
+
+	offset = sbi_scratch_alloc_type_offset(void *);
+	if (!offset)
+		return SBI_ENOMEM;
+
+	sbi_for_each_hartindex(i) {
+		cb = sbi_zalloc(sizeof(*cb));
+		if (!cb)
+			goto fail_free;
+		rscratch = sbi_hartindex_to_scratch(i);
+		sbi_scratch_write_type(rscratch, void *, offset, cb);
+	}
+
+	console_buffer_offset = offset;
+	return 0;
+
+fail_free:
+	sbi_for_each_hartindex(i)
+		sbi_free(sbi_scratch_read_type(sbi_hartindex_to_scratch(i),
+					       void *, offset));
+	sbi_scratch_free_offset(offset);
+	return SBI_ENOMEM;
+}
+
+#else
+
+struct console_buffer;
+
+static inline struct console_buffer *console_buffer_thishart(void)
+{
+	return NULL;
+}
+
+#endif
+
 bool sbi_isprintable(char c)
 {
 	if (((31 < c) && (c < 127)) || (c == '\f') || (c == '\r') ||
@@ -79,23 +262,57 @@ static void nputs_all(const char *str, unsigned long len)
 		p += nputs(&str[p], len - p);
 }
 
+/*
+ * Write to the buffer of this HART if there is one, otherwise to the
+ * console device. Callers hold console_out_lock if there is no buffer.
+ */
+static void console_out(const char *str, unsigned long len)
+{
+#ifdef CONFIG_CONSOLE_BUFFER
+	struct console_buffer *cb = console_buffer_thishart();
+
+	if (cb) {
+		console_buffer_put_all(cb, str, len);
+		return;
+	}
+#endif
+	nputs_all(str, len);
+}
+
 void sbi_putc(char ch)
 {
-	nputs_all(&ch, 1);
+	console_out(&ch, 1);
 }
 
 void sbi_puts(const char *str)
 {
 	unsigned long len = sbi_strlen(str);
+	bool locked = !console_buffer_thishart();
 
-	spin_lock(&console_out_lock);
-	nputs_all(str, len);
-	spin_unlock(&console_out_lock);
+	if (locked)
+		spin_lock(&console_out_lock);
+	console_out(str, len);
+	if (locked)
+		spin_unlock(&console_out_lock);
 }
 
 unsigned long sbi_nputs(const char *str, unsigned long len)
 {
 	unsigned long ret;
+#ifdef CONFIG_CONSOLE_BUFFER
+	struct console_buffer *cb = console_buffer_thishart();
+
+	if (cb && len) {
+		ret = console_buffer_put(cb, str, len);
+		if (!ret) {
+			spin_lock(&console_out_lock);
+			console_buffer_out(cb, CONSOLE_BUFFER_SIZE);
+			spin_unlock(&console_out_lock);
+			ret = console_buffer_put(cb, str, len);
+		}
+		return ret;
+	}
+#endif
 
 	spin_lock(&console_out_lock);
 	ret = nputs(str, len);
@@ -144,6 +361,20 @@ unsigned long sbi_ngets(char *str, unsigned long len)
 #define va_arg __builtin_va_arg
 typedef __builtin_va_list va_list;
 
+static char *console_tbuf_get(u32 **len)
+{
+#ifdef CONFIG_CONSOLE_BUFFER
+	struct console_buffer *cb = console_buffer_thishart();
+
+	if (cb) {
+		*len = &cb->tbuf_len;
+		return cb->tbuf;
+	}
+#endif
+	*len = &console_tbuf_len;
+	return console_tbuf;
+}
+
 static void printc(char **out, u32 *out_len, char ch, int flags)
 {
 	if (!out) {
@@ -161,8 +392,8 @@ static void printc(char **out, u32 *out_len, char ch, int flags)
 		if (out_len) {
 			--(*out_len);
 			if ((flags & USE_TBUF) && *out_len == 1) {
-				nputs_all(console_tbuf, CONSOLE_TBUF_MAX - *out_len);
-				*out = console_tbuf;
+				*out -= CONSOLE_TBUF_MAX - 1;
+				console_out(*out, CONSOLE_TBUF_MAX - 1);
 				*out_len = CONSOLE_TBUF_MAX;
 			}
 		}
@@ -277,13 +508,12 @@ static int print(char **out, u32 *out_len, const char *format, va_list args)
 	/*
 	 * The console_tbuf is protected by console_out_lock and
 	 * print() is always called with console_out_lock held
-	 * when out == NULL.
+	 * when out == NULL, unless this HART has its own buffer.
 	 */
 	if (use_tbuf) {
-		console_tbuf_len = CONSOLE_TBUF_MAX;
-		tout = console_tbuf;
+		tout = console_tbuf_get(&out_len);
+		*out_len = CONSOLE_TBUF_MAX;
 		out = &tout;
-		out_len = &console_tbuf_len;
 	}
 
 	/* handle special case: *out_len == 1*/
@@ -400,8 +630,9 @@ literal:
 		}
 	}
 
-	if (use_tbuf && console_tbuf_len < CONSOLE_TBUF_MAX)
-		nputs_all(console_tbuf, CONSOLE_TBUF_MAX - console_tbuf_len);
+	if (use_tbuf && *out_len < CONSOLE_TBUF_MAX)
+		console_out(tout - (CONSOLE_TBUF_MAX - *out_len),
+			    CONSOLE_TBUF_MAX - *out_len);
 
 	return pc;
 }
@@ -437,16 +668,33 @@ int sbi_snprintf(char *out, u32 out_sz, const char *format, ...)
 	return retval;
 }
 
+/* Without a buffer of this HART, print() needs console_out_lock */
+static bool console_print_lock(void)
+{
+	if (console_buffer_thishart())
+		return false;
+
+	spin_lock(&console_out_lock);
+	return true;
+}
+
+static void console_print_unlock(bool locked)
+{
+	if (locked)
+		spin_unlock(&console_out_lock);
+}
+
 int sbi_printf(const char *format, ...)
 {
 	va_list args;
 	int retval;
+	bool locked;
 
-	spin_lock(&console_out_lock);
+	locked = console_print_lock();
 	va_start(args, format);
 	retval = print(NULL, NULL, format, args);
 	va_end(args);
-	spin_unlock(&console_out_lock);
+	console_print_unlock(locked);
 
 	return retval;
 }
@@ -455,13 +703,14 @@ int sbi_dprintf(const char *format, ...)
 {
 	va_list args;
 	int retval = 0;
+	bool locked;
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 
 	va_start(args, format);
 	if (scratch->options & SBI_SCRATCH_DEBUG_PRINTS) {
-		spin_lock(&console_out_lock);
+		locked = console_print_lock();
 		retval = print(NULL, NULL, format, args);
-		spin_unlock(&console_out_lock);
+		console_print_unlock(locked);
 	}
 	va_end(args);
 
@@ -471,13 +720,15 @@ int sbi_dprintf(const char *format, ...)
 void sbi_panic(const char *format, ...)
 {
 	va_list args;
+	bool locked;
 
-	spin_lock(&console_out_lock);
+	locked = console_print_lock();
 	va_start(args, format);
 	print(NULL, NULL, format, args);
 	va_end(args);
-	spin_unlock(&console_out_lock);
+	console_print_unlock(locked);
 
+	/* Also writes out the buffers */
 	sbi_hart_hang();
 }
 
@@ -494,6 +745,9 @@ void sbi_console_set_device(const struct sbi_console_device *dev)
 	if (!dev)
 		return;
 
+	/* Buffered output belongs to the previous device */
+	sbi_console_flush();
+
 	if (!console_dev)
 		flush_early_fifo = true;
 
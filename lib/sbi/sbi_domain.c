@@ -38,6 +38,22 @@ struct sbi_domain root = {
 
 static unsigned long domain_hart_ptr_offset;
 
+/* Per-HART index of the memindex entry that matched last */
+static unsigned long domain_memindex_hit_offset;
+
+/*
+ * Interval of addresses which are covered by the same smallest region,
+ * with the permissions of that region for M-mode and S/U-mode in the
+ * SBI_DOMAIN_MEMREGION_M_{READABLE/WRITABLE/EXECUTABLE} bits.
+ */
+struct sbi_domain_memindex {
+	unsigned long start;
+	unsigned long end;
+	u8 m_rwx;
+	u8 su_rwx;
+	bool mmio;
+};
+
 struct sbi_domain *sbi_hartindex_to_domain(u32 hartindex)
 {
 	struct sbi_scratch *scratch;
@@ -122,16 +138,9 @@ void sbi_domain_memregion_init(unsigned long addr,
 	}
 }
 
-bool sbi_domain_check_addr(const struct sbi_domain *dom,
-			   unsigned long addr, unsigned long mode,
-			   unsigned long access_flags)
+static unsigned long domain_access_rwx(unsigned long access_flags)
 {
-	bool rmmio, mmio = false;
-	struct sbi_domain_memregion *reg;
-	unsigned long rstart, rend, rflags, rwx = 0, rrwx = 0;
-
-	if (!dom)
-		return false;
+	unsigned long rwx = 0;
 
 	/*
 	 * Use M_{R/W/X} bits because the SU-bits are at the
@@ -147,9 +156,73 @@ bool sbi_domain_check_addr(const struct sbi_domain *dom,
 	if (access_flags & SBI_DOMAIN_EXECUTE)
 		rwx |= SBI_DOMAIN_MEMREGION_M_EXECUTABLE;
 
+	return rwx;
+}
+
+static const struct sbi_domain_memindex *memindex_find(
+						const struct sbi_domain *dom,
+						unsigned long addr)
+{
+	const struct sbi_domain_memindex *index = dom->memindex;
+	u32 lo = 0, hi = dom->memindex_count, mid, *hit = NULL;
+
+	/* Consecutive checks mostly hit the same interval */
+	if (domain_memindex_hit_offset) {
+		hit = sbi_scratch_thishart_offset_ptr(domain_memindex_hit_offset);
+		if (*hit < hi && index[*hit].start <= addr &&
+		    addr <= index[*hit].end)
+			return &index[*hit];
+	}
+
+	/* Find the last interval starting at or below the address */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (index[mid].start <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo || index[lo - 1].end < addr)
+		return NULL;
+
+	if (hit)
+		*hit = lo - 1;
+	return &index[lo - 1];
+}
+
+static bool memindex_allows(const struct sbi_domain_memindex *e,
+			    unsigned long mode, unsigned long rwx, bool mmio)
+{
+	unsigned long rrwx = (mode == PRV_M) ? e->m_rwx : e->su_rwx;
+
+	return e->mmio == mmio && (rrwx & rwx) == rwx;
+}
+
+bool sbi_domain_check_addr(const struct sbi_domain *dom,
+			   unsigned long addr, unsigned long mode,
+			   unsigned long access_flags)
+{
+	bool rmmio, mmio = false;
+	struct sbi_domain_memregion *reg;
+	const struct sbi_domain_memindex *e;
+	unsigned long rstart, rend, rflags, rwx, rrwx = 0;
+
+	if (!dom)
+		return false;
+
+	rwx = domain_access_rwx(access_flags);
+
 	if (access_flags & SBI_DOMAIN_MMIO)
 		mmio = true;
 
+	if (dom->memindex) {
+		e = memindex_find(dom, addr);
+		if (e)
+			return memindex_allows(e, mode, rwx, mmio);
+		return (mode == PRV_M) ? true : false;
+	}
+
+	/* Domains which were not sanitized have no index */
 	sbi_domain_for_each_memregion(dom, reg) {
 		rflags = reg->flags;
 		rrwx = (mode == PRV_M ?
@@ -246,6 +319,87 @@ static const struct sbi_domain_memregion *find_region(
 	return NULL;
 }
 
+/*
+ * Flatten the sorted regions of a domain into disjoint intervals sorted by
+ * address. Every address is owned by the smallest region covering it,
+ * which is the one find_region() returns. Adjacent intervals with the same
+ * permissions are merged.
+ */
+static int build_memindex(struct sbi_domain *dom)
+{
+	u32 i, j, count = 0, nbounds = 0, nindex = 0;
+	struct sbi_domain_memindex *index, *e;
+	const struct sbi_domain_memregion *reg;
+	unsigned long *bounds, start, end;
+	u8 m_rwx, su_rwx;
+	bool mmio;
+
+	sbi_domain_for_each_memregion(dom, reg)
+		count++;
+
+	bounds = sbi_malloc(2 * count * sizeof(*bounds));
+	index = sbi_calloc(sizeof(*index), 2 * count);
+	if (!bounds || !index) {
+		sbi_free(bounds);
+		sbi_free(index);
+		return SBI_ENOMEM;
+	}
+
+	/* Intervals start at each region and right after each region */
+	sbi_domain_for_each_memregion(dom, reg) {
+		bounds[nbounds++] = reg->base;
+		if (reg->order < __riscv_xlen)
+			bounds[nbounds++] = reg->base + BIT(reg->order);
+	}
+
+	/* Sort the boundaries and drop the duplicates */
+	for (i = 1; i < nbounds; i++) {
+		start = bounds[i];
+		for (j = i; j && start < bounds[j - 1]; j--)
+			bounds[j] = bounds[j - 1];
+		bounds[j] = start;
+	}
+	for (i = 1, j = 1; i < nbounds; i++) {
+		if (bounds[i] != bounds[j - 1])
+			bounds[j++] = bounds[i];
+	}
+	nbounds = j;
+
+	for (i = 0; i < nbounds; i++) {
+		start = bounds[i];
+		end = (i + 1 < nbounds) ? bounds[i + 1] - 1 : -1UL;
+		reg = find_region(dom, start);
+		if (!reg)
+			continue;
+
+		m_rwx = reg->flags & SBI_DOMAIN_MEMREGION_M_ACCESS_MASK;
+		su_rwx = (reg->flags & SBI_DOMAIN_MEMREGION_SU_ACCESS_MASK) >>
+			 SBI_DOMAIN_MEMREGION_SU_ACCESS_SHIFT;
+		mmio = (reg->flags & SBI_DOMAIN_MEMREGION_MMIO) ? true : false;
+
+		e = nindex ? &index[nindex - 1] : NULL;
+		if (e && e->end + 1 == start && e->m_rwx == m_rwx &&
+		    e->su_rwx == su_rwx && e->mmio == mmio) {
+			e->end = end;
+			continue;
+		}
+
+		e = &index[nindex++];
+		e->start = start;
+		e->end = end;
+		e->m_rwx = m_rwx;
+		e->su_rwx = su_rwx;
+		e->mmio = mmio;
+	}
+
+	sbi_free(bounds);
+	sbi_free(dom->memindex);
+	dom->memindex = index;
+	dom->memindex_count = nindex;
+
+	return 0;
+}
+
 static const struct sbi_domain_memregion *find_next_subset_region(
 				const struct sbi_domain *dom,
 				const struct sbi_domain_memregion *reg,
@@ -283,6 +437,7 @@ static void clear_region(struct sbi_domain_memregion* reg)
 
 static int sanitize_domain(struct sbi_domain *dom)
 {
+	int rc;
 	u32 i, j, count;
 	bool is_covered;
 	struct sbi_domain_memregion *reg, *reg1;
@@ -368,6 +523,14 @@ static int sanitize_domain(struct sbi_domain *dom)
 			i++;
 	}
 
+	/* Index the sorted regions for sbi_domain_check_addr() */
+	rc = build_memindex(dom);
+	if (rc) {
+		sbi_printf("%s: %s no memory for region index\n",
+			   __func__, dom->name);
+		return rc;
+	}
+
 	/*
 	 * We don't need to check boot HART id of domain because if boot
 	 * HART id is not possible/assigned to this domain then it won't
@@ -403,12 +566,34 @@ bool sbi_domain_check_addr_range(const struct sbi_domain *dom,
 				 unsigned long mode,
 				 unsigned long access_flags)
 {
-	unsigned long max = addr + size;
+	unsigned long max = addr + size, rwx;
 	const struct sbi_domain_memregion *reg, *sreg;
+	const struct sbi_domain_memindex *e, *last;
+	bool mmio;
 
 	if (!dom)
 		return false;
 
+	/* Walk the adjacent intervals covering the range in one pass */
+	if (dom->memindex && addr < max) {
+		e = memindex_find(dom, addr);
+		if (!e)
+			return false;
+
+		rwx = domain_access_rwx(access_flags);
+		mmio = (access_flags & SBI_DOMAIN_MMIO) ? true : false;
+		last = &dom->memindex[dom->memindex_count - 1];
+		while (memindex_allows(e, mode, rwx, mmio)) {
+			if (max - 1 <= e->end)
+				return true;
+			if (e == last || e[1].start != e->end + 1)
+				return false;
+			e++;
+		}
+
+		return false;
+	}
+
 	while (addr < max) {
 		reg = find_region(dom, addr);
 		if (!reg)
@@ -793,6 +978,9 @@ int sbi_domain_init(struct sbi_scratch *scratch, u32 cold_hartid)
 	if (!domain_hart_ptr_offset)
 		return SBI_ENOMEM;
 
+	/* The lookups work without the cache if there is no space for it */
+	domain_memindex_hit_offset = sbi_scratch_alloc_type_offset(u32);
+
 	/* Initialize domain context support */
 	rc = sbi_domain_context_init();
 	if (rc)
@@ -870,6 +1058,8 @@ fail_free_root_memregs:
 fail_deinit_context:
 	sbi_domain_context_deinit();
 fail_free_domain_hart_ptr_offset:
+	if (domain_memindex_hit_offset)
+		sbi_scratch_free_offset(domain_memindex_hit_offset);
 	sbi_scratch_free_offset(domain_hart_ptr_offset);
 	return rc;
 }
@@ -11,9 +11,18 @@
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_scratch.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_trap.h>
 
+/* Hash slots for single-ID extensions, at most a quarter of them used */
+#define ECALL_HASH_BITS		8
+#define ECALL_HASH_SIZE		(1 << ECALL_HASH_BITS)
+#define ECALL_SINGLE_MAX	(ECALL_HASH_SIZE / 4)
+#define ECALL_RANGE_MAX		16
+/* Number of multipliers tried for a collision-free hash */
+#define ECALL_HASH_TRIES	32
+
 extern struct sbi_ecall_extension *const sbi_ecall_exts[];
 
 u16 sbi_ecall_version_major(void)
@@ -40,9 +49,147 @@ void sbi_ecall_set_impid(unsigned long impid)
 
 static SBI_LIST_HEAD(ecall_exts_list);
 
+/*
+ * Lookup table compiled from ecall_exts_list by ecall_table_build(). Single
+ * extension IDs are hashed, ideally without collisions, and the remaining
+ * ranges, such as the legacy and vendor ones, are sorted by their start.
+ */
+struct ecall_table {
+	/* Index + 1 into singles, zero for an empty slot */
+	u8 hash[ECALL_HASH_SIZE];
+	u32 hash_mult;
+	struct sbi_ecall_extension *singles[ECALL_SINGLE_MAX];
+	struct sbi_ecall_extension *ranges[ECALL_RANGE_MAX];
+	int range_count;
+	/* ecall_exts_list is walked instead if the table is not valid */
+	bool valid;
+	/* Incremented on every build, invalidates the per-HART caches */
+	unsigned long gen;
+};
+
+/* Last extension found on a HART */
+struct ecall_cache {
+	unsigned long extid;
+	struct sbi_ecall_extension *ext;
+	unsigned long gen;
+};
+
+static struct ecall_table ecall_table;
+static unsigned long ecall_cache_offset;
+
+static inline u32 ecall_hash(u32 mult, unsigned long extid)
+{
+	return ((u32)extid * mult) >> (32 - ECALL_HASH_BITS);
+}
+
+/* Returns the number of collisions */
+static int ecall_hash_fill(struct ecall_table *t, int count)
+{
+	int i, collisions = 0;
+	u32 h;
+
+	sbi_memset(t->hash, 0, sizeof(t->hash));
+	for (i = 0; i < count; i++) {
+		h = ecall_hash(t->hash_mult, t->singles[i]->extid_start);
+		while (t->hash[h]) {
+			h = (h + 1) & (ECALL_HASH_SIZE - 1);
+			collisions++;
+		}
+		t->hash[h] = i + 1;
+	}
+
+	return collisions;
+}
+
+static void ecall_table_build(void)
+{
+	struct ecall_table *t = &ecall_table;
+	struct sbi_ecall_extension *ext;
+	int i, singles = 0;
+
+	t->valid = false;
+	t->range_count = 0;
+	sbi_list_for_each_entry(ext, &ecall_exts_list, head) {
+		if (ext->extid_start == ext->extid_end) {
+			if (singles == ECALL_SINGLE_MAX)
+				goto done;
+			t->singles[singles++] = ext;
+			continue;
+		}
+
+		/* Insertion sort by extid_start, the ranges do not overlap */
+		if (t->range_count == ECALL_RANGE_MAX)
+			goto done;
+		for (i = t->range_count++; i > 0; i--) {
+			if (t->ranges[i - 1]->extid_start < ext->extid_start)
+				break;
+			t->ranges[i] = t->ranges[i - 1];
+		}
+		t->ranges[i] = ext;
+	}
+
+	/* Odd multipliers, keep the first without collisions */
+	for (i = 0; i < ECALL_HASH_TRIES; i++) {
+		t->hash_mult = 0x9e3779b1U * (2 * i + 1);
+		if (!ecall_hash_fill(t, singles))
+			break;
+	}
+	t->valid = true;
+
+done:
+	t->gen++;
+}
+
+static struct sbi_ecall_extension *ecall_table_find(unsigned long extid)
+{
+	const struct ecall_table *t = &ecall_table;
+	struct sbi_ecall_extension *ext;
+	int lo, hi, mid;
+	u32 h;
+
+	h = ecall_hash(t->hash_mult, extid);
+	while (t->hash[h]) {
+		ext = t->singles[t->hash[h] - 1];
+		if (ext->extid_start == extid)
+			return ext;
+		h = (h + 1) & (ECALL_HASH_SIZE - 1);
+	}
+
+	/* Last range starting at or below extid */
+	lo = 0;
+	hi = t->range_count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (t->ranges[mid]->extid_start <= extid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo && extid <= t->ranges[lo - 1]->extid_end)
+		return t->ranges[lo - 1];
+
+	return NULL;
+}
+
 struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
 {
 	struct sbi_ecall_extension *t, *ret = NULL;
+	struct ecall_cache *cache;
+
+	if (ecall_table.valid) {
+		if (!ecall_cache_offset)
+			return ecall_table_find(extid);
+
+		cache = sbi_scratch_thishart_offset_ptr(ecall_cache_offset);
+		if (cache->gen == ecall_table.gen && cache->extid == extid)
+			return cache->ext;
+
+		ret = ecall_table_find(extid);
+		cache->extid = extid;
+		cache->ext = ret;
+		cache->gen = ecall_table.gen;
+		return ret;
+	}
 
 	sbi_list_for_each_entry(t, &ecall_exts_list, head) {
 		if (t->extid_start <= extid && extid <= t->extid_end) {
@@ -94,6 +241,8 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 	}
 
 	sbi_list_add_tail(&ext->head, &ecall_exts_list);
+	if (ecall_table.gen)
+		ecall_table_build();
 
 	return 0;
 }
@@ -113,8 +262,11 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext)
 		}
 	}
 
-	if (found)
+	if (found) {
 		sbi_list_del_init(&ext->head);
+		if (ecall_table.gen)
+			ecall_table_build();
+	}
 }
 
 int sbi_ecall_handler(struct sbi_trap_context *tcntx)
@@ -180,5 +332,12 @@ int sbi_ecall_init(void)
 			return ret;
 	}
 
+	ecall_cache_offset = sbi_scratch_alloc_type_offset(struct ecall_cache);
+	if (!ecall_cache_offset)
+		return SBI_ENOMEM;
+
+	/* From now on, registering or unregistering rebuilds the table */
+	ecall_table_build();
+
 	return 0;
 }
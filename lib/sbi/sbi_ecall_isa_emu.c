@@ -0,0 +1,53 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_insn_emu_calib.h>
+#include <sbi/sbi_insn_emu_hot.h>
+#include <sbi/sbi_trap.h>
+
+static int sbi_ecall_isa_emu_handler(unsigned long extid, unsigned long funcid,
+				     struct sbi_trap_regs *regs,
+				     struct sbi_ecall_return *out)
+{
+	int ret = 0;
+
+	switch (funcid) {
+	case SBI_EXT_ISA_EMU_GET_TRAP_COST:
+		ret = sbi_insn_emu_calib_trap_cost(regs->a0, &out->value);
+		break;
+	case SBI_EXT_ISA_EMU_GET_COST:
+		ret = sbi_insn_emu_calib_cost(regs->a0, regs->a1, &out->value);
+		break;
+	case SBI_EXT_ISA_EMU_READ_HOT_SITE:
+		ret = sbi_insn_emu_hot_read(regs->a0, regs->a1);
+		break;
+	default:
+		ret = SBI_ENOTSUPP;
+	}
+
+	return ret;
+}
+
+struct sbi_ecall_extension ecall_isa_emu;
+
+static int sbi_ecall_isa_emu_register_extensions(void)
+{
+	return sbi_ecall_register_extension(&ecall_isa_emu);
+}
+
+struct sbi_ecall_extension ecall_isa_emu = {
+	.name			= "isa-emu",
+	.extid_start		= SBI_EXT_ISA_EMU,
+	.extid_end		= SBI_EXT_ISA_EMU,
+	.register_extensions	= sbi_ecall_isa_emu_register_extensions,
+	.handle			= sbi_ecall_isa_emu_handler,
+};
@@ -0,0 +1,62 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_tlb.h>
+
+static int sbi_ecall_rfence_hint_handler(unsigned long extid,
+					 unsigned long funcid,
+					 struct sbi_trap_regs *regs,
+					 struct sbi_ecall_return *out)
+{
+	struct sbi_tlb_info tlb_info;
+	u32 source_hart = current_hartid();
+	unsigned long stride;
+
+	switch (funcid) {
+	case SBI_EXT_RFENCE_HINT_REMOTE_SFENCE_VMA:
+		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, 0, 0,
+				  SBI_TLB_SFENCE_VMA, source_hart);
+		stride = regs->a4;
+		break;
+	case SBI_EXT_RFENCE_HINT_REMOTE_SFENCE_VMA_ASID:
+		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, regs->a4, 0,
+				  SBI_TLB_SFENCE_VMA_ASID, source_hart);
+		stride = regs->a5;
+		break;
+	default:
+		return SBI_ENOTSUPP;
+	}
+
+	/* The stride is the size of a page or superpage */
+	if (stride < PAGE_SIZE || (stride & (stride - 1)))
+		return SBI_EINVAL;
+	tlb_info.stride = stride;
+
+	return sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
+}
+
+struct sbi_ecall_extension ecall_rfence_hint;
+
+static int sbi_ecall_rfence_hint_register_extensions(void)
+{
+	return sbi_ecall_register_extension(&ecall_rfence_hint);
+}
+
+struct sbi_ecall_extension ecall_rfence_hint = {
+	.name			= "rfhint",
+	.extid_start		= SBI_EXT_RFENCE_HINT,
+	.extid_end		= SBI_EXT_RFENCE_HINT,
+	.register_extensions	= sbi_ecall_rfence_hint_register_extensions,
+	.handle			= sbi_ecall_rfence_hint_handler,
+};
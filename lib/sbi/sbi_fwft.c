@@ -13,6 +13,8 @@
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_heap.h>
+#include <sbi/sbi_insn_emu.h>
+#include <sbi/sbi_insn_emu_hot.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_types.h>
@@ -60,6 +62,8 @@ static const unsigned long fwft_defined_features[] = {
 	SBI_FWFT_DOUBLE_TRAP,
 	SBI_FWFT_PTE_AD_HW_UPDATING,
 	SBI_FWFT_POINTER_MASKING_PMLEN,
+	SBI_FWFT_ISA_EMU_GROUPS,
+	SBI_FWFT_ISA_EMU_HOT_THRESHOLD,
 };
 
 static bool fwft_is_defined_feature(enum sbi_fwft_feature_t feature)
@@ -283,6 +287,39 @@ static int fwft_get_pmlen(struct fwft_config *conf, unsigned long *value)
 }
 #endif
 
+static int fwft_set_isa_emu_groups(struct fwft_config *conf,
+				   unsigned long value)
+{
+	return sbi_insn_emu_set_groups(value);
+}
+
+static int fwft_get_isa_emu_groups(struct fwft_config *conf,
+				   unsigned long *value)
+{
+	*value = sbi_insn_emu_get_groups();
+
+	return SBI_OK;
+}
+
+static int fwft_isa_emu_hot_supported(struct fwft_config *conf)
+{
+	unsigned long threshold;
+
+	return sbi_insn_emu_hot_get_threshold(&threshold);
+}
+
+static int fwft_set_isa_emu_hot_threshold(struct fwft_config *conf,
+					  unsigned long value)
+{
+	return sbi_insn_emu_hot_set_threshold(value);
+}
+
+static int fwft_get_isa_emu_hot_threshold(struct fwft_config *conf,
+					  unsigned long *value)
+{
+	return sbi_insn_emu_hot_get_threshold(value);
+}
+
 static struct fwft_config* get_feature_config(enum sbi_fwft_feature_t feature)
 {
 	int i;
@@ -412,6 +449,17 @@ static const struct fwft_feature features[] =
 		.get = fwft_get_pmlen,
 	},
 #endif
+	{
+		.id = SBI_FWFT_ISA_EMU_GROUPS,
+		.set = fwft_set_isa_emu_groups,
+		.get = fwft_get_isa_emu_groups,
+	},
+	{
+		.id = SBI_FWFT_ISA_EMU_HOT_THRESHOLD,
+		.supported = fwft_isa_emu_hot_supported,
+		.set = fwft_set_isa_emu_hot_threshold,
+		.get = fwft_get_isa_emu_hot_threshold,
+	},
 };
 
 int sbi_fwft_init(struct sbi_scratch *scratch, bool cold_boot)
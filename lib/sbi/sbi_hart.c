@@ -15,6 +15,7 @@
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_domain.h>
 #include <sbi/sbi_csr_detect.h>
+#include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_math.h>
@@ -715,6 +716,9 @@ const struct sbi_hart_ext_data sbi_hart_ext[] = {
 	__SBI_HART_EXT_DATA(smctr, SBI_HART_EXT_SMCTR),
 	__SBI_HART_EXT_DATA(ssctr, SBI_HART_EXT_SSCTR),
 	__SBI_HART_EXT_DATA(ssstateen, SBI_HART_EXT_SSSTATEEN),
+	__SBI_HART_EXT_DATA(xtheadvector, SBI_HART_EXT_XTHEADVECTOR),
+	__SBI_HART_EXT_DATA(xtheadcondmov, SBI_HART_EXT_XTHEADCONDMOV),
+	__SBI_HART_EXT_DATA(svinval, SBI_HART_EXT_SVINVAL),
 };
 
 _Static_assert(SBI_HART_EXT_MAX == array_size(sbi_hart_ext),
@@ -771,6 +775,47 @@ bool sbi_hart_has_csr(struct sbi_scratch *scratch, enum sbi_hart_csrs csr)
 	return __test_bit(csr, hfeatures->csrs);
 }
 
+unsigned long sbi_hart_emu_groups_native(struct sbi_scratch *scratch)
+{
+	struct sbi_hart_features *hfeatures =
+			sbi_scratch_offset_ptr(scratch, hart_features_offset);
+
+	return hfeatures->emu_groups_native;
+}
+
+bool sbi_hart_features_detected(struct sbi_scratch *scratch)
+{
+	struct sbi_hart_features *hfeatures =
+			sbi_scratch_offset_ptr(scratch, hart_features_offset);
+
+	return hfeatures->detected;
+}
+
+/*
+ * Same as misa_extension() but for any HART, which must have detected
+ * its features
+ */
+bool sbi_hart_has_misa_extension(struct sbi_scratch *scratch, char ext)
+{
+	struct sbi_hart_features *hfeatures =
+			sbi_scratch_offset_ptr(scratch, hart_features_offset);
+
+	if ('a' <= ext && ext <= 'z')
+		ext -= 'a' - 'A';
+	if (ext < 'A' || 'Z' < ext)
+		return false;
+
+	return hfeatures->misa & BIT(ext - 'A');
+}
+
+bool sbi_hart_tval_insn16(struct sbi_scratch *scratch)
+{
+	struct sbi_hart_features *hfeatures =
+			sbi_scratch_offset_ptr(scratch, hart_features_offset);
+
+	return hfeatures->tval_insn16;
+}
+
 static unsigned long hart_pmp_get_allowed_addr(void)
 {
 	unsigned long val = 0;
@@ -821,12 +866,131 @@ static int hart_mhpm_get_allowed_bits(void)
 	return num_bits;
 }
 
+/*
+ * Execute one instruction with the expected trap handler installed. The
+ * handler skips 4 bytes, so 16-bit instructions are padded with c.nop.
+ */
+#define __probe_insn(__insn, __trap)					\
+	({								\
+	register ulong tinfo asm("a3") = (ulong)(__trap);		\
+	register ulong ttmp asm("a4");					\
+	register ulong mtvec = (ulong)sbi_hart_expected_trap;		\
+	(__trap)->cause = 0;						\
+	asm volatile(							\
+		"add %[ttmp], %[tinfo], zero\n"				\
+		"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"	\
+		__insn "\n"						\
+		"csrw " STR(CSR_MTVEC) ", %[mtvec]"			\
+	    : [mtvec] "+&r"(mtvec), [tinfo] "+&r"(tinfo),		\
+	      [ttmp] "+&r"(ttmp)					\
+	    :								\
+	    : "a5", "memory");						\
+	!(__trap)->cause;						\
+	})
+
+static unsigned long hart_detect_emu_groups_native(
+				struct sbi_hart_features *hfeatures)
+{
+	struct sbi_trap_info trap = {0};
+	unsigned long native = 0, mstatus;
+
+#define __check_insn(__group, __insn)					\
+	if (__probe_insn(__insn, &trap))				\
+		native |= BIT(__group);
+
+	/* All operands are x0 (or a5 for the compressed ones) */
+	__check_insn(SBI_ISA_EMU_GROUP_ZBA, ".4byte 0x20002033");   /* sh1add */
+	__check_insn(SBI_ISA_EMU_GROUP_ZBB, ".4byte 0x60201013");   /* cpop */
+	__check_insn(SBI_ISA_EMU_GROUP_ZBC, ".4byte 0x0a001033");   /* clmul */
+	__check_insn(SBI_ISA_EMU_GROUP_ZBS, ".4byte 0x28001033");   /* bset */
+	__check_insn(SBI_ISA_EMU_GROUP_ZICOND, ".4byte 0x0e005033"); /* czero.eqz */
+	__check_insn(SBI_ISA_EMU_GROUP_ZIMOP, ".4byte 0x81c04073"); /* mop.r.0 */
+	__check_insn(SBI_ISA_EMU_GROUP_ZAWRS, ".4byte 0x01d00073"); /* wrs.sto */
+#if __riscv_xlen == 64
+	__check_insn(SBI_ISA_EMU_GROUP_ZKND, ".4byte 0x3a000033");  /* aes64ds */
+	__check_insn(SBI_ISA_EMU_GROUP_ZKNE, ".4byte 0x32000033");  /* aes64es */
+#else
+	__check_insn(SBI_ISA_EMU_GROUP_ZKND, ".4byte 0x2a000033");  /* aes32dsi */
+	__check_insn(SBI_ISA_EMU_GROUP_ZKNE, ".4byte 0x22000033");  /* aes32esi */
+#endif
+	__check_insn(SBI_ISA_EMU_GROUP_ZKNH, ".4byte 0x10201013");  /* sha256sig0 */
+	if (misa_extension('C')) {
+		/* c.mop.1 */
+		__check_insn(SBI_ISA_EMU_GROUP_ZCMOP,
+			     ".2byte 0x6081\n.2byte 0x0001");
+		/* c.zext.b a5 */
+		__check_insn(SBI_ISA_EMU_GROUP_ZCB,
+			     ".2byte 0x9fe1\n.2byte 0x0001");
+	}
+
+	/* Cache block operations can be probed through their enables */
+	if (hfeatures->priv_version >= SBI_HART_PRIV_VER_1_12) {
+		unsigned long menvcfg = csr_read(CSR_MENVCFG);
+
+		csr_set(CSR_MENVCFG, ENVCFG_CBCFE | ENVCFG_CBZE);
+		if (csr_read(CSR_MENVCFG) & ENVCFG_CBCFE)
+			native |= BIT(SBI_ISA_EMU_GROUP_ZICBOM);
+		if (csr_read(CSR_MENVCFG) & ENVCFG_CBZE)
+			native |= BIT(SBI_ISA_EMU_GROUP_ZICBOZ);
+		csr_write(CSR_MENVCFG, menvcfg);
+	}
+	if (__test_bit(SBI_HART_EXT_ZICBOM, hfeatures->extensions))
+		native |= BIT(SBI_ISA_EMU_GROUP_ZICBOM);
+	if (__test_bit(SBI_HART_EXT_ZICBOZ, hfeatures->extensions))
+		native |= BIT(SBI_ISA_EMU_GROUP_ZICBOZ);
+
+	mstatus = csr_read(CSR_MSTATUS);
+	if (misa_extension('F')) {
+		csr_set(CSR_MSTATUS, MSTATUS_FS);
+		/* fcvt.s.h f0, f0 */
+		__check_insn(SBI_ISA_EMU_GROUP_ZFHMIN, ".4byte 0x40200053");
+		/* fround.s f0, f0 */
+		__check_insn(SBI_ISA_EMU_GROUP_ZFA, ".4byte 0x40400053");
+	}
+#if __riscv_xlen == 64
+	if (misa_extension('V')) {
+		csr_set(CSR_MSTATUS, MSTATUS_VS);
+		/* vsetivli x0, 1, e8, m1, ta, ma; vandn.vv v0, v0, v0 */
+		__check_insn(SBI_ISA_EMU_GROUP_ZVBB,
+			     ".4byte 0xcc00f057\n.4byte 0x06000057");
+		if (misa_extension('F')) {
+			/* vsetivli x0, 1, e16, m1, ta, ma; vfadd.vv v0, v0, v0 */
+			__check_insn(SBI_ISA_EMU_GROUP_ZVFH,
+				     ".4byte 0xcc80f057\n.4byte 0x02001057");
+		}
+	}
+#endif
+	csr_write(CSR_MSTATUS, mstatus);
+
+#undef __check_insn
+
+	return native;
+}
+
+/*
+ * Check whether MTVAL reports the encoding of an illegal 16-bit instruction,
+ * so that the illegal instruction handler need not fetch it again.
+ */
+static bool hart_detect_tval_insn16(void)
+{
+	struct sbi_trap_info trap = {0};
+
+	if (!misa_extension('C'))
+		return false;
+
+	/* c.jr x0 is reserved */
+	__probe_insn(".2byte 0x8002\n.2byte 0x0001", &trap);
+
+	return trap.cause == CAUSE_ILLEGAL_INSTRUCTION && trap.tval == 0x8002;
+}
+
 static int hart_detect_features(struct sbi_scratch *scratch)
 {
 	struct sbi_trap_info trap = {0};
 	struct sbi_hart_features *hfeatures =
 		sbi_scratch_offset_ptr(scratch, hart_features_offset);
 	unsigned long val, oldval;
+	char ext;
 	int rc;
 
 	/* If hart features already detected then do nothing */
@@ -1010,6 +1174,15 @@ __pmp_skip:
 			    sbi_hart_has_csr(scratch, SBI_HART_CSR_TIME)  &&
 			    sbi_hart_has_csr(scratch, SBI_HART_CSR_INSTRET));
 
+	/* Emulated extension groups which the hardware implements */
+	hfeatures->emu_groups_native = hart_detect_emu_groups_native(hfeatures);
+	hfeatures->tval_insn16 = hart_detect_tval_insn16();
+	hfeatures->misa = 0;
+	for (ext = 'A'; ext <= 'Z'; ext++) {
+		if (misa_extension_imp(ext))
+			hfeatures->misa |= BIT(ext - 'A');
+	}
+
 	/* Extensions implied by other extensions and features */
 	if (hfeatures->mhpm_mask)
 		__sbi_hart_update_extension(hfeatures,
@@ -1077,6 +1250,8 @@ int sbi_hart_init(struct sbi_scratch *scratch, bool cold_boot)
 
 void __attribute__((noreturn)) sbi_hart_hang(void)
 {
+	sbi_console_flush();
+
 	while (1)
 		wfi();
 	__builtin_unreachable();
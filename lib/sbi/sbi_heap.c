@@ -9,6 +9,7 @@
 
 #include <sbi/riscv_locks.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_list.h>
 #include <sbi/sbi_scratch.h>
@@ -20,12 +21,47 @@
 /* Number of heap nodes to allocate at once */
 #define HEAP_NODE_BATCH_SIZE		8
 
+/*
+ * Size classes of the slab allocator, 64 to 512 bytes. The smallest class
+ * keeps the minimum size and alignment of HEAP_ALLOC_ALIGN, so that small
+ * objects of different HARTs never share a cache line.
+ */
+#define HEAP_SLAB_MIN_SHIFT		6
+#define HEAP_SLAB_MAX_SHIFT		9
+#define HEAP_SLAB_CLASSES		\
+	(HEAP_SLAB_MAX_SHIFT - HEAP_SLAB_MIN_SHIFT + 1)
+
+/* Size and alignment of the heap blocks that are carved into objects */
+#define HEAP_SLAB_SIZE			1024
+
+/* Objects a per-HART cache keeps at most, and moves from the depot */
+#define HEAP_CACHE_MAX			16
+#define HEAP_CACHE_BATCH		8
+
+_Static_assert((1UL << HEAP_SLAB_MIN_SHIFT) >= HEAP_ALLOC_ALIGN,
+	       "slab objects must keep the heap allocation alignment");
+
 struct heap_node {
 	struct sbi_dlist head;
 	unsigned long addr;
 	unsigned long size;
 };
 
+/* Free slab object */
+struct heap_object {
+	struct heap_object *next;
+};
+
+struct heap_object_list {
+	struct heap_object *head;
+	unsigned long count;
+};
+
+/* Per-HART free objects of each size class, only used by its HART */
+struct heap_cache {
+	struct heap_object_list classes[HEAP_SLAB_CLASSES];
+};
+
 struct sbi_heap_control {
 	spinlock_t lock;
 	unsigned long base;
@@ -35,6 +71,18 @@ struct sbi_heap_control {
 	struct sbi_dlist free_space_list;
 	struct sbi_dlist used_space_list;
 	struct heap_node init_free_space_node;
+	/* Free objects shared by all HARTs, protected by depot_lock */
+	spinlock_t depot_lock;
+	struct heap_object_list depot[HEAP_SLAB_CLASSES];
+	/*
+	 * Size class plus one of every HEAP_SLAB_SIZE block of the heap
+	 * that is a slab, zero for other blocks. NULL without slabs.
+	 */
+	u8 *slab_class;
+	/* Objects of every slab that are in the depot, beside slab_class */
+	u8 *slab_depot;
+	/* Scratch offset of the per-HART caches, zero without caches */
+	unsigned long cache_off;
 };
 
 struct sbi_heap_control global_hpctrl;
@@ -137,8 +185,233 @@ out:
 	return ret;
 }
 
+static inline void heap_list_push(struct heap_object_list *list,
+				  struct heap_object *obj)
+{
+	obj->next = list->head;
+	list->head = obj;
+	list->count++;
+}
+
+static inline struct heap_object *heap_list_pop(struct heap_object_list *list)
+{
+	struct heap_object *obj = list->head;
+
+	if (obj) {
+		list->head = obj->next;
+		list->count--;
+	}
+	return obj;
+}
+
+static int heap_size_class(size_t size)
+{
+	int c = 0;
+
+	if (!size || size > (1UL << HEAP_SLAB_MAX_SHIFT))
+		return -1;
+
+	while ((1UL << (c + HEAP_SLAB_MIN_SHIFT)) < size)
+		c++;
+	return c;
+}
+
+static unsigned long heap_slab_index(struct sbi_heap_control *hpctrl,
+				     unsigned long addr)
+{
+	return addr / HEAP_SLAB_SIZE - hpctrl->base / HEAP_SLAB_SIZE;
+}
+
+/* Size class of the slab object at ptr, or -1 if ptr is not one */
+static int heap_slab_class_of(struct sbi_heap_control *hpctrl, void *ptr)
+{
+	unsigned long addr = (unsigned long)ptr;
+
+	if (!hpctrl->slab_class || addr < hpctrl->base ||
+	    addr - hpctrl->base >= hpctrl->size)
+		return -1;
+
+	return (int)hpctrl->slab_class[heap_slab_index(hpctrl, addr)] - 1;
+}
+
+static struct heap_object_list *heap_cache_list(struct sbi_heap_control *hpctrl,
+						int c)
+{
+	struct heap_cache *cache;
+
+	if (!hpctrl->cache_off)
+		return NULL;
+
+	cache = sbi_scratch_offset_ptr(sbi_scratch_thishart_ptr(),
+				       hpctrl->cache_off);
+	return &cache->classes[c];
+}
+
+/* Objects of a slab of size class c */
+static inline unsigned long heap_slab_objects(int c)
+{
+	return HEAP_SLAB_SIZE >> (c + HEAP_SLAB_MIN_SHIFT);
+}
+
+static void heap_depot_push(struct sbi_heap_control *hpctrl, int c,
+			    struct heap_object *obj)
+{
+	heap_list_push(&hpctrl->depot[c], obj);
+	hpctrl->slab_depot[heap_slab_index(hpctrl, (unsigned long)obj)]++;
+}
+
+static struct heap_object *heap_depot_pop(struct sbi_heap_control *hpctrl,
+					  int c)
+{
+	struct heap_object *obj = heap_list_pop(&hpctrl->depot[c]);
+
+	if (obj)
+		hpctrl->slab_depot[heap_slab_index(hpctrl,
+						   (unsigned long)obj)]--;
+	return obj;
+}
+
+static void heap_free_block(struct sbi_heap_control *hpctrl, void *ptr);
+
+/*
+ * Give the slab of obj back to the heap if all its objects are in the
+ * depot. The depot keeps one slab worth of objects, so that a class
+ * that is used all the time does not carve and release slabs in turn.
+ * Called with depot_lock held.
+ */
+static void heap_slab_release(struct sbi_heap_control *hpctrl, int c,
+			      struct heap_object *obj)
+{
+	unsigned long addr = (unsigned long)obj & ~(HEAP_SLAB_SIZE - 1UL);
+	unsigned long idx = heap_slab_index(hpctrl, addr);
+	struct heap_object **pp = &hpctrl->depot[c].head;
+
+	if (hpctrl->slab_depot[idx] < heap_slab_objects(c) ||
+	    hpctrl->depot[c].count < 2 * heap_slab_objects(c))
+		return;
+
+	while (*pp) {
+		if (((unsigned long)*pp & ~(HEAP_SLAB_SIZE - 1UL)) == addr) {
+			*pp = (*pp)->next;
+			hpctrl->depot[c].count--;
+		} else {
+			pp = &(*pp)->next;
+		}
+	}
+
+	hpctrl->slab_depot[idx] = 0;
+	hpctrl->slab_class[idx] = 0;
+	heap_free_block(hpctrl, (void *)addr);
+}
+
+/* Carve a new slab into the depot, called with depot_lock held */
+static bool heap_slab_grow(struct sbi_heap_control *hpctrl, int c)
+{
+	unsigned long i, addr, obj_size = 1UL << (c + HEAP_SLAB_MIN_SHIFT);
+	struct heap_object *obj;
+
+	addr = (unsigned long)alloc_with_align(hpctrl, HEAP_SLAB_SIZE,
+					       HEAP_SLAB_SIZE);
+	if (!addr)
+		return false;
+
+	hpctrl->slab_class[heap_slab_index(hpctrl, addr)] = c + 1;
+	for (i = HEAP_SLAB_SIZE; i; i -= obj_size) {
+		obj = (void *)(addr + i - obj_size);
+		heap_depot_push(hpctrl, c, obj);
+	}
+
+	return true;
+}
+
+static void *heap_slab_alloc(struct sbi_heap_control *hpctrl, int c)
+{
+	struct heap_object_list *cache = heap_cache_list(hpctrl, c);
+	struct heap_object *obj;
+
+	/* Fast path, lock-free as only this HART uses its cache */
+	if (cache && cache->head)
+		return heap_list_pop(cache);
+
+	spin_lock(&hpctrl->depot_lock);
+
+	if (!hpctrl->depot[c].head && !heap_slab_grow(hpctrl, c)) {
+		spin_unlock(&hpctrl->depot_lock);
+		return NULL;
+	}
+
+	obj = heap_depot_pop(hpctrl, c);
+	while (cache && hpctrl->depot[c].head &&
+	       cache->count < HEAP_CACHE_BATCH)
+		heap_list_push(cache, heap_depot_pop(hpctrl, c));
+
+	spin_unlock(&hpctrl->depot_lock);
+
+	return obj;
+}
+
+static void heap_slab_free(struct sbi_heap_control *hpctrl, int c, void *ptr)
+{
+	struct heap_object_list *cache = heap_cache_list(hpctrl, c);
+	struct heap_object *obj = ptr;
+
+	if (cache && cache->count < HEAP_CACHE_MAX) {
+		heap_list_push(cache, obj);
+		return;
+	}
+
+	/* Return a batch to the depot so that other HARTs can use it */
+	spin_lock(&hpctrl->depot_lock);
+	while (obj) {
+		heap_depot_push(hpctrl, c, obj);
+		heap_slab_release(hpctrl, c, obj);
+		obj = NULL;
+		if (cache && cache->count > HEAP_CACHE_MAX - HEAP_CACHE_BATCH)
+			obj = heap_list_pop(cache);
+	}
+	spin_unlock(&hpctrl->depot_lock);
+}
+
+unsigned long sbi_heap_cached_space_from(struct sbi_heap_control *hpctrl)
+{
+	struct heap_cache *cache;
+	unsigned long ret = 0;
+	int c;
+
+	if (!hpctrl->slab_class)
+		return 0;
+
+	spin_lock(&hpctrl->depot_lock);
+	for (c = 0; c < HEAP_SLAB_CLASSES; c++)
+		ret += hpctrl->depot[c].count << (c + HEAP_SLAB_MIN_SHIFT);
+	spin_unlock(&hpctrl->depot_lock);
+
+	if (!hpctrl->cache_off)
+		return ret;
+
+	/* Racy for other HARTs, which is fine for reporting */
+	sbi_for_each_hartindex(i) {
+		cache = sbi_scratch_offset_ptr(sbi_hartindex_to_scratch(i),
+					       hpctrl->cache_off);
+		for (c = 0; c < HEAP_SLAB_CLASSES; c++)
+			ret += cache->classes[c].count <<
+			       (c + HEAP_SLAB_MIN_SHIFT);
+	}
+
+	return ret;
+}
+
 void *sbi_malloc_from(struct sbi_heap_control *hpctrl, size_t size)
 {
+	int c = heap_size_class(size);
+	void *ret;
+
+	if (c >= 0 && hpctrl->slab_class) {
+		ret = heap_slab_alloc(hpctrl, c);
+		if (ret)
+			return ret;
+	}
+
 	return alloc_with_align(hpctrl, HEAP_ALLOC_ALIGN, size);
 }
 
@@ -168,13 +441,10 @@ void *sbi_zalloc_from(struct sbi_heap_control *hpctrl, size_t size)
 	return ret;
 }
 
-void sbi_free_from(struct sbi_heap_control *hpctrl, void *ptr)
+static void heap_free_block(struct sbi_heap_control *hpctrl, void *ptr)
 {
 	struct heap_node *n, *np;
 
-	if (!ptr)
-		return;
-
 	spin_lock(&hpctrl->lock);
 
 	np = NULL;
@@ -216,6 +486,23 @@ void sbi_free_from(struct sbi_heap_control *hpctrl, void *ptr)
 	spin_unlock(&hpctrl->lock);
 }
 
+void sbi_free_from(struct sbi_heap_control *hpctrl, void *ptr)
+{
+	int c;
+
+	if (!ptr)
+		return;
+
+	/* Slab objects need no search of the used space list */
+	c = heap_slab_class_of(hpctrl, ptr);
+	if (c >= 0) {
+		heap_slab_free(hpctrl, c, ptr);
+		return;
+	}
+
+	heap_free_block(hpctrl, ptr);
+}
+
 unsigned long sbi_heap_free_space_from(struct sbi_heap_control *hpctrl)
 {
 	struct heap_node *n;
@@ -231,7 +518,8 @@ unsigned long sbi_heap_free_space_from(struct sbi_heap_control *hpctrl)
 
 unsigned long sbi_heap_used_space_from(struct sbi_heap_control *hpctrl)
 {
-	return hpctrl->size - hpctrl->resv - sbi_heap_free_space();
+	return hpctrl->size - hpctrl->resv - sbi_heap_free_space_from(hpctrl) -
+	       sbi_heap_cached_space_from(hpctrl);
 }
 
 unsigned long sbi_heap_reserved_space_from(struct sbi_heap_control *hpctrl)
@@ -242,6 +530,7 @@ unsigned long sbi_heap_reserved_space_from(struct sbi_heap_control *hpctrl)
 int sbi_heap_init_new(struct sbi_heap_control *hpctrl, unsigned long base,
 		       unsigned long size)
 {
+	unsigned long slabs, map_size;
 	struct heap_node *n;
 
 	/* Initialize heap control */
@@ -259,6 +548,29 @@ int sbi_heap_init_new(struct sbi_heap_control *hpctrl, unsigned long base,
 	n->size = size;
 	sbi_list_add_tail(&n->head, &hpctrl->free_space_list);
 
+	/*
+	 * Reserve the slab class and depot maps at the end of the heap,
+	 * skip the slabs if the maps would take a large part of the heap.
+	 */
+	SPIN_LOCK_INIT(hpctrl->depot_lock);
+	sbi_memset(hpctrl->depot, 0, sizeof(hpctrl->depot));
+	hpctrl->slab_class = NULL;
+	hpctrl->slab_depot = NULL;
+	slabs = heap_slab_index(hpctrl, base + size - 1) + 1;
+	map_size = ROUNDUP(2 * slabs, HEAP_ALLOC_ALIGN);
+	if (map_size * 8 <= size) {
+		n->size -= map_size;
+		hpctrl->resv += map_size;
+		hpctrl->slab_class = (void *)(n->addr + n->size);
+		hpctrl->slab_depot = hpctrl->slab_class + slabs;
+		sbi_memset(hpctrl->slab_class, 0, map_size);
+	}
+
+	/* All HARTs use the depot if the scratch space runs out */
+	if (!hpctrl->cache_off)
+		hpctrl->cache_off =
+			sbi_scratch_alloc_offset(sizeof(struct heap_cache));
+
 	return 0;
 }
 
@@ -284,6 +284,9 @@ void __noreturn sbi_hsm_exit(struct sbi_scratch *scratch)
 							    hart_data_offset);
 	void (*jump_warmboot)(void) = (void (*)(void))scratch->warmboot_addr;
 
+	/* A stopped HART would leave its buffered output behind */
+	sbi_console_flush();
+
 	if (!__sbi_hsm_hart_change_state(hdata, SBI_HSM_STATE_STOP_PENDING,
 					 SBI_HSM_STATE_STOPPED))
 		goto fail_exit;
@@ -10,6 +10,7 @@
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_illegal_atomic.h>
 #include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_unpriv_ptw.h>
 
 #if !defined(__riscv_atomic) && !defined(__riscv_zalrsc)
 #error "opensbi strongly relies on the A extension of RISC-V"
@@ -24,6 +25,9 @@ int sbi_illegal_atomic(ulong insn, struct sbi_trap_regs *regs)
 
 #elif __riscv_zalrsc
 
+/* Host builds (make host-emu) provide LR/SC on top of mock memory */
+#ifndef OPENSBI_HOST_EMU
+
 #define DEFINE_UNPRIVILEGED_LR_FUNCTION(type, aqrl, insn)			\
 	static type lr_##type##aqrl(const type *addr,				\
 				struct sbi_trap_info *trap)			\
@@ -32,7 +36,18 @@ int sbi_illegal_atomic(ulong insn, struct sbi_trap_regs *regs)
 		register ulong mstatus = 0;					\
 		register ulong mtvec = (ulong)sbi_hart_expected_trap;		\
 		type ret = 0;							\
+		ulong paddr;							\
 		trap->cause = 0;						\
+		if (sbi_unpriv_ptw_translate((ulong)addr, sizeof(type),		\
+					     SBI_UNPRIV_PTW_READ, &paddr,	\
+					     trap)) {				\
+			if (!trap->cause)					\
+				asm volatile(#insn " %[ret], %[addr]\n"	\
+				    : [ret] "=&r"(ret)				\
+				    : [addr] "m"(*(const type *)paddr)		\
+				    : "memory");				\
+			return ret;						\
+		}								\
 		asm volatile(							\
 			"add %[tinfo], %[taddr], zero\n"			\
 			"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"	\
@@ -59,7 +74,19 @@ int sbi_illegal_atomic(ulong insn, struct sbi_trap_regs *regs)
 		register ulong mstatus = 0;					\
 		register ulong mtvec = (ulong)sbi_hart_expected_trap;		\
 		type ret = 0;							\
+		ulong paddr;							\
 		trap->cause = 0;						\
+		if (sbi_unpriv_ptw_translate((ulong)addr, sizeof(type),		\
+					     SBI_UNPRIV_PTW_WRITE, &paddr,	\
+					     trap)) {				\
+			if (!trap->cause)					\
+				asm volatile(#insn " %[ret], %[val], %[addr]\n"\
+				    : [ret] "=&r"(ret)				\
+				    : [addr] "m"(*(type *)paddr),		\
+				      [val] "r"(val)				\
+				    : "memory");				\
+			return ret;						\
+		}								\
 		asm volatile(							\
 			"add %[tinfo], %[taddr], zero\n"			\
 			"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"	\
@@ -78,6 +105,8 @@ int sbi_illegal_atomic(ulong insn, struct sbi_trap_regs *regs)
 		return ret;							\
 	}
 
+#endif
+
 DEFINE_UNPRIVILEGED_LR_FUNCTION(s32, , lr.w);
 DEFINE_UNPRIVILEGED_LR_FUNCTION(s32, _aq, lr.w.aq);
 DEFINE_UNPRIVILEGED_LR_FUNCTION(s32, _rl, lr.w.rl);
@@ -97,6 +126,25 @@ DEFINE_UNPRIVILEGED_SC_FUNCTION(s64, _rl, sc.d.rl);
 DEFINE_UNPRIVILEGED_SC_FUNCTION(s64, _aqrl, sc.d.aqrl);
 #endif
 
+/* An AMO faulting on its LR half still reports a store/AMO fault */
+static void amo_fixup_load_fault(struct sbi_trap_info *trap)
+{
+	switch (trap->cause) {
+	case CAUSE_MISALIGNED_LOAD:
+		trap->cause = CAUSE_MISALIGNED_STORE;
+		break;
+	case CAUSE_LOAD_ACCESS:
+		trap->cause = CAUSE_STORE_ACCESS;
+		break;
+	case CAUSE_LOAD_PAGE_FAULT:
+		trap->cause = CAUSE_STORE_PAGE_FAULT;
+		break;
+	case CAUSE_LOAD_GUEST_PAGE_FAULT:
+		trap->cause = CAUSE_STORE_GUEST_PAGE_FAULT;
+		break;
+	}
+}
+
 #define DEFINE_ATOMIC_FUNCTION(name, type, func)				\
 	static int atomic_##name(ulong insn, struct sbi_trap_regs *regs)	\
 	{									\
@@ -108,6 +156,7 @@ DEFINE_UNPRIVILEGED_SC_FUNCTION(s64, _aqrl, sc.d.aqrl);
 		while (fail) {							\
 			rd_val = lr_##type((void *)addr, &uptrap);		\
 			if (uptrap.cause) {					\
+				amo_fixup_load_fault(&uptrap);			\
 				return sbi_trap_redirect(regs, &uptrap);	\
 			}							\
 			fail = sc_##type((void *)addr, func, &uptrap);	\
@@ -17,12 +17,15 @@
 #include <sbi/sbi_bitops.h>
 #include <sbi/sbi_emulate_csr.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
 #include <sbi/sbi_illegal_atomic.h>
 #include <sbi/sbi_illegal_insn.h>
 #include <sbi/sbi_insn_emu.h>
 #include <sbi/sbi_insn_emu_fp.h>
+#include <sbi/sbi_insn_emu_hot.h>
 #include <sbi/sbi_insn_emu_v.h>
 #include <sbi/sbi_pmu.h>
+#include <sbi/sbi_scratch.h>
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_unpriv.h>
 #include <sbi/sbi_console.h>
@@ -214,12 +217,15 @@ int sbi_illegal_insn_handler(struct sbi_trap_context *tcntx)
 {
 	struct sbi_trap_regs *regs = &tcntx->regs;
 	ulong insn		   = tcntx->trap.tval;
+	ulong pc		   = regs->mepc;
 	struct sbi_trap_info uptrap;
+	int rc;
 
 	/*
 	 * We only deal with 32-bit (or longer) illegal instructions directly.
 	 * If we see instruction is zero OR instruction is 16-bit then we fetch
-	 * and check the instruction encoding using unprivilege access.
+	 * and check the instruction encoding using unprivilege access, unless
+	 * the HART was seen to report 16-bit encodings in MTVAL at boot time.
 	 *
 	 * The program counter (PC) in RISC-V world is always 2-byte aligned
 	 * so handling only 32-bit (or longer) illegal instructions also help
@@ -229,13 +235,31 @@ int sbi_illegal_insn_handler(struct sbi_trap_context *tcntx)
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_ILLEGAL_INSN);
 	if (unlikely((insn & 3) != 3)) {
-		insn = sbi_get_insn(regs->mepc, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		if ((insn & 3) != 3)
-			return illegal_insn16_table[(insn & 3) << 3 |
-						    insn >> 13](insn, regs);
+		if (!insn || !sbi_hart_tval_insn16(sbi_scratch_thishart_ptr())) {
+			insn = sbi_get_insn(regs->mepc, &uptrap);
+			if (uptrap.cause)
+				return sbi_trap_redirect(regs, &uptrap);
+		}
+		if ((insn & 3) != 3) {
+			insn &= 0xffff;
+			if (unlikely(!sbi_insn_emu_allowed(insn)))
+				return truly_illegal_insn(insn, regs);
+			rc = illegal_insn16_table[(insn & 3) << 3 |
+						  insn >> 13](insn, regs);
+			if (!rc && regs->mepc == pc + 2)
+				sbi_insn_emu_hot_record(pc, insn);
+			return rc;
+		}
 	}
 
-	return illegal_insn_table[(insn & 0x7c) >> 2](insn, regs);
+	/* Emulation may be disabled per extension group, see FWFT */
+	if (unlikely(!sbi_insn_emu_allowed(insn)))
+		return truly_illegal_insn(insn, regs);
+
+	rc = illegal_insn_table[(insn & 0x7c) >> 2](insn, regs);
+	/* Only count instructions that retired, not redirected traps */
+	if (!rc && regs->mepc == pc + 4)
+		sbi_insn_emu_hot_record(pc, insn);
+
+	return rc;
 }
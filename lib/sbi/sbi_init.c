@@ -20,6 +20,10 @@
 #include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_hsm.h>
+#include <sbi/sbi_insn_emu.h>
+#include <sbi/sbi_insn_emu_calib.h>
+#include <sbi/sbi_insn_emu_hot.h>
+#include <sbi/sbi_insn_emu_xtheadvector.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi/sbi_irqchip.h>
 #include <sbi/sbi_platform.h>
@@ -31,6 +35,7 @@
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_timer.h>
 #include <sbi/sbi_tlb.h>
+#include <sbi/sbi_unpriv_ptw.h>
 #include <sbi/sbi_version.h>
 #include <sbi/sbi_unit_test.h>
 
@@ -128,10 +133,12 @@ static void sbi_boot_print_general(struct sbi_scratch *scratch)
 		   (u32)((scratch->fw_size - scratch->fw_rw_offset) / 1024));
 	sbi_printf("Firmware Heap Offset        : 0x%lx\n", scratch->fw_heap_offset);
 	sbi_printf("Firmware Heap Size          : "
-		   "%d KB (total), %d KB (reserved), %d KB (used), %d KB (free)\n",
+		   "%d KB (total), %d KB (reserved), %d KB (used), "
+		   "%d KB (cached), %d KB (free)\n",
 		   (u32)(scratch->fw_heap_size / 1024),
 		   (u32)(sbi_heap_reserved_space() / 1024),
 		   (u32)(sbi_heap_used_space() / 1024),
+		   (u32)(sbi_heap_cached_space() / 1024),
 		   (u32)(sbi_heap_free_space() / 1024));
 	sbi_printf("Firmware Scratch Size       : "
 		   "%d B (total), %d B (used), %d B (free)\n",
@@ -195,6 +202,7 @@ static void sbi_boot_print_hart(struct sbi_scratch *scratch, u32 hartid)
 	sbi_printf("Boot HART Debug Triggers    : %d triggers\n",
 		   sbi_dbtr_get_total_triggers());
 	sbi_hart_delegation_dump(scratch, "Boot HART ", "           ");
+	sbi_insn_emu_calib_dump(scratch, "Boot HART ");
 }
 
 static unsigned long coldboot_done;
@@ -307,6 +315,34 @@ static void __noreturn init_coldboot(struct sbi_scratch *scratch, u32 hartid)
 		sbi_hart_hang();
 	}
 
+	rc = sbi_insn_emu_init(scratch, true);
+	if (rc) {
+		sbi_printf("%s: insn emu init failed (error %d)\n",
+			   __func__, rc);
+		sbi_hart_hang();
+	}
+
+	rc = sbi_insn_emu_hot_init(scratch, true);
+	if (rc) {
+		sbi_printf("%s: insn emu hot site init failed (error %d)\n",
+			   __func__, rc);
+		sbi_hart_hang();
+	}
+
+	rc = sbi_unpriv_ptw_init(scratch, true);
+	if (rc) {
+		sbi_printf("%s: unpriv ptw init failed (error %d)\n",
+			   __func__, rc);
+		sbi_hart_hang();
+	}
+
+	rc = sbi_insn_emu_xtheadvector_init(scratch, true);
+	if (rc) {
+		sbi_printf("%s: xtheadvector init failed (error %d)\n",
+			   __func__, rc);
+		sbi_hart_hang();
+	}
+
 	rc = sbi_fwft_init(scratch, true);
 	if (rc) {
 		sbi_printf("%s: fwft init failed (error %d)\n", __func__, rc);
@@ -319,6 +355,19 @@ static void __noreturn init_coldboot(struct sbi_scratch *scratch, u32 hartid)
 		sbi_hart_hang();
 	}
 
+	/*
+	 * Note: Emulation cost calibration should be after all trap
+	 * related initialization so that measured paths match runtime,
+	 * and before platform final initialization so that FDT fixups
+	 * can use the results.
+	 */
+	rc = sbi_insn_emu_calib_init(scratch, true);
+	if (rc) {
+		sbi_printf("%s: emulation calibration failed (error %d)\n",
+			   __func__, rc);
+		sbi_hart_hang();
+	}
+
 	/*
 	 * Note: Finalize domains after HSM initialization
 	 * Note: Finalize domains before HART PMP configuration so
@@ -372,6 +421,12 @@ static void __noreturn init_coldboot(struct sbi_scratch *scratch, u32 hartid)
 
 	run_all_tests();
 
+	/* Boot messages are written directly, the rest is buffered */
+	rc = sbi_console_buffer_init(scratch);
+	if (rc)
+		sbi_printf("%s: console buffer init failed (error %d)\n",
+			   __func__, rc);
+
 	/*
 	 * Note: Startup domains after all initialization are done
 	 * otherwise boot HART of non-root domain can crash.
@@ -450,10 +505,26 @@ static void __noreturn init_warm_startup(struct sbi_scratch *scratch,
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_insn_emu_hot_init(scratch, false);
+	if (rc)
+		sbi_hart_hang();
+
+	rc = sbi_unpriv_ptw_init(scratch, false);
+	if (rc)
+		sbi_hart_hang();
+
+	rc = sbi_insn_emu_xtheadvector_init(scratch, false);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_fwft_init(scratch, false);
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_insn_emu_calib_init(scratch, false);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_platform_final_init(plat, false);
 	if (rc)
 		sbi_hart_hang();
@@ -8,8 +8,16 @@
  */
 
 #include <sbi/riscv_encoding.h>
+#include <sbi/sbi_bitops.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_insn_emu.h>
+#include <sbi/sbi_insn_emu_crypto.h>
+#include <sbi/sbi_insn_emu_fuse.h>
+#include <sbi/sbi_insn_emu_xtheadvector.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_trap_ldst.h>
@@ -20,6 +28,291 @@
 #define GET_SHAMT32(insn) ((insn >> 20) & MASK_SHAMT32)
 #define GET_SHAMT(insn) ((insn >> 20) & MASK_SHAMT)
 
+static const char *const group_names[SBI_ISA_EMU_GROUP_MAX] = {
+	[SBI_ISA_EMU_GROUP_ZBA]		= "zba",
+	[SBI_ISA_EMU_GROUP_ZBB]		= "zbb",
+	[SBI_ISA_EMU_GROUP_ZBC]		= "zbc",
+	[SBI_ISA_EMU_GROUP_ZBS]		= "zbs",
+	[SBI_ISA_EMU_GROUP_ZICOND]	= "zicond",
+	[SBI_ISA_EMU_GROUP_ZIMOP]	= "zimop",
+	[SBI_ISA_EMU_GROUP_ZCMOP]	= "zcmop",
+	[SBI_ISA_EMU_GROUP_ZCB]		= "zcb",
+	[SBI_ISA_EMU_GROUP_ZAWRS]	= "zawrs",
+	[SBI_ISA_EMU_GROUP_ZICBOM]	= "zicbom",
+	[SBI_ISA_EMU_GROUP_ZICBOZ]	= "zicboz",
+	[SBI_ISA_EMU_GROUP_ZFHMIN]	= "zfhmin",
+	[SBI_ISA_EMU_GROUP_ZFA]		= "zfa",
+	[SBI_ISA_EMU_GROUP_ZVBB]	= "zvbb",
+	[SBI_ISA_EMU_GROUP_ZKND]	= "zknd",
+	[SBI_ISA_EMU_GROUP_ZKNE]	= "zkne",
+	[SBI_ISA_EMU_GROUP_ZKNH]	= "zknh",
+	[SBI_ISA_EMU_GROUP_ZVFH]	= "zvfh",
+};
+
+const char *sbi_insn_emu_group_name(u32 group)
+{
+	if (group >= SBI_ISA_EMU_GROUP_MAX)
+		return NULL;
+
+	return group_names[group];
+}
+
+u32 sbi_insn_emu_group_of(ulong insn)
+{
+	u32 funct3 = GET_FUNC3(insn);
+	u32 funct7 = (insn >> 25) & 0x7f;
+	u32 rs2 = GET_RS2_NUM(insn);
+
+	/* Compressed instructions, see illegal_insn16_table */
+	if ((insn & 3) != 3) {
+		switch ((insn & 3) << 3 | (insn & 0xffff) >> 13) {
+		case 4:
+		case 12:
+			return SBI_ISA_EMU_GROUP_ZCB;
+		case 11:
+			if ((insn & INSN_MASK_C_MOP_N) == INSN_MATCH_C_MOP_N)
+				return SBI_ISA_EMU_GROUP_ZCMOP;
+			break;
+		}
+		return SBI_ISA_EMU_GROUP_MAX;
+	}
+
+	/* Major opcodes, see illegal_insn_table */
+	switch ((insn & 0x7c) >> 2) {
+	case 1: /* LOAD-FP */
+	case 9: /* STORE-FP */
+		if (funct3 == 1)
+			return SBI_ISA_EMU_GROUP_ZFHMIN;
+		break;
+	case 3: /* MISC-MEM */
+		if (funct3 != 2)
+			break;
+		if ((insn & INSN_MASK_CBO) == INSN_MATCH_CBO_ZERO)
+			return SBI_ISA_EMU_GROUP_ZICBOZ;
+		return SBI_ISA_EMU_GROUP_ZICBOM;
+	case 4: /* OP-IMM */
+		/* The AES key schedule is in Zknd too but counts as Zkne */
+		if (funct3 == 1 && funct7 == 0x18)
+			return (insn & BIT(24)) ? SBI_ISA_EMU_GROUP_ZKNE
+						: SBI_ISA_EMU_GROUP_ZKND;
+		if (funct3 == 1 && funct7 == 0x08)
+			return SBI_ISA_EMU_GROUP_ZKNH;
+		if (funct3 == 1)
+			return ((insn >> 26) == 0x18) ? SBI_ISA_EMU_GROUP_ZBB
+						      : SBI_ISA_EMU_GROUP_ZBS;
+		if (funct3 == 5)
+			return ((insn >> 26) == 0x12) ? SBI_ISA_EMU_GROUP_ZBS
+						      : SBI_ISA_EMU_GROUP_ZBB;
+		break;
+	case 6: /* OP-IMM-32 */
+		return ((insn >> 26) == 0x02) ? SBI_ISA_EMU_GROUP_ZBA
+					      : SBI_ISA_EMU_GROUP_ZBB;
+	case 12: /* OP */
+		switch (funct7) {
+		case 0x05:
+			return (funct3 < 4) ? SBI_ISA_EMU_GROUP_ZBC
+					    : SBI_ISA_EMU_GROUP_ZBB;
+		case 0x07:
+			return SBI_ISA_EMU_GROUP_ZICOND;
+		case 0x10:
+			return SBI_ISA_EMU_GROUP_ZBA;
+		case 0x14:
+		case 0x24:
+		case 0x34:
+			return SBI_ISA_EMU_GROUP_ZBS;
+		case 0x04:
+		case 0x20:
+		case 0x30:
+			return SBI_ISA_EMU_GROUP_ZBB;
+		case 0x19:
+		case 0x1b:
+		case 0x3f:
+			return SBI_ISA_EMU_GROUP_ZKNE;
+		case 0x1d:
+		case 0x1f:
+			return SBI_ISA_EMU_GROUP_ZKND;
+		}
+		/* aes32*, with the byte select in funct7[6:5] */
+		if ((funct7 & 0x1d) == 0x11)
+			return SBI_ISA_EMU_GROUP_ZKNE;
+		if ((funct7 & 0x1d) == 0x15)
+			return SBI_ISA_EMU_GROUP_ZKND;
+		if ((funct7 & 0x78) == 0x28)
+			return SBI_ISA_EMU_GROUP_ZKNH;
+		break;
+	case 14: /* OP-32 */
+		if (funct7 == 0x10 || (funct7 == 0x04 && funct3 == 0))
+			return SBI_ISA_EMU_GROUP_ZBA;
+		return SBI_ISA_EMU_GROUP_ZBB;
+	case 20: /* OP-FP */
+		switch (funct7) {
+		case 0x20:
+		case 0x21:
+		case 0x22:
+		case 0x23:
+			/* fround and froundnx share funct7 with fcvt */
+			return (rs2 >= 4) ? SBI_ISA_EMU_GROUP_ZFA
+					  : SBI_ISA_EMU_GROUP_ZFHMIN;
+		case 0x78:
+		case 0x79:
+		case 0x7a:
+			/* fli shares funct7 with fmv from integer */
+			return (rs2 == 1) ? SBI_ISA_EMU_GROUP_ZFA
+					  : SBI_ISA_EMU_GROUP_ZFHMIN;
+		case 0x62:
+		case 0x6a:
+		case 0x72:
+			return SBI_ISA_EMU_GROUP_ZFHMIN;
+		case 0x14:
+		case 0x15:
+		case 0x16:
+		case 0x50:
+		case 0x51:
+		case 0x52:
+		case 0x61:
+			return SBI_ISA_EMU_GROUP_ZFA;
+		}
+		break;
+	case 21: /* OP-V */
+		/*
+		 * On XTheadVector HARTs all of OP-V goes to the RVV 1.0
+		 * translation, which is not gated per extension group.
+		 */
+		if (sbi_insn_emu_xtheadvector_active())
+			return SBI_ISA_EMU_GROUP_MAX;
+		/* OPFVV and OPFVF */
+		if (GET_FUNC3(insn) == 1 || GET_FUNC3(insn) == 5)
+			return SBI_ISA_EMU_GROUP_ZVFH;
+		return SBI_ISA_EMU_GROUP_ZVBB;
+	case 28: /* SYSTEM */
+		if (insn == INSN_MATCH_WRS_NTO || insn == INSN_MATCH_WRS_STO)
+			return SBI_ISA_EMU_GROUP_ZAWRS;
+		if ((insn & INSN_MASK_MOP_R_N) == INSN_MATCH_MOP_R_N ||
+		    (insn & INSN_MASK_MOP_RR_N) == INSN_MATCH_MOP_RR_N)
+			return SBI_ISA_EMU_GROUP_ZIMOP;
+		break;
+	}
+
+	return SBI_ISA_EMU_GROUP_MAX;
+}
+
+static bool emu_groups_registered;
+
+static int domain_emu_groups_setup(struct sbi_domain *dom,
+				   struct sbi_domain_data *data,
+				   void *data_ptr)
+{
+	unsigned long *dom_hartindex_to_groups_table = data_ptr;
+
+	/* Everything the firmware can emulate is enabled by default */
+	sbi_for_each_hartindex(i)
+		dom_hartindex_to_groups_table[i] = SBI_ISA_EMU_GROUP_ALL;
+
+	return 0;
+}
+
+static struct sbi_domain_data emu_groups_priv = {
+	.data_setup = domain_emu_groups_setup,
+};
+
+static unsigned long *hart_emu_groups_ptr(u32 hartindex)
+{
+	unsigned long *dom_hartindex_to_groups_table;
+	struct sbi_domain *dom = sbi_hartindex_to_domain(hartindex);
+
+	if (!emu_groups_registered || !dom)
+		return NULL;
+
+	dom_hartindex_to_groups_table =
+		sbi_domain_data_ptr(dom, &emu_groups_priv);
+	if (!dom_hartindex_to_groups_table)
+		return NULL;
+
+	return &dom_hartindex_to_groups_table[hartindex];
+}
+
+static unsigned long *thishart_emu_groups_ptr(void)
+{
+	return hart_emu_groups_ptr(current_hartindex());
+}
+
+unsigned long sbi_insn_emu_get_groups(void)
+{
+	unsigned long *groups = thishart_emu_groups_ptr();
+
+	return groups ? *groups : SBI_ISA_EMU_GROUP_ALL;
+}
+
+int sbi_insn_emu_set_groups(unsigned long value)
+{
+	unsigned long *groups = thishart_emu_groups_ptr();
+
+	if (value & ~SBI_ISA_EMU_GROUP_ALL)
+		return SBI_EINVAL;
+	if (!groups)
+		return SBI_ENOTSUPP;
+
+	*groups = value;
+
+	return 0;
+}
+
+unsigned long sbi_insn_emu_groups_emulated(struct sbi_scratch *scratch)
+{
+	unsigned long *enabled = hart_emu_groups_ptr(scratch->hartindex);
+	unsigned long groups = enabled ? *enabled : SBI_ISA_EMU_GROUP_ALL;
+	bool has_f = sbi_hart_has_misa_extension(scratch, 'F');
+	bool has_v = sbi_hart_has_misa_extension(scratch, 'V');
+
+	if (!sbi_hart_has_misa_extension(scratch, 'C'))
+		groups &= ~(BIT(SBI_ISA_EMU_GROUP_ZCMOP) |
+			    BIT(SBI_ISA_EMU_GROUP_ZCB));
+	if (!has_f)
+		groups &= ~(BIT(SBI_ISA_EMU_GROUP_ZFHMIN) |
+			    BIT(SBI_ISA_EMU_GROUP_ZFA));
+	if (__riscv_xlen != 64 || !has_v)
+		groups &= ~BIT(SBI_ISA_EMU_GROUP_ZVBB);
+	if (__riscv_xlen != 64 || !has_v || !has_f)
+		groups &= ~BIT(SBI_ISA_EMU_GROUP_ZVFH);
+	/* OP-V is translated, not emulated, on XTheadVector HARTs */
+	if (sbi_insn_emu_xtheadvector_hart_active(scratch))
+		groups &= ~(BIT(SBI_ISA_EMU_GROUP_ZVBB) |
+			    BIT(SBI_ISA_EMU_GROUP_ZVFH));
+
+	return groups & ~sbi_hart_emu_groups_native(scratch);
+}
+
+bool sbi_insn_emu_allowed(ulong insn)
+{
+	unsigned long groups = sbi_insn_emu_get_groups();
+	u32 group;
+
+	if (likely(groups == SBI_ISA_EMU_GROUP_ALL))
+		return true;
+
+	group = sbi_insn_emu_group_of(insn);
+
+	return group >= SBI_ISA_EMU_GROUP_MAX || (groups & BIT(group));
+}
+
+int sbi_insn_emu_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	int rc;
+
+	if (!cold_boot)
+		return 0;
+
+	/* Per-domain and per-HART table of enabled extension groups */
+	emu_groups_priv.data_size = sizeof(unsigned long) * sbi_hart_count();
+	rc = sbi_domain_register_data(&emu_groups_priv);
+	if (rc)
+		return rc;
+
+	emu_groups_registered = true;
+
+	return 0;
+}
+
 int sbi_insn_emu_op_imm(ulong insn, struct sbi_trap_regs *regs)
 {
 	ulong rs1_val = GET_RS1(insn, regs);
@@ -108,7 +401,7 @@ int sbi_insn_emu_op_imm(ulong insn, struct sbi_trap_regs *regs)
 			rd_val = (long)(s16)rs1_val;
 			break;
 		default:
-			return truly_illegal_insn(insn, regs);
+			return sbi_insn_emu_crypto_op_imm(insn, regs);
 		}
 	}
 
@@ -125,6 +418,10 @@ int sbi_insn_emu_op(ulong insn, struct sbi_trap_regs *regs)
 	ulong rs2_val = GET_RS2(insn, regs);
 	ulong rd_val;
 
+	/* Retire czero selects and shift-add loads in one trap */
+	if (sbi_insn_emu_fuse(insn, regs))
+		return 0;
+
 	switch (insn & INSN_MASK_RTYPE_RD_RS1_RS2) {
 	/* Emulate Zbs register instructions */
 	case INSN_MATCH_BCLR:
@@ -189,7 +486,7 @@ int sbi_insn_emu_op(ulong insn, struct sbi_trap_regs *regs)
 		break;
 	case INSN_MATCH_CLMULH:
 		rd_val = 0;
-		for (int i = 1; i <= __riscv_xlen; i++) {
+		for (int i = 1; i < __riscv_xlen; i++) {
 			if ((rs2_val >> i) & 1)
 				rd_val ^= rs1_val >> (__riscv_xlen - i);
 		}
@@ -217,7 +514,7 @@ int sbi_insn_emu_op(ulong insn, struct sbi_trap_regs *regs)
 			break;
 #endif
 		default:
-			return truly_illegal_insn(insn, regs);
+			return sbi_insn_emu_crypto_op(insn, regs);
 		}
 	}
 
@@ -339,100 +636,46 @@ int sbi_insn_emu_op_imm_32(ulong insn, struct sbi_trap_regs *regs)
 
 int sbi_insn_emu_c_reserved(ulong insn, struct sbi_trap_regs *regs)
 {
-	ulong rs1_val = GET_RS1S(insn, regs);
+	struct sbi_unpriv_access acc;
 	struct sbi_trap_info uptrap;
-	ulong val;
 
-	switch (insn & INSN_MASK_C_GENERIC_RXS_RXS) {
-	/* Emulate Zcb additional compressed instructions */
+	/* Emulate Zcb additional compressed loads and stores */
+	switch (insn & INSN_MASK_C_LBU) {
 	case INSN_MATCH_C_LBU:
-		val = sbi_load_u8((void *)rs1_val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
-		break;
-	case INSN_MATCH_C_LBU + 0x40:
-		val = sbi_load_u8((void *)rs1_val + 1, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
-		break;
-	case INSN_MATCH_C_LBU + 0x20:
-		val = sbi_load_u8((void *)rs1_val + 2, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
-		break;
-	case INSN_MATCH_C_LBU + 0x60:
-		val = sbi_load_u8((void *)rs1_val + 3, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
+		acc.size = 1;
+		acc.flags = 0;
 		break;
 	case INSN_MATCH_C_LHU:
-		val = sbi_load_u16((void *)rs1_val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
-		break;
-	case INSN_MATCH_C_LHU + 0x20:
-		val = sbi_load_u16((void *)rs1_val + 2, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
-		break;
-	case INSN_MATCH_C_LH:
-		val = sbi_load_s16((void *)rs1_val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
-		break;
-	case INSN_MATCH_C_LH + 0x20:
-		val = sbi_load_s16((void *)rs1_val + 2, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		SET_RD2S(insn, regs, val);
+		/* c.lh differs from c.lhu in the bit that is uimm[0] of c.lbu */
+		acc.size = 2;
+		acc.flags = insn & 0x40 ? SBI_UNPRIV_SIGNED : 0;
 		break;
 	case INSN_MATCH_C_SB:
-		val = GET_RS2S(insn, regs);
-		sbi_store_u8((void *)rs1_val, val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		break;
-	case INSN_MATCH_C_SB + 0x40:
-		val = GET_RS2S(insn, regs);
-		sbi_store_u8((void *)rs1_val + 1, val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		break;
-	case INSN_MATCH_C_SB + 0x20:
-		val = GET_RS2S(insn, regs);
-		sbi_store_u8((void *)rs1_val + 2, val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		break;
-	case INSN_MATCH_C_SB + 0x60:
-		val = GET_RS2S(insn, regs);
-		sbi_store_u8((void *)rs1_val + 3, val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
+		acc.size = 1;
+		acc.flags = SBI_UNPRIV_STORE;
 		break;
 	case INSN_MATCH_C_SH:
-		val = GET_RS2S(insn, regs);
-		sbi_store_u16((void *)rs1_val, val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
-		break;
-	case INSN_MATCH_C_SH + 0x20:
-		val = GET_RS2S(insn, regs);
-		sbi_store_u16((void *)rs1_val + 2, val, &uptrap);
-		if (uptrap.cause)
-			return sbi_trap_redirect(regs, &uptrap);
+		if (insn & 0x40)
+			return truly_illegal_insn(insn, regs);
+		acc.size = 2;
+		acc.flags = SBI_UNPRIV_STORE;
 		break;
 	default:
 		return truly_illegal_insn(insn, regs);
 	}
 
+	/* uimm[1] in bit 5, uimm[0] in bit 6 for byte accesses */
+	acc.addr = GET_RS1S(insn, regs) + ((insn >> 4) & 2);
+	if (acc.size == 1)
+		acc.addr += (insn >> 6) & 1;
+	acc.val = GET_RS2S(insn, regs);
+
+	sbi_unpriv_batch(&acc, 1, &uptrap);
+	if (uptrap.cause)
+		return sbi_trap_redirect(regs, &uptrap);
+	if (!(acc.flags & SBI_UNPRIV_STORE))
+		SET_RD2S(insn, regs, acc.val);
+
 	regs->mepc += 2;
 
 	return 0;
@@ -535,7 +778,7 @@ int sbi_insn_emu_zicbom_zicboz(ulong insn, struct sbi_trap_regs *regs)
 			return truly_illegal_insn(insn, regs);
 
 		u32 *addr =
-			(u32 *)(GET_RS1S(insn, regs) & 0xffffffffffffffc0ull);
+			(u32 *)(GET_RS1(insn, regs) & 0xffffffffffffffc0ull);
 		struct sbi_trap_info uptrap;
 		/* Zero the 64 byte block */
 		for (int i = 0; i < 16; i++) {
@@ -0,0 +1,311 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_bitops.h>
+#include <sbi/sbi_console.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_insn_emu.h>
+#include <sbi/sbi_insn_emu_calib.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_trap.h>
+
+#define CALIB_ITERATIONS	CONFIG_SBI_INSN_EMU_CALIBRATION_ITERATIONS
+/* Not allocated by the SBI specification, nor in the firmware range */
+#define CALIB_EXT_UNKNOWN	0x0b000000
+
+/* Operands of the sample instructions: rd = a0, rs1 = a1, rs2 = a2 */
+#define CALIB_RD		(10 << 7)
+#define CALIB_RS1		(11 << 15)
+#define CALIB_RS2		(12 << 20)
+/* Compressed operands: rd' = a0, rs1' = a1 */
+#define CALIB_RD_C		(2 << 2)
+#define CALIB_RS1_C		(3 << 7)
+
+struct calib_sample {
+	u32 insn;
+	/* Privilege mode the instruction pretends to come from */
+	ulong mpp;
+};
+
+/* One representative instruction per extension group */
+static const struct calib_sample samples[SBI_ISA_EMU_GROUP_MAX] = {
+	[SBI_ISA_EMU_GROUP_ZBA] = {
+		INSN_MATCH_SH1ADD | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZBB] = {
+		INSN_MATCH_CPOP | CALIB_RD | CALIB_RS1, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZBC] = {
+		INSN_MATCH_CLMUL | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZBS] = {
+		INSN_MATCH_BSET | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZICOND] = {
+		INSN_MATCH_CZERO_EQZ | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZIMOP] = {
+		INSN_MATCH_MOP_R_N | CALIB_RD | CALIB_RS1, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZCMOP] = {
+		INSN_MATCH_C_MOP_N, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZCB] = {
+		INSN_MATCH_C_LBU | CALIB_RD_C | CALIB_RS1_C, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZAWRS] = {
+		INSN_MATCH_WRS_NTO, PRV_U },
+	/* Cache block operations are checked against menvcfg from S-mode */
+	[SBI_ISA_EMU_GROUP_ZICBOM] = {
+		INSN_MATCH_CBO_CLEAN | CALIB_RS1, PRV_S },
+	[SBI_ISA_EMU_GROUP_ZICBOZ] = {
+		INSN_MATCH_CBO_ZERO | CALIB_RS1, PRV_S },
+	[SBI_ISA_EMU_GROUP_ZFHMIN] = {
+		INSN_MATCH_FCVT_S_H | CALIB_RD | CALIB_RS1, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZFA] = {
+		INSN_MATCH_FROUND_S | CALIB_RD | CALIB_RS1, PRV_U },
+	/* vandn.vv v1, v3, v2 (unmasked) */
+	[SBI_ISA_EMU_GROUP_ZVBB] = {
+		INSN_MATCH_VANDNVV | BIT(25) | (1 << 7) | (2 << 15) | (3 << 20),
+		PRV_U },
+#if __riscv_xlen == 64
+	[SBI_ISA_EMU_GROUP_ZKND] = {
+		INSN_MATCH_AES64DSM | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZKNE] = {
+		INSN_MATCH_AES64ESM | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+#else
+	[SBI_ISA_EMU_GROUP_ZKND] = {
+		INSN_MATCH_AES32DSMI | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+	[SBI_ISA_EMU_GROUP_ZKNE] = {
+		INSN_MATCH_AES32ESMI | CALIB_RD | CALIB_RS1 | CALIB_RS2, PRV_U },
+#endif
+	[SBI_ISA_EMU_GROUP_ZKNH] = {
+		INSN_MATCH_SHA256SIG0 | CALIB_RD | CALIB_RS1, PRV_U },
+	/* vfadd.vv v1, v3, v2 (unmasked) */
+	[SBI_ISA_EMU_GROUP_ZVFH] = {
+		INSN_MATCH_VFADDVV | BIT(25) | (1 << 7) | (2 << 15) | (3 << 20),
+		PRV_U },
+};
+
+struct insn_emu_calib {
+	/* Measured once per HART, kept across HSM stop and start */
+	bool done;
+	/* Round-trip cost of an M-mode trap, zero if not calibrated */
+	u32 trap_cycles;
+	/* Average handler cost per group, zero if not emulated */
+	u32 cycles[SBI_ISA_EMU_GROUP_MAX];
+};
+
+static unsigned long calib_offset;
+
+/* Target of the emulated Zcb load and Zicboz store */
+static u8 calib_buf[64] __aligned(64);
+
+static u32 calib_trap_cost(void)
+{
+	register ulong a0 asm("a0") = 0;
+	register ulong a1 asm("a1") = 0;
+	register ulong a6 asm("a6") = 0;
+	register ulong a7 asm("a7") = CALIB_EXT_UNKNOWN;
+	ulong start, total = 0;
+	int i;
+
+	/* Unknown extension, so only the trap path itself is measured */
+	for (i = 0; i < CALIB_ITERATIONS; i++) {
+		start = csr_read(CSR_MCYCLE);
+		asm volatile("ecall"
+			     : "+r"(a0), "+r"(a1)
+			     : "r"(a6), "r"(a7)
+			     : "memory");
+		total += csr_read(CSR_MCYCLE) - start;
+	}
+
+	return total / CALIB_ITERATIONS;
+}
+
+static u32 calib_group_cost(u32 group, ulong mstatus)
+{
+	const struct calib_sample *s = &samples[group];
+	struct sbi_trap_context tcntx;
+	struct sbi_trap_regs *regs = &tcntx.regs;
+	/* Fetched through sbi_get_insn() for compressed instructions */
+	u16 code[2] = { s->insn, s->insn >> 16 };
+	ulong len = ((s->insn & 3) == 3) ? 4 : 2;
+	ulong start, total = 0;
+	int i, rc;
+
+	sbi_memset(&tcntx, 0, sizeof(tcntx));
+	tcntx.trap.cause = CAUSE_ILLEGAL_INSTRUCTION;
+	/* A zero tval makes the handler fetch the instruction itself */
+	tcntx.trap.tval = (len == 4) ? s->insn : 0;
+
+	for (i = 0; i < CALIB_ITERATIONS; i++) {
+		regs->mstatus = (mstatus & ~MSTATUS_MPP) |
+				(s->mpp << MSTATUS_MPP_SHIFT);
+		regs->mepc = (ulong)code;
+		regs->a1 = (ulong)calib_buf;
+		regs->a2 = 0x5a5a5a5a;
+
+		start = csr_read(CSR_MCYCLE);
+		rc = sbi_illegal_insn_handler(&tcntx);
+		total += csr_read(CSR_MCYCLE) - start;
+
+		/* Anything but a plain retirement means "not emulated" */
+		if (rc || regs->mepc != (ulong)code + len)
+			return 0;
+	}
+
+	return total / CALIB_ITERATIONS;
+}
+
+static void calib_run(struct insn_emu_calib *calib)
+{
+	ulong mstatus, sepc = 0, scause = 0, stval = 0;
+	ulong hstatus = 0, htval = 0, htinst = 0, fcsr = 0;
+#if __riscv_xlen == 64
+	ulong vl = 0, vtype = 0;
+#endif
+	u32 g;
+
+	/* Must precede the MPP update below because mret resets MPP */
+	calib->trap_cycles = calib_trap_cost();
+
+	mstatus = csr_read(CSR_MSTATUS);
+	if (misa_extension('S')) {
+		sepc = csr_read(CSR_SEPC);
+		scause = csr_read(CSR_SCAUSE);
+		stval = csr_read(CSR_STVAL);
+	}
+	if (misa_extension('H')) {
+		hstatus = csr_read(CSR_HSTATUS);
+		htval = csr_read(CSR_HTVAL);
+		htinst = csr_read(CSR_HTINST);
+	}
+	if (misa_extension('F'))
+		fcsr = csr_read(CSR_FCSR);
+#if __riscv_xlen == 64
+	if (misa_extension('V')) {
+		vl = csr_read(CSR_VL);
+		vtype = csr_read(CSR_VTYPE);
+		/* Four 16-bit elements, as Zvfh only exists at SEW=16 */
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetivli x0, 4, e16, m1, ta, ma\n\t"
+			     ".option pop\n\t");
+	}
+#endif
+
+	/*
+	 * Unprivileged accesses of the emulation code use MPRV, so let
+	 * them target M-mode memory while the calibration is running.
+	 */
+	csr_write(CSR_MSTATUS, (mstatus & ~MSTATUS_MPP) |
+			       (PRV_M << MSTATUS_MPP_SHIFT));
+
+	for (g = 0; g < SBI_ISA_EMU_GROUP_MAX; g++)
+		calib->cycles[g] = calib_group_cost(g, mstatus);
+
+	csr_write(CSR_MSTATUS, mstatus);
+#if __riscv_xlen == 64
+	if (misa_extension('V'))
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetvl x0, %0, %1\n\t"
+			     ".option pop\n\t"
+			     :: "r"(vl), "r"(vtype));
+#endif
+	if (misa_extension('F'))
+		csr_write(CSR_FCSR, fcsr);
+	if (misa_extension('H')) {
+		csr_write(CSR_HSTATUS, hstatus);
+		csr_write(CSR_HTVAL, htval);
+		csr_write(CSR_HTINST, htinst);
+	}
+	if (misa_extension('S')) {
+		csr_write(CSR_SEPC, sepc);
+		csr_write(CSR_SCAUSE, scause);
+		csr_write(CSR_STVAL, stval);
+	}
+}
+
+int sbi_insn_emu_calib_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct insn_emu_calib *calib;
+
+	if (cold_boot) {
+		calib_offset = sbi_scratch_alloc_offset(sizeof(struct insn_emu_calib));
+		if (!calib_offset)
+			return SBI_ENOMEM;
+	} else if (!calib_offset) {
+		return SBI_ENOMEM;
+	}
+
+	calib = sbi_scratch_offset_ptr(scratch, calib_offset);
+	if (!calib->done) {
+		calib_run(calib);
+		calib->done = true;
+	}
+
+	return 0;
+}
+
+void sbi_insn_emu_calib_dump(struct sbi_scratch *scratch, const char *prefix)
+{
+	struct insn_emu_calib *calib;
+	u32 g;
+
+	if (!calib_offset)
+		return;
+
+	calib = sbi_scratch_offset_ptr(scratch, calib_offset);
+	sbi_printf("%sEmu Trap Cost     : %u cycles\n",
+		   prefix, calib->trap_cycles);
+	for (g = 0; g < SBI_ISA_EMU_GROUP_MAX; g++) {
+		if (calib->cycles[g])
+			sbi_printf("%sEmu Cost %-9s: %u cycles\n", prefix,
+				   sbi_insn_emu_group_name(g), calib->cycles[g]);
+		else
+			sbi_printf("%sEmu Cost %-9s: n/a\n", prefix,
+				   sbi_insn_emu_group_name(g));
+	}
+}
+
+static struct insn_emu_calib *calib_get(u32 hartid)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+
+	if (!scratch || !calib_offset)
+		return NULL;
+
+	return sbi_scratch_offset_ptr(scratch, calib_offset);
+}
+
+int sbi_insn_emu_calib_trap_cost(u32 hartid, unsigned long *out_cycles)
+{
+	struct insn_emu_calib *calib = calib_get(hartid);
+
+	if (!calib)
+		return SBI_EINVAL;
+	if (!calib->trap_cycles)
+		return SBI_ENOTSUPP;
+
+	*out_cycles = calib->trap_cycles;
+	return 0;
+}
+
+int sbi_insn_emu_calib_cost(u32 hartid, u32 group, unsigned long *out_cycles)
+{
+	struct insn_emu_calib *calib = calib_get(hartid);
+
+	if (!calib || group >= SBI_ISA_EMU_GROUP_MAX)
+		return SBI_EINVAL;
+	if (!calib->cycles[group])
+		return SBI_ENOTSUPP;
+
+	*out_cycles = calib->cycles[group];
+	return 0;
+}
@@ -0,0 +1,397 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Emulation of the scalar cryptography extensions Zkne, Zknd and Zknh
+ *
+ * Everything in here runs in constant time with respect to the register
+ * operands: the AES S-box is computed on bit planes as GF(2^8) inversion
+ * followed by the affine transformation, MixColumns works on packed bytes
+ * and all table indices come from the instruction encoding only.
+ */
+
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_insn_emu_crypto.h>
+#include <sbi/sbi_trap.h>
+
+#define SEXT32(v)	((ulong)(long)(s32)(v))
+
+static inline u32 ror32(u32 x, int shamt)
+{
+	return x >> shamt | x << (32 - shamt);
+}
+
+#if __riscv_xlen == 64
+static inline u64 ror64(u64 x, int shamt)
+{
+	return x >> shamt | x << (64 - shamt);
+}
+#endif
+
+/*
+ * Transpose an 8x8 bit matrix held in the bytes of x, i.e. bit i of
+ * byte j becomes bit j of byte i. The operation is its own inverse.
+ */
+static u64 aes_transpose8(u64 x)
+{
+	u64 t;
+
+	t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+/* Reduce a bit-plane polynomial of degree 14 modulo x^8+x^4+x^3+x+1 */
+static void gf_reduce(u32 c[15], u32 r[8])
+{
+	int k;
+
+	for (k = 14; k >= 8; k--) {
+		c[k - 4] ^= c[k];
+		c[k - 5] ^= c[k];
+		c[k - 7] ^= c[k];
+		c[k - 8] ^= c[k];
+	}
+	for (k = 0; k < 8; k++)
+		r[k] = c[k];
+}
+
+static void gf_mul(u32 r[8], const u32 a[8], const u32 b[8])
+{
+	u32 c[15] = { 0 };
+	int i, j;
+
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < 8; j++)
+			c[i + j] ^= a[i] & b[j];
+
+	gf_reduce(c, r);
+}
+
+static void gf_sqr(u32 r[8], const u32 a[8])
+{
+	u32 c[15] = { 0 };
+	int i;
+
+	for (i = 0; i < 8; i++)
+		c[2 * i] = a[i];
+
+	gf_reduce(c, r);
+}
+
+/* a^254, which is the inverse for a != 0 and maps 0 to 0 */
+static void gf_inv(u32 r[8], const u32 a[8])
+{
+	u32 a2[8], a3[8], a12[8], t[8];
+	int i;
+
+	gf_sqr(a2, a);
+	gf_mul(a3, a2, a);
+	gf_sqr(t, a3);
+	gf_sqr(a12, t);
+	gf_mul(t, a12, a3);		/* a^15 */
+	for (i = 0; i < 4; i++)
+		gf_sqr(t, t);		/* a^240 */
+	gf_mul(t, t, a12);		/* a^252 */
+	gf_mul(r, t, a2);		/* a^254 */
+}
+
+/* y = M * x ^ c with M given by the bit rotations set in rot */
+static void aes_affine(u32 r[8], const u32 p[8], u8 rot, u8 c)
+{
+	int i, k;
+
+	for (i = 0; i < 8; i++) {
+		r[i] = -(u32)((c >> i) & 1) & 0xff;
+		for (k = 0; k < 8; k++)
+			if ((rot >> k) & 1)
+				r[i] ^= p[(i - k) & 7];
+	}
+}
+
+/* Forward affine transformation: rotations by 0 to 4, constant 0x63 */
+#define AES_AFFINE_FWD_ROT	0x1f
+#define AES_AFFINE_FWD_C	0x63
+/* Inverse affine transformation: rotations by 1, 3 and 6, constant 0x05 */
+#define AES_AFFINE_INV_ROT	0x4a
+#define AES_AFFINE_INV_C	0x05
+
+/* Forward or inverse S-box applied to each of the eight bytes of x */
+static u64 aes_sbox8(u64 x, bool inv)
+{
+	u32 p[8], q[8];
+	u64 t;
+	int i;
+
+	t = aes_transpose8(x);
+	for (i = 0; i < 8; i++)
+		p[i] = (t >> (8 * i)) & 0xff;
+
+	if (inv) {
+		aes_affine(q, p, AES_AFFINE_INV_ROT, AES_AFFINE_INV_C);
+		gf_inv(p, q);
+	} else {
+		gf_inv(q, p);
+		aes_affine(p, q, AES_AFFINE_FWD_ROT, AES_AFFINE_FWD_C);
+	}
+
+	t = 0;
+	for (i = 0; i < 8; i++)
+		t |= (u64)p[i] << (8 * i);
+
+	return aes_transpose8(t);
+}
+
+/* Multiply each of the four packed bytes by x */
+static inline u32 aes_xtime4(u32 w)
+{
+	return ((w & 0x7f7f7f7f) << 1) ^ (((w >> 7) & 0x01010101) * 0x1b);
+}
+
+static u32 aes_mixcolumn_fwd(u32 w)
+{
+	u32 r = ror32(w, 8);
+
+	return aes_xtime4(w ^ r) ^ r ^ ror32(w, 16) ^ ror32(w, 24);
+}
+
+/* InvMixColumns is MixColumns after multiplying by {04}x^2 + {05} */
+static u32 aes_mixcolumn_inv(u32 w)
+{
+	u32 t = aes_xtime4(aes_xtime4(w ^ ror32(w, 16)));
+
+	return aes_mixcolumn_fwd(w ^ t);
+}
+
+#if __riscv_xlen == 64
+/*
+ * Low half of ShiftRows or InvShiftRows of the state rs2:rs1, where
+ * byte 4 * c + r holds row r of column c.
+ */
+static u64 aes64_shift_rows(u64 lo, u64 hi, bool inv)
+{
+	u64 r = 0, b;
+	int k, c, row, src;
+
+	for (k = 0; k < 8; k++) {
+		c = k >> 2;
+		row = k & 3;
+		src = 4 * ((inv ? c - row : c + row) & 3) + row;
+		b = (src < 8) ? lo >> (8 * src) : hi >> (8 * (src - 8));
+		r |= (b & 0xff) << (8 * k);
+	}
+
+	return r;
+}
+
+static u64 aes64_mix(u64 x, bool inv)
+{
+	u32 lo = x, hi = x >> 32;
+
+	if (inv) {
+		lo = aes_mixcolumn_inv(lo);
+		hi = aes_mixcolumn_inv(hi);
+	} else {
+		lo = aes_mixcolumn_fwd(lo);
+		hi = aes_mixcolumn_fwd(hi);
+	}
+
+	return (u64)hi << 32 | lo;
+}
+
+static const u8 aes_rcon[10] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
+};
+
+static u64 aes64_ks1i(u64 rs1, unsigned int rnum)
+{
+	u32 t = rs1 >> 32;
+
+	if (rnum != 0xa)
+		t = ror32(t, 8);
+	t = aes_sbox8(t, false);
+	if (rnum != 0xa)
+		t ^= aes_rcon[rnum];
+
+	return (u64)t << 32 | t;
+}
+#else
+static u32 aes32(u32 rs1, u32 rs2, unsigned int bs, bool inv, bool mix)
+{
+	int shamt = 8 * bs;
+	u32 so = aes_sbox8((rs2 >> shamt) & 0xff, inv) & 0xff;
+
+	if (mix)
+		so = inv ? aes_mixcolumn_inv(so) : aes_mixcolumn_fwd(so);
+
+	return rs1 ^ (so << shamt | (shamt ? so >> (32 - shamt) : 0));
+}
+#endif
+
+int sbi_insn_emu_crypto_op_imm(ulong insn, struct sbi_trap_regs *regs)
+{
+	ulong rs1_val = GET_RS1(insn, regs);
+	ulong rd_val;
+	u32 w = rs1_val;
+
+	switch (insn & INSN_MASK_ITYPE_RD_RS) {
+	/* Emulate Zknh instructions */
+	case INSN_MATCH_SHA256SIG0:
+		rd_val = SEXT32(ror32(w, 7) ^ ror32(w, 18) ^ (w >> 3));
+		break;
+	case INSN_MATCH_SHA256SIG1:
+		rd_val = SEXT32(ror32(w, 17) ^ ror32(w, 19) ^ (w >> 10));
+		break;
+	case INSN_MATCH_SHA256SUM0:
+		rd_val = SEXT32(ror32(w, 2) ^ ror32(w, 13) ^ ror32(w, 22));
+		break;
+	case INSN_MATCH_SHA256SUM1:
+		rd_val = SEXT32(ror32(w, 6) ^ ror32(w, 11) ^ ror32(w, 25));
+		break;
+#if __riscv_xlen == 64
+	case INSN_MATCH_SHA512SIG0:
+		rd_val = ror64(rs1_val, 1) ^ ror64(rs1_val, 8) ^ (rs1_val >> 7);
+		break;
+	case INSN_MATCH_SHA512SIG1:
+		rd_val = ror64(rs1_val, 19) ^ ror64(rs1_val, 61) ^
+			 (rs1_val >> 6);
+		break;
+	case INSN_MATCH_SHA512SUM0:
+		rd_val = ror64(rs1_val, 28) ^ ror64(rs1_val, 34) ^
+			 ror64(rs1_val, 39);
+		break;
+	case INSN_MATCH_SHA512SUM1:
+		rd_val = ror64(rs1_val, 14) ^ ror64(rs1_val, 18) ^
+			 ror64(rs1_val, 41);
+		break;
+	/* Emulate Zknd instructions */
+	case INSN_MATCH_AES64IM:
+		rd_val = aes64_mix(rs1_val, true);
+		break;
+	default:
+		/* Emulate the Zknd and Zkne key schedule */
+		if ((insn & INSN_MASK_AES64KS1I) == INSN_MATCH_AES64KS1I &&
+		    ((insn >> 20) & 0xf) <= 0xa) {
+			rd_val = aes64_ks1i(rs1_val, (insn >> 20) & 0xf);
+			break;
+		}
+		return truly_illegal_insn(insn, regs);
+#else
+	default:
+		return truly_illegal_insn(insn, regs);
+#endif
+	}
+
+	SET_RD(insn, regs, rd_val);
+
+	regs->mepc += 4;
+
+	return 0;
+}
+
+int sbi_insn_emu_crypto_op(ulong insn, struct sbi_trap_regs *regs)
+{
+	ulong rs1_val = GET_RS1(insn, regs);
+	ulong rs2_val = GET_RS2(insn, regs);
+	ulong rd_val;
+
+	switch (insn & INSN_MASK_RTYPE_RD_RS1_RS2) {
+#if __riscv_xlen == 64
+	/* Emulate Zkne instructions */
+	case INSN_MATCH_AES64ES:
+		rd_val = aes_sbox8(aes64_shift_rows(rs1_val, rs2_val, false),
+				   false);
+		break;
+	case INSN_MATCH_AES64ESM:
+		rd_val = aes_sbox8(aes64_shift_rows(rs1_val, rs2_val, false),
+				   false);
+		rd_val = aes64_mix(rd_val, false);
+		break;
+	/* Emulate Zknd instructions */
+	case INSN_MATCH_AES64DS:
+		rd_val = aes_sbox8(aes64_shift_rows(rs1_val, rs2_val, true),
+				   true);
+		break;
+	case INSN_MATCH_AES64DSM:
+		rd_val = aes_sbox8(aes64_shift_rows(rs1_val, rs2_val, true),
+				   true);
+		rd_val = aes64_mix(rd_val, true);
+		break;
+	/* Emulate the Zknd and Zkne key schedule */
+	case INSN_MATCH_AES64KS2:
+		rd_val = (u32)(rs1_val >> 32) ^ (u32)rs2_val;
+		rd_val |= (rd_val ^ (rs2_val >> 32)) << 32;
+		break;
+#else
+	/* Emulate Zknh instructions */
+	case INSN_MATCH_SHA512SIG0H:
+		rd_val = (rs1_val >> 1) ^ (rs1_val >> 7) ^ (rs1_val >> 8) ^
+			 (rs2_val << 31) ^ (rs2_val << 24);
+		break;
+	case INSN_MATCH_SHA512SIG0L:
+		rd_val = (rs1_val >> 1) ^ (rs1_val >> 7) ^ (rs1_val >> 8) ^
+			 (rs2_val << 31) ^ (rs2_val << 25) ^ (rs2_val << 24);
+		break;
+	case INSN_MATCH_SHA512SIG1H:
+		rd_val = (rs1_val << 3) ^ (rs1_val >> 6) ^ (rs1_val >> 19) ^
+			 (rs2_val >> 29) ^ (rs2_val << 13);
+		break;
+	case INSN_MATCH_SHA512SIG1L:
+		rd_val = (rs1_val << 3) ^ (rs1_val >> 6) ^ (rs1_val >> 19) ^
+			 (rs2_val >> 29) ^ (rs2_val << 26) ^ (rs2_val << 13);
+		break;
+	case INSN_MATCH_SHA512SUM0R:
+		rd_val = (rs1_val << 25) ^ (rs1_val << 30) ^ (rs1_val >> 28) ^
+			 (rs2_val >> 7) ^ (rs2_val >> 2) ^ (rs2_val << 4);
+		break;
+	case INSN_MATCH_SHA512SUM1R:
+		rd_val = (rs1_val << 23) ^ (rs1_val >> 14) ^ (rs1_val >> 18) ^
+			 (rs2_val >> 9) ^ (rs2_val << 18) ^ (rs2_val << 14);
+		break;
+#endif
+	default:
+#if __riscv_xlen == 32
+		/* Emulate Zkne and Zknd instructions, bs is in bits 31:30 */
+		switch (insn & INSN_MASK_AES32) {
+		case INSN_MATCH_AES32ESI:
+			rd_val = aes32(rs1_val, rs2_val, insn >> 30,
+				       false, false);
+			break;
+		case INSN_MATCH_AES32ESMI:
+			rd_val = aes32(rs1_val, rs2_val, insn >> 30,
+				       false, true);
+			break;
+		case INSN_MATCH_AES32DSI:
+			rd_val = aes32(rs1_val, rs2_val, insn >> 30,
+				       true, false);
+			break;
+		case INSN_MATCH_AES32DSMI:
+			rd_val = aes32(rs1_val, rs2_val, insn >> 30,
+				       true, true);
+			break;
+		default:
+			return truly_illegal_insn(insn, regs);
+		}
+#else
+		return truly_illegal_insn(insn, regs);
+#endif
+	}
+
+	SET_RD(insn, regs, rd_val);
+
+	regs->mepc += 4;
+
+	return 0;
+}
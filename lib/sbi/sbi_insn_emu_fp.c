@@ -10,14 +10,25 @@
 #include <sbi/riscv_encoding.h>
 #include <sbi/riscv_fp.h>
 #include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_insn_emu_fp.h>
+#include <sbi/sbi_insn_emu_xtheadvector.h>
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_trap_ldst.h>
 
+/* Widths 0 and 5 to 7 of LOAD-FP/STORE-FP encode vector accesses */
+static inline bool is_vector_width(ulong insn)
+{
+	return GET_FUNC3(insn) == 0 || GET_FUNC3(insn) >= 5;
+}
+
 int sbi_insn_emu_load_fp(ulong insn, struct sbi_trap_regs *regs)
 {
 	struct sbi_trap_context *tcntx =
 		container_of(regs, struct sbi_trap_context, regs);
 
+	if (is_vector_width(insn) && sbi_insn_emu_xtheadvector_active())
+		return sbi_insn_emu_xtheadvector(insn, regs);
+
 	/* If floating point is available and insn is FLH,
 	 * simply use the misaligned load handler */
 	if ((regs->mstatus & MSTATUS_FS) != 0 &&
@@ -37,6 +48,9 @@ int sbi_insn_emu_store_fp(ulong insn, struct sbi_trap_regs *regs)
 	struct sbi_trap_context *tcntx =
 		container_of(regs, struct sbi_trap_context, regs);
 
+	if (is_vector_width(insn) && sbi_insn_emu_xtheadvector_active())
+		return sbi_insn_emu_xtheadvector(insn, regs);
+
 	/* If floating point is available and insn is FSH,
 	 * simply use the misaligned store handler */
 	if ((regs->mstatus & MSTATUS_FS) != 0 &&
@@ -68,7 +82,7 @@ static const u32 f32_imm_lut[32] = {
 };
 
 static const u64 f64_imm_lut[32] = {
-	0xbc00000000000000, 0x0010000000000000, 0x3ef0000000000000,
+	0xbff0000000000000, 0x0010000000000000, 0x3ef0000000000000,
 	0x3f00000000000000, 0x3f70000000000000, 0x3f80000000000000,
 	0x3fb0000000000000, 0x3fc0000000000000, 0x3fd0000000000000,
 	0x3fd4000000000000, 0x3fd8000000000000, 0x3fdc000000000000,
@@ -81,20 +95,7 @@ static const u64 f64_imm_lut[32] = {
 	0x7ff0000000000000, 0x7ff8000000000000
 };
 
-#define RM_FIELD_RNE 0
-#define RM_FIELD_RTZ 1
-#define RM_FIELD_RDN 2
-#define RM_FIELD_RUP 3
-#define RM_FIELD_RMM 4
-#define RM_FIELD_DYN 7
-
-#define FFLAG_INEXACT 0x01
-#define FFLAG_UNDERFLOW 0x02
-#define FFLAG_OVERFLOW 0x04
-#define FFLAG_DIVIDE_BY_ZERO 0x08
-#define FFLAG_INVALID_OPERATION 0x10
-
-static u32 convert_f16_to_f32(u16 val, u32 *fcsr)
+u32 convert_f16_to_f32(u16 val, u32 *fcsr)
 {
 	/* special case: +/- zero */
 	if ((val & 0x7fff) == 0)
@@ -125,7 +126,7 @@ static u32 convert_f16_to_f32(u16 val, u32 *fcsr)
 	return result;
 }
 
-static u64 convert_f16_to_f64(u16 val, u32 *fcsr)
+u64 convert_f16_to_f64(u16 val, u32 *fcsr)
 {
 	/* special case: +/- zero */
 	if ((val & 0x7fff) == 0)
@@ -246,7 +247,7 @@ static u16 convert_f32_to_f16(u32 val, u32 *fcsr, int rm)
 				13));
 }
 
-static u16 convert_f64_to_f16(u64 val, u32 *fcsr, int rm)
+u16 convert_f64_to_f16(u64 val, u32 *fcsr, int rm)
 {
 	/* rounding bias to be added below what will be the LSB:
 	 * sign, future LSB, rounding mode */
@@ -357,8 +358,8 @@ static u32 round_f32(u32 val, u32 *fcsr, int rm, bool set_nx)
 	/* values >= this (with masked sign) become at least +/- 1
 	 * sign, rounding mode */
 	static const u32 one_threshold[2][5] = {
-		{ 0x3effffff, 0x3f800000, 0x3f800000, 1, 0x3f000000 },
-		{ 0x3effffff, 0x3f800000, 1, 0x3f800000, 0x3f000000 }
+		{ 0x3f000001, 0x3f800000, 0x3f800000, 1, 0x3f000000 },
+		{ 0x3f000001, 0x3f800000, 1, 0x3f800000, 0x3f000000 }
 	};
 
 	/* handle +/- zero */
@@ -379,7 +380,7 @@ static u32 round_f32(u32 val, u32 *fcsr, int rm, bool set_nx)
 	if ((val & 0x7fffffff) < 0x3f800000) {
 		if (set_nx)
 			*fcsr |= FFLAG_INEXACT;
-		if ((val & 0x7f800000) >= one_threshold[val >> 31][rm])
+		if ((val & 0x7fffffff) >= one_threshold[val >> 31][rm])
 			return (val & 0x80000000) | 0x3f800000;
 		return val & 0x80000000;
 	}
@@ -416,9 +417,9 @@ static u64 round_f64(u64 val, u32 *fcsr, int rm, bool set_nx)
 	/* values >= this (with masked sign) become at least +/- 1
 	 * sign, rounding mode */
 	static const u64 one_threshold[2][5] = {
-		{ 0x3fdfffffffffffff, 0x3ff0000000000000, 0x3ff0000000000000, 1,
+		{ 0x3fe0000000000001, 0x3ff0000000000000, 0x3ff0000000000000, 1,
 		  0x3fe0000000000000 },
-		{ 0x3fdfffffffffffff, 0x3ff0000000000000, 1, 0x3ff0000000000000,
+		{ 0x3fe0000000000001, 0x3ff0000000000000, 1, 0x3ff0000000000000,
 		  0x3fe0000000000000 }
 	};
 
@@ -440,7 +441,7 @@ static u64 round_f64(u64 val, u32 *fcsr, int rm, bool set_nx)
 	if ((val & 0x7fffffffffffffff) < 0x3ff0000000000000) {
 		if (set_nx)
 			*fcsr |= FFLAG_INEXACT;
-		if ((val & 0x7ff0000000000000) >= one_threshold[val >> 63][rm])
+		if ((val & 0x7fffffffffffffff) >= one_threshold[val >> 63][rm])
 			return (val & 0x8000000000000000) | 0x3ff0000000000000;
 		return val & 0x8000000000000000;
 	}
@@ -477,8 +478,8 @@ static u16 round_f16(u16 val, u32 *fcsr, int rm, bool set_nx)
 	/* values >= this (with masked sign) become at least +/- 1
 	 * sign, rounding mode */
 	static const u16 one_threshold[2][5] = {
-		{ 0x37ff, 0x3c00, 0x3c00, 0x0001, 0x3800 },
-		{ 0x37ff, 0x3c00, 0x0001, 0x3c00, 0x3800 }
+		{ 0x3801, 0x3c00, 0x3c00, 0x0001, 0x3800 },
+		{ 0x3801, 0x3c00, 0x0001, 0x3c00, 0x3800 }
 	};
 
 	/* handle +/- zero */
@@ -537,86 +538,79 @@ static s32 fcvtmod_f64(u64 val, u32 *fcsr)
 		*fcsr |= FFLAG_INEXACT;
 		return 0;
 	}
-	/* handle all bigger values */
-	/* handle overflow */
-	if (exp > 31)
-		*fcsr |= FFLAG_INVALID_OPERATION;
 	/* handle values so big that all relevant lower bits are 0 */
-	if (exp > 52 + 31)
+	if (exp > 52 + 31) {
+		*fcsr |= FFLAG_INVALID_OPERATION;
 		return 0;
+	}
 
 	u64 mant = (val & 0x000fffffffffffff) | 0x0010000000000000;
+	bool inexact = false;
 
 	/* handle all other values */
 	if (exp >= 52) {
 		mant = mant << (exp - 52);
 	} else {
-		if ((mant & (0x000fffffffffffff >> exp)) != 0)
-			*fcsr |= FFLAG_INEXACT;
+		inexact = (mant & (0x000fffffffffffff >> exp)) != 0;
 		mant = mant >> (52 - exp);
 	}
-	mant &= 0x7fffffff;
-	return sign ? -mant : mant;
+	/* handle overflow, only -2^31 fits with an exponent of 31,
+	 * the invalid operation flag takes precedence over inexact */
+	if (exp > 31 || (exp == 31 && !(sign && mant == 0x80000000)))
+		*fcsr |= FFLAG_INVALID_OPERATION;
+	else if (inexact)
+		*fcsr |= FFLAG_INEXACT;
+	/* the result wraps modulo 2^32 */
+	return sign ? -(u32)mant : (u32)mant;
+}
+
+/* rs1 < rs2 for non-NaN values, sign at the given bit, -0 equals +0 */
+static bool fp_bits_lt(u64 rs1, u64 rs2, int sign_bit)
+{
+	u64 mag_mask = (1ULL << sign_bit) - 1;
+	bool sign1 = (rs1 >> sign_bit) & 1, sign2 = (rs2 >> sign_bit) & 1;
+
+	if (!(rs1 & mag_mask) && !(rs2 & mag_mask))
+		return false;
+	if (sign1 != sign2)
+		return sign1;
+	return sign1 ? rs1 > rs2 : rs1 < rs2;
 }
 
 static u32 f32_handle_and_signal_nans(u32 rs1, u32 rs2)
 {
-	u32 val = 0;
-	/* check first and second operand for NaN */
-	if ((rs1 & 0x7fffffff) > 0x7f800000) {
-		/* set canonical NaN */
-		val = 0x7fc00000;
-		/* check for signaling NaN */
-		if (!(rs1 & 0x00400000))
-			SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
-	} else if ((rs2 & 0x7fffffff) > 0x7f800000) {
-		/* set canonical NaN */
-		val = 0x7fc00000;
-		/* check for signaling NaN */
-		if (!(rs2 & 0x00400000))
-			SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
-	}
-	return val;
+	bool nan1 = (rs1 & 0x7fffffff) > 0x7f800000;
+	bool nan2 = (rs2 & 0x7fffffff) > 0x7f800000;
+
+	/* check both operands for signaling NaN */
+	if ((nan1 && !(rs1 & 0x00400000)) || (nan2 && !(rs2 & 0x00400000)))
+		SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
+	/* return canonical NaN if either operand is NaN */
+	return (nan1 || nan2) ? 0x7fc00000 : 0;
 }
 
 static u64 f64_handle_and_signal_nans(u64 rs1, u64 rs2)
 {
-	u64 val = 0;
-	/* check first and second operand for NaN */
-	if ((rs1 & 0x7fffffffffffffff) > 0x7ff0000000000000) {
-		/* set canonical NaN */
-		val = 0x7ff8000000000000;
-		/* check for signaling NaN */
-		if (!(rs1 & 0x0008000000000000))
-			SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
-	} else if ((rs2 & 0x7fffffffffffffff) > 0x7ff0000000000000) {
-		/* set canonical NaN */
-		val = 0x7ff8000000000000;
-		/* check for signaling NaN */
-		if (!(rs2 & 0x0008000000000000))
-			SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
-	}
-	return val;
+	bool nan1 = (rs1 & 0x7fffffffffffffff) > 0x7ff0000000000000;
+	bool nan2 = (rs2 & 0x7fffffffffffffff) > 0x7ff0000000000000;
+
+	/* check both operands for signaling NaN */
+	if ((nan1 && !(rs1 & 0x0008000000000000)) || (nan2 && !(rs2 & 0x0008000000000000)))
+		SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
+	/* return canonical NaN if either operand is NaN */
+	return (nan1 || nan2) ? 0x7ff8000000000000 : 0;
 }
 
 static u16 f16_handle_and_signal_nans(u16 rs1, u16 rs2)
 {
-	u16 val = 0;
-	/* check first and second operand for NaN */
-	if ((rs1 & 0x7fff) > 0x7c00) {
-		/* set canonical NaN */
-		val = 0x7e00;
-		/* check for signaling NaN */
-		if (!(rs1 & 0x0200))
-			SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
-	} else if ((rs2 & 0x7fff) > 0x7c00) {
-		/* set canonical NaN */
-		val = 0x7e00;
-		/* check for signaling NaN */
-		if (!(rs2 & 0x0200))
-			SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
-	}
-	return val;
+	bool nan1 = (rs1 & 0x7fff) > 0x7c00;
+	bool nan2 = (rs2 & 0x7fff) > 0x7c00;
+
+	/* check both operands for signaling NaN */
+	if ((nan1 && !(rs1 & 0x0200)) || (nan2 && !(rs2 & 0x0200)))
+		SET_FCSR(GET_FCSR() | FFLAG_INVALID_OPERATION);
+	/* return canonical NaN if either operand is NaN */
+	return (nan1 || nan2) ? 0x7e00 : 0;
 }
 
 int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs)
@@ -907,7 +901,7 @@ int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs)
 			u16 rs1 = GET_F16_RS1_OR_NAN(insn, regs);
 			u16 rs2 = GET_F16_RS2_OR_NAN(insn, regs);
 			if ((val = !f16_handle_and_signal_nans(rs1, rs2)))
-				val = (rs1 < rs2) ^ ((rs1 | rs2) >> 15);
+				val = fp_bits_lt(rs1, rs2, 15);
 			SET_RD(insn, regs, val);
 			break;
 		}
@@ -915,7 +909,7 @@ int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs)
 			u16 rs1 = GET_F16_RS1_OR_NAN(insn, regs);
 			u16 rs2 = GET_F16_RS2_OR_NAN(insn, regs);
 			if ((val = !f16_handle_and_signal_nans(rs1, rs2)))
-				val = !((rs1 > rs2) ^ ((rs1 | rs2) >> 15));
+				val = !fp_bits_lt(rs2, rs1, 15);
 			SET_RD(insn, regs, val);
 			break;
 		}
@@ -923,7 +917,7 @@ int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs)
 			u32 rs1 = GET_F32_RS1_OR_NAN(insn, regs);
 			u32 rs2 = GET_F32_RS2_OR_NAN(insn, regs);
 			if ((val = !f32_handle_and_signal_nans(rs1, rs2)))
-				val = (rs1 < rs2) ^ ((rs1 | rs2) >> 31);
+				val = fp_bits_lt(rs1, rs2, 31);
 			SET_RD(insn, regs, val);
 			break;
 		}
@@ -931,7 +925,7 @@ int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs)
 			u32 rs1 = GET_F32_RS1_OR_NAN(insn, regs);
 			u32 rs2 = GET_F32_RS2_OR_NAN(insn, regs);
 			if ((val = !f32_handle_and_signal_nans(rs1, rs2)))
-				val = !((rs1 > rs2) ^ ((rs1 | rs2) >> 31));
+				val = !fp_bits_lt(rs2, rs1, 31);
 			SET_RD(insn, regs, val);
 			break;
 		}
@@ -939,7 +933,7 @@ int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs)
 			u64 rs1 = GET_F64_RS1_OR_NAN(insn, regs);
 			u64 rs2 = GET_F64_RS2_OR_NAN(insn, regs);
 			if ((val = !f64_handle_and_signal_nans(rs1, rs2)))
-				val = (rs1 < rs2) ^ ((rs1 | rs2) >> 63);
+				val = fp_bits_lt(rs1, rs2, 63);
 			SET_RD(insn, regs, val);
 			break;
 		}
@@ -947,7 +941,7 @@ int sbi_insn_emu_op_fp(ulong insn, struct sbi_trap_regs *regs)
 			u64 rs1 = GET_F64_RS1_OR_NAN(insn, regs);
 			u64 rs2 = GET_F64_RS2_OR_NAN(insn, regs);
 			if ((val = !f64_handle_and_signal_nans(rs1, rs2)))
-				val = !((rs1 > rs2) ^ ((rs1 | rs2) >> 63));
+				val = !fp_bits_lt(rs2, rs1, 63);
 			SET_RD(insn, regs, val);
 			break;
 		}
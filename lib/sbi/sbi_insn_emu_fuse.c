@@ -0,0 +1,356 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_insn_emu_fuse.h>
+#include <sbi/sbi_insn_emu_hot.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_types.h>
+#include <sbi/sbi_unpriv.h>
+
+/* Maximum number of instructions in an idiom */
+#define FUSE_WINDOW		3
+
+/* a0 = rd, a1 = rs1, a2 = rs2 */
+#define TH_REGS			((10 << 7) | (11 << 15) | (12 << 20))
+#define TH_MVEQZ_A0_A1_A2	(INSN_MATCH_TH_MVEQZ | TH_REGS)
+#define TH_MVNEZ_A0_A1_A2	(INSN_MATCH_TH_MVNEZ | TH_REGS)
+
+struct insn_fuse_idiom {
+	/* Leading instruction, i.e. the trapping one */
+	ulong mask;
+	ulong match;
+	/* Second instruction, checked before any further fetch */
+	ulong next_mask;
+	ulong next_match;
+	/* Number of instructions including the leading one */
+	int len;
+	/*
+	 * Check the data flow between the instructions and retire them
+	 * without touching mepc, or return false if they do not form the
+	 * idiom. Must not change any state before it is sure to succeed.
+	 */
+	bool (*exec)(const ulong *insn, struct sbi_trap_regs *regs);
+};
+
+#ifdef CONFIG_SBI_INSN_EMU_FUSION_XTHEADCONDMOV
+
+/* rd = rs2 == 0 ? rs1 : rd */
+static ulong th_mveqz(ulong rd, ulong rs1, ulong rs2)
+{
+	register ulong a0 asm("a0") = rd;
+	register ulong a1 asm("a1") = rs1;
+	register ulong a2 asm("a2") = rs2;
+
+	asm volatile(".4byte " STR(TH_MVEQZ_A0_A1_A2)
+		     : "+r"(a0) : "r"(a1), "r"(a2));
+	return a0;
+}
+
+/* rd = rs2 != 0 ? rs1 : rd */
+static ulong th_mvnez(ulong rd, ulong rs1, ulong rs2)
+{
+	register ulong a0 asm("a0") = rd;
+	register ulong a1 asm("a1") = rs1;
+	register ulong a2 asm("a2") = rs2;
+
+	asm volatile(".4byte " STR(TH_MVNEZ_A0_A1_A2)
+		     : "+r"(a0) : "r"(a1), "r"(a2));
+	return a0;
+}
+
+static inline bool fuse_use_xtheadcondmov(void)
+{
+	return sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+				      SBI_HART_EXT_XTHEADCONDMOV);
+}
+
+#else
+
+static inline ulong th_mveqz(ulong rd, ulong rs1, ulong rs2)
+{
+	return rd;
+}
+
+static inline ulong th_mvnez(ulong rd, ulong rs1, ulong rs2)
+{
+	return rd;
+}
+
+static inline bool fuse_use_xtheadcondmov(void)
+{
+	return false;
+}
+
+#endif
+
+/*
+ * czero.eqz t0, a, c; czero.nez t1, b, c; or rd, t0, t1 in either order of
+ * the czero instructions, with c.or as the last instruction if the
+ * registers allow it. Computes rd = c ? a : b without branches, as Zicond
+ * is used for constant-time code.
+ */
+static bool fuse_zicond_select(const ulong *insn, struct sbi_trap_regs *regs)
+{
+	ulong eqz, nez, mask, cond, tval, fval, t_eqz, t_nez, sel;
+	int t0 = GET_RD_NUM(insn[0]), t1 = GET_RD_NUM(insn[1]);
+	int rd, a, b;
+
+	switch (insn[0] & INSN_MASK_RTYPE_RD_RS1_RS2) {
+	case INSN_MATCH_CZERO_EQZ:
+		if ((insn[1] & INSN_MASK_RTYPE_RD_RS1_RS2) !=
+		    INSN_MATCH_CZERO_NEZ)
+			return false;
+		eqz = insn[0];
+		nez = insn[1];
+		break;
+	case INSN_MATCH_CZERO_NEZ:
+		if ((insn[1] & INSN_MASK_RTYPE_RD_RS1_RS2) !=
+		    INSN_MATCH_CZERO_EQZ)
+			return false;
+		eqz = insn[1];
+		nez = insn[0];
+		break;
+	default:
+		return false;
+	}
+
+	/* Same condition, and the second czero must not read the first */
+	if (GET_RS2_NUM(insn[0]) != GET_RS2_NUM(insn[1]) || !t0 || !t1 ||
+	    t0 == t1 || t0 == GET_RS1_NUM(insn[1]) ||
+	    t0 == GET_RS2_NUM(insn[1]))
+		return false;
+
+	if ((insn[2] & INSN_MASK_RTYPE_RD_RS1_RS2) == INSN_MATCH_OR) {
+		rd = GET_RD_NUM(insn[2]);
+		a = GET_RS1_NUM(insn[2]);
+		b = GET_RS2_NUM(insn[2]);
+	} else if ((insn[2] & INSN_MASK_C_OR) == INSN_MATCH_C_OR) {
+		rd = a = GET_RS1S_NUM(insn[2]);
+		b = GET_RS2S_NUM(insn[2]);
+	} else {
+		return false;
+	}
+	if (!((a == t0 && b == t1) || (a == t1 && b == t0)))
+		return false;
+
+	cond = GET_RS2(eqz, regs);
+	tval = GET_RS1(eqz, regs);
+	fval = GET_RS1(nez, regs);
+
+	if (fuse_use_xtheadcondmov()) {
+		t_eqz = th_mveqz(tval, 0, cond);
+		t_nez = th_mvnez(fval, 0, cond);
+		sel = th_mvnez(fval, tval, cond);
+	} else {
+		mask = -(ulong)(cond != 0);
+		t_eqz = tval & mask;
+		t_nez = fval & ~mask;
+		sel = t_eqz | t_nez;
+	}
+
+	SET_RD(eqz, regs, t_eqz);
+	SET_RD(nez, regs, t_nez);
+	REG_VAL(rd, regs) = sel;
+
+	return true;
+}
+
+/*
+ * sh1add/sh2add/sh3add rd, rs1, rs2 followed by a load from an offset to rd.
+ * Misaligned or faulting loads are left to the hardware, i.e. only the
+ * shift-and-add is retired and the load traps on its own.
+ */
+static bool fuse_zba_load(const ulong *insn, struct sbi_trap_regs *regs)
+{
+	struct sbi_trap_info trap;
+	int base = GET_RD_NUM(insn[0]);
+	ulong sum, addr, val;
+
+	if (!base || (insn[1] & INSN_MASK_LB) != INSN_MATCH_LB ||
+	    GET_RS1_NUM(insn[1]) != base)
+		return false;
+
+	switch (insn[0] & INSN_MASK_RTYPE_RD_RS1_RS2) {
+	case INSN_MATCH_SH1ADD:
+		sum = GET_RS2(insn[0], regs) + (GET_RS1(insn[0], regs) << 1);
+		break;
+	case INSN_MATCH_SH2ADD:
+		sum = GET_RS2(insn[0], regs) + (GET_RS1(insn[0], regs) << 2);
+		break;
+	case INSN_MATCH_SH3ADD:
+		sum = GET_RS2(insn[0], regs) + (GET_RS1(insn[0], regs) << 3);
+		break;
+	default:
+		return false;
+	}
+
+	addr = sum + IMM_I(insn[1]);
+	trap.cause = 0;
+	switch (insn[1] & INSN_MASK_LB) {
+	case INSN_MATCH_LB:
+		val = sbi_load_s8((const s8 *)addr, &trap);
+		break;
+	case INSN_MATCH_LBU:
+		val = sbi_load_u8((const u8 *)addr, &trap);
+		break;
+	case INSN_MATCH_LH:
+		if (addr & 1)
+			return false;
+		val = sbi_load_s16((const s16 *)addr, &trap);
+		break;
+	case INSN_MATCH_LHU:
+		if (addr & 1)
+			return false;
+		val = sbi_load_u16((const u16 *)addr, &trap);
+		break;
+	case INSN_MATCH_LW:
+		if (addr & 3)
+			return false;
+		val = sbi_load_s32((const s32 *)addr, &trap);
+		break;
+#if __riscv_xlen == 64
+	case INSN_MATCH_LWU:
+		if (addr & 3)
+			return false;
+		val = sbi_load_u32((const u32 *)addr, &trap);
+		break;
+	case INSN_MATCH_LD:
+		if (addr & 7)
+			return false;
+		val = sbi_load_u64((const u64 *)addr, &trap);
+		break;
+#endif
+	default:
+		return false;
+	}
+	if (trap.cause)
+		return false;
+
+	REG_VAL(base, regs) = sum;
+	SET_RD(insn[1], regs, val);
+
+	return true;
+}
+
+/* Any of the integer loads */
+#define FUSE_MASK_LOAD		0x7f
+#define FUSE_MATCH_LOAD		0x03
+
+static const struct insn_fuse_idiom idioms[] = {
+	{ INSN_MASK_RTYPE_RD_RS1_RS2, INSN_MATCH_CZERO_EQZ,
+	  INSN_MASK_RTYPE_RD_RS1_RS2, INSN_MATCH_CZERO_NEZ, 3,
+	  fuse_zicond_select },
+	{ INSN_MASK_RTYPE_RD_RS1_RS2, INSN_MATCH_CZERO_NEZ,
+	  INSN_MASK_RTYPE_RD_RS1_RS2, INSN_MATCH_CZERO_EQZ, 3,
+	  fuse_zicond_select },
+	{ INSN_MASK_RTYPE_RD_RS1_RS2, INSN_MATCH_SH1ADD,
+	  FUSE_MASK_LOAD, FUSE_MATCH_LOAD, 2, fuse_zba_load },
+	{ INSN_MASK_RTYPE_RD_RS1_RS2, INSN_MATCH_SH2ADD,
+	  FUSE_MASK_LOAD, FUSE_MATCH_LOAD, 2, fuse_zba_load },
+	{ INSN_MASK_RTYPE_RD_RS1_RS2, INSN_MATCH_SH3ADD,
+	  FUSE_MASK_LOAD, FUSE_MATCH_LOAD, 2, fuse_zba_load },
+};
+
+/*
+ * Longest idiom led by insn, and with a second instruction next if
+ * check_next is set, or zero if there is none
+ */
+static int fuse_idiom_len(ulong insn, ulong next, bool check_next)
+{
+	const struct insn_fuse_idiom *idiom;
+	int len = 0;
+
+	for (int i = 0; i < array_size(idioms); i++) {
+		idiom = &idioms[i];
+		if ((insn & idiom->mask) == idiom->match &&
+		    (!check_next ||
+		     (next & idiom->next_mask) == idiom->next_match) &&
+		    idiom->len > len)
+			len = idiom->len;
+	}
+
+	return len;
+}
+
+/*
+ * Fetch the instruction at addr if it lies completely in the page of pc.
+ * sbi_get_insn() only needs read permission, but the hardware fetched the
+ * trapping instruction from that page, so it is executable.
+ */
+static bool fuse_fetch(ulong pc, ulong addr, ulong *insn)
+{
+	struct sbi_trap_info trap;
+
+	if ((addr ^ pc) & PAGE_MASK)
+		return false;
+
+	*insn = sbi_get_insn(addr, &trap);
+	if (trap.cause)
+		return false;
+
+	return !(((addr + INSN_LEN(*insn) - 1) ^ pc) & PAGE_MASK);
+}
+
+bool sbi_insn_emu_fuse_window(const ulong *insn, int count,
+			      struct sbi_trap_regs *regs)
+{
+	const struct insn_fuse_idiom *idiom;
+
+	for (int i = 0; i < array_size(idioms); i++) {
+		idiom = &idioms[i];
+		if ((insn[0] & idiom->mask) != idiom->match ||
+		    count < idiom->len || !idiom->exec(insn, regs))
+			continue;
+
+		for (int j = 0; j < idiom->len; j++)
+			regs->mepc += INSN_LEN(insn[j]);
+		return true;
+	}
+
+	return false;
+}
+
+bool sbi_insn_emu_fuse(ulong insn, struct sbi_trap_regs *regs)
+{
+	ulong window[FUSE_WINDOW], pc = regs->mepc, next;
+	int count = 1, len = 2;
+
+	/* Nothing is fetched for instructions that cannot lead an idiom */
+	if (!fuse_idiom_len(insn, 0, false))
+		return false;
+
+	/*
+	 * Stop at the first instruction that cannot be fetched from the
+	 * page of the trapping one, and after the second instruction if no
+	 * idiom continues with it
+	 */
+	window[0] = insn;
+	next = pc + INSN_LEN(insn);
+	while (count < len) {
+		if (!fuse_fetch(pc, next, &window[count]))
+			break;
+		if (count == 1) {
+			len = fuse_idiom_len(insn, window[1], true);
+			if (!len)
+				return false;
+		}
+		next += INSN_LEN(window[count]);
+		count++;
+	}
+
+	if (!sbi_insn_emu_fuse_window(window, count, regs))
+		return false;
+
+	sbi_insn_emu_hot_record(pc, insn);
+	return true;
+}
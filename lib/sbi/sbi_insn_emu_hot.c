@@ -0,0 +1,201 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_heap.h>
+#include <sbi/sbi_insn_emu.h>
+#include <sbi/sbi_insn_emu_hot.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_sse.h>
+
+#define HOT_SITE_ENTRIES	CONFIG_SBI_INSN_EMU_HOT_SITES_ENTRIES
+#define HOT_SITE_INTERVAL	CONFIG_SBI_INSN_EMU_HOT_SITES_INTERVAL
+
+#if HOT_SITE_ENTRIES & (HOT_SITE_ENTRIES - 1)
+#error "CONFIG_SBI_INSN_EMU_HOT_SITES_ENTRIES must be a power of two"
+#endif
+
+struct hot_site {
+	ulong pc;
+	u32 insn;
+	u32 count;
+};
+
+struct insn_emu_hot {
+	/* Number of emulations that makes a site hot, zero if disabled */
+	unsigned long threshold;
+	/* Cycle counter value of the last injected event */
+	u64 last_report;
+	/* Report not yet read by the supervisor */
+	bool pending;
+	struct sbi_isa_emu_hot_site report;
+	/*
+	 * Direct-mapped, a colliding site simply evicts the previous one.
+	 * On the heap, as it may not fit into the scratch space.
+	 */
+	struct hot_site *sites;
+};
+
+static unsigned long hot_offset;
+
+static inline struct insn_emu_hot *hot_thishart_ptr(void)
+{
+	return sbi_scratch_thishart_offset_ptr(hot_offset);
+}
+
+static inline u32 hot_site_index(ulong pc)
+{
+	return ((pc >> 1) ^ (pc >> 7)) & (HOT_SITE_ENTRIES - 1);
+}
+
+static void hot_site_report(struct insn_emu_hot *hot, struct hot_site *site)
+{
+	u64 now = csr_read(CSR_MCYCLE);
+
+	/* One report in flight and at most one per interval */
+	if (hot->pending || (hot->last_report &&
+			     now - hot->last_report < HOT_SITE_INTERVAL)) {
+		/* Try again on the next emulation of this site */
+		site->count--;
+		return;
+	}
+
+	hot->report.pc = site->pc;
+	hot->report.insn = site->insn;
+	hot->report.group = sbi_insn_emu_group_of(site->insn);
+	hot->report.count = site->count;
+
+	/* Fails unless the supervisor registered and enabled the event */
+	if (sbi_sse_inject_event(SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE)) {
+		site->count--;
+		return;
+	}
+
+	hot->pending = true;
+	hot->last_report = now;
+	/* Report again if the site stays hot after another threshold */
+	site->count = 0;
+}
+
+void sbi_insn_emu_hot_record(ulong pc, ulong insn)
+{
+	struct insn_emu_hot *hot;
+	struct hot_site *site;
+
+	if (!hot_offset)
+		return;
+
+	hot = hot_thishart_ptr();
+	if (likely(!hot->threshold))
+		return;
+
+	site = &hot->sites[hot_site_index(pc)];
+	if (site->pc != pc || site->insn != (u32)insn) {
+		site->pc = pc;
+		site->insn = insn;
+		site->count = 0;
+	}
+
+	if (++site->count >= hot->threshold)
+		hot_site_report(hot, site);
+}
+
+int sbi_insn_emu_hot_set_threshold(unsigned long threshold)
+{
+	struct insn_emu_hot *hot;
+
+	if (!hot_offset)
+		return SBI_ENOTSUPP;
+	if (threshold > (u32)-1)
+		return SBI_EINVAL;
+
+	hot = hot_thishart_ptr();
+	hot->threshold = threshold;
+	/* Counts gathered against another threshold are meaningless */
+	for (int i = 0; i < HOT_SITE_ENTRIES; i++)
+		hot->sites[i].count = 0;
+
+	return 0;
+}
+
+int sbi_insn_emu_hot_get_threshold(unsigned long *threshold)
+{
+	if (!hot_offset)
+		return SBI_ENOTSUPP;
+
+	*threshold = hot_thishart_ptr()->threshold;
+	return 0;
+}
+
+int sbi_insn_emu_hot_read(unsigned long phys_lo, unsigned long phys_hi)
+{
+	struct sbi_isa_emu_hot_site *out;
+	struct insn_emu_hot *hot;
+
+	if (!hot_offset)
+		return SBI_ENOTSUPP;
+
+	/* M-mode cannot reach beyond 4GB on RV32, see sbi_sse_attr_check() */
+	if (phys_hi || phys_lo & (sizeof(unsigned long) - 1))
+		return SBI_EINVALID_ADDR;
+
+	if (!sbi_domain_check_addr_range(sbi_domain_thishart_ptr(), phys_lo,
+					 sizeof(*out), PRV_S,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_EINVALID_ADDR;
+
+	hot = hot_thishart_ptr();
+	if (!hot->pending)
+		return SBI_EINVALID_STATE;
+
+	sbi_hart_map_saddr(phys_lo, sizeof(*out));
+	out = (struct sbi_isa_emu_hot_site *)phys_lo;
+	out->pc = hot->report.pc;
+	out->insn = hot->report.insn;
+	out->group = hot->report.group;
+	out->count = hot->report.count;
+	sbi_hart_unmap_saddr();
+
+	hot->pending = false;
+
+	return 0;
+}
+
+int sbi_insn_emu_hot_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct insn_emu_hot *hot;
+	int rc;
+
+	if (cold_boot) {
+		hot_offset = sbi_scratch_alloc_offset(sizeof(*hot));
+		if (!hot_offset)
+			return SBI_ENOMEM;
+		rc = sbi_sse_add_event(SBI_SSE_EVENT_LOCAL_ISA_EMU_HOT_SITE,
+				       NULL);
+		if (rc)
+			return rc;
+	} else if (!hot_offset) {
+		return SBI_ENOMEM;
+	}
+
+	/* Allocated once per HART, kept across HSM stop and start */
+	hot = sbi_scratch_offset_ptr(scratch, hot_offset);
+	if (!hot->sites) {
+		hot->sites = sbi_zalloc(HOT_SITE_ENTRIES * sizeof(*hot->sites));
+		if (!hot->sites)
+			return SBI_ENOMEM;
+	}
+
+	return 0;
+}
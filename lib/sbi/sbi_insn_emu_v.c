@@ -10,7 +10,11 @@
 #if __riscv_xlen == 64
 
 #include <sbi/riscv_encoding.h>
+#include <sbi/riscv_fp.h>
+#include <sbi/sbi_bitops.h>
 #include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_insn_emu_fp.h>
+#include <sbi/sbi_insn_emu_xtheadvector.h>
 #include <sbi/sbi_trap.h>
 
 /* TODO: make VLMAX_BYTES configurable */
@@ -1026,8 +1030,727 @@ static inline u64 op_cpop(u64 op)
 	return result;
 }
 
+#ifdef __riscv_flen
+
+/*
+ * Zvfh arithmetic for harts that implement at most Zvfhmin
+ *
+ * Rounding is kept exact by computing on wider formats that represent
+ * every intermediate result the half-precision operation needs: the
+ * non-widening operations run natively on doubles, where the sum,
+ * difference and product of two halves are exact and quotient and
+ * square root are rounded early enough to be innocuous, before a single
+ * rounding back to half precision. The widening operations produce
+ * single precision results, so they run natively on exact singles.
+ * Fused multiply-adds and reductions are rounded in software.
+ *
+ * Moves, merges, slides, compares and vfclass are emulated as well, as
+ * they trap alike. Conversions, vfrec7/vfrsqrt7 and the widening
+ * reductions are not.
+ */
+
+#define F16_ONE			0x3c00
+#define F16_CANONICAL_NAN	0x7e00
+#define F32_ONE			0x3f800000
+#define F64_ONE			0x3ff0000000000000UL
+
+#define F16_IS_ZERO(x)		(((x) & 0x7fff) == 0)
+#define F16_IS_INF(x)		(((x) & 0x7fff) == 0x7c00)
+#define F16_IS_NAN(x)		(((x) & 0x7fff) > 0x7c00)
+#define F16_IS_SNAN(x)		(F16_IS_NAN(x) && !((x) & 0x0200))
+
+static inline bool velem_active(const u8 *mask, int i)
+{
+	return !mask || ((mask[i / 8] >> (i % 8)) & 1);
+}
+
+static inline void get_mask(u8 *dest)
+{
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsm.v v0, (%0)\n\t"
+		     ".option pop\n\t" ::"r"(dest)
+		     : "memory");
+}
+
+static inline void set_vl_vtype(ulong vl, ulong vtype)
+{
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvl x0, %0, %1\n\t"
+		     ".option pop\n\t" ::"r"(vl), "r"(vtype));
+}
+
+/* Significand and exponent of a finite non-zero half */
+static u64 f16_unpack(u16 val, int *exp)
+{
+	int e = (val >> 10) & 0x1f;
+
+	*exp = e ? e - 25 : -24;
+	return e ? (val & 0x3ff) | 0x400 : val & 0x3ff;
+}
+
+/*
+ * Round (-1)^sign * mant * 2^exp to half precision. Narrowing to a
+ * double with round-to-odd first keeps a sticky bit far below the half
+ * precision rounding position, so convert_f64_to_f16() rounds correctly.
+ */
+static u16 f16_round_exact(int sign, u64 mant, int exp, u32 *fflags, int rm)
+{
+	int msb = sbi_fls(mant);
+	u64 sig;
+
+	if (msb > 52) {
+		sig = mant >> (msb - 52);
+		if (mant & ((1UL << (msb - 52)) - 1))
+			sig |= 1;
+	} else {
+		sig = mant << (52 - msb);
+	}
+
+	return convert_f64_to_f16(((u64)sign << 63) |
+				  ((u64)(exp + msb + 1023) << 52) |
+				  (sig & 0x000fffffffffffffUL),
+				  fflags, rm);
+}
+
+/* a * b + c with a single rounding */
+static u16 f16_muladd(u16 a, u16 b, u16 c, u32 *fflags, int rm)
+{
+	int sp = (a ^ b) >> 15, sc = c >> 15, ep, eb, ec, eh, el, sh, sl;
+	u64 mp, mc, mh, ml;
+	s64 sum;
+
+	if (F16_IS_NAN(a) || F16_IS_NAN(b) || F16_IS_NAN(c)) {
+		if (F16_IS_SNAN(a) || F16_IS_SNAN(b) || F16_IS_SNAN(c) ||
+		    (F16_IS_INF(a) && F16_IS_ZERO(b)) ||
+		    (F16_IS_ZERO(a) && F16_IS_INF(b)))
+			*fflags |= FFLAG_INVALID_OPERATION;
+		return F16_CANONICAL_NAN;
+	}
+	if (F16_IS_INF(a) || F16_IS_INF(b)) {
+		if (F16_IS_ZERO(a) || F16_IS_ZERO(b) ||
+		    (F16_IS_INF(c) && sc != sp)) {
+			*fflags |= FFLAG_INVALID_OPERATION;
+			return F16_CANONICAL_NAN;
+		}
+		return (sp << 15) | 0x7c00;
+	}
+	if (F16_IS_INF(c))
+		return c;
+	if (F16_IS_ZERO(a) || F16_IS_ZERO(b)) {
+		if (!F16_IS_ZERO(c) || sc == sp)
+			return c;
+		return rm == RM_FIELD_RDN ? 0x8000 : 0;
+	}
+
+	mp = f16_unpack(a, &ep) * f16_unpack(b, &eb);
+	ep += eb;
+	if (F16_IS_ZERO(c))
+		return f16_round_exact(sp, mp, ep, fflags, rm);
+	mc = f16_unpack(c, &ec);
+
+	if (ep >= ec) {
+		sh = sp; mh = mp; eh = ep;
+		sl = sc; ml = mc; el = ec;
+	} else {
+		sh = sc; mh = mc; eh = ec;
+		sl = sp; ml = mp; el = ep;
+	}
+	if (eh - el > 40) {
+		/*
+		 * The low term is below 2^(eh - 19), well under half an ulp
+		 * of the result, so 2^(eh - 24) stands in for it as a
+		 * sticky bit that rounds the same way.
+		 */
+		mh <<= 24;
+		eh -= 24;
+		ml = 1;
+	} else {
+		mh <<= eh - el;
+		eh = el;
+	}
+
+	sum = (sh ? -(s64)mh : (s64)mh) + (sl ? -(s64)ml : (s64)ml);
+	if (!sum)
+		return rm == RM_FIELD_RDN ? 0x8000 : 0;
+	return f16_round_exact(sum < 0, sum < 0 ? -sum : sum, eh, fflags, rm);
+}
+
+/* IEEE 754-2019 minimumNumber/maximumNumber */
+static u16 f16_minmax(u16 a, u16 b, bool max, u32 *fflags)
+{
+	u16 ka, kb;
+
+	if (F16_IS_SNAN(a) || F16_IS_SNAN(b))
+		*fflags |= FFLAG_INVALID_OPERATION;
+	if (F16_IS_NAN(a))
+		return F16_IS_NAN(b) ? F16_CANONICAL_NAN : b;
+	if (F16_IS_NAN(b))
+		return a;
+
+	/* map sign and magnitude to an unsigned order, -0 below +0 */
+	ka = (a & 0x8000) ? (u16)~a : a | 0x8000;
+	kb = (b & 0x8000) ? (u16)~b : b | 0x8000;
+	return ((ka < kb) != max) ? a : b;
+}
+
+/* -1, 0 or 1 for a < b, a == b or a > b, 2 if unordered */
+static int f16_compare(u16 a, u16 b, bool signaling, u32 *fflags)
+{
+	u16 ka, kb;
+
+	if (F16_IS_NAN(a) || F16_IS_NAN(b)) {
+		if (signaling || F16_IS_SNAN(a) || F16_IS_SNAN(b))
+			*fflags |= FFLAG_INVALID_OPERATION;
+		return 2;
+	}
+	if (F16_IS_ZERO(a) && F16_IS_ZERO(b))
+		return 0;
+
+	ka = (a & 0x8000) ? (u16)~a : a | 0x8000;
+	kb = (b & 0x8000) ? (u16)~b : b | 0x8000;
+	return ka < kb ? -1 : ka > kb;
+}
+
+/* The result of vmfeq, vmfle, vmflt, vmfne, vmfgt or vmfge */
+static bool f16_compare_funct6(u16 a, u16 b, u32 funct6, u32 *fflags)
+{
+	/* only vmfeq and vmfne are quiet */
+	int c = f16_compare(a, b, (funct6 & 3) != 0, fflags);
+
+	switch (funct6) {
+	case 0x18:
+		return c == 0;
+	case 0x19:
+		return c == 0 || c == -1;
+	case 0x1b:
+		return c == -1;
+	case 0x1c:
+		return c != 0;
+	case 0x1d:
+		return c == 1;
+	default:
+		return c == 0 || c == 1;
+	}
+}
+
+static u16 f16_class(u16 x)
+{
+	bool neg = x >> 15;
+
+	if (F16_IS_NAN(x))
+		return F16_IS_SNAN(x) ? BIT(8) : BIT(9);
+	if (F16_IS_INF(x))
+		return neg ? BIT(0) : BIT(7);
+	if (F16_IS_ZERO(x))
+		return neg ? BIT(3) : BIT(4);
+	if (!(x & 0x7c00))
+		return neg ? BIT(2) : BIT(5);
+	return neg ? BIT(1) : BIT(6);
+}
+
+static inline u64 op_fsgnj_u16(u64 op1, u64 op2)
+{
+	return (op2 & 0x7fff) | (op1 & 0x8000);
+}
+
+static inline u64 op_fsgnjn_u16(u64 op1, u64 op2)
+{
+	return (op2 & 0x7fff) | (~op1 & 0x8000);
+}
+
+static inline u64 op_fsgnjx_u16(u64 op1, u64 op2)
+{
+	return op2 ^ (op1 & 0x8000);
+}
+
+/*
+ * Native vector engine: v8, v16 and v24 receive one chunk of the x, y
+ * and z operands while their guest contents are parked in the spill
+ * area. The result replaces x, or z for the fused operations.
+ */
+#define ZVFH_CHUNK_BYTES 128
+
+enum zvfh_op {
+	ZVFH_ADD,
+	ZVFH_SUB,
+	ZVFH_MUL,
+	ZVFH_DIV,
+	ZVFH_SQRT,
+	/* fused, in the funct6 order of vfwmacc to vfwnmsac */
+	ZVFH_MACC,
+	ZVFH_NMACC,
+	ZVFH_MSAC,
+	ZVFH_NMSAC,
+};
+
+struct zvfh_engine {
+	u8 spill[3][ZVFH_CHUNK_BYTES];
+	/* LMUL that fits a chunk into one register group */
+	ulong lmul;
+	/* guest vector configuration */
+	ulong vl, vtype;
+};
+
+#define ZVFH_V(insn, ...)                            \
+	asm volatile(".option push\n\t"              \
+		     ".option arch, +v\n\t"          \
+		     insn "\n\t"                     \
+		     ".option pop\n\t" ::__VA_ARGS__ \
+		     : "memory")
+
+static void zvfh_engine_begin(struct zvfh_engine *e, ulong vl, ulong vtype)
+{
+	ulong vlenb = csr_read(CSR_VLENB);
+
+	/* the V extension guarantees VLEN >= 128, i.e. at most LMUL=8 */
+	e->lmul = vlenb < ZVFH_CHUNK_BYTES ?
+			  sbi_fls(ZVFH_CHUNK_BYTES / vlenb) : 0;
+	e->vl = vl;
+	e->vtype = vtype;
+
+	set_vl_vtype(ZVFH_CHUNK_BYTES, e->lmul);
+	ZVFH_V("vse8.v v8, (%0)", "r"(e->spill[0]));
+	ZVFH_V("vse8.v v16, (%0)", "r"(e->spill[1]));
+	ZVFH_V("vse8.v v24, (%0)", "r"(e->spill[2]));
+}
+
+static void zvfh_engine_end(struct zvfh_engine *e)
+{
+	set_vl_vtype(ZVFH_CHUNK_BYTES, e->lmul);
+	ZVFH_V("vle8.v v8, (%0)", "r"(e->spill[0]));
+	ZVFH_V("vle8.v v16, (%0)", "r"(e->spill[1]));
+	ZVFH_V("vle8.v v24, (%0)", "r"(e->spill[2]));
+	set_vl_vtype(e->vl, e->vtype);
+}
+
+/* One chunk of SEW=32 (sew 2) or SEW=64 (sew 3) elements */
+static void zvfh_engine_run(struct zvfh_engine *e, int op, int sew,
+			    void *x, void *y, void *z)
+{
+	bool fused = op >= ZVFH_MACC;
+
+	set_vl_vtype(ZVFH_CHUNK_BYTES, e->lmul);
+	ZVFH_V("vle8.v v8, (%0)", "r"(x));
+	ZVFH_V("vle8.v v16, (%0)", "r"(y));
+	if (fused)
+		ZVFH_V("vle8.v v24, (%0)", "r"(z));
+
+	set_vl_vtype(ZVFH_CHUNK_BYTES >> sew, (sew << SH_VSEW) | e->lmul);
+	switch (op) {
+	case ZVFH_ADD:
+		ZVFH_V("vfadd.vv v8, v8, v16");
+		break;
+	case ZVFH_SUB:
+		ZVFH_V("vfsub.vv v8, v8, v16");
+		break;
+	case ZVFH_MUL:
+		ZVFH_V("vfmul.vv v8, v8, v16");
+		break;
+	case ZVFH_DIV:
+		ZVFH_V("vfdiv.vv v8, v8, v16");
+		break;
+	case ZVFH_SQRT:
+		ZVFH_V("vfsqrt.v v8, v8");
+		break;
+	case ZVFH_MACC:
+		ZVFH_V("vfmacc.vv v24, v8, v16");
+		break;
+	case ZVFH_NMACC:
+		ZVFH_V("vfnmacc.vv v24, v8, v16");
+		break;
+	case ZVFH_MSAC:
+		ZVFH_V("vfmsac.vv v24, v8, v16");
+		break;
+	case ZVFH_NMSAC:
+		ZVFH_V("vfnmsac.vv v24, v8, v16");
+		break;
+	}
+
+	set_vl_vtype(ZVFH_CHUNK_BYTES, e->lmul);
+	if (fused)
+		ZVFH_V("vse8.v v24, (%0)", "r"(z));
+	else
+		ZVFH_V("vse8.v v8, (%0)", "r"(x));
+}
+
+/* d = x op y through native doubles */
+static void zvfh_arith(struct zvfh_engine *e, int op, int vl, const u8 *mask,
+		       const u16 *x, const u16 *y, u16 *d, u32 *fflags, int rm)
+{
+	u64 cx[ZVFH_CHUNK_BYTES / 8], cy[ZVFH_CHUNK_BYTES / 8];
+	int base, i, k;
+
+	for (base = 0; base < vl; base += ZVFH_CHUNK_BYTES / 8) {
+		for (i = 0; i < ZVFH_CHUNK_BYTES / 8; i++) {
+			k = base + i;
+			/* inactive and tail elements compute exactly on 1.0 */
+			cx[i] = cy[i] = F64_ONE;
+			if (k < vl && velem_active(mask, k)) {
+				cx[i] = convert_f16_to_f64(x[k], fflags);
+				cy[i] = convert_f16_to_f64(y[k], fflags);
+			}
+		}
+		zvfh_engine_run(e, op, 3, cx, cy, NULL);
+		for (i = 0; i < ZVFH_CHUNK_BYTES / 8; i++) {
+			k = base + i;
+			if (k < vl && velem_active(mask, k))
+				d[k] = convert_f64_to_f16(cx[i], fflags, rm);
+		}
+	}
+}
+
+/*
+ * Widen the halves of data to singles in place. Walking downwards only
+ * overwrites halves that have already been converted.
+ */
+static void zvfh_widen(sbi_vector_data *data, int vl, const u8 *mask,
+		       u32 *fflags)
+{
+	for (int i = vl - 1; i >= 0; i--)
+		data->u32[i] = velem_active(mask, i) ?
+			convert_f16_to_f32(data->u16[i], fflags) : F32_ONE;
+}
+
+/* Replace inactive and tail elements of a single operand with 1.0 */
+static void zvfh_fill_ones(sbi_vector_data *data, int vl, const u8 *mask)
+{
+	for (int i = 0; i < VLMAX_BYTES / 4; i++)
+		if (i >= vl || !velem_active(mask, i))
+			data->u32[i] = F32_ONE;
+}
+
+static int emu_zvfh(ulong insn, struct sbi_trap_regs *regs, int vl,
+		    ulong vtype)
+{
+	u32 funct6 = insn >> 26, fflags = 0;
+	int vs1 = GET_VS1(insn), vs2 = GET_VS2(insn), vd = GET_VD(insn);
+	int lmul = GET_VLMUL(vtype), rm = GET_FRM();
+	/* registers per group, fractional LMUL counts as one */
+	int nregs = lmul < 4 ? 1 << lmul : 1;
+	int nwregs = lmul < 4 ? 2 << lmul : 1;
+	bool vf = GET_FUNC3(insn) == 5;
+	u8 mask_data[VLMAX_BYTES / 8], *mask = NULL;
+	sbi_vector_data src1, src2, dest;
+	struct zvfh_engine e;
+	typeof(u64(u64, u64)) *sgnj;
+	u16 acc, a, b, c;
+	ulong vlenb;
+	int i, op;
+
+	/* back out if the FPU is off or frm holds a reserved rounding mode */
+	if ((regs->mstatus & MSTATUS_FS) == 0 ||
+	    (sbi_mstatus_prev_mode(regs->mstatus) == PRV_U &&
+	     (csr_read(CSR_SSTATUS) & SSTATUS_FS) == 0) ||
+	    rm > RM_FIELD_RMM)
+		return truly_illegal_insn(insn, regs);
+
+	if (IS_MASKED(insn)) {
+		get_mask(mask_data);
+		mask = mask_data;
+	}
+
+	switch (insn & INSN_MASK_VVBINARY0) {
+	case INSN_MATCH_VWFUNARY0:
+		/* vfmv.f.s reads element 0 even if vl is 0 */
+		if (mask || vs1)
+			return truly_illegal_insn(insn, regs);
+		set_vl_vtype(1, 1 << SH_VSEW);
+		get_vector_as_array_u16(vs2, &src2);
+		set_vl_vtype(vl, vtype);
+		SET_F16_RD(insn, regs, src2.u16[0]);
+		break;
+	case INSN_MATCH_VRFUNARY0:
+		/* vfmv.s.f leaves the other elements undisturbed */
+		if (mask || vs2)
+			return truly_illegal_insn(insn, regs);
+		if (vl == 0)
+			break;
+		dest.u16[0] = GET_F16_RS1_OR_NAN(insn, regs);
+		set_vl_vtype(1, 1 << SH_VSEW);
+		set_vector_from_array_u16(vd, &dest);
+		set_vl_vtype(vl, vtype);
+		break;
+	case INSN_MATCH_VFMERGEVFM:
+		/* vfmv.v.f is the unmasked form with vs2 = v0 */
+		if (((vd | vs2) & (nregs - 1)) || (mask ? !vd : vs2))
+			return truly_illegal_insn(insn, regs);
+		a = GET_F16_RS1_OR_NAN(insn, regs);
+		if (mask)
+			get_vector_as_array_u16(vs2, &src2);
+		for (i = 0; i < vl; i++)
+			dest.u16[i] = velem_active(mask, i) ? a : src2.u16[i];
+		set_vector_from_array_u16(vd, &dest);
+		break;
+	case INSN_MATCH_VFSLIDE1UPVF:
+	case INSN_MATCH_VFSLIDE1DOWNVF:
+		/* only vfslide1up must not overwrite its source */
+		if (((vd | vs2) & (nregs - 1)) || (mask && !vd) ||
+		    (funct6 == 0x0e && vd == vs2))
+			return truly_illegal_insn(insn, regs);
+		a = GET_F16_RS1_OR_NAN(insn, regs);
+		get_vector_as_array_u16(vs2, &src2);
+		for (i = 0; i < vl; i++) {
+			if (funct6 == 0x0e)
+				dest.u16[i] = i ? src2.u16[i - 1] : a;
+			else
+				dest.u16[i] = i + 1 < vl ? src2.u16[i + 1] : a;
+		}
+		if (mask)
+			set_masked_vector_from_array_u16(vd, &dest);
+		else
+			set_vector_from_array_u16(vd, &dest);
+		break;
+	case INSN_MATCH_VMFEQVV:
+	case INSN_MATCH_VMFEQVF:
+	case INSN_MATCH_VMFLEVV:
+	case INSN_MATCH_VMFLEVF:
+	case INSN_MATCH_VMFLTVV:
+	case INSN_MATCH_VMFLTVF:
+	case INSN_MATCH_VMFNEVV:
+	case INSN_MATCH_VMFNEVF:
+	case INSN_MATCH_VMFGTVF:
+	case INSN_MATCH_VMFGEVF:
+		/* vd is a single mask register, rewritten at e8 and m1 */
+		vlenb = csr_read(CSR_VLENB);
+		if (((vs2 | (vf ? 0 : vs1)) & (nregs - 1)) ||
+		    vlenb > VLMAX_BYTES)
+			return truly_illegal_insn(insn, regs);
+		if (vf) {
+			for (i = 0; i < vl; i++)
+				src1.u16[i] = GET_F16_RS1_OR_NAN(insn, regs);
+		} else {
+			get_vector_as_array_u16(vs1, &src1);
+		}
+		get_vector_as_array_u16(vs2, &src2);
+		set_vl_vtype(vlenb, 0);
+		get_vector_as_array_u8(vd, &dest);
+		for (i = 0; i < vl; i++) {
+			if (!velem_active(mask, i))
+				continue;
+			dest.u8[i / 8] &= ~BIT(i % 8);
+			if (f16_compare_funct6(src2.u16[i], src1.u16[i],
+					       funct6, &fflags))
+				dest.u8[i / 8] |= BIT(i % 8);
+		}
+		set_vector_from_array_u8(vd, &dest);
+		set_vl_vtype(vl, vtype);
+		break;
+	case INSN_MATCH_VFREDUSUMVS:
+	case INSN_MATCH_VFREDOSUMVS:
+	case INSN_MATCH_VFREDMINVS:
+	case INSN_MATCH_VFREDMAXVS:
+		/* vd and vs1 are single registers, so access them at m1 */
+		if (vs2 & (nregs - 1))
+			return truly_illegal_insn(insn, regs);
+		if (vl == 0)
+			break;
+		get_vector_as_array_u16(vs2, &src2);
+		set_vl_vtype(1, 1 << SH_VSEW);
+		get_vector_as_array_u16(vs1, &src1);
+		acc = src1.u16[0];
+		for (i = 0; i < vl; i++) {
+			if (!velem_active(mask, i))
+				continue;
+			if (funct6 & 4)
+				acc = f16_minmax(acc, src2.u16[i], funct6 & 2,
+						 &fflags);
+			else
+				acc = f16_muladd(acc, F16_ONE, src2.u16[i],
+						 &fflags, rm);
+		}
+		dest.u16[0] = acc;
+		set_vector_from_array_u16(vd, &dest);
+		set_vl_vtype(vl, vtype);
+		break;
+	case INSN_MATCH_VFWADDVV:
+	case INSN_MATCH_VFWADDVF:
+	case INSN_MATCH_VFWSUBVV:
+	case INSN_MATCH_VFWSUBVF:
+	case INSN_MATCH_VFWADDWV:
+	case INSN_MATCH_VFWADDWF:
+	case INSN_MATCH_VFWSUBWV:
+	case INSN_MATCH_VFWSUBWF:
+	case INSN_MATCH_VFWMULVV:
+	case INSN_MATCH_VFWMULVF:
+	case INSN_MATCH_VFWMACCVV:
+	case INSN_MATCH_VFWMACCVF:
+	case INSN_MATCH_VFWNMACCVV:
+	case INSN_MATCH_VFWNMACCVF:
+	case INSN_MATCH_VFWMSACVV:
+	case INSN_MATCH_VFWMSACVF:
+	case INSN_MATCH_VFWNMSACVV:
+	case INSN_MATCH_VFWNMSACVF:
+		/* .w forms read vs2 at the wide EEW */
+		if (lmul == 3 || (vd & (nwregs - 1)) ||
+		    (vs2 & ((funct6 & 0x3c) == 0x34 ? nwregs - 1 :
+						      nregs - 1)) ||
+		    (!vf && (vs1 & (nregs - 1))) ||
+		    vl * 4 > VLMAX_BYTES)
+			return truly_illegal_insn(insn, regs);
+		if (vf) {
+			for (i = 0; i < vl; i++)
+				src1.u16[i] = GET_F16_RS1_OR_NAN(insn, regs);
+		} else {
+			get_vector_as_array_u16(vs1, &src1);
+		}
+		zvfh_widen(&src1, vl, mask, &fflags);
+		zvfh_fill_ones(&src1, vl, mask);
+		if ((funct6 & 0x3c) == 0x34) {
+			get_vector_as_array_u32(vs2, &src2);
+		} else {
+			get_vector_as_array_u16(vs2, &src2);
+			zvfh_widen(&src2, vl, mask, &fflags);
+		}
+		zvfh_fill_ones(&src2, vl, mask);
+		if (funct6 >= 0x3c) {
+			op = ZVFH_MACC + (funct6 & 3);
+			get_vector_as_array_u32(vd, &dest);
+			zvfh_fill_ones(&dest, vl, mask);
+		} else {
+			op = funct6 == 0x38 ? ZVFH_MUL :
+			     (funct6 & 2) ? ZVFH_SUB : ZVFH_ADD;
+		}
+		zvfh_engine_begin(&e, vl, vtype);
+		for (i = 0; i < vl; i += ZVFH_CHUNK_BYTES / 4)
+			zvfh_engine_run(&e, op, 2, &src2.u32[i], &src1.u32[i],
+					&dest.u32[i]);
+		zvfh_engine_end(&e);
+		if (mask)
+			set_masked_vector_from_array_u32(
+				vd, op >= ZVFH_MACC ? &dest : &src2);
+		else
+			set_vector_from_array_u32(
+				vd, op >= ZVFH_MACC ? &dest : &src2);
+		break;
+	default:
+		if ((vd | vs2 | (vf ? 0 : vs1)) & (nregs - 1))
+			return truly_illegal_insn(insn, regs);
+		if (vf) {
+			for (i = 0; i < vl; i++)
+				src1.u16[i] = GET_F16_RS1_OR_NAN(insn, regs);
+		} else {
+			get_vector_as_array_u16(vs1, &src1);
+		}
+		get_vector_as_array_u16(vs2, &src2);
+
+		switch (insn & INSN_MASK_VVBINARY0) {
+		case INSN_MATCH_VFADDVV:
+		case INSN_MATCH_VFADDVF:
+		case INSN_MATCH_VFSUBVV:
+		case INSN_MATCH_VFSUBVF:
+		case INSN_MATCH_VFMULVV:
+		case INSN_MATCH_VFMULVF:
+		case INSN_MATCH_VFDIVVV:
+		case INSN_MATCH_VFDIVVF:
+			op = funct6 == 0x00 ? ZVFH_ADD :
+			     funct6 == 0x02 ? ZVFH_SUB :
+			     funct6 == 0x24 ? ZVFH_MUL : ZVFH_DIV;
+			zvfh_engine_begin(&e, vl, vtype);
+			zvfh_arith(&e, op, vl, mask, src2.u16, src1.u16,
+				   dest.u16, &fflags, rm);
+			zvfh_engine_end(&e);
+			break;
+		case INSN_MATCH_VFRSUBVF:
+		case INSN_MATCH_VFRDIVVF:
+			op = funct6 == 0x27 ? ZVFH_SUB : ZVFH_DIV;
+			zvfh_engine_begin(&e, vl, vtype);
+			zvfh_arith(&e, op, vl, mask, src1.u16, src2.u16,
+				   dest.u16, &fflags, rm);
+			zvfh_engine_end(&e);
+			break;
+		case INSN_MATCH_VFMINVV:
+		case INSN_MATCH_VFMINVF:
+		case INSN_MATCH_VFMAXVV:
+		case INSN_MATCH_VFMAXVF:
+			for (i = 0; i < vl; i++)
+				if (velem_active(mask, i))
+					dest.u16[i] = f16_minmax(
+						src2.u16[i], src1.u16[i],
+						funct6 & 2, &fflags);
+			break;
+		case INSN_MATCH_VFSGNJVV:
+		case INSN_MATCH_VFSGNJVF:
+		case INSN_MATCH_VFSGNJNVV:
+		case INSN_MATCH_VFSGNJNVF:
+		case INSN_MATCH_VFSGNJXVV:
+		case INSN_MATCH_VFSGNJXVF:
+			sgnj = funct6 == 0x08 ? op_fsgnj_u16 :
+			       funct6 == 0x09 ? op_fsgnjn_u16 : op_fsgnjx_u16;
+			for (i = 0; i < vl; i++)
+				dest.u16[i] = sgnj(src1.u16[i], src2.u16[i]);
+			break;
+		case INSN_MATCH_VFMADDVV:
+		case INSN_MATCH_VFMADDVF:
+		case INSN_MATCH_VFNMADDVV:
+		case INSN_MATCH_VFNMADDVF:
+		case INSN_MATCH_VFMSUBVV:
+		case INSN_MATCH_VFMSUBVF:
+		case INSN_MATCH_VFNMSUBVV:
+		case INSN_MATCH_VFNMSUBVF:
+		case INSN_MATCH_VFMACCVV:
+		case INSN_MATCH_VFMACCVF:
+		case INSN_MATCH_VFNMACCVV:
+		case INSN_MATCH_VFNMACCVF:
+		case INSN_MATCH_VFMSACVV:
+		case INSN_MATCH_VFMSACVF:
+		case INSN_MATCH_VFNMSACVV:
+		case INSN_MATCH_VFNMSACVF:
+			/* vf*acc add to vd, the others multiply by it */
+			get_vector_as_array_u16(vd, &dest);
+			for (i = 0; i < vl; i++) {
+				if (!velem_active(mask, i))
+					continue;
+				a = src1.u16[i] ^ ((funct6 & 1) << 15);
+				b = (funct6 & 4) ? src2.u16[i] : dest.u16[i];
+				c = (funct6 & 4) ? dest.u16[i] : src2.u16[i];
+				c ^= ((funct6 ^ (funct6 >> 1)) & 1) << 15;
+				dest.u16[i] = f16_muladd(a, b, c, &fflags, rm);
+			}
+			break;
+		default:
+			switch (insn & INSN_MASK_VXUNARY0) {
+			case INSN_MATCH_VFSQRTV:
+				zvfh_engine_begin(&e, vl, vtype);
+				zvfh_arith(&e, ZVFH_SQRT, vl, mask, src2.u16,
+					   src2.u16, dest.u16, &fflags, rm);
+				zvfh_engine_end(&e);
+				break;
+			case INSN_MATCH_VFCLASSV:
+				for (i = 0; i < vl; i++)
+					dest.u16[i] = f16_class(src2.u16[i]);
+				break;
+			default:
+				return truly_illegal_insn(insn, regs);
+			}
+			break;
+		}
+
+		if (mask)
+			set_masked_vector_from_array_u16(vd, &dest);
+		else
+			set_vector_from_array_u16(vd, &dest);
+		break;
+	}
+
+	if (fflags)
+		csr_set(CSR_FFLAGS, fflags);
+	SET_FS_DIRTY(regs);
+	regs->mstatus |= MSTATUS_VS;
+	regs->mepc += 4;
+
+	return 0;
+}
+
+#endif
+
 int sbi_insn_emu_op_v(ulong insn, struct sbi_trap_regs *regs)
 {
+	/* RVV 1.0 instruction on a XTheadVector hart */
+	if (sbi_insn_emu_xtheadvector_active())
+		return sbi_insn_emu_xtheadvector(insn, regs);
+
 	/* back out if vector unit is not available */
 	if ((regs->mstatus & MSTATUS_VS) == 0 ||
 	    (sbi_mstatus_prev_mode(regs->mstatus) == PRV_U &&
@@ -1047,6 +1770,12 @@ int sbi_insn_emu_op_v(ulong insn, struct sbi_trap_regs *regs)
 	if (vl * (1 << sew) > VLMAX_BYTES)
 		return truly_illegal_insn(insn, regs);
 
+#ifdef __riscv_flen
+	/* Emulate Zvfh arithmetic, which only exists at SEW=16 */
+	if (sew == 1 && (GET_FUNC3(insn) == 1 || GET_FUNC3(insn) == 5))
+		return emu_zvfh(insn, regs, vl, vtype);
+#endif
+
 	switch (insn & INSN_MASK_VXUNARY0) {
 	/* Emulate Zvbb unary operations */
 	case INSN_MATCH_VBREVV:
@@ -0,0 +1,552 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/riscv_fp.h>
+#include <sbi/sbi_bitops.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_insn_emu_xtheadvector.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_unpriv.h>
+
+#if __riscv_xlen == 64
+
+/*
+ * RVV 1.0 on top of XTheadVector (RVV 0.7.1)
+ *
+ * Most arithmetic shares its encoding between both versions, so the bulk
+ * of a RVV 1.0 binary runs natively once vtype holds what the program
+ * asked for. The hardware does not trap on a vsetvli/vsetvl with a RVV
+ * 1.0 vtype but sets vill, which makes the next vector instruction trap.
+ * That instruction is resumed after replaying the preceding vsetvli with
+ * a translated vtype. Instructions that exist in RVV 1.0 only are
+ * executed through their XTheadVector counterparts.
+ */
+
+/* mstatus.VS of XTheadVector, RVV 1.0 moved it to bits 10:9 */
+#define XT_MSTATUS_VS		_UL(0x01800000)
+
+/* XTheadVector vtype: vlmul[1:0], vsew[4:2], vediv[6:5] and vill */
+#define XT_VTYPE(sew, lmul)	(((sew) << 2) | (lmul))
+#define XT_VTYPE_VSEW(vtype)	(((vtype) >> 2) & 0x7)
+#define XT_VTYPE_VLMUL(vtype)	((vtype) & 0x3)
+#define XT_VTYPE_VILL		(1UL << (__riscv_xlen - 1))
+/* SEW=1024 does not exist on any XTheadVector core, this sets vill */
+#define XT_VTYPE_UNSUPPORTED	XT_VTYPE(7, 0)
+
+/* RVV 1.0 vtype: vlmul[2:0], vsew[5:3], vta, vma */
+#define RVV_VTYPE_VSEW(vtype)	(((vtype) >> 3) & 0x7)
+#define RVV_VTYPE_VLMUL(vtype)	((vtype) & 0x7)
+
+/* XTheadVector instructions with a0/a1 as scalar operands */
+#define XT_VSETVL		0x80b57557	/* th.vsetvl a0, a0, a1 */
+#define XT_VLSE_V		0x08b57007	/* th.vlse.v v0, (a0), a1, v0.t */
+#define XT_VSSE_V		0x08b57027	/* th.vsse.v v0, (a0), a1, v0.t */
+#define XT_VLE_V		0x02057007	/* th.vle.v v0, (a0) */
+#define XT_VSE_V		0x02057027	/* th.vse.v v0, (a0) */
+#define XT_VEXT_X_V		0x32002557	/* th.vext.x.v a0, v0, x0 */
+#define XT_VM			0x02000000
+
+#define XT_SH_VD		7
+#define XT_SH_VS2		20
+
+/* Register group staged in M-mode memory, enough for LMUL=8 at VLEN=256 */
+#define XT_VBUF_BYTES		(8 * 32)
+
+/* RVV 1.0 lumop values that XTheadVector lacks */
+#define RVV_LUMOP_WHOLE_REG	0x08
+#define RVV_LUMOP_MASK		0x0b
+
+#define XT_INSN(n, enc, sh)	STR((enc) | ((n) << (sh)))
+
+#define XT_CASES(m, enc, sh)						\
+	m(0, enc, sh) m(1, enc, sh) m(2, enc, sh) m(3, enc, sh)		\
+	m(4, enc, sh) m(5, enc, sh) m(6, enc, sh) m(7, enc, sh)		\
+	m(8, enc, sh) m(9, enc, sh) m(10, enc, sh) m(11, enc, sh)	\
+	m(12, enc, sh) m(13, enc, sh) m(14, enc, sh) m(15, enc, sh)	\
+	m(16, enc, sh) m(17, enc, sh) m(18, enc, sh) m(19, enc, sh)	\
+	m(20, enc, sh) m(21, enc, sh) m(22, enc, sh) m(23, enc, sh)	\
+	m(24, enc, sh) m(25, enc, sh) m(26, enc, sh) m(27, enc, sh)	\
+	m(28, enc, sh) m(29, enc, sh) m(30, enc, sh) m(31, enc, sh)
+
+/* Vector instruction operating on a0 only */
+#define XT_VREG_CASE(n, enc, sh)					\
+	case n:								\
+		asm volatile(".4byte " XT_INSN(n, enc, sh)		\
+			     : "+r"(a0) : : "memory");			\
+		break;
+
+/**
+ * Vector memory access with MSTATUS_MPRV set. a3 must be a pointer to the
+ * sbi_trap_info and a4 is used as a temporary register in the trap
+ * handler, see sbi_unpriv.c.
+ */
+#define XT_VMEM_CASE(n, enc, sh)					\
+	case n:								\
+		asm volatile(						\
+			"add %[tinfo], %[taddr], zero\n"		\
+			"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n" \
+			"csrrs %[mstatus], " STR(CSR_MSTATUS) ", %[mprv]\n" \
+			".4byte " XT_INSN(n, enc, sh) "\n"		\
+			"csrw " STR(CSR_MSTATUS) ", %[mstatus]\n"	\
+			"csrw " STR(CSR_MTVEC) ", %[mtvec]"		\
+		    : [mstatus] "+&r"(mstatus), [mtvec] "+&r"(mtvec),	\
+		      [tinfo] "+&r"(tinfo)				\
+		    : [mprv] "r"(MSTATUS_MPRV), [taddr] "r"((ulong)trap), \
+		      "r"(base), "r"(stride)				\
+		    : "a4", "memory");					\
+		break;
+
+struct xtheadvector_state {
+	bool active;
+};
+
+static unsigned long xt_offset;
+
+static inline struct xtheadvector_state *xt_thishart_ptr(void)
+{
+	return sbi_scratch_thishart_offset_ptr(xt_offset);
+}
+
+static ulong xt_vsetvl(ulong avl, ulong vtype)
+{
+	register ulong a0 asm("a0") = avl;
+	register ulong a1 asm("a1") = vtype;
+
+	asm volatile(".4byte " STR(XT_VSETVL) : "+r"(a0) : "r"(a1));
+	return a0;
+}
+
+static ulong xt_vext_x(int vs2)
+{
+	register ulong a0 asm("a0") = 0;
+
+	switch (vs2) {
+		XT_CASES(XT_VREG_CASE, XT_VEXT_X_V, XT_SH_VS2)
+	}
+	return a0;
+}
+
+static void xt_vse(int vs3, void *buf)
+{
+	register ulong a0 asm("a0") = (ulong)buf;
+
+	switch (vs3) {
+		XT_CASES(XT_VREG_CASE, XT_VSE_V, XT_SH_VD)
+	}
+}
+
+static void xt_vle(int vd, void *buf)
+{
+	register ulong a0 asm("a0") = (ulong)buf;
+
+	switch (vd) {
+		XT_CASES(XT_VREG_CASE, XT_VLE_V, XT_SH_VD)
+	}
+}
+
+static void xt_vmem(bool store, bool masked, int vd, ulong addr,
+		    ulong step, struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3");
+	register ulong base asm("a0") = addr;
+	register ulong stride asm("a1") = step;
+	register ulong mstatus = 0;
+	register ulong mtvec = (ulong)sbi_hart_expected_trap;
+
+	trap->cause = 0;
+	if (store && masked) {
+		switch (vd) {
+			XT_CASES(XT_VMEM_CASE, XT_VSSE_V, XT_SH_VD)
+		}
+	} else if (store) {
+		switch (vd) {
+			XT_CASES(XT_VMEM_CASE, XT_VSSE_V | XT_VM, XT_SH_VD)
+		}
+	} else if (masked) {
+		switch (vd) {
+			XT_CASES(XT_VMEM_CASE, XT_VLSE_V, XT_SH_VD)
+		}
+	} else {
+		switch (vd) {
+			XT_CASES(XT_VMEM_CASE, XT_VLSE_V | XT_VM, XT_SH_VD)
+		}
+	}
+}
+
+static ulong xt_vtype(ulong vtype)
+{
+	ulong vlmul = RVV_VTYPE_VLMUL(vtype), vsew = RVV_VTYPE_VSEW(vtype);
+
+	/*
+	 * vta and vma permit the undisturbed behaviour of XTheadVector.
+	 * Fractional LMUL, reserved bits and vill have no counterpart.
+	 */
+	if ((vtype & ~0xffUL) || vlmul > 3 || vsew > 3)
+		return XT_VTYPE_UNSUPPORTED;
+
+	return XT_VTYPE(vsew, vlmul);
+}
+
+static bool xt_is_vsetvl(ulong insn)
+{
+	return (insn & INSN_MASK_VSETVLI) == INSN_MATCH_VSETVLI ||
+	       (insn & INSN_MASK_VSETVL) == INSN_MATCH_VSETVL;
+}
+
+/*
+ * Execute vsetvli, vsetivli or vsetvl with a translated vtype. The
+ * keep-vl form takes AVL from the live vl, which a replayed instruction
+ * already overwrote with 0, so it cannot be replayed.
+ */
+static bool xt_vset(ulong insn, struct sbi_trap_regs *regs, bool replay)
+{
+	ulong rs1 = GET_RS1_NUM(insn), vtype, avl, vl;
+
+	if ((insn & INSN_MASK_VSETIVLI) == INSN_MATCH_VSETIVLI) {
+		vtype = (insn >> 20) & 0x3ff;
+		avl = rs1;
+	} else {
+		if ((insn & INSN_MASK_VSETVL) == INSN_MATCH_VSETVL)
+			vtype = GET_RS2(insn, regs);
+		else
+			vtype = (insn >> 20) & 0x7ff;
+
+		if (rs1)
+			avl = GET_RS1(insn, regs);
+		else if (GET_RD_NUM(insn))
+			avl = -1UL;
+		else if (!replay)
+			avl = csr_read(CSR_VL);
+		else
+			return false;
+	}
+
+	vl = xt_vsetvl(avl, xt_vtype(vtype));
+	SET_RD(insn, regs, vl);
+	regs->mstatus |= XT_MSTATUS_VS;
+	return true;
+}
+
+static int xt_replay(ulong insn, struct sbi_trap_regs *regs)
+{
+	struct sbi_trap_info trap = { 0 };
+	ulong prev = sbi_get_insn(regs->mepc - 4, &trap);
+	ulong rd = GET_RD_NUM(prev);
+
+	/*
+	 * Only a vsetvli/vsetvl right in front of the trapping instruction
+	 * is replayed. It wrote vl=0 to x[rd], which must not have been the
+	 * register holding AVL or vtype.
+	 */
+	if (trap.cause || !xt_is_vsetvl(prev))
+		return truly_illegal_insn(insn, regs);
+	if (rd && (REG_VAL(rd, regs) || rd == GET_RS1_NUM(prev) ||
+		   ((prev & INSN_MASK_VSETVL) == INSN_MATCH_VSETVL &&
+		    rd == GET_RS2_NUM(prev))))
+		return truly_illegal_insn(insn, regs);
+
+	if (!xt_vset(prev, regs, true) ||
+	    (csr_read(CSR_VTYPE) & XT_VTYPE_VILL))
+		return truly_illegal_insn(insn, regs);
+
+	/* Retry the trapping instruction with the translated vtype */
+	return 0;
+}
+
+/*
+ * vmv.s.x and vfmv.s.f: th.vmv.s.x zeroes elements 1 and up, RVV 1.0
+ * leaves them undisturbed. Element 0 is written through M-mode memory.
+ */
+static bool xt_vmv_s(int vd, u64 val)
+{
+	ulong vtype = csr_read(CSR_VTYPE), vl = csr_read(CSR_VL);
+	ulong sew = 8UL << XT_VTYPE_VSEW(vtype);
+	u8 buf[XT_VBUF_BYTES];
+
+	if (xt_vsetvl(-1UL, XT_VTYPE(0, 0)) > sizeof(buf)) {
+		xt_vsetvl(vl, vtype);
+		return false;
+	}
+
+	if (vl) {
+		xt_vse(vd, buf);
+		sbi_memcpy(buf, &val, sew / 8);
+		xt_vle(vd, buf);
+	}
+
+	xt_vsetvl(vl, vtype);
+	return true;
+}
+
+/*
+ * vlm.v and vsm.v: RVV 1.0 packs one mask bit per element, XTheadVector
+ * places the mask bit of element i at bit i * SEW / LMUL.
+ */
+static int xt_vmask(ulong insn, struct sbi_trap_regs *regs)
+{
+	bool store = (insn & INSN_OPCODE_MASK) == INSN_OPCODE_VECTOR_STORE;
+	ulong vtype = csr_read(CSR_VTYPE), vl = csr_read(CSR_VL);
+	ulong mlen = (8UL << XT_VTYPE_VSEW(vtype)) >> XT_VTYPE_VLMUL(vtype);
+	u8 *addr = (u8 *)GET_RS1(insn, regs);
+	ulong bytes = (vl + 7) / 8, vlenb, i, j;
+	struct sbi_trap_info trap = { 0 };
+	u8 buf[XT_VBUF_BYTES], val;
+	int vd = GET_VD(insn);
+
+	if (IS_MASKED(insn) || GET_FUNC3(insn) || (insn >> 29))
+		return truly_illegal_insn(insn, regs);
+
+	vlenb = xt_vsetvl(-1UL, XT_VTYPE(0, 0));
+	if (vlenb > sizeof(buf)) {
+		xt_vsetvl(vl, vtype);
+		return truly_illegal_insn(insn, regs);
+	}
+
+	if (store) {
+		xt_vse(vd, buf);
+		for (i = 0; i < bytes && !trap.cause; i++) {
+			val = 0;
+			for (j = 0; j < 8 && (i * 8 + j) * mlen < vlenb * 8;
+			     j++) {
+				if (buf[(i * 8 + j) * mlen / 8] &
+				    BIT((i * 8 + j) * mlen % 8))
+					val |= BIT(j);
+			}
+			sbi_store_u8(addr + i, val, &trap);
+		}
+	} else {
+		sbi_memset(buf, 0, vlenb);
+		for (i = 0; i < bytes && !trap.cause; i++) {
+			val = sbi_load_u8(addr + i, &trap);
+			for (j = 0; j < 8 && (i * 8 + j) * mlen < vlenb * 8;
+			     j++) {
+				if (val & BIT(j))
+					buf[(i * 8 + j) * mlen / 8] |=
+						BIT((i * 8 + j) * mlen % 8);
+			}
+		}
+		if (!trap.cause) {
+			xt_vle(vd, buf);
+			regs->mstatus |= XT_MSTATUS_VS;
+		}
+	}
+
+	xt_vsetvl(vl, vtype);
+	if (trap.cause)
+		return sbi_trap_redirect(regs, &trap);
+
+	regs->mepc += 4;
+	return 0;
+}
+
+/*
+ * Unit-stride and strided accesses with EEW > SEW, which XTheadVector
+ * cannot express, and whole register accesses. The access is done with
+ * th.vlse.v/th.vsse.v under a temporary vtype with SEW=EEW.
+ */
+static int xt_vmem_insn(ulong insn, struct sbi_trap_regs *regs)
+{
+	bool store = (insn & INSN_OPCODE_MASK) == INSN_OPCODE_VECTOR_STORE;
+	ulong nf = (insn >> 29) & 0x7, mop = (insn >> 26) & 0x3;
+	ulong lumop = GET_RS2_NUM(insn), width = GET_FUNC3(insn);
+	ulong vtype = csr_read(CSR_VTYPE), vl = csr_read(CSR_VL);
+	ulong vstart = csr_read(CSR_VSTART);
+	ulong eew = width ? width - 4 : 0, shift = 0;
+	long emul = XT_VTYPE_VLMUL(vtype) + eew - XT_VTYPE_VSEW(vtype);
+	ulong xtype, avl, stride, nreg;
+	struct sbi_trap_info trap = { 0 };
+	int vd = GET_VD(insn);
+
+	if (GET_MEW(insn))
+		return truly_illegal_insn(insn, regs);
+
+	if (!mop && lumop == RVV_LUMOP_MASK)
+		return xt_vmask(insn, regs);
+
+	if (!mop && lumop == RVV_LUMOP_WHOLE_REG) {
+		nreg = nf + 1;
+		if (IS_MASKED(insn) || (nreg & (nreg - 1)) || (vd & (nreg - 1)))
+			return truly_illegal_insn(insn, regs);
+		/* Byte elements, vstart is counted in elements of EEW */
+		xtype = XT_VTYPE(0, sbi_ffs(nreg));
+		avl = -1UL;
+		stride = 1;
+		shift = eew;
+	} else {
+		/* Segments, indexed and fault-only-first stay unsupported */
+		if (nf || (mop != 0 && mop != 2) || (!mop && lumop) ||
+		    emul < 0 || emul > 3)
+			return truly_illegal_insn(insn, regs);
+		xtype = XT_VTYPE(eew, emul);
+		avl = vl;
+		stride = mop ? GET_RS2(insn, regs) : 1UL << eew;
+	}
+
+	xt_vsetvl(avl, xtype);
+	csr_write(CSR_VSTART, vstart << shift);
+	xt_vmem(store, IS_MASKED(insn), vd, GET_RS1(insn, regs), stride,
+		&trap);
+	vstart = trap.cause ? csr_read(CSR_VSTART) >> shift : 0;
+	xt_vsetvl(vl, vtype);
+	csr_write(CSR_VSTART, vstart);
+	if (!store)
+		regs->mstatus |= XT_MSTATUS_VS;
+
+	if (trap.cause)
+		return sbi_trap_redirect(regs, &trap);
+
+	regs->mepc += 4;
+	return 0;
+}
+
+#ifdef __riscv_flen
+static bool xt_fs_enabled(struct sbi_trap_regs *regs)
+{
+	return (regs->mstatus & MSTATUS_FS) != 0 &&
+	       (sbi_mstatus_prev_mode(regs->mstatus) != PRV_U ||
+		(csr_read(CSR_SSTATUS) & SSTATUS_FS) != 0);
+}
+#endif
+
+static int xt_op_v(ulong insn, struct sbi_trap_regs *regs)
+{
+	ulong vtype = csr_read(CSR_VTYPE), vl, nreg, val;
+	ulong sew = 8UL << XT_VTYPE_VSEW(vtype);
+	int vd = GET_VD(insn), vs2 = GET_VS2(insn);
+	u8 buf[XT_VBUF_BYTES];
+
+	switch (insn & INSN_MASK_VMVXS) {
+	case INSN_MATCH_VMVXS:
+		val = xt_vext_x(vs2);
+		if (sew < __riscv_xlen)
+			val = (long)(val << (__riscv_xlen - sew)) >>
+			      (__riscv_xlen - sew);
+		SET_RD(insn, regs, val);
+		regs->mepc += 4;
+		return 0;
+#ifdef __riscv_flen
+	case INSN_MATCH_VFMVFS:
+		if (!xt_fs_enabled(regs) || sew < 16 || sew > __riscv_flen)
+			return truly_illegal_insn(insn, regs);
+		val = xt_vext_x(vs2);
+		/* NaN-box narrower elements */
+		if (sew < 64)
+			val |= -1UL << sew;
+		SET_F64_RD(insn, regs, val);
+		regs->mepc += 4;
+		return 0;
+#endif
+	}
+
+	switch (insn & INSN_MASK_VMVSX) {
+	case INSN_MATCH_VMVSX:
+		if (!xt_vmv_s(vd, (long)GET_RS1(insn, regs)))
+			return truly_illegal_insn(insn, regs);
+		regs->mstatus |= XT_MSTATUS_VS;
+		regs->mepc += 4;
+		return 0;
+#ifdef __riscv_flen
+	case INSN_MATCH_VFMVSF:
+		if (!xt_fs_enabled(regs) || sew < 16 || sew > __riscv_flen)
+			return truly_illegal_insn(insn, regs);
+		if (!xt_vmv_s(vd, GET_F64_RS1(insn, regs)))
+			return truly_illegal_insn(insn, regs);
+		regs->mstatus |= XT_MSTATUS_VS;
+		regs->mepc += 4;
+		return 0;
+#endif
+	}
+
+	if ((insn & INSN_MASK_VMVNRV) == INSN_MATCH_VMVNRV) {
+		nreg = GET_RS1_NUM(insn) + 1;
+		if ((nreg & (nreg - 1)) || nreg > 8 || (vd & (nreg - 1)) ||
+		    (vs2 & (nreg - 1)))
+			return truly_illegal_insn(insn, regs);
+
+		/* Copy the whole register group through M-mode memory */
+		vl = csr_read(CSR_VL);
+		if (xt_vsetvl(-1UL, XT_VTYPE(0, sbi_ffs(nreg))) > sizeof(buf)) {
+			xt_vsetvl(vl, vtype);
+			return truly_illegal_insn(insn, regs);
+		}
+		xt_vse(vs2, buf);
+		xt_vle(vd, buf);
+		xt_vsetvl(vl, vtype);
+		regs->mstatus |= XT_MSTATUS_VS;
+		regs->mepc += 4;
+		return 0;
+	}
+
+	return truly_illegal_insn(insn, regs);
+}
+
+bool sbi_insn_emu_xtheadvector_hart_active(struct sbi_scratch *scratch)
+{
+	struct xtheadvector_state *xt;
+
+	if (!xt_offset)
+		return false;
+
+	xt = sbi_scratch_offset_ptr(scratch, xt_offset);
+	return xt->active;
+}
+
+bool sbi_insn_emu_xtheadvector_active(void)
+{
+	return xt_offset && xt_thishart_ptr()->active;
+}
+
+int sbi_insn_emu_xtheadvector(ulong insn, struct sbi_trap_regs *regs)
+{
+	if ((regs->mstatus & XT_MSTATUS_VS) == 0)
+		return truly_illegal_insn(insn, regs);
+
+	if ((insn & INSN_MASK_VSETIVLI) == INSN_MATCH_VSETIVLI ||
+	    xt_is_vsetvl(insn)) {
+		xt_vset(insn, regs, false);
+		regs->mepc += 4;
+		return 0;
+	}
+
+	if (csr_read(CSR_VTYPE) & XT_VTYPE_VILL)
+		return xt_replay(insn, regs);
+
+	if (IS_VECTOR_LOAD_STORE(insn))
+		return xt_vmem_insn(insn, regs);
+
+	return xt_op_v(insn, regs);
+}
+
+int sbi_insn_emu_xtheadvector_init(struct sbi_scratch *scratch,
+				   bool cold_boot)
+{
+	struct xtheadvector_state *xt;
+
+	if (cold_boot) {
+		xt_offset = sbi_scratch_alloc_offset(sizeof(*xt));
+		if (!xt_offset)
+			return SBI_ENOMEM;
+	} else if (!xt_offset) {
+		return SBI_ENOMEM;
+	}
+
+	xt = sbi_scratch_offset_ptr(scratch, xt_offset);
+	xt->active = sbi_hart_has_extension(scratch,
+					    SBI_HART_EXT_XTHEADVECTOR);
+
+	return 0;
+}
+
+#endif
@@ -25,6 +25,10 @@
 
 struct sbi_ipi_data {
 	unsigned long ipi_type;
+#ifdef CONFIG_SBI_IPI_FANOUT
+	/* HARTs this HART raises the IPI for, set by multicast senders */
+	struct sbi_hartmask forward;
+#endif
 };
 
 _Static_assert(
@@ -36,8 +40,12 @@ static unsigned long ipi_data_off;
 static const struct sbi_ipi_device *ipi_dev = NULL;
 static const struct sbi_ipi_event_ops *ipi_ops_array[SBI_IPI_EVENT_MAX];
 
+/*
+ * Update the remote HART for the event and mark it in raise_mask if the
+ * caller has to raise its IPI.
+ */
 static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartindex,
-			u32 event, void *data)
+			u32 event, void *data, struct sbi_hartmask *raise_mask)
 {
 	int ret = 0;
 	struct sbi_scratch *remote_scratch = NULL;
@@ -75,18 +83,79 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartindex,
 	 * trigger the interrupt.
 	 *
 	 * Multiple harts may be trying to send IPI to the
-	 * remote hart so call sbi_ipi_raw_send() only when
-	 * the ipi_type was previously zero.
+	 * remote hart so raise the IPI only when the
+	 * ipi_type was previously zero.
 	 */
 	if (!__atomic_fetch_or(&ipi_data->ipi_type,
 				BIT(event), __ATOMIC_RELAXED))
-		ret = sbi_ipi_raw_send(remote_hartindex);
+		sbi_hartmask_set_hartindex(remote_hartindex, raise_mask);
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
 
 	return ret;
 }
 
+#ifdef CONFIG_SBI_IPI_FANOUT
+/*
+ * Split a large multicast into groups of CONFIG_SBI_IPI_FANOUT_DEGREE
+ * HARTs. Only the first HART of each group is left in the mask, it
+ * raises the IPIs of the rest of its group in sbi_ipi_process().
+ */
+static void sbi_ipi_fanout(struct sbi_hartmask *mask)
+{
+	struct sbi_hartmask leaders = { 0 };
+	struct sbi_ipi_data *ipi_data = NULL;
+	u32 i, n = 0;
+
+	if (sbi_hartmask_weight(mask) <= CONFIG_SBI_IPI_FANOUT_DEGREE)
+		return;
+
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		if (!(n++ % CONFIG_SBI_IPI_FANOUT_DEGREE)) {
+			sbi_hartmask_set_hartindex(i, &leaders);
+			ipi_data = sbi_scratch_offset_ptr(
+					sbi_hartindex_to_scratch(i),
+					ipi_data_off);
+			continue;
+		}
+
+		__atomic_fetch_or(&ipi_data->forward.bits[BIT_WORD(i)],
+				  BIT_MASK(i), __ATOMIC_RELAXED);
+	}
+
+	*mask = leaders;
+}
+
+static void sbi_ipi_forward(struct sbi_ipi_data *ipi_data)
+{
+	struct sbi_hartmask mask;
+	unsigned long pending = 0;
+	int i;
+
+	for (i = 0; i < array_size(mask.bits); i++) {
+		mask.bits[i] = atomic_raw_xchg_ulong(&ipi_data->forward.bits[i],
+						     0);
+		pending |= mask.bits[i];
+	}
+
+	if (pending)
+		sbi_ipi_raw_send_many(&mask);
+}
+
+void sbi_ipi_forward_pending(void)
+{
+	sbi_ipi_forward(sbi_scratch_thishart_offset_ptr(ipi_data_off));
+}
+#else
+static void sbi_ipi_fanout(struct sbi_hartmask *mask)
+{
+}
+
+static void sbi_ipi_forward(struct sbi_ipi_data *ipi_data)
+{
+}
+#endif
+
 static int sbi_ipi_sync(struct sbi_scratch *scratch, u32 event)
 {
 	const struct sbi_ipi_event_ops *ipi_ops;
@@ -109,10 +178,10 @@ static int sbi_ipi_sync(struct sbi_scratch *scratch, u32 event)
  */
 int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 {
-	int rc = 0;
+	int rc = 0, raise_rc;
 	bool retry_needed;
 	ulong i;
-	struct sbi_hartmask target_mask;
+	struct sbi_hartmask target_mask, raise_mask;
 	struct sbi_domain *dom = sbi_domain_thishart_ptr();
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 
@@ -141,19 +210,32 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 			return SBI_EINVAL;
 	}
 
-	/* Send IPIs */
+	/*
+	 * Send IPIs, raising the IPIs of each pass at once. A pass that
+	 * needs a retry waits for remote HARTs, so they must have been
+	 * raised before the next pass.
+	 */
 	do {
 		retry_needed = false;
+		SBI_HARTMASK_INIT(&raise_mask);
 		sbi_hartmask_for_each_hartindex(i, &target_mask) {
-			rc = sbi_ipi_send(scratch, i, event, data);
+			rc = sbi_ipi_send(scratch, i, event, data,
+					  &raise_mask);
 			if (rc < 0)
-				goto done;
+				break;
 			if (rc == SBI_IPI_UPDATE_RETRY)
 				retry_needed = true;
 			else
 				sbi_hartmask_clear_hartindex(i, &target_mask);
 			rc = 0;
 		}
+
+		sbi_ipi_fanout(&raise_mask);
+		raise_rc = sbi_ipi_raw_send_many(&raise_mask);
+		if (!rc)
+			rc = raise_rc;
+		if (rc < 0)
+			goto done;
 	} while (retry_needed);
 
 done:
@@ -250,6 +332,9 @@ void sbi_ipi_process(void)
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_RECVD);
 	sbi_ipi_raw_clear();
 
+	/* Raise the IPIs of a multicast this HART is a fanout leader of */
+	sbi_ipi_forward(ipi_data);
+
 	ipi_type = atomic_raw_xchg_ulong(&ipi_data->ipi_type, 0);
 	ipi_event = 0;
 	while (ipi_type) {
@@ -283,6 +368,29 @@ int sbi_ipi_raw_send(u32 hartindex)
 	return 0;
 }
 
+int sbi_ipi_raw_send_many(const struct sbi_hartmask *mask)
+{
+	u32 i;
+
+	if (!sbi_hartmask_weight(mask))
+		return 0;
+
+	if (!ipi_dev || (!ipi_dev->ipi_send && !ipi_dev->ipi_send_many))
+		return SBI_EINVAL;
+
+	/* Same ordering as in sbi_ipi_raw_send(), once for all targets */
+	wmb();
+
+	if (ipi_dev->ipi_send_many) {
+		ipi_dev->ipi_send_many(mask);
+		return 0;
+	}
+
+	sbi_hartmask_for_each_hartindex(i, mask)
+		ipi_dev->ipi_send(i);
+	return 0;
+}
+
 void sbi_ipi_raw_clear(void)
 {
 	if (ipi_dev && ipi_dev->ipi_clear)
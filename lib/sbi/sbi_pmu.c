@@ -19,6 +19,7 @@
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_sse.h>
+#include <sbi/sbi_timer.h>
 
 /** Information about hardware counters */
 struct sbi_pmu_hw_event {
@@ -100,6 +101,16 @@ static uint32_t num_hw_ctrs;
 /* Maximum number of counters available */
 static uint32_t total_ctrs;
 
+static void pmu_set_fw_counters_started(struct sbi_pmu_hart_state *phs,
+					unsigned long started)
+{
+	phs->fw_counters_started = started;
+
+	/* The ecall fast path does not count firmware events */
+	sbi_timer_fast_inhibit(sbi_hartid_to_scratch(phs->hartid),
+			       started != 0);
+}
+
 /* Helper macros to retrieve event idx and code type */
 #define get_cidx_type(x) \
   (((x) & SBI_PMU_EVENT_IDX_TYPE_MASK) >> SBI_PMU_EVENT_IDX_TYPE_OFFSET)
@@ -458,7 +469,8 @@ static int pmu_ctr_start_fw(struct sbi_pmu_hart_state *phs,
 			phs->fw_counters_data[cidx - num_hw_ctrs] = ival;
 	}
 
-	phs->fw_counters_started |= BIT(cidx - num_hw_ctrs);
+	pmu_set_fw_counters_started(phs, phs->fw_counters_started |
+					 BIT(cidx - num_hw_ctrs));
 
 	return 0;
 }
@@ -549,7 +561,8 @@ static int pmu_ctr_stop_fw(struct sbi_pmu_hart_state *phs,
 			return ret;
 	}
 
-	phs->fw_counters_started &= ~BIT(cidx - num_hw_ctrs);
+	pmu_set_fw_counters_started(phs, phs->fw_counters_started &
+					 ~BIT(cidx - num_hw_ctrs));
 
 	return 0;
 }
@@ -904,7 +917,9 @@ skip_match:
 				if (ret)
 					return ret;
 			}
-			phs->fw_counters_started |= BIT(ctr_idx - num_hw_ctrs);
+			pmu_set_fw_counters_started(phs,
+				phs->fw_counters_started |
+				BIT(ctr_idx - num_hw_ctrs));
 		}
 	}
 
@@ -1068,7 +1083,7 @@ static void pmu_reset_event_map(struct sbi_pmu_hart_state *phs)
 		phs->active_events[j] = SBI_PMU_EVENT_IDX_INVALID;
 	for (j = 0; j < SBI_PMU_FW_CTR_MAX; j++)
 		phs->fw_counters_data[j] = 0;
-	phs->fw_counters_started = 0;
+	pmu_set_fw_counters_started(phs, 0);
 	phs->sse_enabled = 0;
 }
 
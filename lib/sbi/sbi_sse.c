@@ -724,6 +724,8 @@ static int sse_event_set_pending(struct sbi_sse_event *e)
 		return SBI_EINVALID_STATE;
 
 	e->attrs.status |= BIT(SBI_SSE_ATTR_STATUS_PENDING_OFFSET);
+	/* Keep the ecall fast path from returning before the injection */
+	sbi_scratch_thishart_ptr()->ecall_fast_defer = 1;
 
 	return SBI_OK;
 }
@@ -8,10 +8,13 @@
  */
 
 /*
- * Simple libc functions. These are not optimized at all and might have some
- * bugs as well. Use any optimized routines from newlib or glibc if required.
+ * Simple libc functions. The string functions are not optimized at all and
+ * might have some bugs as well. The memory functions work a word at a time
+ * and can optionally use the vector extension for large sizes.
  */
 
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
 #include <sbi/sbi_string.h>
 
 /*
@@ -109,9 +112,301 @@ char *sbi_strrchr(const char *s, int c)
 	else
 		return (char *)last;
 }
+#define WSIZE		sizeof(unsigned long)
+#define WMASK		(WSIZE - 1)
+/* Shorter copies, fills and compares are done byte by byte */
+#define WORD_MIN	(2 * WSIZE)
+
+/*
+ * Build the word at an unaligned source position from the two aligned
+ * words around it. The source is only ever read in aligned words, which
+ * never cross a page boundary and work with -mstrict-align.
+ */
+static inline unsigned long merge_words(unsigned long lo, unsigned long hi,
+					unsigned int shift)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return (lo << shift) | (hi >> (8 * WSIZE - shift));
+#else
+	return (lo >> shift) | (hi << (8 * WSIZE - shift));
+#endif
+}
+
+static void copy_forward(char *d, const char *s, size_t count)
+{
+	unsigned long *wd, w0, w1, w2, w3;
+	const unsigned long *ws;
+	unsigned int shift;
+
+	if (count >= WORD_MIN) {
+		for (; (unsigned long)d & WMASK; count--)
+			*d++ = *s++;
+
+		wd = (unsigned long *)d;
+		shift = ((unsigned long)s & WMASK) * 8;
+		if (!shift) {
+			ws = (const unsigned long *)s;
+			for (; count >= 4 * WSIZE; count -= 4 * WSIZE) {
+				w0 = ws[0];
+				w1 = ws[1];
+				w2 = ws[2];
+				w3 = ws[3];
+				wd[0] = w0;
+				wd[1] = w1;
+				wd[2] = w2;
+				wd[3] = w3;
+				ws += 4;
+				wd += 4;
+			}
+			for (; count >= WSIZE; count -= WSIZE)
+				*wd++ = *ws++;
+		} else {
+			ws = (const unsigned long *)((unsigned long)s & ~WMASK);
+			w0 = *ws++;
+			for (; count >= WSIZE; count -= WSIZE) {
+				w1 = *ws++;
+				*wd++ = merge_words(w0, w1, shift);
+				w0 = w1;
+			}
+		}
+
+		s += (char *)wd - d;
+		d = (char *)wd;
+	}
+
+	while (count > 0) {
+		*d++ = *s++;
+		count--;
+	}
+}
+
+static void copy_backward(char *d, const char *s, size_t count)
+{
+	unsigned long *wd, w0, w1, w2, w3;
+	const unsigned long *ws;
+	unsigned int shift;
+
+	d += count;
+	s += count;
+
+	if (count >= WORD_MIN) {
+		for (; (unsigned long)d & WMASK; count--)
+			*--d = *--s;
+
+		wd = (unsigned long *)d;
+		shift = ((unsigned long)s & WMASK) * 8;
+		if (!shift) {
+			ws = (const unsigned long *)s;
+			for (; count >= 4 * WSIZE; count -= 4 * WSIZE) {
+				w3 = ws[-1];
+				w2 = ws[-2];
+				w1 = ws[-3];
+				w0 = ws[-4];
+				wd[-1] = w3;
+				wd[-2] = w2;
+				wd[-3] = w1;
+				wd[-4] = w0;
+				ws -= 4;
+				wd -= 4;
+			}
+			for (; count >= WSIZE; count -= WSIZE)
+				*--wd = *--ws;
+		} else {
+			ws = (const unsigned long *)((unsigned long)s & ~WMASK);
+			w1 = *ws;
+			for (; count >= WSIZE; count -= WSIZE) {
+				w0 = *--ws;
+				*--wd = merge_words(w0, w1, shift);
+				w1 = w0;
+			}
+		}
+
+		s -= d - (char *)wd;
+		d = (char *)wd;
+	}
+
+	while (count > 0) {
+		*--d = *--s;
+		count--;
+	}
+}
+
+#if defined(CONFIG_SBI_STRING_VECTOR) && defined(OPENSBI_CC_SUPPORT_VECTOR)
+
+/* Bytes of vector registers saved on the stack, this bounds the LMUL */
+#define VEC_SAVE_MAX	256
+/* Shorter copies and fills do not pay for the save and restore */
+#define VEC_MIN		512
+/* vtype of e8 with tail and mask agnostic, the LMUL is ORed in */
+#define VEC_VTYPE_E8	0xc0UL
+
+struct vec_state {
+	unsigned long mstatus;
+	unsigned long vl;
+	unsigned long vtype;
+	unsigned long vstart;
+	unsigned long e8;
+	unsigned char save[VEC_SAVE_MAX];
+};
+
+/*
+ * The vector registers belong to the interrupted context. They are only
+ * used when MSTATUS.VS is not Off, and v0 to v(LMUL-1), vl, vtype and
+ * vstart are saved and restored around the operation.
+ */
+static bool vec_begin(struct vec_state *vs)
+{
+	unsigned long vlenb, lmul = 3, vl;
+
+	vs->mstatus = csr_read(CSR_MSTATUS);
+	if (!(vs->mstatus & MSTATUS_VS) || !misa_extension('V'))
+		return false;
+
+	vlenb = csr_read(CSR_VLENB);
+	while (lmul && (vlenb << lmul) > VEC_SAVE_MAX)
+		lmul--;
+	if ((vlenb << lmul) > VEC_SAVE_MAX)
+		return false;
+
+	vs->vl = csr_read(CSR_VL);
+	vs->vtype = csr_read(CSR_VTYPE);
+	vs->vstart = csr_read(CSR_VSTART);
+	vs->e8 = VEC_VTYPE_E8 | lmul;
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvl %0, x0, %2\n\t"
+		     "vse8.v v0, (%1)\n\t"
+		     ".option pop\n\t"
+		     : "=&r"(vl)
+		     : "r"(vs->save), "r"(vs->e8)
+		     : "memory");
+
+	return true;
+}
+
+static void vec_end(struct vec_state *vs)
+{
+	unsigned long vl;
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvl %0, x0, %2\n\t"
+		     "vle8.v v0, (%1)\n\t"
+		     "vsetvl x0, %3, %4\n\t"
+		     ".option pop\n\t"
+		     : "=&r"(vl)
+		     : "r"(vs->save), "r"(vs->e8), "r"(vs->vl), "r"(vs->vtype)
+		     : "memory");
+	csr_write(CSR_VSTART, vs->vstart);
+
+	/* The registers hold their old values, so restore the old state */
+	csr_clear(CSR_MSTATUS, MSTATUS_VS);
+	csr_set(CSR_MSTATUS, vs->mstatus & MSTATUS_VS);
+}
+
+/*
+ * Every chunk is loaded completely before it is stored, so overlapping
+ * moves are safe when the chunks are taken from the right end.
+ */
+static __attribute__((noinline)) bool vec_move(char *d, const char *s,
+					       size_t count, bool backward)
+{
+	struct vec_state vs;
+	unsigned long vl, off;
+
+	if (count < VEC_MIN || !vec_begin(&vs))
+		return false;
+
+	for (off = 0; count > 0; count -= vl) {
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetvl %0, %1, %2\n\t"
+			     ".option pop\n\t"
+			     : "=r"(vl) : "r"(count), "r"(vs.e8));
+		if (backward)
+			off = count - vl;
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vle8.v v0, (%0)\n\t"
+			     "vse8.v v0, (%1)\n\t"
+			     ".option pop\n\t"
+			     : : "r"(s + off), "r"(d + off) : "memory");
+		if (!backward)
+			off += vl;
+	}
+
+	vec_end(&vs);
+	return true;
+}
+
+static __attribute__((noinline)) bool vec_fill(char *d, int c, size_t count)
+{
+	struct vec_state vs;
+	unsigned long vl;
+
+	if (count < VEC_MIN || !vec_begin(&vs))
+		return false;
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvl %0, x0, %1\n\t"
+		     "vmv.v.x v0, %2\n\t"
+		     ".option pop\n\t"
+		     : "=&r"(vl) : "r"(vs.e8), "r"(c));
+	for (; count > 0; count -= vl, d += vl)
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetvl %0, %2, %3\n\t"
+			     "vse8.v v0, (%1)\n\t"
+			     ".option pop\n\t"
+			     : "=&r"(vl) : "r"(d), "r"(count), "r"(vs.e8)
+			     : "memory");
+
+	vec_end(&vs);
+	return true;
+}
+
+#else
+
+static inline bool vec_move(char *d, const char *s, size_t count,
+			    bool backward)
+{
+	return false;
+}
+
+static inline bool vec_fill(char *d, int c, size_t count)
+{
+	return false;
+}
+
+#endif
+
 void *sbi_memset(void *s, int c, size_t count)
 {
 	char *temp = s;
+	unsigned long *wd, word;
+
+	if (vec_fill(temp, c, count))
+		return s;
+
+	if (count >= WORD_MIN) {
+		for (; (unsigned long)temp & WMASK; count--)
+			*temp++ = c;
+
+		word = (unsigned char)c * (~0UL / 0xff);
+		wd = (unsigned long *)temp;
+		for (; count >= 4 * WSIZE; count -= 4 * WSIZE) {
+			wd[0] = word;
+			wd[1] = word;
+			wd[2] = word;
+			wd[3] = word;
+			wd += 4;
+		}
+		for (; count >= WSIZE; count -= WSIZE)
+			*wd++ = word;
+		temp = (char *)wd;
+	}
 
 	while (count > 0) {
 		count--;
@@ -123,47 +418,59 @@ void *sbi_memset(void *s, int c, size_t count)
 
 void *sbi_memcpy(void *dest, const void *src, size_t count)
 {
-	char *temp1	  = dest;
-	const char *temp2 = src;
-
-	while (count > 0) {
-		*temp1++ = *temp2++;
-		count--;
-	}
+	if (!vec_move(dest, src, count, false))
+		copy_forward(dest, src, count);
 
 	return dest;
 }
 
 void *sbi_memmove(void *dest, const void *src, size_t count)
 {
-	char *temp1	  = (char *)dest;
-	const char *temp2 = (char *)src;
+	bool backward;
 
 	if (src == dest)
 		return dest;
 
-	if (dest < src) {
-		while (count > 0) {
-			*temp1++ = *temp2++;
-			count--;
-		}
-	} else {
-		temp1 = (char *)dest + count - 1;
-		temp2 = (char *)src + count - 1;
+	/* Copy backward only if the start of dest overlaps the source */
+	backward = (unsigned long)dest - (unsigned long)src < count;
+	if (vec_move(dest, src, count, backward))
+		return dest;
 
-		while (count > 0) {
-			*temp1-- = *temp2--;
-			count--;
-		}
-	}
+	if (backward)
+		copy_backward(dest, src, count);
+	else
+		copy_forward(dest, src, count);
 
 	return dest;
 }
 
 int sbi_memcmp(const void *s1, const void *s2, size_t count)
 {
-	const char *temp1 = s1;
-	const char *temp2 = s2;
+	const unsigned char *temp1 = s1;
+	const unsigned char *temp2 = s2;
+	const unsigned long *w1, *w2;
+
+	/* Compare words if both sides can be aligned at the same time */
+	if (count >= WORD_MIN &&
+	    !(((unsigned long)s1 ^ (unsigned long)s2) & WMASK)) {
+		for (; (unsigned long)temp1 & WMASK; count--) {
+			if (*temp1 != *temp2)
+				return *temp1 - *temp2;
+			temp1++;
+			temp2++;
+		}
+
+		w1 = (const unsigned long *)temp1;
+		w2 = (const unsigned long *)temp2;
+		for (; count >= WSIZE && *w1 == *w2; count -= WSIZE) {
+			w1++;
+			w2++;
+		}
+
+		/* The bytes of the differing word give the result */
+		temp1 = (const unsigned char *)w1;
+		temp2 = (const unsigned char *)w2;
+	}
 
 	for (; count > 0 && (*temp1 == *temp2); count--) {
 		temp1++;
@@ -171,7 +478,7 @@ int sbi_memcmp(const void *s1, const void *s2, size_t count)
 	}
 
 	if (count > 0)
-		return *(unsigned char *)temp1 - *(unsigned char *)temp2;
+		return *temp1 - *temp2;
 	else
 		return 0;
 }
@@ -19,6 +19,7 @@
 #include <sbi/sbi_timer.h>
 
 static unsigned long time_delta_off;
+static unsigned long fast_off;
 static u64 (*get_time_val)(void);
 static const struct sbi_timer_device *timer_dev = NULL;
 
@@ -159,6 +160,57 @@ void sbi_timer_process(void)
 		csr_set(CSR_MIP, MIP_STIP);
 }
 
+struct timer_fast_state {
+	volatile u64 *timecmp;
+	bool inhibit;
+};
+
+static void timer_fast_update(struct sbi_scratch *scratch)
+{
+	struct timer_fast_state *fs;
+
+	if (!fast_off)
+		return;
+
+	/*
+	 * The assembly fast path of the trap handler writes the time compare
+	 * register directly, which bypasses Sstc and the firmware counters
+	 * of the PMU extension.
+	 */
+	fs = sbi_scratch_offset_ptr(scratch, fast_off);
+	scratch->ecall_fast_timecmp = 0;
+#ifdef CONFIG_SBI_ECALL_FAST_PATH
+	if (fs->timecmp && !fs->inhibit &&
+	    !sbi_hart_has_extension(scratch, SBI_HART_EXT_SSTC))
+		scratch->ecall_fast_timecmp = (unsigned long)fs->timecmp;
+#endif
+}
+
+void sbi_timer_set_fast_timecmp(volatile u64 *timecmp)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct timer_fast_state *fs;
+
+	if (!fast_off)
+		return;
+
+	fs = sbi_scratch_offset_ptr(scratch, fast_off);
+	fs->timecmp = timecmp;
+	timer_fast_update(scratch);
+}
+
+void sbi_timer_fast_inhibit(struct sbi_scratch *scratch, bool inhibit)
+{
+	struct timer_fast_state *fs;
+
+	if (!fast_off || !scratch)
+		return;
+
+	fs = sbi_scratch_offset_ptr(scratch, fast_off);
+	fs->inhibit = inhibit;
+	timer_fast_update(scratch);
+}
+
 const struct sbi_timer_device *sbi_timer_get_device(void)
 {
 	return timer_dev;
@@ -185,6 +237,10 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (!time_delta_off)
 			return SBI_ENOMEM;
 
+		fast_off = sbi_scratch_alloc_type_offset(struct timer_fast_state);
+		if (!fast_off)
+			return SBI_ENOMEM;
+
 		if (sbi_hart_has_csr(scratch, SBI_HART_CSR_TIME))
 			get_time_val = get_ticks;
 
@@ -192,13 +248,16 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (ret)
 			return ret;
 	} else {
-		if (!time_delta_off)
+		if (!time_delta_off || !fast_off)
 			return SBI_ENOMEM;
 	}
 
 	time_delta = sbi_scratch_offset_ptr(scratch, time_delta_off);
 	*time_delta = 0;
 
+	/* The timer device enables the fast path in its warm_init */
+	sbi_timer_set_fast_timecmp(NULL);
+
 	if (timer_dev && timer_dev->warm_init) {
 		ret = timer_dev->warm_init();
 		if (ret)
@@ -210,6 +269,8 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 
 void sbi_timer_exit(struct sbi_scratch *scratch)
 {
+	sbi_timer_set_fast_timecmp(NULL);
+
 	if (timer_dev && timer_dev->timer_event_stop)
 		timer_dev->timer_event_stop();
 
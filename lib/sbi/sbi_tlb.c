@@ -12,7 +12,6 @@
 #include <sbi/riscv_atomic.h>
 #include <sbi/riscv_barrier.h>
 #include <sbi/sbi_error.h>
-#include <sbi/sbi_fifo.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_ipi.h>
@@ -23,17 +22,123 @@
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_pmu.h>
+#include <sbi/sbi_unpriv_ptw.h>
+
+/*
+ * Every HART owns a ring of remote fence requests, which any HART may
+ * fill without taking a lock and only the owner takes requests out of.
+ * The seq word of a slot holds the ring position the slot is used for
+ * and, in the low bits, its state:
+ *
+ *   TLB_SLOT_FREE	a producer may reserve the slot for the position
+ *   TLB_SLOT_READY	the slot holds a queued request
+ *   TLB_SLOT_BUSY	a producer coalesces into the request or the
+ *			owner takes it out of the ring
+ */
+#define TLB_SLOT_FREE		0
+#define TLB_SLOT_READY		1
+#define TLB_SLOT_BUSY		2
+#define TLB_SLOT_STATE_BITS	2
+
+#define TLB_SLOT_SEQ(__pos, __state)	\
+	(((__pos) << TLB_SLOT_STATE_BITS) | (__state))
+
+struct tlb_ring {
+	/* Next position to take out, only written by the owner */
+	unsigned long head;
+	/* Next position to reserve */
+	unsigned long tail;
+	/* Number of slots minus one, the number is a power of 2 */
+	unsigned long mask;
+	struct sbi_tlb_slot *slots;
+};
 
 static unsigned long tlb_sync_off;
-static unsigned long tlb_fifo_off;
-static unsigned long tlb_fifo_mem_off;
+static unsigned long tlb_ring_off;
 static unsigned long tlb_range_flush_limit;
 
+/* Get exclusive access to the queued request of a slot */
+static bool tlb_slot_claim(struct sbi_tlb_slot *slot, unsigned long pos)
+{
+	unsigned long seq = TLB_SLOT_SEQ(pos, TLB_SLOT_READY);
+
+	return __atomic_compare_exchange_n(&slot->seq, &seq,
+					   TLB_SLOT_SEQ(pos, TLB_SLOT_BUSY),
+					   false, __ATOMIC_ACQUIRE,
+					   __ATOMIC_RELAXED);
+}
+
 static void tlb_flush_all(void)
 {
 	__asm__ __volatile("sfence.vma");
 }
 
+static bool tlb_info_is_full(const struct sbi_tlb_info *tinfo)
+{
+	return (!tinfo->start && !tinfo->size) ||
+	       tinfo->size == SBI_TLB_FLUSH_ALL;
+}
+
+static unsigned long tlb_info_end(const struct sbi_tlb_info *tinfo)
+{
+	unsigned long end = tinfo->start + tinfo->size;
+
+	return end < tinfo->start ? -1UL : end;
+}
+
+static unsigned long tlb_info_stride(const struct sbi_tlb_info *tinfo)
+{
+	return tinfo->stride ? tinfo->stride : PAGE_SIZE;
+}
+
+/* Fencing a range larger than this costs more than a full flush */
+static bool tlb_range_too_big(unsigned long size, unsigned long stride)
+{
+	return size / (stride / PAGE_SIZE) > tlb_range_flush_limit;
+}
+
+/*
+ * Fence every leaf mapping of the range, whose granularity is the stride
+ * of the request. With Svinval the invalidations are not ordered against
+ * each other and the HART can pipeline them between a single pair of
+ * fences.
+ */
+static void tlb_sfence_vma_range(const struct sbi_tlb_info *tinfo,
+				 bool use_asid)
+{
+	unsigned long stride = tlb_info_stride(tinfo);
+	unsigned long va = tinfo->start & ~(stride - 1);
+	unsigned long span = tlb_info_end(tinfo) - va;
+	unsigned long count = span / stride + !!(span & (stride - 1));
+	unsigned long asid = tinfo->asid;
+
+	if (sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+				   SBI_HART_EXT_SVINVAL)) {
+		__sbi_sfence_w_inval();
+		for (; count; count--, va += stride) {
+			if (use_asid)
+				__sbi_sinval_vma_asid_va(va, asid);
+			else
+				__sbi_sinval_vma_va(va);
+		}
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
+	for (; count; count--, va += stride) {
+		if (use_asid)
+			__asm__ __volatile__("sfence.vma %0, %1"
+					     :
+					     : "r"(va), "r"(asid)
+					     : "memory");
+		else
+			__asm__ __volatile__("sfence.vma %0"
+					     :
+					     : "r"(va)
+					     : "memory");
+	}
+}
+
 static void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
@@ -79,23 +184,15 @@ static void sbi_tlb_local_hfence_gvma(struct sbi_tlb_info *tinfo)
 
 static void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
 {
-	unsigned long start = tinfo->start;
-	unsigned long size  = tinfo->size;
-	unsigned long i;
-
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_RCVD);
+	sbi_unpriv_ptw_flush();
 
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_info_is_full(tinfo)) {
 		tlb_flush_all();
 		return;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
-		__asm__ __volatile__("sfence.vma %0"
-				     :
-				     : "r"(start + i)
-				     : "memory");
-	}
+	tlb_sfence_vma_range(tinfo, false);
 }
 
 static void sbi_tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
@@ -145,15 +242,13 @@ static void sbi_tlb_local_hfence_gvma_vmid(struct sbi_tlb_info *tinfo)
 
 static void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 {
-	unsigned long start = tinfo->start;
-	unsigned long size  = tinfo->size;
 	unsigned long asid  = tinfo->asid;
-	unsigned long i;
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_ASID_RCVD);
+	sbi_unpriv_ptw_flush();
 
 	/* Flush entire MM context for a given ASID */
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_info_is_full(tinfo)) {
 		__asm__ __volatile__("sfence.vma x0, %0"
 				     :
 				     : "r"(asid)
@@ -161,12 +256,7 @@ static void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
-		__asm__ __volatile__("sfence.vma %0, %1"
-				     :
-				     : "r"(start + i), "r"(asid)
-				     : "memory");
-	}
+	tlb_sfence_vma_range(tinfo, true);
 }
 
 static void sbi_tlb_local_fence_i(struct sbi_tlb_info *tinfo)
@@ -228,16 +318,28 @@ static void tlb_entry_process(struct sbi_tlb_info *tinfo)
 
 static bool tlb_process_once(struct sbi_scratch *scratch)
 {
+	struct tlb_ring *ring = sbi_scratch_offset_ptr(scratch, tlb_ring_off);
+	unsigned long pos = ring->head, seq;
+	struct sbi_tlb_slot *slot = &ring->slots[pos & ring->mask];
 	struct sbi_tlb_info tinfo;
-	struct sbi_fifo *tlb_fifo =
-			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 
-	if (!sbi_fifo_dequeue(tlb_fifo, &tinfo)) {
-		tlb_entry_process(&tinfo);
-		return true;
+	/* Wait for a producer that is coalescing into the request */
+	while (!tlb_slot_claim(slot, pos)) {
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+		if (seq != TLB_SLOT_SEQ(pos, TLB_SLOT_BUSY))
+			return false;
+		cpu_relax();
 	}
 
-	return false;
+	tinfo = slot->info;
+	__atomic_store_n(&slot->seq,
+			 TLB_SLOT_SEQ(pos + ring->mask + 1, TLB_SLOT_FREE),
+			 __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->head, pos + 1, __ATOMIC_RELEASE);
+
+	tlb_entry_process(&tinfo);
+
+	return true;
 }
 
 static void tlb_process(struct sbi_scratch *scratch)
@@ -253,88 +355,164 @@ static void tlb_sync(struct sbi_scratch *scratch)
 	while (atomic_read(tlb_sync) > 0) {
 		/*
 		 * While we are waiting for remote hart to set the sync,
-		 * consume fifo requests to avoid deadlock.
+		 * consume fifo requests and raise the IPIs forwarded
+		 * through us to avoid deadlock.
 		 */
+		sbi_ipi_forward_pending();
 		tlb_process_once(scratch);
 	}
 
 	return;
 }
 
-static inline int tlb_range_check(struct sbi_tlb_info *curr,
-					struct sbi_tlb_info *next)
-{
-	unsigned long curr_end;
-	unsigned long next_end;
-	int ret = SBI_FIFO_UNCHANGED;
-
-	if (!curr || !next)
-		return ret;
-
-	next_end = next->start + next->size;
-	curr_end = curr->start + curr->size;
-	if (next->start <= curr->start && next_end > curr_end) {
-		curr->start = next->start;
-		curr->size  = next->size;
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
-		ret = SBI_FIFO_UPDATED;
-	} else if (next->start >= curr->start && next_end <= curr_end) {
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
-		ret = SBI_FIFO_SKIP;
-	}
-
-	return ret;
-}
-
 /**
- * Call back to decide if an inplace fifo update is required or next entry can
- * can be skipped. Here are the different cases that are being handled.
+ * Coalesce the request next into the queued request curr if both fence
+ * the same address space. Here are the different cases that are being
+ * handled.
  *
  * Case1:
- *	if next flush request range lies within one of the existing entry, skip
- *	the next entry.
+ *	FENCE.I requests and requests covered by a full flush of curr only
+ *	add their source HARTs to curr.
  * Case2:
- *	if flush request range in current fifo entry lies within next flush
- *	request, update the current entry.
+ *	Overlapping or adjacent ranges are merged, so that the queued
+ *	requests of an address space form a set of disjoint intervals.
+ * Case3:
+ *	With force, disjoint ranges are merged as well, i.e. the gap
+ *	between them is fenced too. This is used when the queue is full.
  *
- * Note:
- *	We can not issue a fifo reset anymore if a complete vma flush is requested.
- *	This is because we are queueing FENCE.I requests as well now.
- *	To ease up the pressure in enqueue/fifo sync path, try to dequeue 1 element
- *	before continuing the while loop. This method is preferred over wfi/ipi because
- *	of MMIO cost involved in later method.
+ * A merged range larger than tlb_range_flush_limit becomes a full flush.
+ * It is fenced with the smaller stride of both requests.
  */
-static int tlb_update_cb(void *in, void *data)
+static bool tlb_info_merge(struct sbi_tlb_info *curr,
+			   const struct sbi_tlb_info *next, bool force)
 {
-	struct sbi_tlb_info *curr;
-	struct sbi_tlb_info *next;
-	int ret = SBI_FIFO_UNCHANGED;
-
-	if (!in || !data)
-		return ret;
-
-	curr = (struct sbi_tlb_info *)data;
-	next = (struct sbi_tlb_info *)in;
-
-	if (next->type == SBI_TLB_SFENCE_VMA_ASID &&
-	    curr->type == SBI_TLB_SFENCE_VMA_ASID) {
-		if (next->asid == curr->asid)
-			ret = tlb_range_check(curr, next);
-	} else if (next->type == SBI_TLB_SFENCE_VMA &&
-		   curr->type == SBI_TLB_SFENCE_VMA) {
-		ret = tlb_range_check(curr, next);
+	unsigned long start, end, stride;
+
+	if (curr->type != next->type) {
+		/* A full SFENCE.VMA covers every ASID */
+		if (curr->type != SBI_TLB_SFENCE_VMA ||
+		    next->type != SBI_TLB_SFENCE_VMA_ASID ||
+		    !tlb_info_is_full(curr))
+			return false;
+		goto merged;
 	}
 
-	return ret;
+	switch (curr->type) {
+	case SBI_TLB_FENCE_I:
+		goto merged;
+	case SBI_TLB_SFENCE_VMA_ASID:
+		if (curr->asid != next->asid)
+			return false;
+		break;
+	case SBI_TLB_HFENCE_VVMA_ASID:
+		if (curr->asid != next->asid || curr->vmid != next->vmid)
+			return false;
+		break;
+	case SBI_TLB_HFENCE_GVMA_VMID:
+	case SBI_TLB_HFENCE_VVMA:
+		if (curr->vmid != next->vmid)
+			return false;
+		break;
+	default:
+		break;
+	}
+
+	if (tlb_info_is_full(curr))
+		goto merged;
+
+	if (tlb_info_is_full(next)) {
+		start = 0;
+		end = SBI_TLB_FLUSH_ALL;
+	} else {
+		if (!force && (next->start > tlb_info_end(curr) ||
+			       curr->start > tlb_info_end(next)))
+			return false;
+		start = MIN(curr->start, next->start);
+		end = MAX(tlb_info_end(curr), tlb_info_end(next));
+	}
+
+	/* The merged range may mix mappings of both granularities */
+	stride = MIN(tlb_info_stride(curr), tlb_info_stride(next));
+	if (tlb_range_too_big(end - start, stride)) {
+		curr->start = 0;
+		curr->size = SBI_TLB_FLUSH_ALL;
+	} else {
+		curr->start = start;
+		curr->size = end - start;
+		curr->stride = stride;
+	}
+
+merged:
+	sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+	return true;
+}
+
+static bool tlb_ring_coalesce(struct tlb_ring *ring,
+			      const struct sbi_tlb_info *tinfo, bool force)
+{
+	unsigned long pos, tail, head;
+	struct sbi_tlb_slot *slot;
+	bool merged;
+
+	/* Read head first, it never passes the tail read afterwards */
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (tail - head > ring->mask + 1)
+		head = tail - (ring->mask + 1);
+
+	for (pos = head; pos != tail; pos++) {
+		slot = &ring->slots[pos & ring->mask];
+		if (!tlb_slot_claim(slot, pos))
+			continue;
+
+		merged = tlb_info_merge(&slot->info, tinfo, force);
+		__atomic_store_n(&slot->seq, TLB_SLOT_SEQ(pos, TLB_SLOT_READY),
+				 __ATOMIC_RELEASE);
+		if (merged)
+			return true;
+	}
+
+	return false;
+}
+
+static bool tlb_ring_enqueue(struct tlb_ring *ring,
+			     const struct sbi_tlb_info *tinfo)
+{
+	unsigned long pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	struct sbi_tlb_slot *slot;
+	unsigned long seq;
+
+	for (;;) {
+		slot = &ring->slots[pos & ring->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq == TLB_SLOT_SEQ(pos, TLB_SLOT_FREE)) {
+			if (__atomic_compare_exchange_n(&ring->tail, &pos,
+							pos + 1, false,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if ((long)(seq - TLB_SLOT_SEQ(pos, 0)) < 0) {
+			/* Not taken out of the ring since the last round */
+			return false;
+		} else {
+			pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->info = *tinfo;
+	__atomic_store_n(&slot->seq, TLB_SLOT_SEQ(pos, TLB_SLOT_READY),
+			 __ATOMIC_RELEASE);
+
+	return true;
 }
 
 static int tlb_update(struct sbi_scratch *scratch,
 			  struct sbi_scratch *remote_scratch,
 			  u32 remote_hartindex, void *data)
 {
-	int ret;
+	int ret = SBI_IPI_UPDATE_SUCCESS;
 	atomic_t *tlb_sync;
-	struct sbi_fifo *tlb_fifo_r;
+	struct tlb_ring *ring;
 	struct sbi_tlb_info *tinfo = data;
 	u32 curr_hartid = current_hartid();
 
@@ -347,30 +525,33 @@ static int tlb_update(struct sbi_scratch *scratch,
 		return SBI_IPI_UPDATE_BREAK;
 	}
 
-	tlb_fifo_r = sbi_scratch_offset_ptr(remote_scratch, tlb_fifo_off);
-
-	ret = sbi_fifo_inplace_update(tlb_fifo_r, data, tlb_update_cb);
-
-	if (ret == SBI_FIFO_UNCHANGED &&
-	    sbi_fifo_enqueue(tlb_fifo_r, data, false) < 0) {
-		/**
-		 * For now, Busy loop until there is space in the fifo.
-		 * There may be case where target hart is also
-		 * enqueue in source hart's fifo. Both hart may busy
-		 * loop leading to a deadlock.
-		 * TODO: Introduce a wait/wakeup event mechanism to handle
-		 * this properly.
-		 */
-		tlb_process_once(scratch);
-		sbi_dprintf("hart%d: hart%d tlb fifo full\n", curr_hartid,
-			    sbi_hartindex_to_hartid(remote_hartindex));
-		return SBI_IPI_UPDATE_RETRY;
+	ring = sbi_scratch_offset_ptr(remote_scratch, tlb_ring_off);
+
+	if (tlb_ring_coalesce(ring, tinfo, false)) {
+		ret = SBI_IPI_UPDATE_COALESCED;
+	} else if (!tlb_ring_enqueue(ring, tinfo)) {
+		if (tlb_ring_coalesce(ring, tinfo, true)) {
+			ret = SBI_IPI_UPDATE_COALESCED;
+		} else {
+			/*
+			 * The ring only holds requests for other address
+			 * spaces. Take a request out of our own ring in the
+			 * meantime, so that HARTs filling each other's rings
+			 * keep making progress.
+			 */
+			sbi_ipi_forward_pending();
+			tlb_process_once(scratch);
+			sbi_dprintf("hart%d: hart%d tlb ring full\n",
+				    curr_hartid,
+				    sbi_hartindex_to_hartid(remote_hartindex));
+			return SBI_IPI_UPDATE_RETRY;
+		}
 	}
 
 	tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
 	atomic_add_return(tlb_sync, 1);
 
-	return SBI_IPI_UPDATE_SUCCESS;
+	return ret;
 }
 
 static struct sbi_ipi_event_ops tlb_ops = {
@@ -400,9 +581,9 @@ int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 	/*
 	 * If address range to flush is too big then simply
 	 * upgrade it to flush all because we can only flush
-	 * 4KB at a time.
+	 * one mapping of the stride at a time.
 	 */
-	if (tinfo->size > tlb_range_flush_limit) {
+	if (tlb_range_too_big(tinfo->size, tlb_info_stride(tinfo))) {
 		tinfo->start = 0;
 		tinfo->size = SBI_TLB_FLUSH_ALL;
 	}
@@ -415,30 +596,23 @@ int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	int ret;
-	void *tlb_mem;
+	unsigned long i, count;
 	atomic_t *tlb_sync;
-	struct sbi_fifo *tlb_q;
+	struct tlb_ring *ring;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 
 	if (cold_boot) {
 		tlb_sync_off = sbi_scratch_alloc_offset(sizeof(*tlb_sync));
 		if (!tlb_sync_off)
 			return SBI_ENOMEM;
-		tlb_fifo_off = sbi_scratch_alloc_offset(sizeof(*tlb_q));
-		if (!tlb_fifo_off) {
-			sbi_scratch_free_offset(tlb_sync_off);
-			return SBI_ENOMEM;
-		}
-		tlb_fifo_mem_off = sbi_scratch_alloc_offset(sizeof(tlb_mem));
-		if (!tlb_fifo_mem_off) {
-			sbi_scratch_free_offset(tlb_fifo_off);
+		tlb_ring_off = sbi_scratch_alloc_offset(sizeof(*ring));
+		if (!tlb_ring_off) {
 			sbi_scratch_free_offset(tlb_sync_off);
 			return SBI_ENOMEM;
 		}
 		ret = sbi_ipi_event_create(&tlb_ops);
 		if (ret < 0) {
-			sbi_scratch_free_offset(tlb_fifo_mem_off);
-			sbi_scratch_free_offset(tlb_fifo_off);
+			sbi_scratch_free_offset(tlb_ring_off);
 			sbi_scratch_free_offset(tlb_sync_off);
 			return ret;
 		}
@@ -446,28 +620,32 @@ int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 		tlb_range_flush_limit = sbi_platform_tlbr_flush_limit(plat);
 	} else {
 		if (!tlb_sync_off ||
-		    !tlb_fifo_off ||
-		    !tlb_fifo_mem_off)
+		    !tlb_ring_off)
 			return SBI_ENOMEM;
 		if (SBI_IPI_EVENT_MAX <= tlb_event)
 			return SBI_ENOSPC;
 	}
 
+	/* Largest power of 2 within the platform's number of entries */
+	count = 1;
+	while (count * 2 <= sbi_platform_tlb_fifo_num_entries(plat))
+		count *= 2;
+
 	tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
-	tlb_q = sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
-	tlb_mem = sbi_scratch_read_type(scratch, void *, tlb_fifo_mem_off);
-	if (!tlb_mem) {
-		tlb_mem = sbi_malloc(
-				sbi_platform_tlb_fifo_num_entries(plat) * SBI_TLB_INFO_SIZE);
-		if (!tlb_mem)
+	ring = sbi_scratch_offset_ptr(scratch, tlb_ring_off);
+	if (!ring->slots) {
+		ring->slots = sbi_malloc(count * SBI_TLB_SLOT_SIZE);
+		if (!ring->slots)
 			return SBI_ENOMEM;
-		sbi_scratch_write_type(scratch, void *, tlb_fifo_mem_off, tlb_mem);
 	}
 
 	ATOMIC_INIT(tlb_sync, 0);
 
-	sbi_fifo_init(tlb_q, tlb_mem,
-		      sbi_platform_tlb_fifo_num_entries(plat), SBI_TLB_INFO_SIZE);
+	ring->head = 0;
+	ring->tail = 0;
+	ring->mask = count - 1;
+	for (i = 0; i < count; i++)
+		ring->slots[i].seq = TLB_SLOT_SEQ(i, TLB_SLOT_FREE);
 
 	return 0;
 }
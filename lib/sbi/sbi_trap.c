@@ -421,8 +421,16 @@ trap_done:
 	if (rc)
 		sbi_trap_error(msg, rc, tcntx);
 
-	if (sbi_mstatus_prev_mode(regs->mstatus) != PRV_M)
+	if (sbi_mstatus_prev_mode(regs->mstatus) != PRV_M) {
+		/*
+		 * Events left pending now wait for an SSE call, which
+		 * takes this path again. Console output that is left
+		 * sets the flag again.
+		 */
+		scratch->ecall_fast_defer = 0;
 		sbi_sse_process_pending_events(regs);
+		sbi_console_drain();
+	}
 
 	sbi_trap_set_context(scratch, tcntx->prev_context);
 	return tcntx;
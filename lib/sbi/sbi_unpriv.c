@@ -7,12 +7,14 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_asm.h>
 #include <sbi/riscv_encoding.h>
 #include <sbi/sbi_bitops.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_unpriv.h>
+#include <sbi/sbi_unpriv_ptw.h>
 
 /**
  * a3 must a pointer to the sbi_trap_info and a4 is used as a temporary
@@ -26,7 +28,13 @@
 		register ulong mstatus = 0;                                   \
 		register ulong mtvec = (ulong)sbi_hart_expected_trap;         \
 		type ret = 0;                                                 \
+		ulong paddr;                                                  \
 		trap->cause = 0;                                              \
+		if (sbi_unpriv_ptw_translate((ulong)addr, sizeof(type),       \
+					     SBI_UNPRIV_PTW_READ, &paddr,     \
+					     trap))                           \
+			return trap->cause ? 0 :                              \
+				*(const volatile type *)paddr;                \
 		asm volatile(                                                 \
 			"add %[tinfo], %[taddr], zero\n"                      \
 			"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"      \
@@ -52,7 +60,15 @@
 		register ulong tinfo asm("a3") = (ulong)trap;                 \
 		register ulong mstatus = 0;                                   \
 		register ulong mtvec = (ulong)sbi_hart_expected_trap;         \
+		ulong paddr;                                                  \
 		trap->cause = 0;                                              \
+		if (sbi_unpriv_ptw_translate((ulong)addr, sizeof(type),       \
+					     SBI_UNPRIV_PTW_WRITE, &paddr,    \
+					     trap)) {                         \
+			if (!trap->cause)                                     \
+				*(volatile type *)paddr = val;                \
+			return;                                               \
+		}                                                             \
 		asm volatile(                                                 \
 			"add %[tinfo], %[taddr], zero\n"                      \
 			"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"      \
@@ -116,6 +132,29 @@ void sbi_store_u64(u64 *addr, u64 val,
 # error "Unexpected __riscv_xlen"
 #endif
 
+static bool ptw_get_insn(ulong mepc, ulong *insn, struct sbi_trap_info *trap)
+{
+	ulong access = SBI_UNPRIV_PTW_READ | SBI_UNPRIV_PTW_MXR;
+	ulong paddr;
+
+	if (!sbi_unpriv_ptw_translate(mepc, 2, access, &paddr, trap))
+		return false;
+	if (trap->cause)
+		return true;
+
+	*insn = *(const volatile u16 *)paddr;
+	if ((*insn & 3) != 3)
+		return true;
+
+	/* The upper half may live on another page */
+	if (!sbi_unpriv_ptw_translate(mepc + 2, 2, access, &paddr, trap))
+		return false;
+	if (!trap->cause)
+		*insn |= (ulong)*(const volatile u16 *)paddr << 16;
+
+	return true;
+}
+
 ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
 {
 	register ulong tinfo asm("a3");
@@ -126,6 +165,9 @@ ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
 
 	trap->cause = 0;
 
+	if (ptw_get_insn(mepc, &insn, trap))
+		goto done;
+
 	asm volatile(
 	    "add %[tinfo], %[taddr], zero\n"
 	    "csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"
@@ -146,6 +188,7 @@ ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
 	      [taddr] "r"((ulong)trap), [addr] "r"(mepc)
 	    : "memory");
 
+done:
 	switch (trap->cause) {
 	case CAUSE_LOAD_ACCESS:
 		trap->cause = CAUSE_FETCH_ACCESS;
@@ -167,3 +210,184 @@ ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
 
 	return insn;
 }
+
+#define UNPRIV_KEY(size, flags)		((size) << 2 | (flags))
+
+/**
+ * Single access with MSTATUS_MPRV set, MTVEC must already point to the
+ * expected trap handler. a3 and a4 are used as in the functions above.
+ */
+#define UNPRIV_BATCH_LOAD(type, insn)                                         \
+	asm volatile(                                                         \
+		"add %[tinfo], %[taddr], zero\n"                              \
+		"csrrs %[mstatus], " STR(CSR_MSTATUS) ", %[mprv]\n"           \
+		".option push\n"                                              \
+		".option norvc\n"                                             \
+		#insn " %[val], %[addr]\n"                                    \
+		".option pop\n"                                               \
+		"csrw " STR(CSR_MSTATUS) ", %[mstatus]"                       \
+	    : [mstatus] "+&r"(mstatus), [tinfo] "+&r"(tinfo),                 \
+	      [val] "+&r"(val)                                                \
+	    : [addr] "m"(*(const type *)acc->addr), [mprv] "r"(MSTATUS_MPRV), \
+	      [taddr] "r"((ulong)trap)                                        \
+	    : "a4", "memory")
+
+#define UNPRIV_BATCH_STORE(type, insn)                                        \
+	asm volatile(                                                         \
+		"add %[tinfo], %[taddr], zero\n"                              \
+		"csrrs %[mstatus], " STR(CSR_MSTATUS) ", %[mprv]\n"           \
+		".option push\n"                                              \
+		".option norvc\n"                                             \
+		#insn " %[val], %[addr]\n"                                    \
+		".option pop\n"                                               \
+		"csrw " STR(CSR_MSTATUS) ", %[mstatus]"                       \
+	    : [mstatus] "+&r"(mstatus), [tinfo] "+&r"(tinfo)                  \
+	    : [addr] "m"(*(type *)acc->addr), [mprv] "r"(MSTATUS_MPRV),       \
+	      [val] "r"(acc->val), [taddr] "r"((ulong)trap)                   \
+	    : "a4", "memory")
+
+static void unpriv_batch_mprv(struct sbi_unpriv_access *acc,
+			      struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3");
+	register ulong mstatus = 0;
+	ulong val = 0;
+
+	switch (UNPRIV_KEY(acc->size, acc->flags)) {
+	case UNPRIV_KEY(1, 0):
+		UNPRIV_BATCH_LOAD(u8, lbu);
+		break;
+	case UNPRIV_KEY(1, SBI_UNPRIV_SIGNED):
+		UNPRIV_BATCH_LOAD(s8, lb);
+		break;
+	case UNPRIV_KEY(2, 0):
+		UNPRIV_BATCH_LOAD(u16, lhu);
+		break;
+	case UNPRIV_KEY(2, SBI_UNPRIV_SIGNED):
+		UNPRIV_BATCH_LOAD(s16, lh);
+		break;
+	case UNPRIV_KEY(4, SBI_UNPRIV_SIGNED):
+		UNPRIV_BATCH_LOAD(s32, lw);
+		break;
+#if __riscv_xlen == 64
+	case UNPRIV_KEY(4, 0):
+		UNPRIV_BATCH_LOAD(u32, lwu);
+		break;
+	case UNPRIV_KEY(8, 0):
+	case UNPRIV_KEY(8, SBI_UNPRIV_SIGNED):
+		UNPRIV_BATCH_LOAD(u64, ld);
+		break;
+	case UNPRIV_KEY(8, SBI_UNPRIV_STORE):
+		UNPRIV_BATCH_STORE(u64, sd);
+		break;
+#else
+	case UNPRIV_KEY(4, 0):
+		UNPRIV_BATCH_LOAD(u32, lw);
+		break;
+#endif
+	case UNPRIV_KEY(1, SBI_UNPRIV_STORE):
+		UNPRIV_BATCH_STORE(u8, sb);
+		break;
+	case UNPRIV_KEY(2, SBI_UNPRIV_STORE):
+		UNPRIV_BATCH_STORE(u16, sh);
+		break;
+	case UNPRIV_KEY(4, SBI_UNPRIV_STORE):
+		UNPRIV_BATCH_STORE(u32, sw);
+		break;
+	default:
+		trap->cause = CAUSE_ILLEGAL_INSTRUCTION;
+		return;
+	}
+
+	/* val stays zero if the access faults */
+	if (!(acc->flags & SBI_UNPRIV_STORE))
+		acc->val = val;
+}
+
+static bool unpriv_batch_ptw(struct sbi_unpriv_access *acc,
+			     struct sbi_trap_info *trap)
+{
+	bool store = acc->flags & SBI_UNPRIV_STORE;
+	ulong paddr;
+
+	if (!sbi_unpriv_ptw_translate(acc->addr, acc->size,
+				      store ? SBI_UNPRIV_PTW_WRITE :
+					      SBI_UNPRIV_PTW_READ,
+				      &paddr, trap))
+		return false;
+	if (trap->cause)
+		return true;
+
+	switch (UNPRIV_KEY(acc->size, acc->flags)) {
+	case UNPRIV_KEY(1, 0):
+		acc->val = *(const volatile u8 *)paddr;
+		break;
+	case UNPRIV_KEY(1, SBI_UNPRIV_SIGNED):
+		acc->val = *(const volatile s8 *)paddr;
+		break;
+	case UNPRIV_KEY(2, 0):
+		acc->val = *(const volatile u16 *)paddr;
+		break;
+	case UNPRIV_KEY(2, SBI_UNPRIV_SIGNED):
+		acc->val = *(const volatile s16 *)paddr;
+		break;
+	case UNPRIV_KEY(4, 0):
+		acc->val = *(const volatile u32 *)paddr;
+		break;
+	case UNPRIV_KEY(4, SBI_UNPRIV_SIGNED):
+		acc->val = *(const volatile s32 *)paddr;
+		break;
+	case UNPRIV_KEY(1, SBI_UNPRIV_STORE):
+		*(volatile u8 *)paddr = acc->val;
+		break;
+	case UNPRIV_KEY(2, SBI_UNPRIV_STORE):
+		*(volatile u16 *)paddr = acc->val;
+		break;
+	case UNPRIV_KEY(4, SBI_UNPRIV_STORE):
+		*(volatile u32 *)paddr = acc->val;
+		break;
+#if __riscv_xlen == 64
+	case UNPRIV_KEY(8, 0):
+	case UNPRIV_KEY(8, SBI_UNPRIV_SIGNED):
+		acc->val = *(const volatile u64 *)paddr;
+		break;
+	case UNPRIV_KEY(8, SBI_UNPRIV_STORE):
+		*(volatile u64 *)paddr = acc->val;
+		break;
+#endif
+	default:
+		trap->cause = CAUSE_ILLEGAL_INSTRUCTION;
+		break;
+	}
+
+	return true;
+}
+
+int sbi_unpriv_batch(struct sbi_unpriv_access *acc, int count,
+		     struct sbi_trap_info *trap)
+{
+	ulong mtvec = 0;
+	int i;
+
+	trap->cause = 0;
+	for (i = 0; i < count; i++, acc++) {
+		if (unpriv_batch_ptw(acc, trap)) {
+			if (trap->cause)
+				break;
+			continue;
+		}
+
+		/* Install the expected trap handler for the rest */
+		if (!mtvec)
+			mtvec = csr_swap(CSR_MTVEC,
+					 (ulong)sbi_hart_expected_trap);
+		unpriv_batch_mprv(acc, trap);
+		if (trap->cause)
+			break;
+	}
+
+	if (mtvec)
+		csr_write(CSR_MTVEC, mtvec);
+
+	return i;
+}
@@ -0,0 +1,378 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_heap.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_unpriv_ptw.h>
+
+#if __riscv_xlen == 64
+
+#define PTW_TLB_ENTRIES		CONFIG_SBI_UNPRIV_PTW_TLB_ENTRIES
+
+#if PTW_TLB_ENTRIES & (PTW_TLB_ENTRIES - 1)
+#error "CONFIG_SBI_UNPRIV_PTW_TLB_ENTRIES must be a power of two"
+#endif
+
+#define PTE_V			(1UL << 0)
+#define PTE_R			(1UL << 1)
+#define PTE_W			(1UL << 2)
+#define PTE_X			(1UL << 3)
+#define PTE_U			(1UL << 4)
+#define PTE_A			(1UL << 6)
+#define PTE_D			(1UL << 7)
+#define PTE_PPN_SHIFT		10
+#define PTE_PPN_MASK		0x00000fffffffffffUL
+/* N, PBMT and reserved bits, all of them make the walker back off */
+#define PTE_HIGH_MASK		0xffc0000000000000UL
+
+#define PTW_VPN_BITS		9
+#define PTW_MAX_LEVELS		5
+
+enum ptw_result {
+	PTW_OK,
+	PTW_FAULT,
+	PTW_FALLBACK,
+};
+
+struct ptw_tlb_entry {
+	/* Translation context the entry was filled in */
+	ulong satp;
+	const struct sbi_domain *dom;
+	ulong vpn;
+	/* Physical page number of the 4KiB page holding vpn */
+	ulong ppn;
+	/* SBI_DOMAIN_READ/WRITE granted for the whole physical page */
+	ulong dom_access;
+	/* PTEs on the path from the root, the last one being the leaf */
+	u32 levels;
+	bool valid;
+	ulong pte_addr[PTW_MAX_LEVELS];
+	ulong pte[PTW_MAX_LEVELS];
+};
+
+struct unpriv_ptw {
+	bool enabled;
+	/* Pointer masking may be active, see Smnpm */
+	bool has_pm;
+	/* satp seen by the last translation */
+	ulong last_satp;
+	/* Micro-TLB on the heap, it may not fit into the scratch space */
+	struct ptw_tlb_entry *tlb;
+};
+
+static unsigned long ptw_offset;
+
+static inline struct unpriv_ptw *ptw_thishart_ptr(void)
+{
+	return sbi_scratch_thishart_offset_ptr(ptw_offset);
+}
+
+static bool ptw_domain_check(const struct sbi_domain *dom, ulong addr,
+			     ulong size, ulong access)
+{
+	/* MMIO regions fail this check and stay with the MPRV path */
+	return sbi_domain_check_addr_range(dom, addr, size, PRV_S, access);
+}
+
+static bool ptw_domain_usable(const struct sbi_domain *dom)
+{
+	const struct sbi_domain_memregion *reg;
+
+	/*
+	 * M-mode performs the translated accesses itself, which is only
+	 * safe if no region is locked against it, see Smepmp as well.
+	 */
+	sbi_domain_for_each_memregion(dom, reg) {
+		if (reg->flags & SBI_DOMAIN_MEMREGION_ENF_PERMISSIONS)
+			return false;
+	}
+
+	return true;
+}
+
+static enum ptw_result ptw_walk(struct ptw_tlb_entry *e, ulong vaddr)
+{
+	ulong mode = (e->satp & SATP64_MODE) >> 60;
+	ulong table = (e->satp & SATP64_PPN) << PAGE_SHIFT;
+	ulong pte, ppn, vpn;
+	int levels, i, l;
+
+	switch (mode) {
+	case SATP_MODE_SV39:
+		levels = 3;
+		break;
+	case SATP_MODE_SV48:
+		levels = 4;
+		break;
+	case SATP_MODE_SV57:
+		levels = 5;
+		break;
+	default:
+		return PTW_FALLBACK;
+	}
+
+	/* Bits above the VA width must match its top bit */
+	i = PAGE_SHIFT + levels * PTW_VPN_BITS;
+	if (((long)vaddr << (64 - i)) >> (64 - i) != (long)vaddr)
+		return PTW_FAULT;
+
+	for (l = 0; l < levels; l++) {
+		i = levels - 1 - l;
+		vpn = (vaddr >> (PAGE_SHIFT + i * PTW_VPN_BITS)) &
+		      ((1UL << PTW_VPN_BITS) - 1);
+		e->pte_addr[l] = table + vpn * sizeof(ulong);
+
+		/* Implicit page table reads are S-mode accesses */
+		if (!ptw_domain_check(e->dom, e->pte_addr[l], sizeof(ulong),
+				      SBI_DOMAIN_READ))
+			return PTW_FALLBACK;
+
+		pte = e->pte[l] = *(volatile ulong *)e->pte_addr[l];
+		if (!(pte & PTE_V) || ((pte & (PTE_R | PTE_W)) == PTE_W))
+			return PTW_FAULT;
+		if (pte & PTE_HIGH_MASK)
+			return PTW_FALLBACK;
+
+		ppn = (pte >> PTE_PPN_SHIFT) & PTE_PPN_MASK;
+		if (pte & (PTE_R | PTE_X)) {
+			/* Misaligned superpage */
+			if (ppn & ((1UL << (i * PTW_VPN_BITS)) - 1))
+				return PTW_FAULT;
+
+			e->levels = l + 1;
+			e->ppn = ppn | (e->vpn & ((1UL << (i * PTW_VPN_BITS)) - 1));
+			return PTW_OK;
+		}
+
+		/* Reserved for non-leaf PTEs, leave the decision to hardware */
+		if (pte & (PTE_U | PTE_A | PTE_D))
+			return PTW_FALLBACK;
+
+		table = ppn << PAGE_SHIFT;
+	}
+
+	return PTW_FAULT;
+}
+
+static enum ptw_result ptw_check(ulong pte, ulong mpp, ulong mstatus,
+				 ulong access)
+{
+	if (mpp == PRV_U) {
+		if (!(pte & PTE_U))
+			return PTW_FAULT;
+	} else if ((pte & PTE_U) && !(mstatus & MSTATUS_SUM)) {
+		return PTW_FAULT;
+	}
+
+	if (access & SBI_UNPRIV_PTW_WRITE) {
+		if (!(pte & PTE_W))
+			return PTW_FAULT;
+	} else if (!(pte & PTE_R)) {
+		if (!(pte & PTE_X) ||
+		    !((mstatus & MSTATUS_MXR) || (access & SBI_UNPRIV_PTW_MXR)))
+			return PTW_FAULT;
+	}
+
+	/* Hardware either updates A/D (Svadu) or faults (Svade) */
+	if (!(pte & PTE_A) ||
+	    ((access & SBI_UNPRIV_PTW_WRITE) && !(pte & PTE_D)))
+		return PTW_FALLBACK;
+
+	return PTW_OK;
+}
+
+static bool ptw_tlb_hit(struct ptw_tlb_entry *e, ulong satp,
+			const struct sbi_domain *dom, ulong vpn)
+{
+	u32 l;
+
+	if (!e->valid || e->vpn != vpn || e->satp != satp || e->dom != dom)
+		return false;
+
+	/*
+	 * Supervisor sfence.vma does not trap, so compare the whole path
+	 * against memory. This is equivalent to a fresh walk but skips the
+	 * domain checks and decoding.
+	 */
+	for (l = 0; l < e->levels; l++) {
+		if (*(volatile ulong *)e->pte_addr[l] != e->pte[l])
+			return false;
+	}
+
+	return true;
+}
+
+static void ptw_set_fault(ulong vaddr, ulong access,
+			  struct sbi_trap_info *trap)
+{
+	trap->cause = (access & SBI_UNPRIV_PTW_WRITE) ?
+		      CAUSE_STORE_PAGE_FAULT : CAUSE_LOAD_PAGE_FAULT;
+	trap->tval = vaddr;
+	trap->tval2 = 0;
+	trap->tinst = 0;
+	trap->gva = 0;
+}
+
+bool sbi_unpriv_ptw_translate(ulong vaddr, ulong size, ulong access,
+			      ulong *paddr, struct sbi_trap_info *trap)
+{
+	const struct sbi_domain *dom;
+	struct ptw_tlb_entry *e;
+	struct unpriv_ptw *ptw;
+	ulong mstatus, mpp, satp, vpn, dom_access;
+	enum ptw_result rc;
+
+	if (!ptw_offset)
+		return false;
+
+	ptw = ptw_thishart_ptr();
+	if (!ptw->enabled)
+		return false;
+
+	/* Misaligned accesses must trap, just like on the MPRV path */
+	if (vaddr & (size - 1))
+		return false;
+
+	mstatus = csr_read(CSR_MSTATUS);
+	mpp = (mstatus & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+	if (mpp == PRV_M || (mstatus & MSTATUS_MPV))
+		return false;
+
+	if (ptw->has_pm) {
+		if (csr_read(CSR_MENVCFG) & ENVCFG_PMM)
+			return false;
+		if (mpp == PRV_U && (csr_read(CSR_SENVCFG) & ENVCFG_PMM))
+			return false;
+	}
+
+	dom_access = (access & SBI_UNPRIV_PTW_WRITE) ?
+		     SBI_DOMAIN_WRITE : SBI_DOMAIN_READ;
+	dom = sbi_domain_thishart_ptr();
+	satp = csr_read(CSR_SATP);
+
+	if (!(satp & SATP64_MODE)) {
+		if (!ptw_domain_usable(dom) ||
+		    !ptw_domain_check(dom, vaddr, size, dom_access))
+			return false;
+		*paddr = vaddr;
+		return true;
+	}
+
+	if (satp != ptw->last_satp) {
+		sbi_unpriv_ptw_flush();
+		ptw->last_satp = satp;
+	}
+
+	vpn = vaddr >> PAGE_SHIFT;
+	e = &ptw->tlb[vpn & (PTW_TLB_ENTRIES - 1)];
+	if (!ptw_tlb_hit(e, satp, dom, vpn)) {
+		e->valid = false;
+		if (!ptw_domain_usable(dom))
+			return false;
+
+		e->satp = satp;
+		e->dom = dom;
+		e->vpn = vpn;
+
+		rc = ptw_walk(e, vaddr);
+		if (rc == PTW_FAULT) {
+			ptw_set_fault(vaddr, access, trap);
+			return true;
+		}
+		if (rc == PTW_FALLBACK)
+			return false;
+
+		e->dom_access = 0;
+		if (ptw_domain_check(dom, e->ppn << PAGE_SHIFT, PAGE_SIZE,
+				     SBI_DOMAIN_READ))
+			e->dom_access |= SBI_DOMAIN_READ;
+		if (ptw_domain_check(dom, e->ppn << PAGE_SHIFT, PAGE_SIZE,
+				     SBI_DOMAIN_WRITE))
+			e->dom_access |= SBI_DOMAIN_WRITE;
+		e->valid = true;
+	}
+
+	rc = ptw_check(e->pte[e->levels - 1], mpp, mstatus, access);
+	if (rc == PTW_FAULT) {
+		ptw_set_fault(vaddr, access, trap);
+		return true;
+	}
+	if (rc == PTW_FALLBACK || !(e->dom_access & dom_access))
+		return false;
+
+	*paddr = (e->ppn << PAGE_SHIFT) | (vaddr & (PAGE_SIZE - 1));
+	return true;
+}
+
+void sbi_unpriv_ptw_flush(void)
+{
+	struct unpriv_ptw *ptw;
+	int i;
+
+	if (!ptw_offset)
+		return;
+
+	ptw = ptw_thishart_ptr();
+	if (!ptw->tlb)
+		return;
+
+	for (i = 0; i < PTW_TLB_ENTRIES; i++)
+		ptw->tlb[i].valid = false;
+}
+
+/*
+ * Only S-mode capable HARTs have satp and with Smepmp, M-mode has no
+ * direct access to S/U-mode memory.
+ */
+static bool ptw_hart_capable(struct sbi_scratch *scratch)
+{
+	return misa_extension('S') &&
+	       !sbi_hart_has_extension(scratch, SBI_HART_EXT_SMEPMP);
+}
+
+void sbi_unpriv_ptw_enable(bool enable)
+{
+	if (ptw_offset)
+		ptw_thishart_ptr()->enabled = enable &&
+			ptw_hart_capable(sbi_scratch_thishart_ptr());
+}
+
+int sbi_unpriv_ptw_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct unpriv_ptw *ptw;
+
+	if (cold_boot) {
+		ptw_offset = sbi_scratch_alloc_offset(sizeof(struct unpriv_ptw));
+		if (!ptw_offset)
+			return SBI_ENOMEM;
+	} else if (!ptw_offset) {
+		return SBI_ENOMEM;
+	}
+
+	ptw = sbi_scratch_offset_ptr(scratch, ptw_offset);
+	if (!ptw->tlb) {
+		ptw->tlb = sbi_zalloc(PTW_TLB_ENTRIES * sizeof(*ptw->tlb));
+		if (!ptw->tlb)
+			return SBI_ENOMEM;
+	}
+
+	ptw->has_pm = sbi_hart_has_extension(scratch, SBI_HART_EXT_SMNPM);
+	ptw->enabled = ptw_hart_capable(scratch);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __HOST_EMU_H__
+#define __HOST_EMU_H__
+
+#include <sbi/sbi_types.h>
+
+struct sbi_trap_info;
+struct sbi_trap_regs;
+
+/*
+ * Host-side build of the ISA emulation engine ("make host-emu")
+ *
+ * The emulators are compiled for the build host against the mocks
+ * declared here: a flat unprivileged memory with injectable faults, a
+ * CSR file and a FP register file. The shim headers in include/sbi/
+ * route the RISC-V specific inline assembly of the real headers to them.
+ */
+
+/** Guest physical window of the mock unprivileged memory */
+#define HOST_EMU_MEM_BASE	0x80000000UL
+#define HOST_EMU_MEM_SIZE	0x4000UL
+
+extern u8 host_emu_mem[HOST_EMU_MEM_SIZE];
+
+/**
+ * Make the next unprivileged access that overlaps addr fail
+ *
+ * @param cause load cause, turned into the matching store/AMO cause
+ * for writes, or zero to disarm
+ */
+void host_emu_fault_inject(ulong addr, ulong cause);
+
+/** Mock CSR file, FFLAGS and FRM alias FCSR like on hardware */
+ulong host_emu_csr_read(int csr);
+void host_emu_csr_write(int csr, ulong val);
+ulong host_emu_csr_swap(int csr, ulong val);
+
+/** Mock FP register file, NaN-boxed like on an RV64 HART with D */
+extern u64 host_emu_fregs[32];
+
+/** Last trap redirected to the supervisor, cause is zero if none */
+extern struct sbi_trap_info host_emu_redirect;
+
+/** Reset registers, CSRs, memory faults and the redirect record */
+void host_emu_reset(struct sbi_trap_regs *regs);
+
+/** LR/SC on the mock memory, see sbi/sbi_illegal_atomic.h */
+s32 host_emu_lr_s32(const s32 *addr, struct sbi_trap_info *trap);
+s32 host_emu_sc_s32(s32 *addr, s32 val, struct sbi_trap_info *trap);
+s64 host_emu_lr_s64(const s64 *addr, struct sbi_trap_info *trap);
+s64 host_emu_sc_s64(s64 *addr, s64 val, struct sbi_trap_info *trap);
+
+#endif
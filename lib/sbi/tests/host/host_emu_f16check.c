@@ -0,0 +1,432 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Exhaustive verifier of the half-precision conversions
+ *
+ *   sbi_host_f16check [threads] [f32-stride]
+ *
+ * Checks convert_f32_to_f16() for all 2^32 inputs, or every stride-th
+ * one, in all five rounding modes, convert_f64_to_f16() for stratified
+ * f64 inputs around the binary16 range, and the widening conversions
+ * for all 2^16 inputs. Results and fflags are compared against a
+ * bit-exact integer implementation of IEEE 754 rounding with tininess
+ * detected after rounding, as on RISC-V.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* The conversion helpers are static, so pull in the emulator itself */
+#include "../../sbi_insn_emu_fp.c"
+
+#define RM_COUNT		5
+#define MAX_REPORTS		16
+
+#define F32_CHUNK_BITS		16
+#define F32_CHUNKS		(1ULL << (32 - F32_CHUNK_BITS))
+
+/* Biased f64 exponents that do not simply saturate, plus some that do */
+#define F64_EXP_FIRST		(1023 - 30)
+#define F64_EXP_LAST		(1023 + 17)
+static const int f64_extra_exps[] = { 0, 1, 500, 1000, 1050, 1500, 2046, 2047 };
+
+/* Patterns of the f64 mantissa bits below the top 16 */
+static const u64 f64_low_patterns[] = {
+	0, 1, 0x800000000ULL, 0xfffffffffULL, 0x7ffffffffULL, 0x123456789ULL,
+};
+
+enum check_op {
+	CHECK_F32_TO_F16,
+	CHECK_F64_TO_F16,
+	CHECK_F16_TO_F32,
+	CHECK_F16_TO_F64,
+	CHECK_OP_COUNT,
+};
+
+static const char *const check_op_names[CHECK_OP_COUNT] = {
+	"fcvt.h.s", "fcvt.h.d", "fcvt.s.h", "fcvt.d.h",
+};
+
+static const char *const rm_names[RM_COUNT] = {
+	"rne", "rtz", "rdn", "rup", "rmm",
+};
+
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+static u64 mismatches[CHECK_OP_COUNT][RM_COUNT];
+static unsigned int reports;
+
+static u64 f32_stride = 1;
+static u64 next_chunk;
+
+/* Bit-exact reference */
+
+/*
+ * Round sig to a multiple of 2^shift in the given rounding mode, sticky
+ * stands for nonzero bits below sig
+ */
+static u64 ref_round_shift(u64 sig, int shift, bool sticky, int sign, int rm,
+			   bool *inexact)
+{
+	bool above, tie, inc;
+	u64 q, rem, half;
+
+	if (shift > 64) {
+		q = 0;
+		above = tie = false;
+	} else if (shift == 64) {
+		q = 0;
+		rem = sig;
+		half = 1ULL << 63;
+		above = rem > half || (rem == half && sticky);
+		tie = rem == half && !sticky;
+	} else {
+		q = sig >> shift;
+		rem = sig & ((1ULL << shift) - 1);
+		half = 1ULL << (shift - 1);
+		above = rem > half || (rem == half && sticky);
+		tie = rem == half && !sticky;
+	}
+	*inexact = (shift >= 64 ? sig : rem) || sticky;
+
+	switch (rm) {
+	case RM_FIELD_RNE:
+		inc = above || (tie && (q & 1));
+		break;
+	case RM_FIELD_RDN:
+		inc = sign && *inexact;
+		break;
+	case RM_FIELD_RUP:
+		inc = !sign && *inexact;
+		break;
+	case RM_FIELD_RMM:
+		inc = above || tie;
+		break;
+	default:
+		inc = false;
+		break;
+	}
+
+	return q + inc;
+}
+
+/* Round sig * 2^(exp - 63), sig having bit 63 set, to binary16 */
+static u16 ref_round_f16(int sign, int exp, u64 sig, int rm, u32 *fflags)
+{
+	bool inexact, dummy;
+	int shift;
+	u64 q, enc;
+
+	/* 11 significant bits when normal, fewer when subnormal */
+	shift = exp >= -14 ? 53 : 53 + (-14 - exp);
+	q = ref_round_shift(sig, shift, false, sign, rm, &inexact);
+
+	/* A carry out of the significand bumps the exponent field */
+	enc = exp >= -14 ? ((u64)(exp + 15) << 10) + q - 1024 : q;
+
+	if (enc >= 0x7c00) {
+		*fflags |= FFLAG_OVERFLOW | FFLAG_INEXACT;
+		if (rm == RM_FIELD_RTZ || (rm == RM_FIELD_RDN && !sign) ||
+		    (rm == RM_FIELD_RUP && sign))
+			enc = 0x7bff;
+		else
+			enc = 0x7c00;
+		return (sign << 15) | enc;
+	}
+
+	if (inexact) {
+		*fflags |= FFLAG_INEXACT;
+		/* Tiny if below 2^-14 after rounding to 11 bits */
+		if (exp < -15 ||
+		    (exp == -15 &&
+		     ref_round_shift(sig, 53, false, sign, rm, &dummy) < 2048))
+			*fflags |= FFLAG_UNDERFLOW;
+	}
+
+	return (sign << 15) | enc;
+}
+
+static u16 ref_f32_to_f16(u32 val, int rm, u32 *fflags)
+{
+	int sign = val >> 31, e = (val >> 23) & 0xff, lz;
+	u32 mant = val & 0x007fffff;
+
+	if (e == 0xff) {
+		if (!mant)
+			return (sign << 15) | 0x7c00;
+		if (!(mant & 0x00400000))
+			*fflags |= FFLAG_INVALID_OPERATION;
+		return 0x7e00;
+	}
+	if (!e && !mant)
+		return sign << 15;
+
+	if (!e) {
+		lz = __builtin_clzll(mant);
+		return ref_round_f16(sign, -86 - lz, (u64)mant << lz, rm,
+				     fflags);
+	}
+
+	return ref_round_f16(sign, e - 127, ((u64)mant | 0x00800000) << 40, rm,
+			     fflags);
+}
+
+static u16 ref_f64_to_f16(u64 val, int rm, u32 *fflags)
+{
+	int sign = val >> 63, e = (val >> 52) & 0x7ff, lz;
+	u64 mant = val & 0x000fffffffffffffULL;
+
+	if (e == 0x7ff) {
+		if (!mant)
+			return (sign << 15) | 0x7c00;
+		if (!(mant & 0x0008000000000000ULL))
+			*fflags |= FFLAG_INVALID_OPERATION;
+		return 0x7e00;
+	}
+	if (!e && !mant)
+		return sign << 15;
+
+	if (!e) {
+		lz = __builtin_clzll(mant);
+		return ref_round_f16(sign, -1011 - lz, mant << lz, rm, fflags);
+	}
+
+	return ref_round_f16(sign, e - 1023,
+			     (mant | 0x0010000000000000ULL) << 11, rm, fflags);
+}
+
+/*
+ * Decode binary16 into sign, exponent and significand with bit 10 set,
+ * returns false for zeros, infinities and NaNs
+ */
+static bool ref_decode_f16(u16 val, int *exp, u32 *sig)
+{
+	int e = (val >> 10) & 0x1f;
+	u32 mant = val & 0x3ff;
+
+	if (e == 0x1f || (!e && !mant))
+		return false;
+
+	if (e) {
+		*exp = e - 15;
+		*sig = mant | 0x400;
+	} else {
+		/* Subnormals are normal in the wider formats */
+		*exp = -14;
+		*sig = mant;
+		while (!(*sig & 0x400)) {
+			*sig <<= 1;
+			(*exp)--;
+		}
+	}
+
+	return true;
+}
+
+static u32 ref_f16_to_f32(u16 val, u32 *fflags)
+{
+	u32 sign = (u32)(val >> 15) << 31, sig;
+	int exp;
+
+	if (ref_decode_f16(val, &exp, &sig))
+		return sign | (u32)(exp + 127) << 23 | (sig & 0x3ff) << 13;
+	if ((val & 0x7fff) == 0)
+		return sign;
+	if ((val & 0x7fff) == 0x7c00)
+		return sign | 0x7f800000;
+	if (!(val & 0x0200))
+		*fflags |= FFLAG_INVALID_OPERATION;
+	return 0x7fc00000;
+}
+
+static u64 ref_f16_to_f64(u16 val, u32 *fflags)
+{
+	u64 sign = (u64)(val >> 15) << 63;
+	u32 sig;
+	int exp;
+
+	if (ref_decode_f16(val, &exp, &sig))
+		return sign | (u64)(exp + 1023) << 52 | (u64)(sig & 0x3ff) << 42;
+	if ((val & 0x7fff) == 0)
+		return sign;
+	if ((val & 0x7fff) == 0x7c00)
+		return sign | 0x7ff0000000000000ULL;
+	if (!(val & 0x0200))
+		*fflags |= FFLAG_INVALID_OPERATION;
+	return 0x7ff8000000000000ULL;
+}
+
+/* Checking */
+
+static void mismatch(enum check_op op, int rm, u64 in, u64 emu,
+		     u32 emu_flags, u64 ref, u32 ref_flags)
+{
+	pthread_mutex_lock(&report_lock);
+	mismatches[op][rm]++;
+	if (reports++ < MAX_REPORTS)
+		printf("MISMATCH %s %s in=0x%llx emu=0x%llx/0x%02x "
+		       "ref=0x%llx/0x%02x\n",
+		       check_op_names[op], rm_names[rm],
+		       (unsigned long long)in, (unsigned long long)emu,
+		       emu_flags, (unsigned long long)ref, ref_flags);
+	pthread_mutex_unlock(&report_lock);
+}
+
+static void check_f32(u32 val)
+{
+	u32 emu_flags, ref_flags;
+	u16 emu, ref;
+	int rm;
+
+	for (rm = 0; rm < RM_COUNT; rm++) {
+		emu_flags = ref_flags = 0;
+		emu = convert_f32_to_f16(val, &emu_flags, rm);
+		ref = ref_f32_to_f16(val, rm, &ref_flags);
+		if (emu != ref || emu_flags != ref_flags)
+			mismatch(CHECK_F32_TO_F16, rm, val, emu, emu_flags,
+				 ref, ref_flags);
+	}
+}
+
+static void check_f64(u64 val)
+{
+	u32 emu_flags, ref_flags;
+	u16 emu, ref;
+	int rm;
+
+	for (rm = 0; rm < RM_COUNT; rm++) {
+		emu_flags = ref_flags = 0;
+		emu = convert_f64_to_f16(val, &emu_flags, rm);
+		ref = ref_f64_to_f16(val, rm, &ref_flags);
+		if (emu != ref || emu_flags != ref_flags)
+			mismatch(CHECK_F64_TO_F16, rm, val, emu, emu_flags,
+				 ref, ref_flags);
+	}
+}
+
+static void check_f64_exponent(int exp)
+{
+	u64 top, val;
+	int sign, i;
+
+	for (sign = 0; sign < 2; sign++) {
+		for (top = 0; top < 0x10000; top++) {
+			for (i = 0; i < array_size(f64_low_patterns); i++) {
+				val = (u64)sign << 63 | (u64)exp << 52 |
+				      top << 36 | f64_low_patterns[i];
+				check_f64(val);
+			}
+		}
+	}
+}
+
+static void check_widening(void)
+{
+	u32 emu_flags, ref_flags, val;
+	u64 emu, ref;
+
+	for (val = 0; val < 0x10000; val++) {
+		emu_flags = ref_flags = 0;
+		emu = convert_f16_to_f32(val, &emu_flags);
+		ref = ref_f16_to_f32(val, &ref_flags);
+		if (emu != ref || emu_flags != ref_flags)
+			mismatch(CHECK_F16_TO_F32, 0, val, emu, emu_flags,
+				 ref, ref_flags);
+
+		emu_flags = ref_flags = 0;
+		emu = convert_f16_to_f64(val, &emu_flags);
+		ref = ref_f16_to_f64(val, &ref_flags);
+		if (emu != ref || emu_flags != ref_flags)
+			mismatch(CHECK_F16_TO_F64, 0, val, emu, emu_flags,
+				 ref, ref_flags);
+	}
+}
+
+/*
+ * Work items are handed out through a shared counter: first the f64
+ * exponents, then the f32 input space in chunks of 2^16 values
+ */
+#define F64_ITEMS	(F64_EXP_LAST - F64_EXP_FIRST + 1 + \
+			 array_size(f64_extra_exps))
+
+static void *worker(void *arg)
+{
+	u64 item, base, i;
+
+	while ((item = __atomic_fetch_add(&next_chunk, 1, __ATOMIC_RELAXED)) <
+	       F64_ITEMS + F32_CHUNKS) {
+		if (item < F64_EXP_LAST - F64_EXP_FIRST + 1) {
+			check_f64_exponent(F64_EXP_FIRST + item);
+			continue;
+		}
+		if (item < F64_ITEMS) {
+			check_f64_exponent(
+				f64_extra_exps[item - (F64_EXP_LAST -
+						       F64_EXP_FIRST + 1)]);
+			continue;
+		}
+
+		base = (item - F64_ITEMS) << F32_CHUNK_BITS;
+		/* With a stride, check the multiples of it in this chunk */
+		i = (base + f32_stride - 1) / f32_stride * f32_stride;
+		for (; i < base + (1ULL << F32_CHUNK_BITS); i += f32_stride)
+			check_f32(i);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	long threads = argc > 1 ? strtol(argv[1], NULL, 0) : 0;
+	pthread_t *tids;
+	u64 total = 0;
+	int op, rm;
+	long i;
+
+	if (threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads <= 0)
+		threads = 1;
+	if (argc > 2)
+		f32_stride = strtoull(argv[2], NULL, 0);
+	if (!f32_stride)
+		f32_stride = 1;
+
+	printf("f16check: %ld threads, f32 stride %llu\n", threads,
+	       (unsigned long long)f32_stride);
+
+	check_widening();
+
+	tids = calloc(threads, sizeof(*tids));
+	if (!tids)
+		return 2;
+	for (i = 0; i < threads; i++)
+		if (pthread_create(&tids[i], NULL, worker, NULL))
+			return 2;
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	free(tids);
+
+	for (op = 0; op < CHECK_OP_COUNT; op++) {
+		for (rm = 0; rm < RM_COUNT; rm++) {
+			if (!mismatches[op][rm])
+				continue;
+			printf("%s %s: %llu mismatches\n", check_op_names[op],
+			       rm_names[rm],
+			       (unsigned long long)mismatches[op][rm]);
+			total += mismatches[op][rm];
+		}
+	}
+	printf("f16check: %llu mismatches\n", (unsigned long long)total);
+
+	return total ? 1 : 0;
+}
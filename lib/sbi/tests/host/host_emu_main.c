@@ -0,0 +1,458 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Driver of the host build of the ISA emulation engine
+ *
+ *   sbi_host_emu fuzz [iterations] [seed]
+ *	Differential fuzzer, runs random instructions of the reference
+ *	table through the emulators and compares the architectural state.
+ *
+ *   sbi_host_emu bench [iterations]
+ *	Reports the time per emulated instruction for each decoder.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_trap_ldst.h>
+
+#include <host_emu_ref.h>
+
+#define FUZZ_DEFAULT_ITERATIONS		200000
+#define FUZZ_MAX_MISMATCHES		20
+#define BENCH_DEFAULT_ITERATIONS	200000
+
+/* Instructions live at the start of the window, data after them */
+#define INSN_ADDR	(HOST_EMU_MEM_BASE + 0x100)
+#define DATA_OFFSET	0x1000
+#define DATA_SIZE	(HOST_EMU_MEM_SIZE - DATA_OFFSET - 0x100)
+
+static struct sbi_trap_context ctx;
+static struct ref_state ref;
+/* Operands of the last instruction, for mismatch reports */
+static ulong orig_x[32];
+static u64 orig_f[32];
+static ulong orig_fcsr;
+static u64 rng_state;
+
+static u64 rnd(void)
+{
+	/* xorshift64* */
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static ulong rnd_below(ulong n)
+{
+	return rnd() % n;
+}
+
+static ulong *regs_x(struct sbi_trap_regs *regs)
+{
+	/* zero, ra, sp, ... t6 are the first members of sbi_trap_regs */
+	return (ulong *)regs;
+}
+
+static ulong rnd_xval(void)
+{
+	static const ulong interesting[] = {
+		0, 1, 2, -1UL, 0x7fffffffffffffffUL, 0x8000000000000000UL,
+		0x7fffffffUL, 0x80000000UL, 0xffffffffUL, 0xffffffff80000000UL,
+		0x8000UL, 0xffffUL, 0x80UL, 0xffUL, 63, 64, 31, 32,
+	};
+
+	switch (rnd_below(4)) {
+	case 0:
+		return interesting[rnd_below(array_size(interesting))];
+	case 1:
+		return rnd_below(128) - 64;
+	default:
+		return rnd();
+	}
+}
+
+/* Random IEEE 754 value biased towards special cases */
+static u64 rnd_ieee(int exp_bits, int mant_bits)
+{
+	u64 exp_max = (1ULL << exp_bits) - 1, bias = exp_max >> 1;
+	u64 mant_max = (1ULL << mant_bits) - 1, exp, mant;
+
+	switch (rnd_below(6)) {
+	case 0:
+		exp = 0;
+		break;
+	case 1:
+		exp = exp_max;
+		break;
+	case 2:
+		/* Around the limits of the integer conversions */
+		exp = bias + 20 + rnd_below(60);
+		if (exp >= exp_max)
+			exp = exp_max - 1;
+		break;
+	case 3:
+		exp = rnd() & exp_max;
+		break;
+	default:
+		/* Small values with fractional parts */
+		exp = bias - 2 + rnd_below(mant_bits < 16 ? 12 : 16);
+		break;
+	}
+
+	switch (rnd_below(6)) {
+	case 0:
+		mant = 0;
+		break;
+	case 1:
+		mant = 1;
+		break;
+	case 2:
+		mant = 1ULL << (mant_bits - 1);
+		break;
+	case 3:
+		mant = mant_max;
+		break;
+	case 4:
+		/* Few significant bits, often exactly integral */
+		mant = (rnd() & 0xf) << (mant_bits - 4);
+		break;
+	default:
+		mant = rnd() & mant_max;
+		break;
+	}
+
+	return (rnd() & 1) << (exp_bits + mant_bits) | exp << mant_bits | mant;
+}
+
+static u64 rnd_fval(void)
+{
+	/* Mostly properly NaN-boxed values */
+	switch (rnd_below(8)) {
+	case 0:
+		return rnd();
+	case 1:
+	case 2:
+		return 0xffffffffffff0000ULL | rnd_ieee(5, 10);
+	case 3:
+	case 4:
+		return 0xffffffff00000000ULL | rnd_ieee(8, 23);
+	default:
+		return rnd_ieee(11, 52);
+	}
+}
+
+static u32 rnd_insn(const struct ref_insn *r)
+{
+	u32 insn = r->match | ((u32)rnd() & ~r->mask);
+
+	if ((r->match & 3) != 3)
+		insn &= 0xffff;
+
+	/* A static RMM the host cannot reproduce becomes dynamic */
+	if ((r->flags & REF_F_NO_RMM) && ((insn >> 12) & 7) == 4)
+		insn |= 7 << 12;
+
+	return insn;
+}
+
+/* Point the base register of a memory instruction into the data area */
+static ulong steer_address(const struct ref_insn *r, u32 insn)
+{
+	ulong size = r->size, align, addr;
+	long offset;
+	int base = r->addr(insn, &offset);
+
+	align = size < 8 ? size : 8;
+	addr = HOST_EMU_MEM_BASE + DATA_OFFSET + rnd_below(DATA_SIZE);
+	if (r->flags & REF_F_ALIGNED) {
+		addr &= ~(align - 1);
+	} else if (r->flags & REF_F_MISALIGNED) {
+		addr &= ~(align - 1);
+		addr += 1 + rnd_below(align - 1);
+	}
+
+	/* Now and then, straddle the end of the window */
+	if (!rnd_below(64))
+		addr = HOST_EMU_MEM_BASE + HOST_EMU_MEM_SIZE - 1 -
+		       rnd_below(size);
+
+	if (base)
+		ref.x[base] = addr - offset;
+
+	return ref.x[base] + offset;
+}
+
+static void setup(const struct ref_insn *r, u32 insn, bool faults)
+{
+	ulong addr = 0, span, fcsr;
+	int i;
+
+	host_emu_reset(&ctx.regs);
+
+	ref.x[0] = 0;
+	for (i = 1; i < 32; i++)
+		ref.x[i] = rnd_xval();
+	for (i = 0; i < 32; i++)
+		ref.f[i] = rnd_fval();
+
+	/* Random fflags, a rounding mode the host can reproduce */
+	fcsr = rnd() & 0x1f;
+	fcsr |= rnd_below(r->flags & REF_F_NO_RMM ? 4 : 5) << 5;
+	ref.fcsr = fcsr;
+	ref.pc = INSN_ADDR;
+	ref.fault_addr = ref.fault_cause = 0;
+	ref.trap_cause = ref.trap_tval = 0;
+
+	if (r->flags & REF_F_MEM)
+		addr = steer_address(r, insn);
+
+	if (faults && (r->flags & REF_F_MEM) && !rnd_below(8)) {
+		span = r->size == 64 ? 64 : r->size;
+		if (r->size == 64)
+			addr &= ~63UL;
+		ref.fault_addr = addr + rnd_below(span);
+		ref.fault_cause = rnd() & 1 ? CAUSE_LOAD_ACCESS :
+					      CAUSE_LOAD_PAGE_FAULT;
+		host_emu_fault_inject(ref.fault_addr, ref.fault_cause);
+	}
+
+	memcpy(&ref.mem[INSN_ADDR - HOST_EMU_MEM_BASE], &insn, sizeof(insn));
+	memcpy(host_emu_mem, ref.mem, HOST_EMU_MEM_SIZE);
+
+	memcpy(orig_x, ref.x, sizeof(orig_x));
+	memcpy(orig_f, ref.f, sizeof(orig_f));
+	orig_fcsr = fcsr;
+
+	memcpy(regs_x(&ctx.regs), ref.x, sizeof(ref.x));
+	memcpy(host_emu_fregs, ref.f, sizeof(ref.f));
+	host_emu_csr_write(CSR_FCSR, fcsr);
+	ctx.regs.mepc = INSN_ADDR;
+
+	memset(&ctx.trap, 0, sizeof(ctx.trap));
+	switch (r->path) {
+	case REF_PATH_ILLEGAL:
+		ctx.trap.cause = CAUSE_ILLEGAL_INSTRUCTION;
+		/* Hardware may report the encoding or zero */
+		ctx.trap.tval = rnd_below(4) ? insn : 0;
+		break;
+	case REF_PATH_MISALIGNED_LOAD:
+		ctx.trap.cause = CAUSE_MISALIGNED_LOAD;
+		ctx.trap.tval = addr;
+		break;
+	case REF_PATH_MISALIGNED_STORE:
+		ctx.trap.cause = CAUSE_MISALIGNED_STORE;
+		ctx.trap.tval = addr;
+		break;
+	}
+}
+
+static int run_emulator(const struct ref_insn *r)
+{
+	switch (r->path) {
+	case REF_PATH_MISALIGNED_LOAD:
+		return sbi_misaligned_load_handler(&ctx);
+	case REF_PATH_MISALIGNED_STORE:
+		return sbi_misaligned_store_handler(&ctx);
+	default:
+		return sbi_illegal_insn_handler(&ctx);
+	}
+}
+
+static void report(const struct ref_insn *r, u32 insn, u64 iter)
+{
+	int rs1 = (insn >> 15) & 0x1f, rs2 = (insn >> 20) & 0x1f;
+
+	printf("MISMATCH %s insn=0x%08x iteration %llu\n", r->name, insn,
+	       (unsigned long long)iter);
+	printf("  x[rs1]=0x%016lx x[rs2]=0x%016lx fcsr=0x%02lx\n",
+	       orig_x[rs1], orig_x[rs2], orig_fcsr);
+	printf("  f[rs1]=0x%016llx f[rs2]=0x%016llx\n",
+	       (unsigned long long)orig_f[rs1],
+	       (unsigned long long)orig_f[rs2]);
+}
+
+static bool compare(const struct ref_insn *r, u32 insn, u64 iter, int rc)
+{
+	ulong *x = regs_x(&ctx.regs), fcsr = host_emu_csr_read(CSR_FCSR);
+	bool ok = true;
+	int i;
+
+#define MISMATCH(fmt, ...)						\
+	do {								\
+		if (ok)							\
+			report(r, insn, iter);				\
+		printf("  " fmt "\n", __VA_ARGS__);			\
+		ok = false;						\
+	} while (0)
+
+	if (rc)
+		MISMATCH("emulator returned %d", rc);
+	for (i = 1; i < 32; i++)
+		if (x[i] != ref.x[i])
+			MISMATCH("x%d emu=0x%016lx ref=0x%016lx", i, x[i],
+				 ref.x[i]);
+	for (i = 0; i < 32; i++)
+		if (host_emu_fregs[i] != ref.f[i])
+			MISMATCH("f%d emu=0x%016llx ref=0x%016llx", i,
+				 (unsigned long long)host_emu_fregs[i],
+				 (unsigned long long)ref.f[i]);
+	if (fcsr != ref.fcsr)
+		MISMATCH("fcsr emu=0x%02lx ref=0x%02lx", fcsr, ref.fcsr);
+	if (ctx.regs.mepc != ref.pc)
+		MISMATCH("pc emu=0x%lx ref=0x%lx", ctx.regs.mepc, ref.pc);
+	if (host_emu_redirect.cause != ref.trap_cause ||
+	    (ref.trap_cause && host_emu_redirect.tval != ref.trap_tval))
+		MISMATCH("trap emu=%lu/0x%lx ref=%lu/0x%lx",
+			 host_emu_redirect.cause, host_emu_redirect.tval,
+			 ref.trap_cause, ref.trap_tval);
+	for (i = 0; i < HOST_EMU_MEM_SIZE; i++)
+		if (host_emu_mem[i] != ref.mem[i])
+			MISMATCH("mem[0x%lx] emu=0x%02x ref=0x%02x",
+				 HOST_EMU_MEM_BASE + i, host_emu_mem[i],
+				 ref.mem[i]);
+
+#undef MISMATCH
+
+	return ok;
+}
+
+static int fuzz(u64 iterations, u64 seed)
+{
+	unsigned int mismatches = 0;
+	u64 iter;
+	u32 insn;
+	int i, rc;
+
+	rng_state = seed ? seed : 1;
+	for (i = 0; i < HOST_EMU_MEM_SIZE; i++)
+		ref.mem[i] = rnd();
+
+	for (iter = 0; iter < iterations; iter++) {
+		const struct ref_insn *r = &ref_insns[rnd_below(ref_insn_count)];
+
+		insn = rnd_insn(r);
+		setup(r, insn, true);
+
+		rc = run_emulator(r);
+		r->exec(r, &ref, insn);
+
+		if (!compare(r, insn, iter, rc) &&
+		    ++mismatches >= FUZZ_MAX_MISMATCHES)
+			break;
+
+		/* Carry the memory over so stores accumulate */
+		memcpy(ref.mem, host_emu_mem, HOST_EMU_MEM_SIZE);
+	}
+
+	printf("fuzz: %llu iterations, seed %llu, %u mismatches\n",
+	       (unsigned long long)iter, (unsigned long long)seed,
+	       mismatches);
+
+	return mismatches ? 1 : 0;
+}
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Time per handler call, including restoring the registers */
+static double bench_one(const struct ref_insn *r, u64 iterations,
+			bool baseline)
+{
+	ulong saved[32];
+	u64 start, i;
+
+	memcpy(saved, regs_x(&ctx.regs), sizeof(saved));
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		memcpy(regs_x(&ctx.regs), saved, sizeof(saved));
+		ctx.regs.mepc = INSN_ADDR;
+		if (!baseline)
+			run_emulator(r);
+		__asm__ __volatile__("" ::: "memory");
+	}
+
+	return (double)(now_ns() - start) / iterations;
+}
+
+static int bench(u64 iterations)
+{
+	const char *decoder;
+	unsigned int i, j, count;
+	double overhead, total;
+	u32 insn;
+
+	rng_state = 1;
+	setup(&ref_insns[0], ref_insns[0].match, false);
+	overhead = bench_one(&ref_insns[0], iterations, true);
+
+	printf("%-20s %6s %12s\n", "decoder", "insns", "ns/insn");
+	for (i = 0; i < ref_insn_count; i++) {
+		decoder = ref_insns[i].decoder;
+		/* Report each decoder once, at its first table entry */
+		for (j = 0; j < i; j++)
+			if (!strcmp(ref_insns[j].decoder, decoder))
+				break;
+		if (j < i)
+			continue;
+
+		total = 0;
+		count = 0;
+		for (j = i; j < ref_insn_count; j++) {
+			const struct ref_insn *r = &ref_insns[j];
+
+			if (strcmp(r->decoder, decoder))
+				continue;
+
+			/* An instance that retires without trapping */
+			do {
+				insn = rnd_insn(r);
+				setup(r, insn, false);
+				run_emulator(r);
+			} while (host_emu_redirect.cause);
+			setup(r, insn, false);
+
+			total += bench_one(r, iterations, false) - overhead;
+			count++;
+		}
+
+		printf("%-20s %6u %12.1f\n", decoder, count, total / count);
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *mode = argc > 1 ? argv[1] : "fuzz";
+
+	if (!strcmp(mode, "fuzz"))
+		return fuzz(argc > 2 ? strtoull(argv[2], NULL, 0) :
+				       FUZZ_DEFAULT_ITERATIONS,
+			    argc > 3 ? strtoull(argv[3], NULL, 0) : 1);
+	if (!strcmp(mode, "bench"))
+		return bench(argc > 2 ? strtoull(argv[2], NULL, 0) :
+					BENCH_DEFAULT_ITERATIONS);
+
+	fprintf(stderr, "usage: %s fuzz [iterations] [seed]\n"
+			"       %s bench [iterations]\n", argv[0], argv[0]);
+	return 2;
+}
@@ -0,0 +1,365 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_domain_data.h>
+#include <sbi/sbi_emulate_csr.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_illegal_insn.h>
+#include <sbi/sbi_insn_emu_v.h>
+#include <sbi/sbi_platform.h>
+#include <sbi/sbi_pmu.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_unpriv.h>
+
+#include <host_emu.h>
+
+#define FCSR_FFLAGS_MASK	0x1fUL
+#define FCSR_FRM_SHIFT		5
+#define FCSR_FRM_MASK		0x7UL
+
+u8 host_emu_mem[HOST_EMU_MEM_SIZE] __aligned(16);
+u64 host_emu_fregs[32];
+struct sbi_trap_info host_emu_redirect;
+u32 sbi_scratch_hart_count = 1;
+
+static ulong host_csrs[4096];
+static ulong fault_addr, fault_cause;
+static ulong reservation = -1UL;
+
+static const struct sbi_platform_operations host_platform_ops;
+static const struct sbi_platform host_platform = {
+	.name = "host-emu",
+	.hart_count = 1,
+	.platform_ops_addr = (unsigned long)&host_platform_ops,
+};
+static struct sbi_scratch host_scratch = {
+	.platform_addr = (unsigned long)&host_platform,
+};
+
+/* Mock CSR file */
+
+ulong host_emu_csr_read(int csr)
+{
+	switch (csr) {
+	case CSR_MSCRATCH:
+		return (ulong)&host_scratch;
+	case CSR_FFLAGS:
+		return host_csrs[CSR_FCSR] & FCSR_FFLAGS_MASK;
+	case CSR_FRM:
+		return (host_csrs[CSR_FCSR] >> FCSR_FRM_SHIFT) & FCSR_FRM_MASK;
+	case CSR_FCSR:
+		return host_csrs[CSR_FCSR] &
+		       (FCSR_FFLAGS_MASK | (FCSR_FRM_MASK << FCSR_FRM_SHIFT));
+	default:
+		return host_csrs[csr & 0xfff];
+	}
+}
+
+void host_emu_csr_write(int csr, ulong val)
+{
+	ulong fcsr = host_csrs[CSR_FCSR];
+
+	switch (csr) {
+	case CSR_FFLAGS:
+		host_csrs[CSR_FCSR] = (fcsr & ~FCSR_FFLAGS_MASK) |
+				      (val & FCSR_FFLAGS_MASK);
+		break;
+	case CSR_FRM:
+		host_csrs[CSR_FCSR] =
+			(fcsr & ~(FCSR_FRM_MASK << FCSR_FRM_SHIFT)) |
+			((val & FCSR_FRM_MASK) << FCSR_FRM_SHIFT);
+		break;
+	case CSR_FCSR:
+		host_csrs[CSR_FCSR] = val & (FCSR_FFLAGS_MASK |
+					     (FCSR_FRM_MASK << FCSR_FRM_SHIFT));
+		break;
+	default:
+		host_csrs[csr & 0xfff] = val;
+		break;
+	}
+}
+
+ulong host_emu_csr_swap(int csr, ulong val)
+{
+	ulong old = host_emu_csr_read(csr);
+
+	host_emu_csr_write(csr, val);
+	return old;
+}
+
+/* Mock unprivileged memory */
+
+enum host_access {
+	HOST_ACCESS_LOAD,
+	HOST_ACCESS_STORE,
+	HOST_ACCESS_FETCH,
+};
+
+static ulong host_fault_cause(ulong cause, enum host_access type)
+{
+	static const ulong causes[][3] = {
+		{ CAUSE_LOAD_ACCESS, CAUSE_STORE_ACCESS, CAUSE_FETCH_ACCESS },
+		{ CAUSE_LOAD_PAGE_FAULT, CAUSE_STORE_PAGE_FAULT,
+		  CAUSE_FETCH_PAGE_FAULT },
+	};
+
+	return causes[cause == CAUSE_LOAD_PAGE_FAULT][type];
+}
+
+void host_emu_fault_inject(ulong addr, ulong cause)
+{
+	fault_addr = addr;
+	fault_cause = cause;
+}
+
+static void *host_access(ulong addr, ulong size, enum host_access type,
+			 struct sbi_trap_info *trap)
+{
+	ulong cause = 0;
+
+	trap->cause = 0;
+	if (fault_cause && addr <= fault_addr && fault_addr < addr + size)
+		cause = host_fault_cause(fault_cause, type);
+	else if (addr < HOST_EMU_MEM_BASE ||
+		 addr - HOST_EMU_MEM_BASE > HOST_EMU_MEM_SIZE - size)
+		cause = host_fault_cause(CAUSE_LOAD_ACCESS, type);
+
+	if (cause) {
+		trap->cause = cause;
+		trap->tval = addr;
+		trap->tval2 = 0;
+		trap->tinst = 0;
+		trap->gva = 0;
+		return NULL;
+	}
+
+	return &host_emu_mem[addr - HOST_EMU_MEM_BASE];
+}
+
+#define DEFINE_HOST_LOAD_FUNCTION(type)					\
+	type sbi_load_##type(const type *addr,				\
+			     struct sbi_trap_info *trap)		\
+	{								\
+		type val = 0;						\
+		void *p = host_access((ulong)addr, sizeof(type),	\
+				      HOST_ACCESS_LOAD, trap);		\
+		if (p)							\
+			memcpy(&val, p, sizeof(type));			\
+		return val;						\
+	}
+
+#define DEFINE_HOST_STORE_FUNCTION(type)				\
+	void sbi_store_##type(type *addr, type val,			\
+			      struct sbi_trap_info *trap)		\
+	{								\
+		void *p = host_access((ulong)addr, sizeof(type),	\
+				      HOST_ACCESS_STORE, trap);		\
+		if (p)							\
+			memcpy(p, &val, sizeof(type));			\
+	}
+
+DEFINE_HOST_LOAD_FUNCTION(u8)
+DEFINE_HOST_LOAD_FUNCTION(u16)
+DEFINE_HOST_LOAD_FUNCTION(s8)
+DEFINE_HOST_LOAD_FUNCTION(s16)
+DEFINE_HOST_LOAD_FUNCTION(s32)
+DEFINE_HOST_STORE_FUNCTION(u8)
+DEFINE_HOST_STORE_FUNCTION(u16)
+DEFINE_HOST_STORE_FUNCTION(u32)
+DEFINE_HOST_LOAD_FUNCTION(u32)
+DEFINE_HOST_LOAD_FUNCTION(u64)
+DEFINE_HOST_STORE_FUNCTION(u64)
+DEFINE_HOST_LOAD_FUNCTION(ulong)
+
+ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
+{
+	u16 lo, hi = 0;
+	void *p;
+
+	p = host_access(mepc, 2, HOST_ACCESS_FETCH, trap);
+	if (!p)
+		return 0;
+	memcpy(&lo, p, 2);
+
+	if ((lo & 3) == 3) {
+		p = host_access(mepc + 2, 2, HOST_ACCESS_FETCH, trap);
+		if (!p)
+			return 0;
+		memcpy(&hi, p, 2);
+	}
+
+	return (ulong)hi << 16 | lo;
+}
+
+int sbi_unpriv_batch(struct sbi_unpriv_access *acc, int count,
+		     struct sbi_trap_info *trap)
+{
+	int i, shift;
+	bool store;
+	void *p;
+
+	trap->cause = 0;
+	for (i = 0; i < count; i++, acc++) {
+		store = acc->flags & SBI_UNPRIV_STORE;
+		p = host_access(acc->addr, acc->size,
+				store ? HOST_ACCESS_STORE : HOST_ACCESS_LOAD,
+				trap);
+		if (!p)
+			break;
+		if (store) {
+			memcpy(p, &acc->val, acc->size);
+			continue;
+		}
+
+		acc->val = 0;
+		memcpy(&acc->val, p, acc->size);
+		shift = __riscv_xlen - 8 * acc->size;
+		if ((acc->flags & SBI_UNPRIV_SIGNED) && shift)
+			acc->val = (long)(acc->val << shift) >> shift;
+	}
+
+	return i;
+}
+
+#define DEFINE_HOST_LRSC_FUNCTIONS(type)				\
+	type host_emu_lr_##type(const type *addr,			\
+				struct sbi_trap_info *trap)		\
+	{								\
+		type val = 0;						\
+		void *p = host_access((ulong)addr, sizeof(type),	\
+				      HOST_ACCESS_LOAD, trap);		\
+		if (p) {						\
+			memcpy(&val, p, sizeof(type));			\
+			reservation = (ulong)addr;			\
+		}							\
+		return val;						\
+	}								\
+	type host_emu_sc_##type(type *addr, type val,			\
+				struct sbi_trap_info *trap)		\
+	{								\
+		void *p = host_access((ulong)addr, sizeof(type),	\
+				      HOST_ACCESS_STORE, trap);		\
+		if (!p || reservation != (ulong)addr)			\
+			return 1;					\
+		memcpy(p, &val, sizeof(type));				\
+		reservation = -1UL;					\
+		return 0;						\
+	}
+
+DEFINE_HOST_LRSC_FUNCTIONS(s32)
+DEFINE_HOST_LRSC_FUNCTIONS(s64)
+
+void host_emu_reset(struct sbi_trap_regs *regs)
+{
+	memset(regs, 0, sizeof(*regs));
+	memset(host_emu_fregs, 0, sizeof(host_emu_fregs));
+	memset(host_csrs, 0, sizeof(host_csrs));
+	memset(&host_emu_redirect, 0, sizeof(host_emu_redirect));
+	fault_addr = fault_cause = 0;
+	reservation = -1UL;
+
+	/* Traps come from S-mode with FP enabled and CBOs allowed */
+	regs->mstatus = (PRV_S << MSTATUS_MPP_SHIFT) | MSTATUS_FS;
+	host_csrs[CSR_SSTATUS] = SSTATUS_FS;
+	host_csrs[CSR_MENVCFG] = ENVCFG_CBZE | ENVCFG_CBCFE | ENVCFG_CBIE;
+	host_csrs[CSR_SENVCFG] = ENVCFG_CBZE | ENVCFG_CBCFE | ENVCFG_CBIE;
+}
+
+/* Mocks of the remaining SBI runtime */
+
+int sbi_trap_redirect(struct sbi_trap_regs *regs,
+		      const struct sbi_trap_info *trap)
+{
+	host_emu_redirect = *trap;
+	return 0;
+}
+
+int sbi_emulate_csr_read(int csr_num, struct sbi_trap_regs *regs,
+			 ulong *csr_val)
+{
+	return SBI_ENOTSUPP;
+}
+
+int sbi_emulate_csr_write(int csr_num, struct sbi_trap_regs *regs,
+			  ulong csr_val)
+{
+	return SBI_ENOTSUPP;
+}
+
+int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id)
+{
+	return 0;
+}
+
+int misa_extension_imp(char ext)
+{
+	/* An RV64GC HART */
+	return ext == 'I' || ext == 'M' || ext == 'A' || ext == 'F' ||
+	       ext == 'D' || ext == 'C' || ext == 'S' || ext == 'U';
+}
+
+bool sbi_hart_has_csr(struct sbi_scratch *scratch, enum sbi_hart_csrs csr)
+{
+	return true;
+}
+
+bool sbi_hart_has_misa_extension(struct sbi_scratch *scratch, char ext)
+{
+	return misa_extension_imp(ext);
+}
+
+unsigned long sbi_hart_emu_groups_native(struct sbi_scratch *scratch)
+{
+	return 0;
+}
+
+bool sbi_hart_tval_insn16(struct sbi_scratch *scratch)
+{
+	return true;
+}
+
+struct sbi_domain *sbi_hartindex_to_domain(u32 hartindex)
+{
+	return NULL;
+}
+
+int sbi_domain_register_data(struct sbi_domain_data *data)
+{
+	return 0;
+}
+
+void *sbi_domain_data_ptr(struct sbi_domain *dom, struct sbi_domain_data *data)
+{
+	return NULL;
+}
+
+int sbi_insn_emu_op_v(ulong insn, struct sbi_trap_regs *regs)
+{
+	return truly_illegal_insn(insn, regs);
+}
+
+int sbi_printf(const char *format, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start(ap, format);
+	ret = vprintf(format, ap);
+	va_end(ap);
+
+	return ret;
+}
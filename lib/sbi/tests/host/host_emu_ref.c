@@ -0,0 +1,1306 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+/*
+ * Reference instruction semantics for the differential fuzzer
+ *
+ * Everything in here is written straight from the ISA manual and must
+ * not share code with the emulators. Floating-point results come from
+ * the host FPU and libgcc soft-fp, which implement IEEE 754 the same way
+ * RISC-V does apart from NaN propagation, so NaNs are handled explicitly.
+ */
+
+#include <fenv.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <sbi/riscv_encoding.h>
+
+#include <host_emu_ref.h>
+
+#define RD(insn)		(((insn) >> 7) & 0x1f)
+#define RS1(insn)		(((insn) >> 15) & 0x1f)
+#define RS2(insn)		(((insn) >> 20) & 0x1f)
+/* rd'/rs1' and rd'/rs2' of the compressed formats */
+#define RS1C(insn)		((((insn) >> 7) & 0x7) + 8)
+#define RS2C(insn)		((((insn) >> 2) & 0x7) + 8)
+#define RM(insn)		(((insn) >> 12) & 0x7)
+#define IS_RVC(insn)		(((insn) & 3) != 3)
+
+#define MASK_R			0xfe00707f
+#define MASK_I_UNARY		0xfff0707f
+#define MASK_SHIFT_IMM		0xfc00707f
+#define MASK_FP_RM		0xfff0007f
+#define MASK_LDST		0x0000707f
+#define MASK_C_LDST		0x0000e003
+#define MASK_AMO		0xf800707f
+
+#define MATCH_AMO_W		0x0000202f
+#define MATCH_AMO_D		0x0000302f
+#define AMO_FUNCT5(n)		((u32)(n) << 27)
+
+#define FFLAG_NV		0x10
+#define FFLAG_DZ		0x08
+#define FFLAG_OF		0x04
+#define FFLAG_UF		0x02
+#define FFLAG_NX		0x01
+
+#define F16_CANONICAL_NAN	0x7e00
+#define F32_CANONICAL_NAN	0x7fc00000U
+#define F64_CANONICAL_NAN	0x7ff8000000000000ULL
+
+/* Common helpers */
+
+static void ref_retire(struct ref_state *s, u32 insn)
+{
+	s->pc += IS_RVC(insn) ? 2 : 4;
+}
+
+static void ref_write_x(struct ref_state *s, int rd, ulong val)
+{
+	if (rd)
+		s->x[rd] = val;
+}
+
+static void ref_illegal(struct ref_state *s, u32 insn)
+{
+	s->trap_cause = CAUSE_ILLEGAL_INSTRUCTION;
+	s->trap_tval = insn;
+}
+
+/* Memory, following the contract of host_emu_fault_inject() */
+
+static bool ref_access(struct ref_state *s, ulong addr, ulong size,
+		       bool store, u8 **p)
+{
+	ulong cause = 0;
+
+	if (s->fault_cause && addr <= s->fault_addr &&
+	    s->fault_addr < addr + size)
+		cause = s->fault_cause;
+	else if (addr < HOST_EMU_MEM_BASE ||
+		 addr - HOST_EMU_MEM_BASE > HOST_EMU_MEM_SIZE - size)
+		cause = CAUSE_LOAD_ACCESS;
+
+	if (cause) {
+		if (store)
+			cause = cause == CAUSE_LOAD_PAGE_FAULT ?
+				CAUSE_STORE_PAGE_FAULT : CAUSE_STORE_ACCESS;
+		s->trap_cause = cause;
+		s->trap_tval = addr;
+		return false;
+	}
+
+	*p = &s->mem[addr - HOST_EMU_MEM_BASE];
+	return true;
+}
+
+static bool ref_load(struct ref_state *s, ulong addr, ulong size,
+		     bool bytewise, u64 *val)
+{
+	u8 *p = NULL;
+	int i;
+
+	*val = 0;
+	for (i = 0; i < size; i++) {
+		if (bytewise || !i) {
+			if (!ref_access(s, addr + i, bytewise ? 1 : size,
+					false, &p))
+				return false;
+		} else {
+			p++;
+		}
+		*val |= (u64)*p << (8 * i);
+	}
+
+	return true;
+}
+
+static bool ref_store(struct ref_state *s, ulong addr, ulong size,
+		      bool bytewise, u64 val)
+{
+	u8 *p = NULL;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		if (bytewise || !i) {
+			if (!ref_access(s, addr + i, bytewise ? 1 : size,
+					true, &p))
+				return false;
+		} else {
+			p++;
+		}
+		*p = val >> (8 * i);
+	}
+
+	return true;
+}
+
+ulong ref_insn_addr(const struct ref_insn *ref, const struct ref_state *s,
+		    u32 insn)
+{
+	long offset;
+	int base = ref->addr(insn, &offset);
+
+	return s->x[base] + offset;
+}
+
+static int ref_addr_r(u32 insn, long *offset)
+{
+	*offset = 0;
+	return RS1(insn);
+}
+
+static int ref_addr_i(u32 insn, long *offset)
+{
+	*offset = (s32)insn >> 20;
+	return RS1(insn);
+}
+
+static int ref_addr_s(u32 insn, long *offset)
+{
+	*offset = ((s32)insn >> 25 << 5) | (s32)((insn >> 7) & 0x1f);
+	return RS1(insn);
+}
+
+static int ref_addr_zcb_b(u32 insn, long *offset)
+{
+	*offset = ((insn >> 6) & 1) | ((insn >> 4) & 2);
+	return RS1C(insn);
+}
+
+static int ref_addr_zcb_h(u32 insn, long *offset)
+{
+	*offset = (insn >> 4) & 2;
+	return RS1C(insn);
+}
+
+static int ref_addr_c_w(u32 insn, long *offset)
+{
+	*offset = ((insn >> 7) & 0x38) | ((insn >> 4) & 0x4) |
+		  ((insn << 1) & 0x40);
+	return RS1C(insn);
+}
+
+static int ref_addr_c_d(u32 insn, long *offset)
+{
+	*offset = ((insn >> 7) & 0x38) | ((insn << 1) & 0xc0);
+	return RS1C(insn);
+}
+
+/* Integer instructions */
+
+static inline ulong rol64(ulong a, int n)
+{
+	n &= 63;
+	return n ? (a << n) | (a >> (64 - n)) : a;
+}
+
+static inline u32 rol32(u32 a, int n)
+{
+	n &= 31;
+	return n ? (a << n) | (a >> (32 - n)) : a;
+}
+
+static unsigned __int128 clmul128(ulong a, ulong b)
+{
+	unsigned __int128 prod = 0;
+	int i;
+
+	for (i = 0; i < 64; i++)
+		if ((b >> i) & 1)
+			prod ^= (unsigned __int128)a << i;
+
+	return prod;
+}
+
+static ulong orc_b(ulong a)
+{
+	ulong r = 0;
+	int i;
+
+	for (i = 0; i < 64; i += 8)
+		if ((a >> i) & 0xff)
+			r |= 0xffUL << i;
+
+	return r;
+}
+
+#define SEXT32(v)		((ulong)(long)(s32)(v))
+
+/* a = rs1, b = rs2, sh = shift amount of the immediate forms */
+#define DEFINE_REF_ALU(name, expr)					\
+	static void ref_##name(const struct ref_insn *ref,		\
+			       struct ref_state *s, u32 insn)		\
+	{								\
+		ulong a = s->x[RS1(insn)], b = s->x[RS2(insn)];		\
+		int sh = (insn >> 20) & 0x3f;				\
+		(void)a; (void)b; (void)sh;				\
+		ref_write_x(s, RD(insn), (expr));			\
+		ref_retire(s, insn);					\
+	}
+
+DEFINE_REF_ALU(sh1add, b + (a << 1))
+DEFINE_REF_ALU(sh2add, b + (a << 2))
+DEFINE_REF_ALU(sh3add, b + (a << 3))
+DEFINE_REF_ALU(add_uw, b + (u32)a)
+DEFINE_REF_ALU(sh1add_uw, b + ((ulong)(u32)a << 1))
+DEFINE_REF_ALU(sh2add_uw, b + ((ulong)(u32)a << 2))
+DEFINE_REF_ALU(sh3add_uw, b + ((ulong)(u32)a << 3))
+DEFINE_REF_ALU(slli_uw, (ulong)(u32)a << sh)
+DEFINE_REF_ALU(andn, a & ~b)
+DEFINE_REF_ALU(orn, a | ~b)
+DEFINE_REF_ALU(xnor, ~(a ^ b))
+DEFINE_REF_ALU(max, (long)a > (long)b ? a : b)
+DEFINE_REF_ALU(maxu, a > b ? a : b)
+DEFINE_REF_ALU(min, (long)a < (long)b ? a : b)
+DEFINE_REF_ALU(minu, a < b ? a : b)
+DEFINE_REF_ALU(rol, rol64(a, b))
+DEFINE_REF_ALU(ror, rol64(a, 64 - (b & 63)))
+DEFINE_REF_ALU(rori, rol64(a, 64 - sh))
+DEFINE_REF_ALU(rolw, SEXT32(rol32(a, b)))
+DEFINE_REF_ALU(rorw, SEXT32(rol32(a, 32 - (b & 31))))
+DEFINE_REF_ALU(roriw, SEXT32(rol32(a, 32 - (sh & 31))))
+DEFINE_REF_ALU(clz, a ? __builtin_clzl(a) : 64)
+DEFINE_REF_ALU(ctz, a ? __builtin_ctzl(a) : 64)
+DEFINE_REF_ALU(cpop, __builtin_popcountl(a))
+DEFINE_REF_ALU(clzw, (u32)a ? __builtin_clz((u32)a) : 32)
+DEFINE_REF_ALU(ctzw, (u32)a ? __builtin_ctz((u32)a) : 32)
+DEFINE_REF_ALU(cpopw, __builtin_popcount((u32)a))
+DEFINE_REF_ALU(orc_b, orc_b(a))
+DEFINE_REF_ALU(rev8, __builtin_bswap64(a))
+DEFINE_REF_ALU(sext_b, (ulong)(long)(s8)a)
+DEFINE_REF_ALU(sext_h, (ulong)(long)(s16)a)
+DEFINE_REF_ALU(zext_h, (u16)a)
+DEFINE_REF_ALU(clmul, (ulong)clmul128(a, b))
+DEFINE_REF_ALU(clmulh, (ulong)(clmul128(a, b) >> 64))
+DEFINE_REF_ALU(clmulr, (ulong)(clmul128(a, b) >> 63))
+DEFINE_REF_ALU(bclr, a & ~(1UL << (b & 63)))
+DEFINE_REF_ALU(bext, (a >> (b & 63)) & 1)
+DEFINE_REF_ALU(binv, a ^ (1UL << (b & 63)))
+DEFINE_REF_ALU(bset, a | (1UL << (b & 63)))
+DEFINE_REF_ALU(bclri, a & ~(1UL << sh))
+DEFINE_REF_ALU(bexti, (a >> sh) & 1)
+DEFINE_REF_ALU(binvi, a ^ (1UL << sh))
+DEFINE_REF_ALU(bseti, a | (1UL << sh))
+DEFINE_REF_ALU(czero_eqz, b ? a : 0)
+DEFINE_REF_ALU(czero_nez, b ? 0 : a)
+/* Zimop instructions write zero to rd */
+DEFINE_REF_ALU(mop, 0)
+
+/* Zknd, Zkne and Zknh, the S-boxes are built from the FIPS-197 definition */
+
+static u8 aes_gmul(u8 a, u8 b)
+{
+	u8 p = 0;
+
+	while (b) {
+		if (b & 1)
+			p ^= a;
+		a = (a << 1) ^ ((a & 0x80) ? 0x1b : 0);
+		b >>= 1;
+	}
+
+	return p;
+}
+
+static u8 aes_sbox(u8 x, bool inv)
+{
+	static u8 fwd[256], rev[256];
+	static bool init;
+	u8 inverse, s;
+	int i, j;
+
+	if (!init) {
+		for (i = 0; i < 256; i++) {
+			inverse = 0;
+			for (j = 1; i && j < 256; j++) {
+				if (aes_gmul(i, j) == 1) {
+					inverse = j;
+					break;
+				}
+			}
+			s = inverse;
+			for (j = 1; j < 5; j++)
+				s ^= (inverse << j) | (inverse >> (8 - j));
+			s ^= 0x63;
+			fwd[i] = s;
+			rev[s] = i;
+		}
+		init = true;
+	}
+
+	return inv ? rev[x] : fwd[x];
+}
+
+static u32 aes_mixcolumn(u32 col, bool inv)
+{
+	static const u8 fwd_m[4] = { 2, 3, 1, 1 }, inv_m[4] = { 14, 11, 13, 9 };
+	const u8 *m = inv ? inv_m : fwd_m;
+	u32 out = 0;
+	u8 b;
+	int r, k;
+
+	for (r = 0; r < 4; r++) {
+		b = 0;
+		for (k = 0; k < 4; k++)
+			b ^= aes_gmul(col >> (8 * k), m[(k - r) & 3]);
+		out |= (u32)b << (8 * r);
+	}
+
+	return out;
+}
+
+/* Low half of ShiftRows (and SubBytes) of the state {rs2, rs1} */
+static ulong aes64_round(ulong a, ulong b, bool inv, bool mix)
+{
+	u8 state[16], out[8];
+	int i, col, row;
+	ulong rd = 0;
+
+	for (i = 0; i < 8; i++) {
+		state[i] = a >> (8 * i);
+		state[i + 8] = b >> (8 * i);
+	}
+	for (i = 0; i < 8; i++) {
+		col = i / 4;
+		row = i % 4;
+		col = inv ? (col - row) & 3 : (col + row) & 3;
+		out[i] = aes_sbox(state[4 * col + row], inv);
+	}
+	for (i = 0; i < 8; i++)
+		rd |= (ulong)out[i] << (8 * i);
+	if (mix)
+		rd = aes_mixcolumn(rd, inv) |
+		     (ulong)aes_mixcolumn(rd >> 32, inv) << 32;
+
+	return rd;
+}
+
+static ulong ror64(ulong a, int n)
+{
+	return rol64(a, 64 - n);
+}
+
+static u32 ror32(u32 a, int n)
+{
+	return rol32(a, 32 - n);
+}
+
+DEFINE_REF_ALU(aes64es, aes64_round(a, b, false, false))
+DEFINE_REF_ALU(aes64esm, aes64_round(a, b, false, true))
+DEFINE_REF_ALU(aes64ds, aes64_round(a, b, true, false))
+DEFINE_REF_ALU(aes64dsm, aes64_round(a, b, true, true))
+DEFINE_REF_ALU(aes64im, aes_mixcolumn(a, true) |
+	       (ulong)aes_mixcolumn(a >> 32, true) << 32)
+DEFINE_REF_ALU(aes64ks2, (((a >> 32) ^ b) & 0xffffffffUL) |
+	       (((a >> 32) ^ b ^ (b >> 32)) << 32))
+DEFINE_REF_ALU(sha256sig0, SEXT32(ror32(a, 7) ^ ror32(a, 18) ^ ((u32)a >> 3)))
+DEFINE_REF_ALU(sha256sig1, SEXT32(ror32(a, 17) ^ ror32(a, 19) ^
+				  ((u32)a >> 10)))
+DEFINE_REF_ALU(sha256sum0, SEXT32(ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)))
+DEFINE_REF_ALU(sha256sum1, SEXT32(ror32(a, 6) ^ ror32(a, 11) ^ ror32(a, 25)))
+DEFINE_REF_ALU(sha512sig0, ror64(a, 1) ^ ror64(a, 8) ^ (a >> 7))
+DEFINE_REF_ALU(sha512sig1, ror64(a, 19) ^ ror64(a, 61) ^ (a >> 6))
+DEFINE_REF_ALU(sha512sum0, ror64(a, 28) ^ ror64(a, 34) ^ ror64(a, 39))
+DEFINE_REF_ALU(sha512sum1, ror64(a, 14) ^ ror64(a, 18) ^ ror64(a, 41))
+
+static void ref_aes64ks1i(const struct ref_insn *ref, struct ref_state *s,
+			  u32 insn)
+{
+	static const u8 rcon[] = {
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36,
+	};
+	int rnum = (insn >> 20) & 0xf;
+	u32 w = s->x[RS1(insn)] >> 32;
+	int i;
+
+	if (rnum > 0xa) {
+		ref_illegal(s, insn);
+		return;
+	}
+
+	if (rnum != 0xa)
+		w = ror32(w, 8);
+	for (i = 0; i < 4; i++)
+		w = (w & ~(0xffU << (8 * i))) |
+		    (u32)aes_sbox(w >> (8 * i), false) << (8 * i);
+	if (rnum != 0xa)
+		w ^= rcon[rnum];
+
+	ref_write_x(s, RD(insn), w | (ulong)w << 32);
+	ref_retire(s, insn);
+}
+
+/* Zcb register instructions with rd'/rs1' in bits 9:7 */
+#define DEFINE_REF_C_ALU(name, expr)					\
+	static void ref_##name(const struct ref_insn *ref,		\
+			       struct ref_state *s, u32 insn)		\
+	{								\
+		ulong a = s->x[RS1C(insn)], b = s->x[RS2C(insn)];	\
+		(void)b;						\
+		ref_write_x(s, RS1C(insn), (expr));			\
+		ref_retire(s, insn);					\
+	}
+
+DEFINE_REF_C_ALU(c_zext_b, (u8)a)
+DEFINE_REF_C_ALU(c_sext_b, (ulong)(long)(s8)a)
+DEFINE_REF_C_ALU(c_zext_h, (u16)a)
+DEFINE_REF_C_ALU(c_sext_h, (ulong)(long)(s16)a)
+DEFINE_REF_C_ALU(c_zext_w, (u32)a)
+DEFINE_REF_C_ALU(c_not, ~a)
+DEFINE_REF_C_ALU(c_mul, a * b)
+
+static void ref_nop(const struct ref_insn *ref, struct ref_state *s,
+		    u32 insn)
+{
+	ref_retire(s, insn);
+}
+
+/* Loads and stores */
+
+static void ref_ld(const struct ref_insn *ref, struct ref_state *s, u32 insn,
+		   bool sign, bool fp)
+{
+	int rd = IS_RVC(insn) ? RS2C(insn) : RD(insn);
+	int shift = 64 - 8 * ref->size;
+	u64 val;
+
+	if (!ref_load(s, ref_insn_addr(ref, s, insn), ref->size,
+		      ref->flags & REF_F_BYTEWISE, &val))
+		return;
+
+	if (!fp)
+		ref_write_x(s, rd, sign ? (ulong)((long)(val << shift) >> shift) :
+				    val);
+	else if (ref->size < 8)
+		/* NaN-box narrower values */
+		s->f[rd] = val | (-1ULL << (8 * ref->size));
+	else
+		s->f[rd] = val;
+
+	ref_retire(s, insn);
+}
+
+static void ref_ld_s(const struct ref_insn *ref, struct ref_state *s, u32 insn)
+{
+	ref_ld(ref, s, insn, true, false);
+}
+
+static void ref_ld_u(const struct ref_insn *ref, struct ref_state *s, u32 insn)
+{
+	ref_ld(ref, s, insn, false, false);
+}
+
+static void ref_ld_f(const struct ref_insn *ref, struct ref_state *s, u32 insn)
+{
+	ref_ld(ref, s, insn, false, true);
+}
+
+static void ref_st(const struct ref_insn *ref, struct ref_state *s, u32 insn,
+		   bool fp)
+{
+	int rs2 = IS_RVC(insn) ? RS2C(insn) : RS2(insn);
+
+	if (!ref_store(s, ref_insn_addr(ref, s, insn), ref->size,
+		       ref->flags & REF_F_BYTEWISE,
+		       fp ? s->f[rs2] : s->x[rs2]))
+		return;
+
+	ref_retire(s, insn);
+}
+
+static void ref_st_x(const struct ref_insn *ref, struct ref_state *s, u32 insn)
+{
+	ref_st(ref, s, insn, false);
+}
+
+static void ref_st_f(const struct ref_insn *ref, struct ref_state *s, u32 insn)
+{
+	ref_st(ref, s, insn, true);
+}
+
+static void ref_cbo_zero(const struct ref_insn *ref, struct ref_state *s,
+			 u32 insn)
+{
+	ulong addr = s->x[RS1(insn)] & ~63UL;
+	int i;
+
+	/* Zeroed in words, a fault leaves the preceding ones written */
+	for (i = 0; i < 64; i += 4)
+		if (!ref_store(s, addr + i, 4, false, 0))
+			return;
+
+	ref_retire(s, insn);
+}
+
+/* AMOs are read-modify-write, faults are reported as store/AMO faults */
+static void ref_amo(const struct ref_insn *ref, struct ref_state *s, u32 insn)
+{
+	ulong addr = s->x[RS1(insn)], b = s->x[RS2(insn)];
+	bool word = RM(insn) == 2;
+	u64 old, val;
+	long sa, sb;
+
+	if (!ref_load(s, addr, ref->size, false, &old)) {
+		s->trap_cause = s->trap_cause == CAUSE_LOAD_PAGE_FAULT ?
+				CAUSE_STORE_PAGE_FAULT : CAUSE_STORE_ACCESS;
+		return;
+	}
+
+	if (word) {
+		old = SEXT32(old);
+		b = SEXT32(b);
+	}
+	sa = old;
+	sb = b;
+
+	switch (insn >> 27) {
+	case 0x00: val = old + b; break;
+	case 0x01: val = b; break;
+	case 0x04: val = old ^ b; break;
+	case 0x08: val = old | b; break;
+	case 0x0c: val = old & b; break;
+	case 0x10: val = sa < sb ? old : b; break;
+	case 0x14: val = sa > sb ? old : b; break;
+	case 0x18: val = (word ? (u32)old < (u32)b : old < b) ? old : b; break;
+	case 0x1c: val = (word ? (u32)old > (u32)b : old > b) ? old : b; break;
+	default:
+		ref_illegal(s, insn);
+		return;
+	}
+
+	if (!ref_store(s, addr, ref->size, false, val))
+		return;
+
+	ref_write_x(s, RD(insn), old);
+	ref_retire(s, insn);
+}
+
+/* Floating-point helpers */
+
+static const int host_rm[] = {
+	FE_TONEAREST, FE_TOWARDZERO, FE_DOWNWARD, FE_UPWARD,
+};
+
+static ulong host_fflags(int ex)
+{
+	return (ex & FE_INVALID ? FFLAG_NV : 0) |
+	       (ex & FE_DIVBYZERO ? FFLAG_DZ : 0) |
+	       (ex & FE_OVERFLOW ? FFLAG_OF : 0) |
+	       (ex & FE_UNDERFLOW ? FFLAG_UF : 0) |
+	       (ex & FE_INEXACT ? FFLAG_NX : 0);
+}
+
+/* Rounding mode of an instruction, negative if reserved */
+static int ref_rm(struct ref_state *s, u32 insn)
+{
+	int rm = RM(insn);
+
+	if (rm == 7)
+		rm = (s->fcsr >> 5) & 7;
+
+	return rm <= 4 ? rm : -1;
+}
+
+static u16 unbox_h(u64 v)
+{
+	return (v >> 16) == 0xffffffffffffULL ? (u16)v : F16_CANONICAL_NAN;
+}
+
+static u32 unbox_s(u64 v)
+{
+	return (v >> 32) == 0xffffffffULL ? (u32)v : F32_CANONICAL_NAN;
+}
+
+static u64 box_h(u16 v)
+{
+	return 0xffffffffffff0000ULL | v;
+}
+
+static u64 box_s(u32 v)
+{
+	return 0xffffffff00000000ULL | v;
+}
+
+static bool h_is_nan(u16 v)
+{
+	return (v & 0x7c00) == 0x7c00 && (v & 0x03ff);
+}
+
+static bool h_is_snan(u16 v)
+{
+	return h_is_nan(v) && !(v & 0x0200);
+}
+
+static bool s_is_nan(u32 v)
+{
+	return (v & 0x7f800000) == 0x7f800000 && (v & 0x007fffff);
+}
+
+static bool s_is_snan(u32 v)
+{
+	return s_is_nan(v) && !(v & 0x00400000);
+}
+
+static bool d_is_nan(u64 v)
+{
+	return (v & 0x7ff0000000000000ULL) == 0x7ff0000000000000ULL &&
+	       (v & 0x000fffffffffffffULL);
+}
+
+static bool d_is_snan(u64 v)
+{
+	return d_is_nan(v) && !(v & 0x0008000000000000ULL);
+}
+
+static float h_to_float(u16 v)
+{
+	_Float16 h;
+
+	memcpy(&h, &v, sizeof(h));
+	return h;
+}
+
+static u16 h_bits(_Float16 h)
+{
+	u16 v;
+
+	memcpy(&v, &h, sizeof(v));
+	return v;
+}
+
+static float s_to_float(u32 v)
+{
+	float f;
+
+	memcpy(&f, &v, sizeof(f));
+	return f;
+}
+
+static u32 s_bits(float f)
+{
+	u32 v;
+
+	memcpy(&v, &f, sizeof(v));
+	return v;
+}
+
+static double d_to_double(u64 v)
+{
+	double d;
+
+	memcpy(&d, &v, sizeof(d));
+	return d;
+}
+
+static u64 d_bits(double d)
+{
+	u64 v;
+
+	memcpy(&v, &d, sizeof(v));
+	return v;
+}
+
+/* Round a non-NaN value to binary16 with the given RISC-V rounding mode */
+static u16 ref_round_to_h(double val, int rm, ulong *fflags)
+{
+	volatile double in = val;
+	volatile _Float16 out;
+	int ex;
+
+	fesetround(host_rm[rm]);
+	feclearexcept(FE_ALL_EXCEPT);
+	out = (_Float16)in;
+	ex = fetestexcept(FE_ALL_EXCEPT);
+	fesetround(FE_TONEAREST);
+
+	*fflags |= host_fflags(ex);
+	return h_bits(out);
+}
+
+/* Zfhmin conversions */
+
+static void ref_fcvt_s_h(const struct ref_insn *ref, struct ref_state *s,
+			 u32 insn)
+{
+	u16 in = unbox_h(s->f[RS1(insn)]);
+	u32 out;
+
+	if (ref_rm(s, insn) < 0)
+		return ref_illegal(s, insn);
+
+	if (h_is_nan(in)) {
+		if (h_is_snan(in))
+			s->fcsr |= FFLAG_NV;
+		out = F32_CANONICAL_NAN;
+	} else {
+		out = s_bits(h_to_float(in));
+	}
+
+	s->f[RD(insn)] = box_s(out);
+	ref_retire(s, insn);
+}
+
+static void ref_fcvt_d_h(const struct ref_insn *ref, struct ref_state *s,
+			 u32 insn)
+{
+	u16 in = unbox_h(s->f[RS1(insn)]);
+	u64 out;
+
+	if (ref_rm(s, insn) < 0)
+		return ref_illegal(s, insn);
+
+	if (h_is_nan(in)) {
+		if (h_is_snan(in))
+			s->fcsr |= FFLAG_NV;
+		out = F64_CANONICAL_NAN;
+	} else {
+		out = d_bits(h_to_float(in));
+	}
+
+	s->f[RD(insn)] = out;
+	ref_retire(s, insn);
+}
+
+static void ref_fcvt_h_s(const struct ref_insn *ref, struct ref_state *s,
+			 u32 insn)
+{
+	u32 in = unbox_s(s->f[RS1(insn)]);
+	int rm = ref_rm(s, insn);
+	u16 out;
+
+	if (rm < 0)
+		return ref_illegal(s, insn);
+
+	if (s_is_nan(in)) {
+		if (s_is_snan(in))
+			s->fcsr |= FFLAG_NV;
+		out = F16_CANONICAL_NAN;
+	} else {
+		out = ref_round_to_h(s_to_float(in), rm, &s->fcsr);
+	}
+
+	s->f[RD(insn)] = box_h(out);
+	ref_retire(s, insn);
+}
+
+static void ref_fcvt_h_d(const struct ref_insn *ref, struct ref_state *s,
+			 u32 insn)
+{
+	u64 in = s->f[RS1(insn)];
+	int rm = ref_rm(s, insn);
+	u16 out;
+
+	if (rm < 0)
+		return ref_illegal(s, insn);
+
+	if (d_is_nan(in)) {
+		if (d_is_snan(in))
+			s->fcsr |= FFLAG_NV;
+		out = F16_CANONICAL_NAN;
+	} else {
+		out = ref_round_to_h(d_to_double(in), rm, &s->fcsr);
+	}
+
+	s->f[RD(insn)] = box_h(out);
+	ref_retire(s, insn);
+}
+
+static void ref_fmv_x_h(const struct ref_insn *ref, struct ref_state *s,
+			u32 insn)
+{
+	ref_write_x(s, RD(insn), (ulong)(long)(s16)s->f[RS1(insn)]);
+	ref_retire(s, insn);
+}
+
+static void ref_fmv_h_x(const struct ref_insn *ref, struct ref_state *s,
+			u32 insn)
+{
+	s->f[RD(insn)] = box_h(s->x[RS1(insn)]);
+	ref_retire(s, insn);
+}
+
+/* Zfa */
+
+static const double fli_values[32] = {
+	-1.0, 0.0 /* minimum normal */, 0x1p-16, 0x1p-15,
+	0x1p-8, 0x1p-7, 0x1p-4, 0x1p-3,
+	0.25, 0.3125, 0.375, 0.4375, 0.5, 0.625, 0.75, 0.875,
+	1.0, 1.25, 1.5, 1.75, 2.0, 2.5, 3.0, 4.0,
+	8.0, 16.0, 128.0, 256.0, 0x1p15, 0x1p16, INFINITY, 0.0 /* NaN */,
+};
+
+static void ref_fli(const struct ref_insn *ref, struct ref_state *s, u32 insn)
+{
+	int idx = RS1(insn);
+	ulong fflags = 0;
+	u64 out;
+
+	switch ((insn >> 25) & 3) {
+	case 0:
+		out = idx == 1 ? s_bits(FLT_MIN) : idx == 31 ?
+		      F32_CANONICAL_NAN : s_bits(fli_values[idx]);
+		out = box_s(out);
+		break;
+	case 1:
+		out = idx == 1 ? d_bits(DBL_MIN) : idx == 31 ?
+		      F64_CANONICAL_NAN : d_bits(fli_values[idx]);
+		break;
+	default:
+		/* 2^16 overflows binary16 and becomes infinity */
+		out = idx == 1 ? 0x0400 : idx == 31 ? F16_CANONICAL_NAN :
+		      ref_round_to_h(fli_values[idx], 0, &fflags);
+		out = box_h(out);
+		break;
+	}
+
+	s->f[RD(insn)] = out;
+	ref_retire(s, insn);
+}
+
+static double ref_round_int(double val, int rm)
+{
+	switch (rm) {
+	case 0:
+		return nearbyint(val);
+	case 1:
+		return trunc(val);
+	case 2:
+		return floor(val);
+	case 3:
+		return ceil(val);
+	default:
+		return round(val);
+	}
+}
+
+static void ref_fround(const struct ref_insn *ref, struct ref_state *s,
+		       u32 insn)
+{
+	bool nx = (insn >> 20) & 1;
+	int fmt = (insn >> 25) & 3;
+	int rm = ref_rm(s, insn);
+	bool nan, snan;
+	double in, out;
+	u64 raw;
+
+	if (rm < 0)
+		return ref_illegal(s, insn);
+
+	switch (fmt) {
+	case 0:
+		raw = unbox_s(s->f[RS1(insn)]);
+		nan = s_is_nan(raw);
+		snan = s_is_snan(raw);
+		in = s_to_float(raw);
+		break;
+	case 1:
+		raw = s->f[RS1(insn)];
+		nan = d_is_nan(raw);
+		snan = d_is_snan(raw);
+		in = d_to_double(raw);
+		break;
+	default:
+		raw = unbox_h(s->f[RS1(insn)]);
+		nan = h_is_nan(raw);
+		snan = h_is_snan(raw);
+		in = h_to_float(raw);
+		break;
+	}
+
+	if (nan) {
+		if (snan)
+			s->fcsr |= FFLAG_NV;
+		raw = fmt == 0 ? F32_CANONICAL_NAN : fmt == 1 ?
+		      F64_CANONICAL_NAN : F16_CANONICAL_NAN;
+	} else {
+		/* Integral results of all formats are exact in a double */
+		out = ref_round_int(in, rm);
+		if (nx && out != in)
+			s->fcsr |= FFLAG_NX;
+		raw = fmt == 0 ? s_bits(out) : fmt == 1 ? d_bits(out) :
+		      h_bits((_Float16)out);
+	}
+
+	s->f[RD(insn)] = fmt == 0 ? box_s(raw) : fmt == 1 ? raw : box_h(raw);
+	ref_retire(s, insn);
+}
+
+/* Operands of the binary Zfa instructions as doubles */
+static bool ref_fp_pair(struct ref_state *s, u32 insn, double *a, double *b,
+			u64 *ra, u64 *rb, bool *snan)
+{
+	u64 x = s->f[RS1(insn)], y = s->f[RS2(insn)];
+
+	switch ((insn >> 25) & 3) {
+	case 0:
+		*ra = unbox_s(x);
+		*rb = unbox_s(y);
+		*snan = s_is_snan(*ra) || s_is_snan(*rb);
+		*a = s_to_float(*ra);
+		*b = s_to_float(*rb);
+		return s_is_nan(*ra) || s_is_nan(*rb);
+	case 1:
+		*ra = x;
+		*rb = y;
+		*snan = d_is_snan(*ra) || d_is_snan(*rb);
+		*a = d_to_double(*ra);
+		*b = d_to_double(*rb);
+		return d_is_nan(*ra) || d_is_nan(*rb);
+	default:
+		*ra = unbox_h(x);
+		*rb = unbox_h(y);
+		*snan = h_is_snan(*ra) || h_is_snan(*rb);
+		*a = h_to_float(*ra);
+		*b = h_to_float(*rb);
+		return h_is_nan(*ra) || h_is_nan(*rb);
+	}
+}
+
+static void ref_fminmaxm(const struct ref_insn *ref, struct ref_state *s,
+			 u32 insn)
+{
+	bool max = RM(insn) == 3, snan;
+	int fmt = (insn >> 25) & 3;
+	u64 ra, rb, out;
+	double a, b;
+
+	if (ref_fp_pair(s, insn, &a, &b, &ra, &rb, &snan)) {
+		out = fmt == 0 ? F32_CANONICAL_NAN : fmt == 1 ?
+		      F64_CANONICAL_NAN : F16_CANONICAL_NAN;
+	} else if (a == b) {
+		/* Only differs for zeros, -0.0 is less than +0.0 */
+		out = max ? ra & rb : ra | rb;
+	} else {
+		out = (a < b) ^ max ? ra : rb;
+	}
+
+	if (snan)
+		s->fcsr |= FFLAG_NV;
+
+	s->f[RD(insn)] = fmt == 0 ? box_s(out) : fmt == 1 ? out : box_h(out);
+	ref_retire(s, insn);
+}
+
+static void ref_fcmpq(const struct ref_insn *ref, struct ref_state *s,
+		      u32 insn)
+{
+	bool lt = RM(insn) == 5, snan;
+	ulong out = 0;
+	double a, b;
+	u64 ra, rb;
+
+	/* Quiet comparisons only signal for signaling NaNs */
+	if (!ref_fp_pair(s, insn, &a, &b, &ra, &rb, &snan))
+		out = lt ? a < b : a <= b;
+	if (snan)
+		s->fcsr |= FFLAG_NV;
+
+	ref_write_x(s, RD(insn), out);
+	ref_retire(s, insn);
+}
+
+static void ref_fcvtmod_w_d(const struct ref_insn *ref, struct ref_state *s,
+			    u32 insn)
+{
+	u64 in = s->f[RS1(insn)];
+	int exp = (in >> 52) & 0x7ff;
+	u64 mant = (in & 0x000fffffffffffffULL) | (1ULL << 52);
+	double d = d_to_double(in), t;
+	u32 out;
+
+	if (exp == 0x7ff) {
+		/* Infinities and NaNs */
+		s->fcsr |= FFLAG_NV;
+		out = 0;
+	} else if ((t = trunc(d)) >= -0x1p31 && t < 0x1p31) {
+		if (t != d)
+			s->fcsr |= FFLAG_NX;
+		out = (s32)t;
+	} else {
+		/* Out of range, the result wraps modulo 2^32 */
+		s->fcsr |= FFLAG_NV;
+		if (exp - 1075 >= 64)
+			out = 0;
+		else if (exp >= 1075)
+			out = mant << (exp - 1075);
+		else
+			out = mant >> (1075 - exp);
+		if (in >> 63)
+			out = -out;
+	}
+
+	ref_write_x(s, RD(insn), SEXT32(out));
+	ref_retire(s, insn);
+}
+
+/* The table */
+
+#define REF_ALU(_name, _dec, _mask, _match, _exec)			\
+	{ .name = _name, .decoder = _dec, .mask = _mask,		\
+	  .match = _match, .path = REF_PATH_ILLEGAL, .exec = _exec }
+
+#define REF_FP(_name, _mask, _match, _flags, _exec)			\
+	{ .name = _name, .decoder = "op_fp", .mask = _mask,		\
+	  .match = _match, .path = REF_PATH_ILLEGAL,			\
+	  .flags = REF_F_FP | (_flags), .exec = _exec }
+
+#define REF_MEM(_name, _dec, _mask, _match, _path, _flags, _size,	\
+		_addr, _exec)						\
+	{ .name = _name, .decoder = _dec, .mask = _mask,		\
+	  .match = _match, .path = _path, .flags = REF_F_MEM | (_flags), \
+	  .size = _size, .addr = _addr, .exec = _exec }
+
+#define REF_MISALIGNED_LD(_name, _mask, _match, _fp, _size, _addr, _exec) \
+	REF_MEM(_name, "misaligned_load", _mask, _match,		\
+		REF_PATH_MISALIGNED_LOAD,				\
+		REF_F_MISALIGNED | REF_F_BYTEWISE | (_fp), _size, _addr, _exec)
+
+#define REF_MISALIGNED_ST(_name, _mask, _match, _fp, _size, _addr, _exec) \
+	REF_MEM(_name, "misaligned_store", _mask, _match,		\
+		REF_PATH_MISALIGNED_STORE,				\
+		REF_F_MISALIGNED | REF_F_BYTEWISE | (_fp), _size, _addr, _exec)
+
+#define REF_AMO(_name, _funct5, _word)					\
+	REF_MEM(_name, "amo", MASK_AMO,					\
+		AMO_FUNCT5(_funct5) | ((_word) ? MATCH_AMO_W : MATCH_AMO_D), \
+		REF_PATH_ILLEGAL, REF_F_ALIGNED, (_word) ? 4 : 8,	\
+		ref_addr_r, ref_amo)
+
+const struct ref_insn ref_insns[] = {
+	/* Zba */
+	REF_ALU("sh1add", "op", MASK_R, INSN_MATCH_SH1ADD, ref_sh1add),
+	REF_ALU("sh2add", "op", MASK_R, INSN_MATCH_SH2ADD, ref_sh2add),
+	REF_ALU("sh3add", "op", MASK_R, INSN_MATCH_SH3ADD, ref_sh3add),
+	REF_ALU("add.uw", "op_32", MASK_R, INSN_MATCH_ADD_UW, ref_add_uw),
+	REF_ALU("sh1add.uw", "op_32", MASK_R, INSN_MATCH_SH1ADD_UW,
+		ref_sh1add_uw),
+	REF_ALU("sh2add.uw", "op_32", MASK_R, INSN_MATCH_SH2ADD_UW,
+		ref_sh2add_uw),
+	REF_ALU("sh3add.uw", "op_32", MASK_R, INSN_MATCH_SH3ADD_UW,
+		ref_sh3add_uw),
+	REF_ALU("slli.uw", "op_imm_32", MASK_SHIFT_IMM, INSN_MATCH_SLLI_UW,
+		ref_slli_uw),
+	/* Zbb */
+	REF_ALU("andn", "op", MASK_R, INSN_MATCH_ANDN, ref_andn),
+	REF_ALU("orn", "op", MASK_R, INSN_MATCH_ORN, ref_orn),
+	REF_ALU("xnor", "op", MASK_R, INSN_MATCH_XNOR, ref_xnor),
+	REF_ALU("max", "op", MASK_R, INSN_MATCH_MAX, ref_max),
+	REF_ALU("maxu", "op", MASK_R, INSN_MATCH_MAXU, ref_maxu),
+	REF_ALU("min", "op", MASK_R, INSN_MATCH_MIN, ref_min),
+	REF_ALU("minu", "op", MASK_R, INSN_MATCH_MINU, ref_minu),
+	REF_ALU("rol", "op", MASK_R, INSN_MATCH_ROL, ref_rol),
+	REF_ALU("ror", "op", MASK_R, INSN_MATCH_ROR, ref_ror),
+	REF_ALU("rori", "op_imm", MASK_SHIFT_IMM, INSN_MATCH_RORI, ref_rori),
+	REF_ALU("rolw", "op_32", MASK_R, INSN_MATCH_ROLW, ref_rolw),
+	REF_ALU("rorw", "op_32", MASK_R, INSN_MATCH_RORW, ref_rorw),
+	REF_ALU("roriw", "op_imm_32", MASK_R, INSN_MATCH_RORIW, ref_roriw),
+	REF_ALU("clz", "op_imm", MASK_I_UNARY, INSN_MATCH_CLZ, ref_clz),
+	REF_ALU("ctz", "op_imm", MASK_I_UNARY, INSN_MATCH_CTZ, ref_ctz),
+	REF_ALU("cpop", "op_imm", MASK_I_UNARY, INSN_MATCH_CPOP, ref_cpop),
+	REF_ALU("clzw", "op_imm_32", MASK_I_UNARY, INSN_MATCH_CLZW, ref_clzw),
+	REF_ALU("ctzw", "op_imm_32", MASK_I_UNARY, INSN_MATCH_CTZW, ref_ctzw),
+	REF_ALU("cpopw", "op_imm_32", MASK_I_UNARY, INSN_MATCH_CPOPW,
+		ref_cpopw),
+	REF_ALU("orc.b", "op_imm", MASK_I_UNARY, INSN_MATCH_ORC_B, ref_orc_b),
+	REF_ALU("rev8", "op_imm", MASK_I_UNARY, INSN_MATCH_REV8_RV64,
+		ref_rev8),
+	REF_ALU("sext.b", "op_imm", MASK_I_UNARY, INSN_MATCH_SEXT_B,
+		ref_sext_b),
+	REF_ALU("sext.h", "op_imm", MASK_I_UNARY, INSN_MATCH_SEXT_H,
+		ref_sext_h),
+	REF_ALU("zext.h", "op_32", MASK_I_UNARY, INSN_MATCH_ZEXT_H_RV64,
+		ref_zext_h),
+	/* Zbc */
+	REF_ALU("clmul", "op", MASK_R, INSN_MATCH_CLMUL, ref_clmul),
+	REF_ALU("clmulh", "op", MASK_R, INSN_MATCH_CLMULH, ref_clmulh),
+	REF_ALU("clmulr", "op", MASK_R, INSN_MATCH_CLMULR, ref_clmulr),
+	/* Zbs */
+	REF_ALU("bclr", "op", MASK_R, INSN_MATCH_BCLR, ref_bclr),
+	REF_ALU("bext", "op", MASK_R, INSN_MATCH_BEXT, ref_bext),
+	REF_ALU("binv", "op", MASK_R, INSN_MATCH_BINV, ref_binv),
+	REF_ALU("bset", "op", MASK_R, INSN_MATCH_BSET, ref_bset),
+	REF_ALU("bclri", "op_imm", MASK_SHIFT_IMM, INSN_MATCH_BCLRI,
+		ref_bclri),
+	REF_ALU("bexti", "op_imm", MASK_SHIFT_IMM, INSN_MATCH_BEXTI,
+		ref_bexti),
+	REF_ALU("binvi", "op_imm", MASK_SHIFT_IMM, INSN_MATCH_BINVI,
+		ref_binvi),
+	REF_ALU("bseti", "op_imm", MASK_SHIFT_IMM, INSN_MATCH_BSETI,
+		ref_bseti),
+	/* Zicond */
+	REF_ALU("czero.eqz", "op", MASK_R, INSN_MATCH_CZERO_EQZ,
+		ref_czero_eqz),
+	REF_ALU("czero.nez", "op", MASK_R, INSN_MATCH_CZERO_NEZ,
+		ref_czero_nez),
+	/* Zknd, Zkne and Zknh */
+	REF_ALU("aes64es", "op", MASK_R, INSN_MATCH_AES64ES, ref_aes64es),
+	REF_ALU("aes64esm", "op", MASK_R, INSN_MATCH_AES64ESM, ref_aes64esm),
+	REF_ALU("aes64ds", "op", MASK_R, INSN_MATCH_AES64DS, ref_aes64ds),
+	REF_ALU("aes64dsm", "op", MASK_R, INSN_MATCH_AES64DSM, ref_aes64dsm),
+	REF_ALU("aes64ks2", "op", MASK_R, INSN_MATCH_AES64KS2, ref_aes64ks2),
+	REF_ALU("aes64im", "op_imm", MASK_I_UNARY, INSN_MATCH_AES64IM,
+		ref_aes64im),
+	REF_ALU("aes64ks1i", "op_imm", INSN_MASK_AES64KS1I,
+		INSN_MATCH_AES64KS1I, ref_aes64ks1i),
+	REF_ALU("sha256sig0", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA256SIG0,
+		ref_sha256sig0),
+	REF_ALU("sha256sig1", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA256SIG1,
+		ref_sha256sig1),
+	REF_ALU("sha256sum0", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA256SUM0,
+		ref_sha256sum0),
+	REF_ALU("sha256sum1", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA256SUM1,
+		ref_sha256sum1),
+	REF_ALU("sha512sig0", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA512SIG0,
+		ref_sha512sig0),
+	REF_ALU("sha512sig1", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA512SIG1,
+		ref_sha512sig1),
+	REF_ALU("sha512sum0", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA512SUM0,
+		ref_sha512sum0),
+	REF_ALU("sha512sum1", "op_imm", MASK_I_UNARY, INSN_MATCH_SHA512SUM1,
+		ref_sha512sum1),
+	/* Zimop, Zcmop and Zawrs */
+	REF_ALU("mop.r.n", "system", INSN_MASK_MOP_R_N, INSN_MATCH_MOP_R_N,
+		ref_mop),
+	REF_ALU("mop.rr.n", "system", INSN_MASK_MOP_RR_N, INSN_MATCH_MOP_RR_N,
+		ref_mop),
+	REF_ALU("wrs.nto", "system", 0xffffffff, INSN_MATCH_WRS_NTO, ref_nop),
+	REF_ALU("wrs.sto", "system", 0xffffffff, INSN_MATCH_WRS_STO, ref_nop),
+	REF_ALU("c.mop.n", "c_mop", INSN_MASK_C_MOP_N, INSN_MATCH_C_MOP_N,
+		ref_nop),
+	/* Zcb */
+	REF_ALU("c.zext.b", "c_misc_alu", INSN_MASK_C_GENERIC_RXS,
+		INSN_MATCH_C_ZEXT_B, ref_c_zext_b),
+	REF_ALU("c.sext.b", "c_misc_alu", INSN_MASK_C_GENERIC_RXS,
+		INSN_MATCH_C_SEXT_B, ref_c_sext_b),
+	REF_ALU("c.zext.h", "c_misc_alu", INSN_MASK_C_GENERIC_RXS,
+		INSN_MATCH_C_ZEXT_H, ref_c_zext_h),
+	REF_ALU("c.sext.h", "c_misc_alu", INSN_MASK_C_GENERIC_RXS,
+		INSN_MATCH_C_SEXT_H, ref_c_sext_h),
+	REF_ALU("c.zext.w", "c_misc_alu", INSN_MASK_C_GENERIC_RXS,
+		INSN_MATCH_C_ZEXT_W, ref_c_zext_w),
+	REF_ALU("c.not", "c_misc_alu", INSN_MASK_C_GENERIC_RXS,
+		INSN_MATCH_C_NOT, ref_c_not),
+	REF_ALU("c.mul", "c_misc_alu", INSN_MASK_C_GENERIC_RXS_RXS,
+		INSN_MATCH_C_MUL, ref_c_mul),
+	REF_MEM("c.lbu", "c_reserved", INSN_MASK_C_LBU, INSN_MATCH_C_LBU,
+		REF_PATH_ILLEGAL, 0, 1, ref_addr_zcb_b, ref_ld_u),
+	REF_MEM("c.lhu", "c_reserved", INSN_MASK_C_LHU, INSN_MATCH_C_LHU,
+		REF_PATH_ILLEGAL, 0, 2, ref_addr_zcb_h, ref_ld_u),
+	REF_MEM("c.lh", "c_reserved", INSN_MASK_C_LH, INSN_MATCH_C_LH,
+		REF_PATH_ILLEGAL, 0, 2, ref_addr_zcb_h, ref_ld_s),
+	REF_MEM("c.sb", "c_reserved", INSN_MASK_C_SB, INSN_MATCH_C_SB,
+		REF_PATH_ILLEGAL, 0, 1, ref_addr_zcb_b, ref_st_x),
+	REF_MEM("c.sh", "c_reserved", INSN_MASK_C_SH, INSN_MATCH_C_SH,
+		REF_PATH_ILLEGAL, 0, 2, ref_addr_zcb_h, ref_st_x),
+	/* Zicbom and Zicboz */
+	REF_MEM("cbo.zero", "misc_mem", INSN_MASK_CBO, INSN_MATCH_CBO_ZERO,
+		REF_PATH_ILLEGAL, 0, 64, ref_addr_r, ref_cbo_zero),
+	REF_ALU("cbo.clean", "misc_mem", INSN_MASK_CBO, INSN_MATCH_CBO_CLEAN,
+		ref_nop),
+	REF_ALU("cbo.flush", "misc_mem", INSN_MASK_CBO, INSN_MATCH_CBO_FLUSH,
+		ref_nop),
+	REF_ALU("cbo.inval", "misc_mem", INSN_MASK_CBO, INSN_MATCH_CBO_INVAL,
+		ref_nop),
+	/* Zfhmin */
+	REF_FP("fcvt.s.h", MASK_FP_RM, INSN_MATCH_FCVT_S_H, 0, ref_fcvt_s_h),
+	REF_FP("fcvt.d.h", MASK_FP_RM, INSN_MATCH_FCVT_D_H, 0, ref_fcvt_d_h),
+	REF_FP("fcvt.h.s", MASK_FP_RM, INSN_MATCH_FCVT_H_S, REF_F_NO_RMM,
+	       ref_fcvt_h_s),
+	REF_FP("fcvt.h.d", MASK_FP_RM, INSN_MATCH_FCVT_H_D, REF_F_NO_RMM,
+	       ref_fcvt_h_d),
+	REF_FP("fmv.x.h", MASK_I_UNARY, INSN_MATCH_FMV_X_H, 0, ref_fmv_x_h),
+	REF_FP("fmv.h.x", MASK_I_UNARY, INSN_MATCH_FMV_H_X, 0, ref_fmv_h_x),
+	REF_MEM("flh", "load_fp", INSN_MASK_FLH, INSN_MATCH_FLH,
+		REF_PATH_ILLEGAL, REF_F_FP | REF_F_BYTEWISE, 2, ref_addr_i,
+		ref_ld_f),
+	REF_MEM("fsh", "store_fp", INSN_MASK_FSH, INSN_MATCH_FSH,
+		REF_PATH_ILLEGAL, REF_F_FP | REF_F_BYTEWISE, 2, ref_addr_s,
+		ref_st_f),
+	/* Zfa */
+	REF_FP("fli.s", MASK_I_UNARY, INSN_MATCH_FLI_S, 0, ref_fli),
+	REF_FP("fli.d", MASK_I_UNARY, INSN_MATCH_FLI_D, 0, ref_fli),
+	REF_FP("fli.h", MASK_I_UNARY, INSN_MATCH_FLI_H, 0, ref_fli),
+	REF_FP("fminm.s", MASK_R, INSN_MATCH_FMINM_S, 0, ref_fminmaxm),
+	REF_FP("fmaxm.s", MASK_R, INSN_MATCH_FMAXM_S, 0, ref_fminmaxm),
+	REF_FP("fminm.d", MASK_R, INSN_MATCH_FMINM_D, 0, ref_fminmaxm),
+	REF_FP("fmaxm.d", MASK_R, INSN_MATCH_FMAXM_D, 0, ref_fminmaxm),
+	REF_FP("fminm.h", MASK_R, INSN_MATCH_FMINM_H, 0, ref_fminmaxm),
+	REF_FP("fmaxm.h", MASK_R, INSN_MATCH_FMAXM_H, 0, ref_fminmaxm),
+	REF_FP("fround.s", MASK_FP_RM, INSN_MATCH_FROUND_S, 0, ref_fround),
+	REF_FP("froundnx.s", MASK_FP_RM, INSN_MATCH_FROUNDNX_S, 0, ref_fround),
+	REF_FP("fround.d", MASK_FP_RM, INSN_MATCH_FROUND_D, 0, ref_fround),
+	REF_FP("froundnx.d", MASK_FP_RM, INSN_MATCH_FROUNDNX_D, 0, ref_fround),
+	REF_FP("fround.h", MASK_FP_RM, INSN_MATCH_FROUND_H, 0, ref_fround),
+	REF_FP("froundnx.h", MASK_FP_RM, INSN_MATCH_FROUNDNX_H, 0, ref_fround),
+	REF_FP("fcvtmod.w.d", MASK_I_UNARY, INSN_MATCH_FCVTMOD_W_D, 0,
+	       ref_fcvtmod_w_d),
+	REF_FP("fltq.s", MASK_R, INSN_MATCH_FLTQ_S, 0, ref_fcmpq),
+	REF_FP("fleq.s", MASK_R, INSN_MATCH_FLEQ_S, 0, ref_fcmpq),
+	REF_FP("fltq.d", MASK_R, INSN_MATCH_FLTQ_D, 0, ref_fcmpq),
+	REF_FP("fleq.d", MASK_R, INSN_MATCH_FLEQ_D, 0, ref_fcmpq),
+	REF_FP("fltq.h", MASK_R, INSN_MATCH_FLTQ_H, 0, ref_fcmpq),
+	REF_FP("fleq.h", MASK_R, INSN_MATCH_FLEQ_H, 0, ref_fcmpq),
+	/* AMOs on top of LR/SC (Zalrsc only HARTs) */
+	REF_AMO("amoadd.w", 0x00, 1),
+	REF_AMO("amoswap.w", 0x01, 1),
+	REF_AMO("amoxor.w", 0x04, 1),
+	REF_AMO("amoor.w", 0x08, 1),
+	REF_AMO("amoand.w", 0x0c, 1),
+	REF_AMO("amomin.w", 0x10, 1),
+	REF_AMO("amomax.w", 0x14, 1),
+	REF_AMO("amominu.w", 0x18, 1),
+	REF_AMO("amomaxu.w", 0x1c, 1),
+	REF_AMO("amoadd.d", 0x00, 0),
+	REF_AMO("amoswap.d", 0x01, 0),
+	REF_AMO("amoxor.d", 0x04, 0),
+	REF_AMO("amoor.d", 0x08, 0),
+	REF_AMO("amoand.d", 0x0c, 0),
+	REF_AMO("amomin.d", 0x10, 0),
+	REF_AMO("amomax.d", 0x14, 0),
+	REF_AMO("amominu.d", 0x18, 0),
+	REF_AMO("amomaxu.d", 0x1c, 0),
+	/* Misaligned loads and stores */
+	REF_MISALIGNED_LD("lh", MASK_LDST, INSN_MATCH_LH, 0, 2, ref_addr_i,
+			  ref_ld_s),
+	REF_MISALIGNED_LD("lhu", MASK_LDST, INSN_MATCH_LHU, 0, 2, ref_addr_i,
+			  ref_ld_u),
+	REF_MISALIGNED_LD("lw", MASK_LDST, INSN_MATCH_LW, 0, 4, ref_addr_i,
+			  ref_ld_s),
+	REF_MISALIGNED_LD("lwu", MASK_LDST, INSN_MATCH_LWU, 0, 4, ref_addr_i,
+			  ref_ld_u),
+	REF_MISALIGNED_LD("ld", MASK_LDST, INSN_MATCH_LD, 0, 8, ref_addr_i,
+			  ref_ld_s),
+	REF_MISALIGNED_LD("flw", MASK_LDST, INSN_MATCH_FLW, REF_F_FP, 4,
+			  ref_addr_i, ref_ld_f),
+	REF_MISALIGNED_LD("fld", MASK_LDST, INSN_MATCH_FLD, REF_F_FP, 8,
+			  ref_addr_i, ref_ld_f),
+	REF_MISALIGNED_LD("c.lw", MASK_C_LDST, INSN_MATCH_C_LW, 0, 4,
+			  ref_addr_c_w, ref_ld_s),
+	REF_MISALIGNED_LD("c.ld", MASK_C_LDST, INSN_MATCH_C_LD, 0, 8,
+			  ref_addr_c_d, ref_ld_s),
+	REF_MISALIGNED_ST("sh", MASK_LDST, INSN_MATCH_SH, 0, 2, ref_addr_s,
+			  ref_st_x),
+	REF_MISALIGNED_ST("sw", MASK_LDST, INSN_MATCH_SW, 0, 4, ref_addr_s,
+			  ref_st_x),
+	REF_MISALIGNED_ST("sd", MASK_LDST, INSN_MATCH_SD, 0, 8, ref_addr_s,
+			  ref_st_x),
+	REF_MISALIGNED_ST("fsw", MASK_LDST, INSN_MATCH_FSW, REF_F_FP, 4,
+			  ref_addr_s, ref_st_f),
+	REF_MISALIGNED_ST("fsd", MASK_LDST, INSN_MATCH_FSD, REF_F_FP, 8,
+			  ref_addr_s, ref_st_f),
+	REF_MISALIGNED_ST("c.sw", MASK_C_LDST, INSN_MATCH_C_SW, 0, 4,
+			  ref_addr_c_w, ref_st_x),
+	REF_MISALIGNED_ST("c.sd", MASK_C_LDST, INSN_MATCH_C_SD, 0, 8,
+			  ref_addr_c_d, ref_st_x),
+};
+
+const unsigned int ref_insn_count = array_size(ref_insns);
@@ -0,0 +1,77 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __HOST_EMU_REF_H__
+#define __HOST_EMU_REF_H__
+
+#include <host_emu.h>
+
+/** Architectural state the reference semantics operate on */
+struct ref_state {
+	ulong x[32];
+	u64 f[32];
+	ulong fcsr;
+	ulong pc;
+	/* Injected fault, same contract as host_emu_fault_inject() */
+	ulong fault_addr;
+	ulong fault_cause;
+	/* Trap redirected to the supervisor, cause is zero if none */
+	ulong trap_cause;
+	ulong trap_tval;
+	u8 mem[HOST_EMU_MEM_SIZE];
+};
+
+/** Entry point of the emulator that gets the trap */
+enum ref_path {
+	/* sbi_illegal_insn_handler() */
+	REF_PATH_ILLEGAL,
+	/* sbi_misaligned_load_handler() with tval holding the address */
+	REF_PATH_MISALIGNED_LOAD,
+	/* sbi_misaligned_store_handler() with tval holding the address */
+	REF_PATH_MISALIGNED_STORE,
+};
+
+/* Reads or writes memory through the base register of addr() */
+#define REF_F_MEM		(1U << 0)
+/* Operates on FP registers, operands are drawn from FP patterns */
+#define REF_F_FP		(1U << 1)
+/* The host cannot round to max magnitude, never draw RMM */
+#define REF_F_NO_RMM		(1U << 2)
+/* Memory address must be naturally aligned */
+#define REF_F_ALIGNED		(1U << 3)
+/* Memory address must be misaligned */
+#define REF_F_MISALIGNED	(1U << 4)
+/* Emulated byte by byte, faults report the address of the failing byte */
+#define REF_F_BYTEWISE		(1U << 5)
+
+struct ref_insn {
+	const char *name;
+	/* Emulator function that decodes it, used to group benchmarks */
+	const char *decoder;
+	u32 mask;
+	u32 match;
+	enum ref_path path;
+	u32 flags;
+	/* Access size of memory instructions */
+	u32 size;
+	/* Base register and offset of memory instructions */
+	int (*addr)(u32 insn, long *offset);
+	/* Reference semantics, updates pc or the trap fields */
+	void (*exec)(const struct ref_insn *ref, struct ref_state *s,
+		     u32 insn);
+};
+
+extern const struct ref_insn ref_insns[];
+extern const unsigned int ref_insn_count;
+
+/** Effective address of a memory instruction */
+ulong ref_insn_addr(const struct ref_insn *ref, const struct ref_state *s,
+		    u32 insn);
+
+#endif
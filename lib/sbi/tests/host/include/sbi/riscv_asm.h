@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __HOST_EMU_RISCV_ASM_H__
+#define __HOST_EMU_RISCV_ASM_H__
+
+#include_next <sbi/riscv_asm.h>
+
+#ifndef __ASSEMBLER__
+
+#include <host_emu.h>
+
+/* Route CSR accesses of the host build to the mock CSR file */
+#undef csr_swap
+#undef csr_read
+#undef csr_read_relaxed
+#undef csr_write
+#undef csr_read_set
+#undef csr_set
+#undef csr_read_clear
+#undef csr_clear
+
+#define csr_swap(csr, val)	host_emu_csr_swap(csr, (ulong)(val))
+#define csr_read(csr)		host_emu_csr_read(csr)
+#define csr_read_relaxed(csr)	host_emu_csr_read(csr)
+#define csr_write(csr, val)	host_emu_csr_write(csr, (ulong)(val))
+
+#define csr_read_set(csr, val)						\
+	({								\
+		ulong __v = host_emu_csr_read(csr);			\
+		host_emu_csr_write(csr, __v | (ulong)(val));		\
+		__v;							\
+	})
+
+#define csr_set(csr, val)	((void)csr_read_set(csr, val))
+
+#define csr_read_clear(csr, val)					\
+	({								\
+		ulong __v = host_emu_csr_read(csr);			\
+		host_emu_csr_write(csr, __v & ~(ulong)(val));		\
+		__v;							\
+	})
+
+#define csr_clear(csr, val)	((void)csr_read_clear(csr, val))
+
+#undef wfi
+#define wfi()			do { } while (0)
+
+#endif
+
+#endif
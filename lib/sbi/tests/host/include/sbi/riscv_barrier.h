@@ -0,0 +1,24 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __HOST_EMU_RISCV_BARRIER_H__
+#define __HOST_EMU_RISCV_BARRIER_H__
+
+#include_next <sbi/riscv_barrier.h>
+
+/* The mocks are single threaded, a compiler barrier is all we need */
+#undef RISCV_FENCE
+#undef RISCV_FENCE_I
+#undef cpu_relax
+
+#define RISCV_FENCE(p, s)	__asm__ __volatile__ ("" : : : "memory")
+#define RISCV_FENCE_I		__asm__ __volatile__ ("" : : : "memory")
+#define cpu_relax()		__asm__ __volatile__ ("" : : : "memory")
+
+#endif
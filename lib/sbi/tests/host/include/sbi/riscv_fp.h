@@ -0,0 +1,35 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __HOST_EMU_RISCV_FP_H__
+#define __HOST_EMU_RISCV_FP_H__
+
+#include_next <sbi/riscv_fp.h>
+
+#include <host_emu.h>
+
+/* Route FP register accesses of the host build to the mock register file */
+#undef GET_F32_REG
+#undef SET_F32_REG
+#undef GET_F64_REG
+#undef SET_F64_REG
+
+#define HOST_EMU_FREG(insn, pos)					\
+	host_emu_fregs[(SHIFT_RIGHT(insn, (pos)-3) & 0xf8) >> 3]
+
+/* fmv.x.w and fmv.w.x semantics, the latter NaN-boxes */
+#define GET_F32_REG(insn, pos, regs)	((s32)HOST_EMU_FREG(insn, pos))
+#define SET_F32_REG(insn, pos, regs, val)				\
+	(HOST_EMU_FREG(insn, pos) = 0xffffffff00000000ULL | (u32)(val))
+
+#define GET_F64_REG(insn, pos, regs)	((ulong)HOST_EMU_FREG(insn, pos))
+#define SET_F64_REG(insn, pos, regs, val)				\
+	(HOST_EMU_FREG(insn, pos) = (u64)(val))
+
+#endif
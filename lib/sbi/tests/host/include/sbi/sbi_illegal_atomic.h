@@ -0,0 +1,36 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#ifndef __HOST_EMU_SBI_ILLEGAL_ATOMIC_H__
+#define __HOST_EMU_SBI_ILLEGAL_ATOMIC_H__
+
+#include_next <sbi/sbi_illegal_atomic.h>
+
+#include <host_emu.h>
+
+/*
+ * LR/SC of the host build, sbi_illegal_atomic.c only provides the
+ * MPRV based ones when OPENSBI_HOST_EMU is not defined. The ordering
+ * suffix does not matter to the single threaded mocks.
+ */
+#define DEFINE_UNPRIVILEGED_LR_FUNCTION(type, aqrl, insn)		\
+	static type lr_##type##aqrl(const type *addr,			\
+				    struct sbi_trap_info *trap)		\
+	{								\
+		return host_emu_lr_##type(addr, trap);			\
+	}
+
+#define DEFINE_UNPRIVILEGED_SC_FUNCTION(type, aqrl, insn)		\
+	static type sc_##type##aqrl(type *addr, type val,		\
+				    struct sbi_trap_info *trap)		\
+	{								\
+		return host_emu_sc_##type(addr, val, trap);		\
+	}
+
+#endif
@@ -21,3 +21,15 @@ libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_ecall_test.o
 
 carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += bitops_test_suite
 libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_bitops_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += insn_emu_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_insn_emu_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += unpriv_ptw_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_unpriv_ptw_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += heap_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_heap_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += string_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_string_test.o
@@ -5,9 +5,11 @@
  */
 #include <sbi/riscv_locks.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_timer.h>
 #include <sbi/sbi_unit_test.h>
 
 #define TEST_CONSOLE_BUF_LEN 1024
+#define TEST_CONSOLE_BENCH_LINES 4
 
 static const struct sbi_console_device *old_dev;
 static char test_console_buf[TEST_CONSOLE_BUF_LEN];
@@ -97,10 +99,85 @@ static void printf_test(struct sbiunit_test_case *test)
 	PRINTF_TEST(test, "18446744073709551615", "%llu", 18446744073709551615ULL);
 }
 
+/*
+ * Write a few lines to the console, including the buffered output, and
+ * return the number of bytes written and the elapsed timer ticks.
+ */
+static unsigned long console_bench(const char *name, u64 *ticks)
+{
+	unsigned long bytes = 0, len, n;
+	char line[64];
+	u64 start;
+
+	sbi_snprintf(line, sizeof(line), "[SBIUnit] console throughput %s "
+		     "...........................\n", name);
+	len = sbi_strlen(line);
+
+	start = sbi_timer_value();
+	for (int i = 0; i < TEST_CONSOLE_BENCH_LINES; i++) {
+		for (n = 1; n && bytes < (i + 1) * len;) {
+			n = sbi_nputs(&line[bytes % len], (i + 1) * len - bytes);
+			bytes += n;
+		}
+	}
+	sbi_console_flush();
+	*ticks = sbi_timer_value() - start;
+
+	return bytes;
+}
+
+/*
+ * Compare the console_puts() burst mode of the console device with the
+ * console_putc() path at the baud rate the console is configured for.
+ */
+static void throughput_test(struct sbiunit_test_case *test)
+{
+	const struct sbi_console_device *dev = sbi_console_get_device();
+	const struct sbi_timer_device *timer = sbi_timer_get_device();
+	unsigned long puts_bytes, putc_bytes, expected;
+	struct sbi_console_device putc_dev;
+	u64 puts_ticks, putc_ticks;
+
+	if (!dev || !dev->console_puts || !dev->console_putc ||
+	    !timer || !timer->timer_freq) {
+		SBIUNIT_SKIP(test, "no console_puts() or timer frequency\n");
+		return;
+	}
+
+	puts_bytes = console_bench("puts", &puts_ticks);
+
+	spin_lock(&test_console_lock);
+	putc_dev = *dev;
+	putc_dev.console_puts = NULL;
+	test_console_begin(&putc_dev);
+	putc_bytes = console_bench("putc", &putc_ticks);
+	test_console_end();
+	spin_unlock(&test_console_lock);
+
+	/* Both lines have the same length and must be written completely */
+	expected = TEST_CONSOLE_BENCH_LINES *
+		   sbi_strlen("[SBIUnit] console throughput puts "
+			      "...........................\n");
+	SBIUNIT_EXPECT_EQ(test, puts_bytes, expected);
+	SBIUNIT_EXPECT_EQ(test, putc_bytes, expected);
+	SBIUNIT_EXPECT_NE(test, puts_ticks, 0);
+	SBIUNIT_EXPECT_NE(test, putc_ticks, 0);
+	if (!puts_ticks || !putc_ticks)
+		return;
+
+	sbi_printf("[SBIUnit] %s: %s puts %lu bytes/s putc %lu bytes/s\n",
+		   test->name, dev->name,
+		   (unsigned long)((u64)puts_bytes * timer->timer_freq /
+				   puts_ticks),
+		   (unsigned long)((u64)putc_bytes * timer->timer_freq /
+				   putc_ticks));
+}
+
 static struct sbiunit_test_case console_test_cases[] = {
 	SBIUNIT_TEST_CASE(putc_test),
 	SBIUNIT_TEST_CASE(puts_test),
 	SBIUNIT_TEST_CASE(printf_test),
+	SBIUNIT_TEST_CASE(throughput_test),
 	SBIUNIT_END_CASE,
 };
 
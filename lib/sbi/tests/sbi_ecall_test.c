@@ -40,10 +40,42 @@ static void test_sbi_ecall_register_find_extension(struct sbiunit_test_case *tes
 	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_EXPERIMENTAL_START), NULL);
 }
 
+static void test_sbi_ecall_find_range_extension(struct sbiunit_test_case *test)
+{
+	struct sbi_ecall_extension range_ext = {
+		.extid_start = SBI_EXT_EXPERIMENTAL_START + 0x10,
+		.extid_end = SBI_EXT_EXPERIMENTAL_START + 0x1f,
+		.name = "TestRng",
+		.handle = dummy_handler,
+	};
+	struct sbi_ecall_extension single_ext = {
+		.extid_start = SBI_EXT_EXPERIMENTAL_START + 0x20,
+		.extid_end = SBI_EXT_EXPERIMENTAL_START + 0x20,
+		.name = "TestOne",
+		.handle = dummy_handler,
+	};
+
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_register_extension(&range_ext), 0);
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_EXPERIMENTAL_START + 0x10), &range_ext);
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_EXPERIMENTAL_START + 0x1f), &range_ext);
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_EXPERIMENTAL_START + 0x20), NULL);
+
+	/* A miss must not stick once the ID gets registered */
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_register_extension(&single_ext), 0);
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_EXPERIMENTAL_START + 0x20), &single_ext);
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_BASE)->extid_start, SBI_EXT_BASE);
+
+	sbi_ecall_unregister_extension(&single_ext);
+	sbi_ecall_unregister_extension(&range_ext);
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_EXPERIMENTAL_START + 0x10), NULL);
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(SBI_EXT_EXPERIMENTAL_START + 0x20), NULL);
+}
+
 static struct sbiunit_test_case ecall_tests[] = {
 	SBIUNIT_TEST_CASE(test_sbi_ecall_version),
 	SBIUNIT_TEST_CASE(test_sbi_ecall_impid),
 	SBIUNIT_TEST_CASE(test_sbi_ecall_register_find_extension),
+	SBIUNIT_TEST_CASE(test_sbi_ecall_find_range_extension),
 	SBIUNIT_END_CASE,
 };
 
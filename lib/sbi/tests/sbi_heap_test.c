@@ -0,0 +1,144 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_heap.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_unit_test.h>
+
+/* Allocations per cycle measurement */
+#define HEAP_TEST_ROUNDS	32
+
+static const size_t heap_test_sizes[] = { 1, 16, 17, 64, 100, 512, 513, 4096 };
+
+static void heap_test_report(struct sbiunit_test_case *test, const char *name,
+			     ulong start)
+{
+	sbi_printf("[SBIUnit] %s: %s %lu cycles\n", test->name, name,
+		   (csr_read(CSR_MCYCLE) - start) / HEAP_TEST_ROUNDS);
+}
+
+static void alloc_free_test(struct sbiunit_test_case *test)
+{
+	size_t size;
+	void *ptr, *again;
+
+	for (int i = 0; i < array_size(heap_test_sizes); i++) {
+		size = heap_test_sizes[i];
+		ptr = sbi_malloc(size);
+		SBIUNIT_ASSERT_NE(test, ptr, NULL);
+
+		/* Every allocation keeps the 64 byte minimum alignment */
+		SBIUNIT_EXPECT_EQ(test, (ulong)ptr & 63, 0);
+
+		sbi_memset(ptr, 0xa5, size);
+		sbi_free(ptr);
+
+		/* The last free object of a size class is reused first */
+		again = sbi_malloc(size);
+		if (size <= 512)
+			SBIUNIT_EXPECT_EQ(test, again, ptr);
+		sbi_free(again);
+	}
+
+	SBIUNIT_EXPECT_EQ(test, sbi_malloc(0), NULL);
+	sbi_free(NULL);
+}
+
+static void usage_test(struct sbiunit_test_case *test)
+{
+	unsigned long used = sbi_heap_used_space();
+	void *small[64], *large[4];
+	void *a, *b;
+
+	for (int i = 0; i < array_size(small); i++) {
+		small[i] = sbi_zalloc(32);
+		SBIUNIT_ASSERT_NE(test, small[i], NULL);
+		SBIUNIT_EXPECT_EQ(test, *(ulong *)small[i], 0);
+		*(ulong *)small[i] = i;
+	}
+	for (int i = 0; i < array_size(large); i++) {
+		large[i] = sbi_malloc(2048);
+		SBIUNIT_ASSERT_NE(test, large[i], NULL);
+	}
+	SBIUNIT_EXPECT(test, sbi_heap_used_space() >=
+			     used + 64 * 64 + 4 * 2048);
+
+	/* Small objects never share a cache line */
+	a = sbi_malloc(8);
+	b = sbi_malloc(8);
+	SBIUNIT_EXPECT_NE(test, (ulong)a / 64, (ulong)b / 64);
+	sbi_free(a);
+	sbi_free(b);
+
+	/* Objects of one class must not overlap */
+	for (int i = 0; i < array_size(small); i++)
+		SBIUNIT_EXPECT_EQ(test, *(ulong *)small[i], i);
+
+	for (int i = 0; i < array_size(small); i++)
+		sbi_free(small[i]);
+	for (int i = 0; i < array_size(large); i++)
+		sbi_free(large[i]);
+
+	/* Free objects in the caches and the depot are not used space */
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_used_space(), used);
+}
+
+static void slab_release_test(struct sbiunit_test_case *test)
+{
+	unsigned long cached = sbi_heap_cached_space();
+	unsigned long free = sbi_heap_free_space();
+	void *objs[256];
+	int i;
+
+	for (i = 0; i < array_size(objs); i++) {
+		objs[i] = sbi_malloc(64);
+		SBIUNIT_ASSERT_NE(test, objs[i], NULL);
+	}
+	for (i = 0; i < array_size(objs); i++)
+		sbi_free(objs[i]);
+
+	/* Fully free slabs go back to the heap, beyond a small reserve */
+	SBIUNIT_EXPECT(test, sbi_heap_cached_space() <= cached + 4096);
+	SBIUNIT_EXPECT(test, sbi_heap_free_space() + 4096 >= free);
+}
+
+static void throughput_test(struct sbiunit_test_case *test)
+{
+	static const size_t sizes[] = { 64, 512, 2048 };
+	char name[32];
+	ulong start;
+	void *ptr;
+
+	for (int i = 0; i < array_size(sizes); i++) {
+		/* Warm up the cache of the size class */
+		sbi_free(sbi_malloc(sizes[i]));
+
+		start = csr_read(CSR_MCYCLE);
+		for (int j = 0; j < HEAP_TEST_ROUNDS; j++) {
+			ptr = sbi_malloc(sizes[i]);
+			sbi_free(ptr);
+		}
+		sbi_snprintf(name, sizeof(name), "malloc+free.%lu",
+			     (ulong)sizes[i]);
+		heap_test_report(test, name, start);
+		SBIUNIT_EXPECT_NE(test, ptr, NULL);
+	}
+}
+
+static struct sbiunit_test_case heap_test_cases[] = {
+	SBIUNIT_TEST_CASE(alloc_free_test),
+	SBIUNIT_TEST_CASE(usage_test),
+	SBIUNIT_TEST_CASE(slab_release_test),
+	SBIUNIT_TEST_CASE(throughput_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(heap_test_suite, heap_test_cases);
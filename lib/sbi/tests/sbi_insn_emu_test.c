@@ -0,0 +1,597 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/riscv_fp.h>
+#include <sbi/sbi_bitops.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_insn_emu.h>
+#include <sbi/sbi_insn_emu_fp.h>
+#include <sbi/sbi_insn_emu_fuse.h>
+#include <sbi/sbi_insn_emu_v.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_unit_test.h>
+
+/* Emulation calls per cycle measurement */
+#define EMU_TEST_ROUNDS		32
+
+#define XLEN_MSB		(1UL << (__riscv_xlen - 1))
+
+/* rd = a0, rs1 = a1, rs2 = a2 */
+#define RD_A0			(10 << 7)
+#define RS1_A1			(11 << 15)
+#define RS2_A2			(12 << 20)
+#define SHAMT(n)		((n) << 20)
+/* rd'/rs1' = a1, rs2' = a2 */
+#define C_RDRS1_A1		(3 << 7)
+#define C_RS2_A2		(4 << 2)
+
+#define OP_RR(match)		((match) | RD_A0 | RS1_A1 | RS2_A2)
+#define OP_R(match)		((match) | RD_A0 | RS1_A1)
+#define C_OP_RR(match)		((match) | C_RDRS1_A1 | C_RS2_A2)
+#define C_OP_R(match)		((match) | C_RDRS1_A1)
+
+struct emu_test_vector {
+	const char *name;
+	ulong insn;
+	ulong rs1;
+	ulong rs2;
+	ulong rd;
+};
+
+static ulong *emu_test_reg(struct sbi_trap_regs *regs, int num)
+{
+	return &((ulong *)regs)[num];
+}
+
+static void emu_test_report(struct sbiunit_test_case *test, const char *name,
+			    ulong start)
+{
+	sbi_printf("[SBIUnit] %s: %s %lu cycles\n", test->name, name,
+		   (csr_read(CSR_MCYCLE) - start) / EMU_TEST_ROUNDS);
+}
+
+/*
+ * Check each vector with sources in a1 and a2 and the result in register
+ * rd_num, then report the average cycle count of the emulation call.
+ */
+static void emu_test_vectors(struct sbiunit_test_case *test,
+			     const struct emu_test_vector *v, int count,
+			     int (*emu)(ulong insn, struct sbi_trap_regs *regs),
+			     int rd_num, ulong len)
+{
+	struct sbi_trap_regs regs;
+	ulong start;
+
+	for (int i = 0; i < count; i++, v++) {
+		sbi_memset(&regs, 0, sizeof(regs));
+		regs.a1 = v->rs1;
+		regs.a2 = v->rs2;
+		SBIUNIT_EXPECT_EQ(test, emu(v->insn, &regs), 0);
+		SBIUNIT_EXPECT_EQ(test, *emu_test_reg(&regs, rd_num), v->rd);
+		SBIUNIT_EXPECT_EQ(test, regs.mepc, len);
+		if (*emu_test_reg(&regs, rd_num) != v->rd)
+			sbi_printf("[SBIUnit] %s: %s got 0x%lx\n", test->name,
+				   v->name, *emu_test_reg(&regs, rd_num));
+
+		start = csr_read(CSR_MCYCLE);
+		for (int r = 0; r < EMU_TEST_ROUNDS; r++) {
+			regs.a1 = v->rs1;
+			emu(v->insn, &regs);
+		}
+		emu_test_report(test, v->name, start);
+	}
+}
+
+static void group_of_test(struct sbiunit_test_case *test)
+{
+	struct {
+		ulong insn;
+		u32 group;
+	} cases[] = {
+		{ INSN_MATCH_SH1ADD, SBI_ISA_EMU_GROUP_ZBA },
+		{ INSN_MATCH_ADD_UW, SBI_ISA_EMU_GROUP_ZBA },
+		{ INSN_MATCH_SLLI_UW, SBI_ISA_EMU_GROUP_ZBA },
+		{ INSN_MATCH_ANDN, SBI_ISA_EMU_GROUP_ZBB },
+		{ INSN_MATCH_MAXU, SBI_ISA_EMU_GROUP_ZBB },
+		{ INSN_MATCH_CPOP, SBI_ISA_EMU_GROUP_ZBB },
+		{ INSN_MATCH_ORC_B, SBI_ISA_EMU_GROUP_ZBB },
+		{ INSN_MATCH_REV8_RV64, SBI_ISA_EMU_GROUP_ZBB },
+		{ INSN_MATCH_ZEXT_H_RV64, SBI_ISA_EMU_GROUP_ZBB },
+		{ INSN_MATCH_CLMULH, SBI_ISA_EMU_GROUP_ZBC },
+		{ INSN_MATCH_BSET, SBI_ISA_EMU_GROUP_ZBS },
+		{ INSN_MATCH_BEXTI, SBI_ISA_EMU_GROUP_ZBS },
+		{ INSN_MATCH_BINVI, SBI_ISA_EMU_GROUP_ZBS },
+		{ INSN_MATCH_CZERO_NEZ, SBI_ISA_EMU_GROUP_ZICOND },
+		{ INSN_MATCH_MOP_R_N, SBI_ISA_EMU_GROUP_ZIMOP },
+		{ INSN_MATCH_C_MOP_N, SBI_ISA_EMU_GROUP_ZCMOP },
+		{ INSN_MATCH_C_LHU, SBI_ISA_EMU_GROUP_ZCB },
+		{ INSN_MATCH_C_NOT, SBI_ISA_EMU_GROUP_ZCB },
+		{ INSN_MATCH_WRS_STO, SBI_ISA_EMU_GROUP_ZAWRS },
+		{ INSN_MATCH_CBO_FLUSH, SBI_ISA_EMU_GROUP_ZICBOM },
+		{ INSN_MATCH_CBO_ZERO, SBI_ISA_EMU_GROUP_ZICBOZ },
+		{ INSN_MATCH_FCVT_H_S, SBI_ISA_EMU_GROUP_ZFHMIN },
+		{ INSN_MATCH_FMV_H_X, SBI_ISA_EMU_GROUP_ZFHMIN },
+		{ INSN_MATCH_FLH, SBI_ISA_EMU_GROUP_ZFHMIN },
+		{ INSN_MATCH_FROUND_H, SBI_ISA_EMU_GROUP_ZFA },
+		{ INSN_MATCH_FLI_D, SBI_ISA_EMU_GROUP_ZFA },
+		{ INSN_MATCH_FLTQ_S, SBI_ISA_EMU_GROUP_ZFA },
+		{ INSN_MATCH_VANDNVV, SBI_ISA_EMU_GROUP_ZVBB },
+		{ INSN_MATCH_VFMACCVF, SBI_ISA_EMU_GROUP_ZVFH },
+		{ INSN_MATCH_VFREDUSUMVS, SBI_ISA_EMU_GROUP_ZVFH },
+		{ INSN_MATCH_AES64ES, SBI_ISA_EMU_GROUP_ZKNE },
+		{ INSN_MATCH_AES64DSM, SBI_ISA_EMU_GROUP_ZKND },
+		{ INSN_MATCH_AES64IM, SBI_ISA_EMU_GROUP_ZKND },
+		{ INSN_MATCH_AES64KS1I, SBI_ISA_EMU_GROUP_ZKNE },
+		{ INSN_MATCH_AES64KS2, SBI_ISA_EMU_GROUP_ZKNE },
+		{ INSN_MATCH_AES32ESMI | BIT(30), SBI_ISA_EMU_GROUP_ZKNE },
+		{ INSN_MATCH_AES32DSI, SBI_ISA_EMU_GROUP_ZKND },
+		{ INSN_MATCH_SHA256SUM1, SBI_ISA_EMU_GROUP_ZKNH },
+		{ INSN_MATCH_SHA512SIG0H, SBI_ISA_EMU_GROUP_ZKNH },
+		/* Not part of any group */
+		{ INSN_MATCH_FENCE_TSO, SBI_ISA_EMU_GROUP_MAX },
+		{ INSN_MATCH_FENCE_I, SBI_ISA_EMU_GROUP_MAX },
+		{ INSN_MATCH_C_FLD, SBI_ISA_EMU_GROUP_MAX },
+	};
+
+	for (int i = 0; i < array_size(cases); i++)
+		SBIUNIT_EXPECT_EQ(test, sbi_insn_emu_group_of(cases[i].insn),
+				  cases[i].group);
+}
+
+static void groups_mask_test(struct sbiunit_test_case *test)
+{
+	unsigned long old = sbi_insn_emu_get_groups();
+
+	SBIUNIT_EXPECT_EQ(test, sbi_insn_emu_set_groups(BIT(SBI_ISA_EMU_GROUP_MAX)),
+			  SBI_EINVAL);
+
+	SBIUNIT_EXPECT_EQ(test,
+			  sbi_insn_emu_set_groups(SBI_ISA_EMU_GROUP_ALL &
+						  ~BIT(SBI_ISA_EMU_GROUP_ZBB)), 0);
+	SBIUNIT_EXPECT(test, !sbi_insn_emu_allowed(INSN_MATCH_CPOP));
+	SBIUNIT_EXPECT(test, sbi_insn_emu_allowed(INSN_MATCH_SH1ADD));
+	SBIUNIT_EXPECT(test, sbi_insn_emu_allowed(INSN_MATCH_FENCE_TSO));
+
+	sbi_insn_emu_set_groups(old);
+	SBIUNIT_EXPECT_EQ(test, sbi_insn_emu_get_groups(), old);
+}
+
+static const struct emu_test_vector op_vectors[] = {
+	{ "sh1add", OP_RR(INSN_MATCH_SH1ADD), 5, 100, 110 },
+	{ "sh2add", OP_RR(INSN_MATCH_SH2ADD), 5, 100, 120 },
+	{ "sh3add", OP_RR(INSN_MATCH_SH3ADD), 5, 100, 140 },
+	{ "andn", OP_RR(INSN_MATCH_ANDN), 0xff00ff, 0x0f0f0f, 0xf000f0 },
+	{ "orn", OP_RR(INSN_MATCH_ORN), 0xf0, 0x0f, ~0x0fUL },
+	{ "xnor", OP_RR(INSN_MATCH_XNOR), 0xff, 0x0f, ~0xf0UL },
+	{ "max", OP_RR(INSN_MATCH_MAX), -5UL, 3, 3 },
+	{ "maxu", OP_RR(INSN_MATCH_MAXU), -5UL, 3, -5UL },
+	{ "min", OP_RR(INSN_MATCH_MIN), -5UL, 3, -5UL },
+	{ "minu", OP_RR(INSN_MATCH_MINU), -5UL, 3, 3 },
+	{ "rol", OP_RR(INSN_MATCH_ROL), XLEN_MSB | 0x81, 4, 0x818 },
+	{ "ror", OP_RR(INSN_MATCH_ROR), 0x3, 1, XLEN_MSB | 1 },
+	{ "bclr", OP_RR(INSN_MATCH_BCLR), 0xff, 3, 0xf7 },
+	{ "bext", OP_RR(INSN_MATCH_BEXT), 0x10, 4, 1 },
+	{ "binv", OP_RR(INSN_MATCH_BINV), 0x80, 7, 0 },
+	{ "bset", OP_RR(INSN_MATCH_BSET), 0, __riscv_xlen - 1, XLEN_MSB },
+	{ "clmul", OP_RR(INSN_MATCH_CLMUL), 0x87, 0x3, 0x189 },
+	{ "clmulh", OP_RR(INSN_MATCH_CLMULH), XLEN_MSB, 0x6, 0x3 },
+	{ "clmulr", OP_RR(INSN_MATCH_CLMULR), XLEN_MSB, 0x3, 0x3 },
+	{ "czero.eqz", OP_RR(INSN_MATCH_CZERO_EQZ), 42, 0, 0 },
+	{ "czero.eqz", OP_RR(INSN_MATCH_CZERO_EQZ), 42, 1, 42 },
+	{ "czero.nez", OP_RR(INSN_MATCH_CZERO_NEZ), 42, 1, 0 },
+	{ "czero.nez", OP_RR(INSN_MATCH_CZERO_NEZ), 42, 0, 42 },
+	/* First round of FIPS-197 appendix C.1 */
+#if __riscv_xlen == 64
+	{ "aes64es", OP_RR(INSN_MATCH_AES64ES), 0x7060504030201000UL,
+	  0xf0e0d0c0b0a09080UL, 0x04e160098ce05363UL },
+	{ "aes64esm", OP_RR(INSN_MATCH_AES64ESM), 0x7060504030201000UL,
+	  0xf0e0d0c0b0a09080UL, 0x92bcf5571564725fUL },
+	{ "aes64ds", OP_RR(INSN_MATCH_AES64DS), 0x274eef89a7fdd57aUL,
+	  0x9ff59f3d0b10ca2bUL, 0x9e77b5f23d7c6ebdUL },
+	{ "aes64ks2", OP_RR(INSN_MATCH_AES64KS2), 0xfe76abd6fe76abd6UL,
+	  0x0706050403020100UL, 0xfa72afd2fd74aad6UL },
+#else
+	{ "aes32esi", OP_RR(INSN_MATCH_AES32ESI | BIT(30)), 0x11111111,
+	  0x5300, 0x1111fc11 },
+	{ "aes32esmi", OP_RR(INSN_MATCH_AES32ESMI | BIT(30)), 0x11111111,
+	  0x5300, 0xfcfcd03d },
+	{ "aes32dsi", OP_RR(INSN_MATCH_AES32DSI | BIT(30)), 0x11111111,
+	  0x5300, 0x11114111 },
+	{ "aes32dsmi", OP_RR(INSN_MATCH_AES32DSMI | BIT(30)), 0x11111111,
+	  0x5300, 0xacf75c57 },
+	{ "sha512sig0h", OP_RR(INSN_MATCH_SHA512SIG0H), 0x01234567,
+	  0x89abcdef, 0x6f92c77c },
+	{ "sha512sig0l", OP_RR(INSN_MATCH_SHA512SIG0L), 0x89abcdef,
+	  0x01234567, 0x6c4f1aa1 },
+	{ "sha512sum0r", OP_RR(INSN_MATCH_SHA512SUM0R), 0x89abcdef,
+	  0x01234567, 0x0c7ec1ab },
+#endif
+};
+
+static void op_test(struct sbiunit_test_case *test)
+{
+	emu_test_vectors(test, op_vectors, array_size(op_vectors),
+			 sbi_insn_emu_op, 10, 4);
+}
+
+static const struct emu_test_vector op_imm_vectors[] = {
+	{ "bclri", OP_R(INSN_MATCH_BCLRI | SHAMT(3)), 0xff, 0, 0xf7 },
+	{ "bexti", OP_R(INSN_MATCH_BEXTI | SHAMT(4)), 0x10, 0, 1 },
+	{ "binvi", OP_R(INSN_MATCH_BINVI | SHAMT(7)), 0, 0, 0x80 },
+	{ "bseti", OP_R(INSN_MATCH_BSETI | SHAMT(__riscv_xlen - 1)), 0, 0,
+	  XLEN_MSB },
+	{ "rori", OP_R(INSN_MATCH_RORI | SHAMT(1)), 0x3, 0, XLEN_MSB | 1 },
+	{ "clz", OP_R(INSN_MATCH_CLZ), 1, 0, __riscv_xlen - 1 },
+	{ "clz", OP_R(INSN_MATCH_CLZ), 0, 0, __riscv_xlen },
+	{ "ctz", OP_R(INSN_MATCH_CTZ), 0x100, 0, 8 },
+	{ "ctz", OP_R(INSN_MATCH_CTZ), 0, 0, __riscv_xlen },
+	{ "cpop", OP_R(INSN_MATCH_CPOP), XLEN_MSB | 0xf0f, 0, 9 },
+	{ "orc.b", OP_R(INSN_MATCH_ORC_B), 0x10200, 0, 0xffff00 },
+#if __riscv_xlen == 64
+	{ "rev8", OP_R(INSN_MATCH_REV8_RV64), 0x0102, 0, 0x0201UL << 48 },
+#else
+	{ "rev8", OP_R(INSN_MATCH_REV8_RV32), 0x0102, 0, 0x0201UL << 16 },
+#endif
+	{ "sext.b", OP_R(INSN_MATCH_SEXT_B), 0x180, 0, -128UL },
+	{ "sext.h", OP_R(INSN_MATCH_SEXT_H), 0x18000, 0, -32768UL },
+	{ "sha256sig0", OP_R(INSN_MATCH_SHA256SIG0), 0x12345678, 0,
+	  (ulong)(s32)0xe7fce6ee },
+	{ "sha256sum1", OP_R(INSN_MATCH_SHA256SUM1), 0x12345678, 0,
+	  0x3561abda },
+#if __riscv_xlen == 64
+	{ "sha512sig0", OP_R(INSN_MATCH_SHA512SIG0), 0x0123456789abcdefUL, 0,
+	  0x6f92c77c6c4f1aa1UL },
+	{ "sha512sum1", OP_R(INSN_MATCH_SHA512SUM1), 0x0123456789abcdefUL, 0,
+	  0x7703112333475567UL },
+	{ "aes64im", OP_R(INSN_MATCH_AES64IM), 0x92bcf5571564725fUL, 0,
+	  0x04e160098ce05363UL },
+	{ "aes64ks1i", OP_R(INSN_MATCH_AES64KS1I), 0x0f0e0d0c0b0a0908UL, 0,
+	  0xfe76abd6fe76abd6UL },
+#endif
+};
+
+static void op_imm_test(struct sbiunit_test_case *test)
+{
+	emu_test_vectors(test, op_imm_vectors, array_size(op_imm_vectors),
+			 sbi_insn_emu_op_imm, 10, 4);
+}
+
+#if __riscv_xlen == 64
+static const struct emu_test_vector op_32_vectors[] = {
+	{ "add.uw", OP_RR(INSN_MATCH_ADD_UW), 0xffffffff00000005UL, 10, 15 },
+	{ "sh1add.uw", OP_RR(INSN_MATCH_SH1ADD_UW), 0x180000000UL, 1,
+	  0x100000001UL },
+	{ "sh2add.uw", OP_RR(INSN_MATCH_SH2ADD_UW), 0x180000000UL, 0,
+	  0x200000000UL },
+	{ "sh3add.uw", OP_RR(INSN_MATCH_SH3ADD_UW), 0x180000000UL, 0,
+	  0x400000000UL },
+	{ "rolw", OP_RR(INSN_MATCH_ROLW), 0x80000001UL, 1, 0x3 },
+	{ "rorw", OP_RR(INSN_MATCH_RORW), 0x1, 1, 0xffffffff80000000UL },
+	{ "zext.h", OP_R(INSN_MATCH_ZEXT_H_RV64), 0x12345678, 0, 0x5678 },
+};
+
+static const struct emu_test_vector op_imm_32_vectors[] = {
+	{ "clzw", OP_R(INSN_MATCH_CLZW), 1, 0, 31 },
+	{ "clzw", OP_R(INSN_MATCH_CLZW), 0xffffffff00000000UL, 0, 32 },
+	{ "ctzw", OP_R(INSN_MATCH_CTZW), 0x10, 0, 4 },
+	{ "cpopw", OP_R(INSN_MATCH_CPOPW), 0xffffffff00000003UL, 0, 2 },
+	{ "slli.uw", OP_R(INSN_MATCH_SLLI_UW | SHAMT(4)),
+	  0xffffffff80000001UL, 0, 0x800000010UL },
+	{ "roriw", OP_R(INSN_MATCH_RORIW | SHAMT(4)), 0x12345678, 0,
+	  0xffffffff81234567UL },
+};
+
+static void op_32_test(struct sbiunit_test_case *test)
+{
+	emu_test_vectors(test, op_32_vectors, array_size(op_32_vectors),
+			 sbi_insn_emu_op_32, 10, 4);
+	emu_test_vectors(test, op_imm_32_vectors,
+			 array_size(op_imm_32_vectors),
+			 sbi_insn_emu_op_imm_32, 10, 4);
+}
+#endif
+
+static const struct emu_test_vector c_misc_alu_vectors[] = {
+	{ "c.zext.b", C_OP_R(INSN_MATCH_C_ZEXT_B), 0x1234, 0, 0x34 },
+	{ "c.sext.b", C_OP_R(INSN_MATCH_C_SEXT_B), 0x80, 0, -128UL },
+	{ "c.zext.h", C_OP_R(INSN_MATCH_C_ZEXT_H), 0x12345, 0, 0x2345 },
+	{ "c.sext.h", C_OP_R(INSN_MATCH_C_SEXT_H), 0x8000, 0, -32768UL },
+#if __riscv_xlen == 64
+	{ "c.zext.w", C_OP_R(INSN_MATCH_C_ZEXT_W), 0xffffffff12345678UL, 0,
+	  0x12345678 },
+#endif
+	{ "c.not", C_OP_R(INSN_MATCH_C_NOT), 0, 0, -1UL },
+	{ "c.mul", C_OP_RR(INSN_MATCH_C_MUL), 7, -6UL, -42UL },
+};
+
+static void c_misc_alu_test(struct sbiunit_test_case *test)
+{
+	emu_test_vectors(test, c_misc_alu_vectors,
+			 array_size(c_misc_alu_vectors),
+			 sbi_insn_emu_c_misc_alu, 11, 2);
+}
+
+#if defined(__riscv_flen) && __riscv_flen == 64
+/* rd = f3 (a0 for integer results), rs1 = f1, rs2 = f2 */
+#define FRD_F3			(3 << 7)
+#define FRS1_F1			(1 << 15)
+#define FRS2_F2			(2 << 20)
+#define RM_RTZ			(1 << 12)
+#define FP_R(match)		((match) | FRD_F3 | FRS1_F1)
+#define FP_RR(match)		((match) | FRD_F3 | FRS1_F1 | FRS2_F2)
+#define BOX_H(v)		(0xffffffffffff0000ULL | (v))
+#define BOX_S(v)		(0xffffffff00000000ULL | (v))
+
+#define FFLAG_NX		0x01
+#define FFLAG_UF		0x02
+#define FFLAG_OF		0x04
+#define FFLAG_NV		0x10
+
+struct emu_test_fp_vector {
+	const char *name;
+	ulong insn;
+	u64 rs1;
+	u64 rs2;
+	u64 rd;
+	u32 fflags;
+	/* Result in a0 instead of f3 */
+	bool int_rd;
+};
+
+static const struct emu_test_fp_vector fp_vectors[] = {
+	{ "fcvt.s.h", FP_R(INSN_MATCH_FCVT_S_H), BOX_H(0x3e00), 0,
+	  BOX_S(0x3fc00000), 0 },
+	{ "fcvt.s.h", FP_R(INSN_MATCH_FCVT_S_H), BOX_H(0x0001), 0,
+	  BOX_S(0x33800000), 0 },
+	{ "fcvt.s.h", FP_R(INSN_MATCH_FCVT_S_H), BOX_H(0x7c01), 0,
+	  BOX_S(0x7fc00000), FFLAG_NV },
+	{ "fcvt.s.h", FP_R(INSN_MATCH_FCVT_S_H), 0x3e00, 0,
+	  BOX_S(0x7fc00000), 0 },
+	{ "fcvt.h.s", FP_R(INSN_MATCH_FCVT_H_S), BOX_S(0x3fc00000), 0,
+	  BOX_H(0x3e00), 0 },
+	{ "fcvt.h.s", FP_R(INSN_MATCH_FCVT_H_S), BOX_S(0x3eaaaaab), 0,
+	  BOX_H(0x3555), FFLAG_NX },
+	{ "fcvt.h.s", FP_R(INSN_MATCH_FCVT_H_S), BOX_S(0x477ff000), 0,
+	  BOX_H(0x7c00), FFLAG_OF | FFLAG_NX },
+	{ "fcvt.h.s", FP_R(INSN_MATCH_FCVT_H_S | RM_RTZ),
+	  BOX_S(0x477ff000), 0, BOX_H(0x7bff), FFLAG_NX },
+	{ "fcvt.h.s", FP_R(INSN_MATCH_FCVT_H_S | RM_RTZ),
+	  BOX_S(0x4788b800), 0, BOX_H(0x7bff), FFLAG_OF | FFLAG_NX },
+	{ "fcvt.d.h", FP_R(INSN_MATCH_FCVT_D_H), BOX_H(0xbc00), 0,
+	  0xbff0000000000000ULL, 0 },
+	{ "fcvt.h.d", FP_R(INSN_MATCH_FCVT_H_D), 0x3ff8000000000000ULL, 0,
+	  BOX_H(0x3e00), 0 },
+	{ "fcvt.h.d", FP_R(INSN_MATCH_FCVT_H_D), 0x3ddb7cdfd9d7bdbbULL, 0,
+	  BOX_H(0x0000), FFLAG_UF | FFLAG_NX },
+	{ "fli.d", INSN_MATCH_FLI_D | FRD_F3 | (16 << 15), 0, 0,
+	  0x3ff0000000000000ULL, 0 },
+	{ "fli.d", INSN_MATCH_FLI_D | FRD_F3, 0, 0, 0xbff0000000000000ULL, 0 },
+	{ "fround.d", FP_R(INSN_MATCH_FROUND_D), 0x4004000000000000ULL, 0,
+	  0x4000000000000000ULL, 0 },
+	{ "fminm.d", FP_RR(INSN_MATCH_FMINM_D),
+	  0x3ff8000000000000ULL, 0x7ff8000000000000ULL,
+	  0x7ff8000000000000ULL, 0 },
+	{ "fcvtmod.w.d", INSN_MATCH_FCVTMOD_W_D | RD_A0 | FRS1_F1,
+	  0x400e000000000000ULL, 0, 3, FFLAG_NX, true },
+	{ "fcvtmod.w.d", INSN_MATCH_FCVTMOD_W_D | RD_A0 | FRS1_F1,
+	  0x41f0000000500000ULL, 0, 5, FFLAG_NV, true },
+	{ "fcvtmod.w.d", INSN_MATCH_FCVTMOD_W_D | RD_A0 | FRS1_F1,
+	  0xc000000000000000ULL, 0, -2UL, 0, true },
+};
+
+static void fp_test(struct sbiunit_test_case *test)
+{
+	const struct emu_test_fp_vector *v = fp_vectors;
+	struct sbi_trap_regs regs;
+	ulong fcsr, start;
+	u64 rd;
+
+	if (!misa_extension('D'))
+		return;
+
+	fcsr = csr_read(CSR_FCSR);
+
+	for (int i = 0; i < array_size(fp_vectors); i++, v++) {
+		sbi_memset(&regs, 0, sizeof(regs));
+		regs.mstatus = MSTATUS_FS | (PRV_M << MSTATUS_MPP_SHIFT);
+		SET_F64_REG(1 << 3, 3, &regs, v->rs1);
+		SET_F64_REG(2 << 3, 3, &regs, v->rs2);
+		SET_F64_REG(3 << 3, 3, &regs, 0);
+		csr_write(CSR_FCSR, 0);
+
+		SBIUNIT_EXPECT_EQ(test,
+				  sbi_insn_emu_op_fp(v->insn, &regs), 0);
+		rd = v->int_rd ? regs.a0 : GET_F64_REG(3 << 3, 3, &regs);
+		SBIUNIT_EXPECT_EQ(test, rd, v->rd);
+		SBIUNIT_EXPECT_EQ(test, csr_read(CSR_FFLAGS), v->fflags);
+		if (rd != v->rd || csr_read(CSR_FFLAGS) != v->fflags)
+			sbi_printf("[SBIUnit] %s: %s got 0x%llx/0x%lx\n",
+				   test->name, v->name, (unsigned long long)rd,
+				   csr_read(CSR_FFLAGS));
+
+		start = csr_read(CSR_MCYCLE);
+		for (int r = 0; r < EMU_TEST_ROUNDS; r++)
+			sbi_insn_emu_op_fp(v->insn, &regs);
+		emu_test_report(test, v->name, start);
+	}
+
+	csr_write(CSR_FCSR, fcsr);
+}
+#endif
+
+#if __riscv_xlen == 64
+/* vd = v3, vs1 = v1, vs2 = v2, unmasked */
+#define VRD_V3			(3 << 7)
+#define VRS1_V1			(1 << 15)
+#define VRS2_V2			(2 << 20)
+#define VM_UNMASKED		(1 << 25)
+
+#define VEC_TEST_VL		4
+
+struct emu_test_v_vector {
+	const char *name;
+	ulong insn;
+	u32 vd[VEC_TEST_VL];
+};
+
+static const u32 vec_test_vs1[VEC_TEST_VL] = {
+	0x0000ffff, 0xf0f0f0f0, 0x00000000, 0x00000001
+};
+static const u32 vec_test_vs2[VEC_TEST_VL] = {
+	0x12345678, 0xffffffff, 0x80000000, 0x00000003
+};
+
+static const struct emu_test_v_vector v_vectors[] = {
+	{ "vandn.vv", INSN_MATCH_VANDNVV | VRS1_V1,
+	  { 0x12340000, 0x0f0f0f0f, 0x80000000, 0x00000002 } },
+	{ "vrol.vv", INSN_MATCH_VROLVV | VRS1_V1,
+	  { 0x091a2b3c, 0xffffffff, 0x80000000, 0x00000006 } },
+	{ "vbrev.v", INSN_MATCH_VBREVV,
+	  { 0x1e6a2c48, 0xffffffff, 0x00000001, 0xc0000000 } },
+	{ "vclz.v", INSN_MATCH_VCLZV, { 3, 0, 0, 30 } },
+	{ "vcpop.v", INSN_MATCH_VCPOPV, { 13, 32, 1, 2 } },
+};
+
+static void v_test(struct sbiunit_test_case *test)
+{
+	const struct emu_test_v_vector *v = v_vectors;
+	struct sbi_trap_regs regs;
+	u32 vd[VEC_TEST_VL];
+	ulong insn, start;
+
+	if (!misa_extension('V'))
+		return;
+
+	sbi_memset(&regs, 0, sizeof(regs));
+	regs.mstatus = MSTATUS_VS | (PRV_M << MSTATUS_MPP_SHIFT);
+
+	for (int i = 0; i < array_size(v_vectors); i++, v++) {
+		insn = v->insn | VRD_V3 | VRS2_V2 | VM_UNMASKED;
+
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetivli zero, %2, e32, m1, ta, ma\n\t"
+			     "vle32.v v1, (%0)\n\t"
+			     "vle32.v v2, (%1)\n\t"
+			     "vmv.v.i v3, 0\n\t"
+			     ".option pop\n\t"
+			     :: "r"(vec_test_vs1), "r"(vec_test_vs2),
+				"i"(VEC_TEST_VL) : "memory");
+
+		SBIUNIT_EXPECT_EQ(test, sbi_insn_emu_op_v(insn, &regs), 0);
+
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vse32.v v3, (%0)\n\t"
+			     ".option pop\n\t"
+			     :: "r"(vd) : "memory");
+		SBIUNIT_EXPECT_MEMEQ(test, vd, v->vd, sizeof(vd));
+
+		start = csr_read(CSR_MCYCLE);
+		for (int r = 0; r < EMU_TEST_ROUNDS; r++)
+			sbi_insn_emu_op_v(insn, &regs);
+		emu_test_report(test, v->name, start);
+	}
+}
+#endif
+
+#ifdef CONFIG_SBI_INSN_EMU_FUSION
+#define R_TYPE(match, rd, rs1, rs2)					\
+	((match) | (rd) << 7 | (rs1) << 15 | (rs2) << 20)
+#define C_OR(rd, rs2)		(INSN_MATCH_C_OR | ((rd) - 8) << 7 |	\
+				 ((rs2) - 8) << 2)
+
+struct emu_test_fuse_vector {
+	const char *name;
+	ulong insn[3];
+	int count;
+	/* Expected mepc, zero if the window must not be fused */
+	ulong len;
+	/* Expected a3, a4 and a5 for a true and a false condition */
+	ulong rd[2][3];
+};
+
+/* Condition in a0, values in a1 and a2, temporaries in a3 and a4 */
+static const struct emu_test_fuse_vector fuse_vectors[] = {
+	{ "select",
+	  { R_TYPE(INSN_MATCH_CZERO_EQZ, 13, 11, 10),
+	    R_TYPE(INSN_MATCH_CZERO_NEZ, 14, 12, 10),
+	    R_TYPE(INSN_MATCH_OR, 15, 13, 14) }, 3, 12,
+	  { { 0x1111, 0, 0x1111 }, { 0, 0x2222, 0x2222 } } },
+	{ "select c.or",
+	  { R_TYPE(INSN_MATCH_CZERO_NEZ, 14, 12, 10),
+	    R_TYPE(INSN_MATCH_CZERO_EQZ, 13, 11, 10),
+	    C_OR(13, 14) }, 3, 10,
+	  { { 0x1111, 0, 0 }, { 0x2222, 0x2222, 0 } } },
+	{ "select truncated",
+	  { R_TYPE(INSN_MATCH_CZERO_EQZ, 13, 11, 10),
+	    R_TYPE(INSN_MATCH_CZERO_NEZ, 14, 12, 10) }, 2, 0 },
+	{ "select dependent",
+	  { R_TYPE(INSN_MATCH_CZERO_EQZ, 13, 11, 10),
+	    R_TYPE(INSN_MATCH_CZERO_NEZ, 14, 13, 10),
+	    R_TYPE(INSN_MATCH_OR, 15, 13, 14) }, 3, 0 },
+	{ "sh2add other base",
+	  { R_TYPE(INSN_MATCH_SH2ADD, 13, 11, 12),
+	    INSN_MATCH_LW | 10 << 7 | 14 << 15 }, 2, 0 },
+};
+
+static void fuse_test(struct sbiunit_test_case *test)
+{
+	const struct emu_test_fuse_vector *v = fuse_vectors;
+	struct sbi_trap_regs regs;
+	ulong start;
+
+	for (int i = 0; i < array_size(fuse_vectors); i++, v++) {
+		for (int c = 0; c < 2; c++) {
+			sbi_memset(&regs, 0, sizeof(regs));
+			regs.a0 = !c;
+			regs.a1 = 0x1111;
+			regs.a2 = 0x2222;
+			SBIUNIT_EXPECT_EQ(test,
+				sbi_insn_emu_fuse_window(v->insn, v->count,
+							 &regs),
+				v->len != 0);
+			SBIUNIT_EXPECT_EQ(test, regs.mepc, v->len);
+			SBIUNIT_EXPECT_EQ(test, regs.a3, v->rd[c][0]);
+			SBIUNIT_EXPECT_EQ(test, regs.a4, v->rd[c][1]);
+			SBIUNIT_EXPECT_EQ(test, regs.a5, v->rd[c][2]);
+		}
+
+		start = csr_read(CSR_MCYCLE);
+		for (int r = 0; r < EMU_TEST_ROUNDS; r++)
+			sbi_insn_emu_fuse_window(v->insn, v->count, &regs);
+		emu_test_report(test, v->name, start);
+	}
+}
+#endif
+
+static struct sbiunit_test_case insn_emu_test_cases[] = {
+	SBIUNIT_TEST_CASE(group_of_test),
+	SBIUNIT_TEST_CASE(groups_mask_test),
+	SBIUNIT_TEST_CASE(op_test),
+	SBIUNIT_TEST_CASE(op_imm_test),
+#if __riscv_xlen == 64
+	SBIUNIT_TEST_CASE(op_32_test),
+#endif
+	SBIUNIT_TEST_CASE(c_misc_alu_test),
+#if defined(__riscv_flen) && __riscv_flen == 64
+	SBIUNIT_TEST_CASE(fp_test),
+#endif
+#if __riscv_xlen == 64
+	SBIUNIT_TEST_CASE(v_test),
+#endif
+#ifdef CONFIG_SBI_INSN_EMU_FUSION
+	SBIUNIT_TEST_CASE(fuse_test),
+#endif
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(insn_emu_test_suite, insn_emu_test_cases);
@@ -0,0 +1,243 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_unit_test.h>
+
+/* Largest size tested, also the largest size of the benchmark */
+#define STRING_TEST_MAX		4096
+/* Untouched bytes around the destination of every operation */
+#define STRING_TEST_GUARD	32
+#define STRING_TEST_BUF		(STRING_TEST_MAX + 2 * STRING_TEST_GUARD)
+#define STRING_TEST_ALIGN	(2 * sizeof(unsigned long))
+/* Calls per cycle measurement */
+#define STRING_TEST_ROUNDS	16
+
+static unsigned char string_src[STRING_TEST_BUF] __aligned(16);
+static unsigned char string_dst[STRING_TEST_BUF] __aligned(16);
+static unsigned char string_ref[STRING_TEST_BUF] __aligned(16);
+
+/* Sizes around the word and unroll boundaries, and some large ones */
+static const size_t string_test_sizes[] = {
+	0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 255,
+	511, 512, 513, 1000, STRING_TEST_MAX - STRING_TEST_ALIGN,
+};
+
+static void string_fill(unsigned char *buf, unsigned char seed)
+{
+	for (int i = 0; i < STRING_TEST_BUF; i++)
+		buf[i] = seed + i * 7 + (i >> 8);
+}
+
+/* Byte-wise reference, independent of the functions under test */
+static size_t string_diff(const unsigned char *a, const unsigned char *b)
+{
+	size_t i, bad = 0;
+
+	for (i = 0; i < STRING_TEST_BUF; i++) {
+		if (a[i] != b[i])
+			bad++;
+	}
+
+	return bad;
+}
+
+static void memcpy_test(struct sbiunit_test_case *test)
+{
+	unsigned char *dst, *src;
+	size_t len, i, bad = 0;
+
+	for (int s = 0; s < STRING_TEST_ALIGN; s++) {
+		for (int d = 0; d < STRING_TEST_ALIGN; d++) {
+			for (int k = 0; k < array_size(string_test_sizes); k++) {
+				len = string_test_sizes[k];
+				src = &string_src[STRING_TEST_GUARD + s];
+				dst = &string_dst[STRING_TEST_GUARD + d];
+
+				string_fill(string_src, s + d + k);
+				string_fill(string_dst, 0x5a);
+				string_fill(string_ref, 0x5a);
+				for (i = 0; i < len; i++)
+					string_ref[STRING_TEST_GUARD + d + i] = src[i];
+
+				SBIUNIT_EXPECT_EQ(test, sbi_memcpy(dst, src, len), dst);
+				bad += string_diff(string_dst, string_ref);
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT_EQ(test, bad, 0);
+}
+
+static void memmove_test(struct sbiunit_test_case *test)
+{
+	static const int shifts[] = { -33, -17, -8, -3, -1, 1, 3, 8, 17, 33 };
+	size_t len, i, bad = 0;
+	unsigned char *src;
+	int d;
+
+	for (int s = 0; s < STRING_TEST_ALIGN; s++) {
+		for (int j = 0; j < array_size(shifts); j++) {
+			for (int k = 0; k < array_size(string_test_sizes); k++) {
+				len = string_test_sizes[k];
+				if (len > STRING_TEST_MAX - 2 * STRING_TEST_GUARD)
+					continue;
+				d = 2 * STRING_TEST_GUARD + s + shifts[j];
+				src = &string_dst[2 * STRING_TEST_GUARD + s];
+
+				string_fill(string_dst, s + j + k);
+				string_fill(string_ref, s + j + k);
+				string_fill(string_src, s + j + k);
+				for (i = 0; i < len; i++)
+					string_ref[d + i] = string_src[src - string_dst + i];
+
+				SBIUNIT_EXPECT_EQ(test,
+					sbi_memmove(&string_dst[d], src, len),
+					&string_dst[d]);
+				bad += string_diff(string_dst, string_ref);
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT_EQ(test, bad, 0);
+}
+
+static void memset_test(struct sbiunit_test_case *test)
+{
+	size_t len, i, bad = 0;
+	unsigned char *dst;
+
+	for (int d = 0; d < STRING_TEST_ALIGN; d++) {
+		for (int k = 0; k < array_size(string_test_sizes); k++) {
+			len = string_test_sizes[k];
+			dst = &string_dst[STRING_TEST_GUARD + d];
+
+			string_fill(string_dst, d + k);
+			string_fill(string_ref, d + k);
+			for (i = 0; i < len; i++)
+				string_ref[STRING_TEST_GUARD + d + i] = 0xa5;
+
+			/* Only the low byte of the value is used */
+			SBIUNIT_EXPECT_EQ(test, sbi_memset(dst, 0x7a5, len), dst);
+			bad += string_diff(string_dst, string_ref);
+		}
+	}
+
+	SBIUNIT_EXPECT_EQ(test, bad, 0);
+}
+
+static void memcmp_test(struct sbiunit_test_case *test)
+{
+	size_t len = 64, bad = 0;
+	unsigned char *a, *b;
+	int ret;
+
+	for (int s = 0; s < STRING_TEST_ALIGN; s++) {
+		for (int d = 0; d < STRING_TEST_ALIGN; d++) {
+			a = &string_src[STRING_TEST_GUARD + s];
+			b = &string_dst[STRING_TEST_GUARD + d];
+			string_fill(string_src, 0);
+			string_fill(string_dst, 0);
+			for (int i = 0; i < len; i++)
+				b[i] = a[i];
+
+			if (sbi_memcmp(a, b, len))
+				bad++;
+
+			/* The first difference decides, compared unsigned */
+			for (int p = 0; p < len; p++) {
+				b[p] = 0x80;
+				a[p] = 0x7f;
+				if (p + 1 < len)
+					a[p + 1] = 0xff;
+				ret = sbi_memcmp(a, b, len);
+				if (ret >= 0 || sbi_memcmp(b, a, len) <= 0 ||
+				    sbi_memcmp(a, b, p))
+					bad++;
+				b[p] = a[p];
+				if (p + 1 < len)
+					a[p + 1] = b[p + 1];
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT_EQ(test, bad, 0);
+	SBIUNIT_EXPECT_EQ(test, sbi_memcmp(string_src, string_dst, 0), 0);
+}
+
+static void string_bench_copy(unsigned char *dst, const unsigned char *src,
+			      size_t len)
+{
+	while (len--)
+		*dst++ = *src++;
+}
+
+static void throughput_test(struct sbiunit_test_case *test)
+{
+	static const size_t sizes[] = { 16, 64, 256, 1024, STRING_TEST_MAX };
+	ulong start, cpy, mov, set, cmp, ref;
+	unsigned char *src = &string_src[STRING_TEST_GUARD];
+	unsigned char *dst = &string_dst[STRING_TEST_GUARD];
+	size_t len;
+	int ret = 0;
+
+	string_fill(string_src, 0);
+	string_fill(string_dst, 0);
+
+	for (int i = 0; i < array_size(sizes); i++) {
+		len = sizes[i];
+
+		start = csr_read(CSR_MCYCLE);
+		for (int j = 0; j < STRING_TEST_ROUNDS; j++)
+			sbi_memcpy(dst, src, len);
+		cpy = csr_read(CSR_MCYCLE) - start;
+
+		start = csr_read(CSR_MCYCLE);
+		for (int j = 0; j < STRING_TEST_ROUNDS; j++)
+			sbi_memmove(dst + 1, dst, len);
+		mov = csr_read(CSR_MCYCLE) - start;
+
+		start = csr_read(CSR_MCYCLE);
+		for (int j = 0; j < STRING_TEST_ROUNDS; j++)
+			sbi_memset(dst, j, len);
+		set = csr_read(CSR_MCYCLE) - start;
+
+		sbi_memcpy(dst, src, len);
+		start = csr_read(CSR_MCYCLE);
+		for (int j = 0; j < STRING_TEST_ROUNDS; j++)
+			ret |= sbi_memcmp(dst, src, len);
+		cmp = csr_read(CSR_MCYCLE) - start;
+
+		start = csr_read(CSR_MCYCLE);
+		for (int j = 0; j < STRING_TEST_ROUNDS; j++)
+			string_bench_copy(dst, src, len);
+		ref = csr_read(CSR_MCYCLE) - start;
+
+		sbi_printf("[SBIUnit] %s: %lu bytes memcpy %lu memmove %lu "
+			   "memset %lu memcmp %lu bytewise %lu cycles\n",
+			   test->name, (ulong)len, cpy / STRING_TEST_ROUNDS,
+			   mov / STRING_TEST_ROUNDS, set / STRING_TEST_ROUNDS,
+			   cmp / STRING_TEST_ROUNDS, ref / STRING_TEST_ROUNDS);
+	}
+
+	SBIUNIT_EXPECT_EQ(test, ret, 0);
+}
+
+static struct sbiunit_test_case string_test_cases[] = {
+	SBIUNIT_TEST_CASE(memcpy_test),
+	SBIUNIT_TEST_CASE(memmove_test),
+	SBIUNIT_TEST_CASE(memset_test),
+	SBIUNIT_TEST_CASE(memcmp_test),
+	SBIUNIT_TEST_CASE(throughput_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(string_test_suite, string_test_cases);
@@ -9,6 +9,7 @@
 
 #define ANSI_COLOR_GREEN "\x1b[32m"
 #define ANSI_COLOR_RED "\x1b[31m"
+#define ANSI_COLOR_YELLOW "\x1b[33m"
 #define ANSI_COLOR_RESET "\x1b[0m"
 
 extern struct sbiunit_test_suite *const sbi_unit_tests[];
@@ -16,7 +17,7 @@ extern struct sbiunit_test_suite *const sbi_unit_tests[];
 static void run_test_suite(struct sbiunit_test_suite *suite)
 {
 	struct sbiunit_test_case *s_case;
-	u32 count_pass = 0, count_fail = 0;
+	u32 count_pass = 0, count_fail = 0, count_skip = 0;
 
 	sbi_printf("## Running test suite: %s\n", suite->name);
 
@@ -26,19 +27,23 @@ static void run_test_suite(struct sbiunit_test_suite *suite)
 	s_case = suite->cases;
 	while (s_case->test_func) {
 		s_case->test_func(s_case);
-		if (s_case->failed)
+		if (s_case->failed) {
 			count_fail++;
-		else
+			sbi_printf(ANSI_COLOR_RED "[FAILED]");
+		} else if (s_case->skipped) {
+			count_skip++;
+			sbi_printf(ANSI_COLOR_YELLOW "[SKIPPED]");
+		} else {
 			count_pass++;
-		sbi_printf("%s[%s]%s %s\n",
-			   s_case->failed ? ANSI_COLOR_RED : ANSI_COLOR_GREEN,
-			   s_case->failed ? "FAILED" : "PASSED",
-			   ANSI_COLOR_RESET, s_case->name);
+			sbi_printf(ANSI_COLOR_GREEN "[PASSED]");
+		}
+		sbi_printf(ANSI_COLOR_RESET " %s\n", s_case->name);
 		s_case++;
 	}
 
-	sbi_printf("%u PASSED / %u FAILED / %u TOTAL\n", count_pass, count_fail,
-		   count_pass + count_fail);
+	sbi_printf("%u PASSED / %u FAILED / %u SKIPPED / %u TOTAL\n",
+		   count_pass, count_fail, count_skip,
+		   count_pass + count_fail + count_skip);
 }
 
 void run_all_tests(void)
@@ -0,0 +1,281 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2025 Benedikt Freisen.
+ *
+ * Authors:
+ *   Benedikt Freisen <b.freisen@gmx.net>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_unit_test.h>
+#include <sbi/sbi_unpriv.h>
+#include <sbi/sbi_unpriv_ptw.h>
+
+#if defined(CONFIG_SBI_UNPRIV_PTW) && __riscv_xlen == 64
+
+#define PTE_V			(1UL << 0)
+#define PTE_R			(1UL << 1)
+#define PTE_W			(1UL << 2)
+#define PTE_X			(1UL << 3)
+#define PTE_U			(1UL << 4)
+#define PTE_A			(1UL << 6)
+#define PTE_D			(1UL << 7)
+#define PTE_PPN_SHIFT		10
+
+#define PTW_TEST_PAGE		4096UL
+/* One 4K mapping for every combination of V, R, W, X, U, A and D */
+#define PTW_TEST_COMBOS		128
+/* The combination V, R, W, X, A and D, valid for S-mode */
+#define PTW_TEST_WALKED		0x6f
+#define PTW_TEST_BASE		0x40000000UL
+/* 2M superpage covering the data page */
+#define PTW_TEST_MEGA		0x40200000UL
+/* 1G superpage with a misaligned PPN */
+#define PTW_TEST_GIGA_BAD	0x80000000UL
+/* Non-leaf root entry with A set, reserved for future use */
+#define PTW_TEST_NONLEAF_A	0xc0000000UL
+/* Bit 39 set without sign extension */
+#define PTW_TEST_NONCANON	0x8000000000UL
+
+#define PTW_TEST_LOAD_OFF	8
+#define PTW_TEST_INSN_OFF	16
+#define PTW_TEST_DATA		0x5a5aa5a5U
+#define PTW_TEST_STORE		0xc3c33c3cU
+#define PTW_TEST_INSN		0x12345677U
+
+static u64 ptw_root[512] __aligned(PTW_TEST_PAGE);
+static u64 ptw_l1[512] __aligned(PTW_TEST_PAGE);
+static u64 ptw_l0[512] __aligned(PTW_TEST_PAGE);
+static u32 ptw_data[PTW_TEST_PAGE / sizeof(u32)] __aligned(PTW_TEST_PAGE);
+
+/* Grants S/U-mode everything so that only the page tables decide */
+static struct sbi_domain_memregion ptw_test_regions[] = {
+	{
+		.order = __riscv_xlen,
+		.base = 0,
+		.flags = SBI_DOMAIN_MEMREGION_SU_RWX |
+			 SBI_DOMAIN_MEMREGION_M_RWX,
+	},
+	{ 0 },
+};
+
+static struct sbi_domain ptw_test_dom = {
+	.name = "unpriv-ptw-test",
+	.regions = ptw_test_regions,
+};
+
+struct ptw_test_ctx {
+	ulong mpp;
+	ulong flags;
+};
+
+static const struct ptw_test_ctx ptw_test_ctxs[] = {
+	{ PRV_S, 0 },
+	{ PRV_S, MSTATUS_SUM },
+	{ PRV_S, MSTATUS_MXR },
+	{ PRV_U, 0 },
+	{ PRV_U, MSTATUS_MXR },
+};
+
+enum ptw_test_op {
+	PTW_TEST_OP_LOAD,
+	PTW_TEST_OP_STORE,
+	PTW_TEST_OP_INSN,
+};
+
+struct ptw_test_result {
+	ulong cause;
+	ulong tval;
+	ulong value;
+	u32 data;
+};
+
+static inline u64 ptw_test_pte(void *target, ulong perms)
+{
+	return (((ulong)target / PTW_TEST_PAGE) << PTE_PPN_SHIFT) | perms;
+}
+
+static inline ulong ptw_test_combo_perms(int combo)
+{
+	return (combo & 0x1f) | ((combo >> 5) << 6);
+}
+
+static void ptw_test_build_tables(void)
+{
+	ulong giga_ppn = (ulong)ptw_data / PTW_TEST_PAGE;
+	ulong mega_base = (ulong)ptw_data & ~((1UL << 21) - 1);
+	int i;
+
+	for (i = 0; i < 512; i++)
+		ptw_root[i] = ptw_l1[i] = ptw_l0[i] = 0;
+
+	ptw_root[1] = ptw_test_pte(ptw_l1, PTE_V);
+	ptw_l1[0] = ptw_test_pte(ptw_l0, PTE_V);
+	ptw_l1[1] = ptw_test_pte((void *)mega_base, PTE_V | PTE_R | PTE_W |
+				 PTE_X | PTE_A | PTE_D);
+
+	/* Misaligned unless the data page happens to be 1G aligned */
+	if (giga_ppn & ((1UL << 18) - 1))
+		ptw_root[2] = ptw_test_pte(ptw_data, PTE_V | PTE_R | PTE_W |
+					   PTE_A | PTE_D);
+	ptw_root[3] = ptw_test_pte(ptw_l1, PTE_V | PTE_A);
+
+	for (i = 0; i < PTW_TEST_COMBOS; i++)
+		ptw_l0[i] = ptw_test_pte(ptw_data, ptw_test_combo_perms(i));
+
+	ptw_data[PTW_TEST_LOAD_OFF / sizeof(u32)] = PTW_TEST_DATA;
+	ptw_data[PTW_TEST_INSN_OFF / sizeof(u32)] = PTW_TEST_INSN;
+
+	/* Hardware A/D updates of the previous run must not leak */
+	__asm__ __volatile__("sfence.vma" : : : "memory");
+}
+
+static void ptw_test_run(const struct ptw_test_ctx *ctx, enum ptw_test_op op,
+			 ulong va, bool walker, struct ptw_test_result *res)
+{
+	ulong mstatus = csr_read(CSR_MSTATUS);
+	struct sbi_trap_info trap = { 0 };
+
+	ptw_test_build_tables();
+	sbi_unpriv_ptw_enable(walker);
+
+	mstatus &= ~(MSTATUS_MPP | MSTATUS_SUM | MSTATUS_MXR | MSTATUS_MPRV);
+	mstatus |= (ctx->mpp << MSTATUS_MPP_SHIFT) | ctx->flags;
+	csr_write(CSR_MSTATUS, mstatus);
+
+	switch (op) {
+	case PTW_TEST_OP_LOAD:
+		res->value = sbi_load_u32((u32 *)(va + PTW_TEST_LOAD_OFF),
+					  &trap);
+		break;
+	case PTW_TEST_OP_STORE:
+		sbi_store_u32((u32 *)(va + PTW_TEST_LOAD_OFF), PTW_TEST_STORE,
+			      &trap);
+		res->value = 0;
+		break;
+	case PTW_TEST_OP_INSN:
+		res->value = sbi_get_insn(va + PTW_TEST_INSN_OFF, &trap);
+		break;
+	}
+
+	res->cause = trap.cause;
+	res->tval = trap.cause ? trap.tval : 0;
+	if (trap.cause)
+		res->value = 0;
+	res->data = ptw_data[PTW_TEST_LOAD_OFF / sizeof(u32)];
+}
+
+static void ptw_test_compare(struct sbiunit_test_case *test, ulong va)
+{
+	struct ptw_test_result mprv, ptw;
+	int i, op;
+
+	for (i = 0; i < array_size(ptw_test_ctxs); i++) {
+		for (op = PTW_TEST_OP_LOAD; op <= PTW_TEST_OP_INSN; op++) {
+			ptw_test_run(&ptw_test_ctxs[i], op, va, false, &mprv);
+			ptw_test_run(&ptw_test_ctxs[i], op, va, true, &ptw);
+
+			SBIUNIT_EXPECT_EQ(test, ptw.cause, mprv.cause);
+			SBIUNIT_EXPECT_EQ(test, ptw.tval, mprv.tval);
+			SBIUNIT_EXPECT_EQ(test, ptw.value, mprv.value);
+			SBIUNIT_EXPECT_EQ(test, ptw.data, mprv.data);
+		}
+	}
+}
+
+static void ptw_test_mprv_equivalence(struct sbiunit_test_case *test)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	ulong mstatus, satp, paddr = 0, pmpcfg0 = 0, pmpaddr0 = 0;
+	struct sbi_trap_info trap = { 0 };
+	bool has_pmp = sbi_hart_pmp_count(scratch) > 0;
+	int i;
+
+	if (!misa_extension('S') ||
+	    sbi_hart_has_extension(scratch, SBI_HART_EXT_SMEPMP)) {
+		SBIUNIT_SKIP(test, "no S-mode or Smepmp present\n");
+		return;
+	}
+
+	if (has_pmp) {
+		pmpcfg0 = csr_read(CSR_PMPCFG0);
+		if (pmpcfg0 & PMP_L) {
+			SBIUNIT_SKIP(test, "first PMP entry is locked\n");
+			return;
+		}
+		pmpaddr0 = csr_read(CSR_PMPADDR0);
+	}
+
+	mstatus = csr_read(CSR_MSTATUS);
+	satp = csr_read(CSR_SATP);
+
+	ptw_test_build_tables();
+	csr_write(CSR_SATP, (SATP_MODE_SV39 << 60) |
+		  ((ulong)ptw_root / PTW_TEST_PAGE));
+	if ((csr_read(CSR_SATP) >> 60) != SATP_MODE_SV39) {
+		csr_write(CSR_SATP, satp);
+		SBIUNIT_SKIP(test, "Sv39 not supported\n");
+		return;
+	}
+
+	/* Without any PMP rule, S/U-mode accesses would all fault */
+	if (has_pmp) {
+		csr_write(CSR_PMPADDR0, -1UL);
+		csr_write(CSR_PMPCFG0, (pmpcfg0 & ~0xffUL) | PMP_A_NAPOT |
+			  PMP_R | PMP_W | PMP_X);
+	}
+	sbi_update_hartindex_to_domain(current_hartindex(), &ptw_test_dom);
+	sbi_unpriv_ptw_flush();
+
+	for (i = 0; i < PTW_TEST_COMBOS; i++)
+		ptw_test_compare(test, PTW_TEST_BASE + i * PTW_TEST_PAGE);
+	ptw_test_compare(test, PTW_TEST_MEGA +
+			 ((ulong)ptw_data & ((1UL << 21) - 1)));
+	ptw_test_compare(test, PTW_TEST_GIGA_BAD);
+	ptw_test_compare(test, PTW_TEST_NONLEAF_A);
+	ptw_test_compare(test, PTW_TEST_NONCANON);
+
+	/* The comparison is void unless the walker did translate */
+	ptw_test_build_tables();
+	sbi_unpriv_ptw_enable(true);
+	csr_write(CSR_MSTATUS, (mstatus & ~(MSTATUS_MPP | MSTATUS_MPRV)) |
+		  (PRV_S << MSTATUS_MPP_SHIFT));
+	SBIUNIT_EXPECT(test, sbi_unpriv_ptw_translate(PTW_TEST_BASE +
+		PTW_TEST_WALKED * PTW_TEST_PAGE, sizeof(u32),
+		SBI_UNPRIV_PTW_READ, &paddr, &trap));
+	SBIUNIT_EXPECT_EQ(test, trap.cause, 0);
+	SBIUNIT_EXPECT_EQ(test, paddr, (ulong)ptw_data);
+
+	sbi_update_hartindex_to_domain(current_hartindex(), dom);
+	if (has_pmp) {
+		csr_write(CSR_PMPCFG0, pmpcfg0);
+		csr_write(CSR_PMPADDR0, pmpaddr0);
+	}
+	csr_write(CSR_SATP, satp);
+	csr_write(CSR_MSTATUS, mstatus);
+	__asm__ __volatile__("sfence.vma" : : : "memory");
+	sbi_unpriv_ptw_enable(true);
+	sbi_unpriv_ptw_flush();
+}
+
+#else
+
+static void ptw_test_mprv_equivalence(struct sbiunit_test_case *test)
+{
+}
+
+#endif
+
+static struct sbiunit_test_case unpriv_ptw_test_cases[] = {
+	SBIUNIT_TEST_CASE(ptw_test_mprv_equivalence),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(unpriv_ptw_test_suite, unpriv_ptw_test_cases);
@@ -13,6 +13,8 @@
 #include <sbi/sbi_domain.h>
 #include <sbi/sbi_math.h>
 #include <sbi/sbi_hart.h>
+#include <sbi/sbi_insn_emu.h>
+#include <sbi/sbi_insn_emu_calib.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_error.h>
@@ -106,11 +108,94 @@ int fdt_add_cpu_idle_states(void *fdt, const struct sbi_cpu_idle_state *state)
 	return 0;
 }
 
+#ifdef CONFIG_FDT_FIXUPS_ISA_EMU
+/* Length of "opensbi,isa-extensions-perf" entries */
+#define FDT_ISA_EMU_PERF_LEN	32
+/* Space the fixup of one CPU node takes at most */
+#define FDT_ISA_EMU_FIXUP_SIZE	\
+	(SBI_ISA_EMU_GROUP_MAX * (8 + FDT_ISA_EMU_PERF_LEN) + 64)
+
+static const char *fdt_isa_emu_perf_class(struct sbi_scratch *scratch,
+					  u32 group, unsigned long native)
+{
+	u32 hartid = sbi_hartindex_to_hartid(scratch->hartindex);
+	unsigned long trap, cost;
+
+	if (native & BIT(group))
+		return "native";
+
+	/* Without calibration data every trap counts as slow */
+	if (sbi_insn_emu_calib_trap_cost(hartid, &trap) ||
+	    sbi_insn_emu_calib_cost(hartid, group, &cost))
+		return "emulated-slow";
+
+	return (trap + cost <= CONFIG_FDT_FIXUPS_ISA_EMU_FAST_CYCLES) ?
+		"emulated-fast" : "emulated-slow";
+}
+
+static int fdt_cpu_fixup_isa_emu(void *fdt, int cpu_offset,
+				 struct sbi_scratch *scratch)
+{
+	unsigned long native = sbi_hart_emu_groups_native(scratch);
+	unsigned long emulated = sbi_insn_emu_groups_emulated(scratch);
+	const char *extensions, *name;
+	char perf[FDT_ISA_EMU_PERF_LEN];
+	int err, len;
+	u32 g;
+
+	/* Same as for Zicntr, only extend existing properties */
+	if (!fdt_getprop(fdt, cpu_offset, "riscv,isa-extensions", &len))
+		return 0;
+
+	err = fdt_delprop(fdt, cpu_offset, "opensbi,isa-extensions-perf");
+	if (err && err != -FDT_ERR_NOTFOUND)
+		return err;
+
+	for (g = 0; g < SBI_ISA_EMU_GROUP_MAX; g++) {
+		if (!((native | emulated) & BIT(g)))
+			continue;
+
+		name = sbi_insn_emu_group_name(g);
+		extensions = fdt_getprop(fdt, cpu_offset,
+					 "riscv,isa-extensions", &len);
+		if (!extensions)
+			return len;
+		if ((emulated & BIT(g)) &&
+		    !fdt_stringlist_contains(extensions, len, name)) {
+			err = fdt_appendprop_string(fdt, cpu_offset,
+						    "riscv,isa-extensions",
+						    name);
+			if (err)
+				return err;
+		}
+
+		sbi_snprintf(perf, sizeof(perf), "%s:%s", name,
+			     fdt_isa_emu_perf_class(scratch, g, native));
+		err = fdt_appendprop_string(fdt, cpu_offset,
+					    "opensbi,isa-extensions-perf",
+					    perf);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+#else
+#define FDT_ISA_EMU_FIXUP_SIZE	0
+
+static int fdt_cpu_fixup_isa_emu(void *fdt, int cpu_offset,
+				 struct sbi_scratch *scratch)
+{
+	return 0;
+}
+#endif
+
 void fdt_cpu_fixup(void *fdt)
 {
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 	struct sbi_domain *dom = sbi_domain_thishart_ptr();
-	int err, cpu_offset, cpus_offset, len;
+	int err, cpu_offset, cpus_offset, len, cpus = 0;
+	struct sbi_scratch *hscratch;
 	const char *mmu_type, *extensions;
 	u32 hartid, hartindex;
 	bool emulated_zicntr;
@@ -124,7 +209,16 @@ void fdt_cpu_fixup(void *fdt)
 			  sbi_hart_has_csr(scratch, SBI_HART_CSR_CYCLE) &&
 			  sbi_hart_has_csr(scratch, SBI_HART_CSR_INSTRET);
 
-	err = fdt_open_into(fdt, fdt, fdt_totalsize(fdt) + 32);
+	cpus_offset = fdt_path_offset(fdt, "/cpus");
+	if (cpus_offset < 0)
+		return;
+
+	/* Make room for the fixups of all CPU nodes at once */
+	fdt_for_each_subnode(cpu_offset, fdt, cpus_offset)
+		cpus++;
+
+	err = fdt_open_into(fdt, fdt, fdt_totalsize(fdt) + 32 +
+			    cpus * (16 + FDT_ISA_EMU_FIXUP_SIZE));
 	if (err < 0)
 		return;
 
@@ -153,6 +247,22 @@ void fdt_cpu_fixup(void *fdt)
 			fdt_setprop_string(fdt, cpu_offset, "status",
 					   "disabled");
 
+		/*
+		 * Claim extensions emulated by OpenSBI and describe their
+		 * performance class, based on the features of the HART of
+		 * the node. HARTs that have not been started yet have not
+		 * detected their features, they are assumed to be like the
+		 * boot HART.
+		 */
+		hscratch = sbi_hartid_to_scratch(hartid);
+		if (!hscratch || !sbi_hart_features_detected(hscratch))
+			hscratch = scratch;
+		err = fdt_cpu_fixup_isa_emu(fdt, cpu_offset, hscratch);
+		if (err)
+			sbi_printf("%s: ISA emulation fixup of hart %u "
+				   "failed (error %d)\n", __func__, hartid,
+				   err);
+
 		if (!emulated_zicntr)
 			continue;
 
@@ -163,14 +273,9 @@ void fdt_cpu_fixup(void *fdt)
 		 * property if there hasn't been already one.
 		 */
 		if (extensions &&
-		    !fdt_stringlist_contains(extensions, len, "zicntr")) {
-			err = fdt_open_into(fdt, fdt, fdt_totalsize(fdt) + 16);
-			if (err)
-				continue;
-
+		    !fdt_stringlist_contains(extensions, len, "zicntr"))
 			fdt_appendprop_string(fdt, cpu_offset,
 					      "riscv,isa-extensions", "zicntr");
-		}
 	}
 }
 
@@ -45,6 +45,34 @@ static void mswi_ipi_send(u32 hart_index)
 			mswi->first_hartid]);
 }
 
+static void mswi_ipi_send_many(const struct sbi_hartmask *mask)
+{
+	u32 i, hartid, *msip = NULL;
+	struct sbi_scratch *scratch;
+	struct aclint_mswi_data *mswi = NULL;
+
+	/*
+	 * Consecutive HARTs mostly share an MSWI device, so look up the
+	 * device only when a target is outside the current one.
+	 */
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		hartid = sbi_hartindex_to_hartid(i);
+		if (!mswi || hartid < mswi->first_hartid ||
+		    hartid - mswi->first_hartid >= mswi->hart_count) {
+			scratch = sbi_hartindex_to_scratch(i);
+			if (!scratch)
+				continue;
+			mswi = mswi_get_hart_data_ptr(scratch);
+			if (!mswi)
+				continue;
+			msip = (void *)mswi->addr;
+		}
+
+		/* Set ACLINT IPI */
+		writel_relaxed(1, &msip[hartid - mswi->first_hartid]);
+	}
+}
+
 static void mswi_ipi_clear(void)
 {
 	u32 *msip;
@@ -63,6 +91,7 @@ static void mswi_ipi_clear(void)
 static struct sbi_ipi_device aclint_mswi = {
 	.name = "aclint-mswi",
 	.ipi_send = mswi_ipi_send,
+	.ipi_send_many = mswi_ipi_send_many,
 	.ipi_clear = mswi_ipi_clear
 };
 
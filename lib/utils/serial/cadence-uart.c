@@ -34,13 +34,17 @@
 #define UART_BRGR_CD_CLKDIVISOR	0x00000001	/* baud_sample = sel_clk */
 
 #define	UART_CSR_REMPTY		0x00000002
+#define	UART_CSR_TEMPTY		0x00000008
 #define	UART_CSR_TFUL		0x00000010
 
+#define UART_FIFO_SIZE		64
+
 /* clang-format on */
 
 static volatile void *uart_base;
 static u32 uart_in_freq;
 static u32 uart_baudrate;
+static u32 uart_fifo_size;
 
 /*
  * Find minimum divisor divides in_freq to max_target_hz;
@@ -76,6 +80,33 @@ static void cadence_uart_putc(char ch)
 	set_reg(UART_REG_RFIFO_TFIFO, ch);
 }
 
+/* Each check of TEMPTY allows writing up to the TX FIFO depth */
+static unsigned long cadence_uart_puts(const char *str, unsigned long len)
+{
+	unsigned long i = 0;
+	bool cr = false;
+	u32 room = 0;
+
+	while (i < len) {
+		if (!room) {
+			while (!(get_reg(UART_REG_CSR) & UART_CSR_TEMPTY))
+				;
+			room = uart_fifo_size;
+		}
+
+		if (str[i] == '\n' && !cr) {
+			set_reg(UART_REG_RFIFO_TFIFO, '\r');
+			cr = true;
+		} else {
+			set_reg(UART_REG_RFIFO_TFIFO, str[i++]);
+			cr = false;
+		}
+		room--;
+	}
+
+	return len;
+}
+
 static int cadence_uart_getc(void)
 {
 	u32 ret = get_reg(UART_REG_CSR);
@@ -89,14 +120,17 @@ static int cadence_uart_getc(void)
 static struct sbi_console_device cadence_console = {
 	.name = "cadence_uart",
 	.console_putc = cadence_uart_putc,
+	.console_puts = cadence_uart_puts,
 	.console_getc = cadence_uart_getc
 };
 
-int cadence_uart_init(unsigned long base, u32 in_freq, u32 baudrate)
+int cadence_uart_init(unsigned long base, u32 in_freq, u32 baudrate,
+		      u32 fifo_size)
 {
-	uart_base     = (volatile void *)base;
-	uart_in_freq  = in_freq;
-	uart_baudrate = baudrate;
+	uart_base      = (volatile void *)base;
+	uart_in_freq   = in_freq;
+	uart_baudrate  = baudrate;
+	uart_fifo_size = fifo_size ? fifo_size : UART_FIFO_SIZE;
 
 	/* Disable interrupts */
 	set_reg(UART_REG_IDR, 0xFFFFFFFF);
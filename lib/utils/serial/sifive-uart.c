@@ -25,13 +25,18 @@
 #define UART_RXFIFO_EMPTY	0x80000000
 #define UART_RXFIFO_DATA	0x000000ff
 #define UART_TXCTRL_TXEN	0x1
+#define UART_TXCTRL_TXCNT(n)	((n) << 16)
 #define UART_RXCTRL_RXEN	0x1
+#define UART_IP_TXWM		0x1
+
+#define UART_FIFO_SIZE		8
 
 /* clang-format on */
 
 static volatile char *uart_base;
 static u32 uart_in_freq;
 static u32 uart_baudrate;
+static u32 uart_fifo_size;
 
 /**
  * Find minimum divisor divides in_freq to max_target_hz;
@@ -74,6 +79,36 @@ static void sifive_uart_putc(char ch)
 	set_reg(UART_REG_TXFIFO, ch);
 }
 
+/*
+ * With a TX watermark of one, TXWM is pending once the TX FIFO is empty,
+ * so each check of it allows writing up to the FIFO depth.
+ */
+static unsigned long sifive_uart_puts(const char *str, unsigned long len)
+{
+	unsigned long i = 0;
+	bool cr = false;
+	u32 room = 0;
+
+	while (i < len) {
+		if (!room) {
+			while (!(get_reg(UART_REG_IP) & UART_IP_TXWM))
+				;
+			room = uart_fifo_size;
+		}
+
+		if (str[i] == '\n' && !cr) {
+			set_reg(UART_REG_TXFIFO, '\r');
+			cr = true;
+		} else {
+			set_reg(UART_REG_TXFIFO, str[i++]);
+			cr = false;
+		}
+		room--;
+	}
+
+	return len;
+}
+
 static int sifive_uart_getc(void)
 {
 	u32 ret = get_reg(UART_REG_RXFIFO);
@@ -87,14 +122,17 @@ static int sifive_uart_getc(void)
 static struct sbi_console_device sifive_console = {
 	.name = "sifive_uart",
 	.console_putc = sifive_uart_putc,
+	.console_puts = sifive_uart_puts,
 	.console_getc = sifive_uart_getc
 };
 
-int sifive_uart_init(unsigned long base, u32 in_freq, u32 baudrate)
+int sifive_uart_init(unsigned long base, u32 in_freq, u32 baudrate,
+		     u32 fifo_size)
 {
-	uart_base     = (volatile char *)base;
-	uart_in_freq  = in_freq;
-	uart_baudrate = baudrate;
+	uart_base      = (volatile char *)base;
+	uart_in_freq   = in_freq;
+	uart_baudrate  = baudrate;
+	uart_fifo_size = fifo_size ? fifo_size : UART_FIFO_SIZE;
 
 	/* Configure baudrate */
 	if (in_freq && baudrate)
@@ -103,8 +141,8 @@ int sifive_uart_init(unsigned long base, u32 in_freq, u32 baudrate)
 	/* Disable interrupts */
 	set_reg(UART_REG_IE, 0);
 
-	/* Enable TX */
-	set_reg(UART_REG_TXCTRL, UART_TXCTRL_TXEN);
+	/* Enable TX, with the watermark pending when the TX FIFO is empty */
+	set_reg(UART_REG_TXCTRL, UART_TXCTRL_TXEN | UART_TXCTRL_TXCNT(1));
 
 	/* Enable Rx */
 	set_reg(UART_REG_RXCTRL, UART_RXCTRL_RXEN);
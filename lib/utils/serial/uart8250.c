@@ -39,6 +39,9 @@
 #define UART_LSR_DR		0x01	/* Receiver data ready */
 #define UART_LSR_BRK_ERROR_BITS	0x1E	/* BI, FE, PE, OE bits */
 
+#define UART_IIR_FIFO_ENABLED	0xC0	/* FIFOs enabled, 16550A and later */
+#define UART_16550A_FIFO_SIZE	16
+
 /* The XScale PXA UARTs define these bits */
 #define UART_IER_DMAE		0x80	/* DMA Requests Enable */
 #define UART_IER_UUE		0x40	/* UART Unit Enable */
@@ -52,6 +55,7 @@ static u32 uart8250_in_freq;
 static u32 uart8250_baudrate;
 static u32 uart8250_reg_width;
 static u32 uart8250_reg_shift;
+static u32 uart8250_fifo_size;
 
 static u32 get_reg(u32 num)
 {
@@ -85,6 +89,36 @@ static void uart8250_putc(char ch)
 	set_reg(UART_THR_OFFSET, ch);
 }
 
+/*
+ * THRE is only set once the whole TX FIFO has drained, so each check of
+ * it allows writing up to the FIFO depth.
+ */
+static unsigned long uart8250_puts(const char *str, unsigned long len)
+{
+	unsigned long i = 0;
+	bool cr = false;
+	u32 room = 0;
+
+	while (i < len) {
+		if (!room) {
+			while ((get_reg(UART_LSR_OFFSET) & UART_LSR_THRE) == 0)
+				;
+			room = uart8250_fifo_size;
+		}
+
+		if (str[i] == '\n' && !cr) {
+			set_reg(UART_THR_OFFSET, '\r');
+			cr = true;
+		} else {
+			set_reg(UART_THR_OFFSET, str[i++]);
+			cr = false;
+		}
+		room--;
+	}
+
+	return len;
+}
+
 static int uart8250_getc(void)
 {
 	if (get_reg(UART_LSR_OFFSET) & UART_LSR_DR)
@@ -95,11 +129,12 @@ static int uart8250_getc(void)
 static struct sbi_console_device uart8250_console = {
 	.name = "uart8250",
 	.console_putc = uart8250_putc,
+	.console_puts = uart8250_puts,
 	.console_getc = uart8250_getc
 };
 
 int uart8250_init(unsigned long base, u32 in_freq, u32 baudrate, u32 reg_shift,
-		  u32 reg_width, u32 reg_offset, u32 caps)
+		  u32 reg_width, u32 reg_offset, u32 caps, u32 fifo_size)
 {
 	u16 bdiv = 0;
 
@@ -131,6 +166,14 @@ int uart8250_init(unsigned long base, u32 in_freq, u32 baudrate, u32 reg_shift,
 	set_reg(UART_LCR_OFFSET, 0x03);
 	/* Enable FIFO */
 	set_reg(UART_FCR_OFFSET, 0x01);
+	/* Without a given depth, assume 16 bytes if the FIFO got enabled */
+	if (fifo_size)
+		uart8250_fifo_size = fifo_size;
+	else if ((get_reg(UART_IIR_OFFSET) & UART_IIR_FIFO_ENABLED) ==
+		 UART_IIR_FIFO_ENABLED)
+		uart8250_fifo_size = UART_16550A_FIFO_SIZE;
+	else
+		uart8250_fifo_size = 1;
 	/* No modem control DTR RTS */
 	set_reg(UART_MCR_OFFSET, 0x00);
 	/* Clear line status and read receive buffer */
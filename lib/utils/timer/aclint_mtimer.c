@@ -162,6 +162,16 @@ static int aclint_mtimer_warm_init(void)
 	mt->time_wr(true, -1ULL,
 		    &mt_time_cmp[target_hart - mt->first_hartid]);
 
+	/*
+	 * The ecall fast path writes Time Compare with a single sd on RV64
+	 * and with the sequence of mtimer_time_wr32() on RV32.
+	 */
+#if __riscv_xlen != 32
+	if (mt->has_64bit_mmio)
+#endif
+		sbi_timer_set_fast_timecmp(
+			&mt_time_cmp[target_hart - mt->first_hartid]);
+
 	return 0;
 }
 
@@ -80,7 +80,7 @@ static int ariane_early_init(bool cold_boot)
 			     ARIANE_UART_REG_SHIFT,
 			     ARIANE_UART_REG_WIDTH,
 			     ARIANE_UART_REG_OFFSET,
-			     ARIANE_UART_CAPS);
+			     ARIANE_UART_CAPS, 0);
 }
 
 /*
@@ -108,7 +108,7 @@ static int openpiton_early_init(bool cold_boot)
 			     OPENPITON_DEFAULT_UART_REG_SHIFT,
 			     OPENPITON_DEFAULT_UART_REG_WIDTH,
 			     OPENPITON_DEFAULT_UART_REG_OFFSET,
-			     OPENPITON_DEFAULT_UART_CAPS);
+			     OPENPITON_DEFAULT_UART_CAPS, uart.fifo_size);
 }
 
 /*
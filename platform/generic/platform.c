@@ -39,8 +39,8 @@ static u32 fw_platform_calculate_heap_size(u32 hart_count)
 
 	heap_size = SBI_PLATFORM_DEFAULT_HEAP_SIZE(hart_count);
 
-	/* For TLB fifo */
-	heap_size += SBI_TLB_INFO_SIZE * (hart_count) * (hart_count);
+	/* For TLB queues */
+	heap_size += SBI_TLB_SLOT_SIZE * (hart_count) * (hart_count);
 
 	return BIT_ALIGN(heap_size, HEAP_BASE_ALIGN);
 }
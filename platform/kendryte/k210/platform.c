@@ -118,7 +118,7 @@ static int k210_early_init(bool cold_boot)
 	sbi_system_reset_add_device(&k210_reset);
 
 	return sifive_uart_init(K210_UART_BASE_ADDR, k210_get_clk_freq(),
-				K210_UART_BAUDRATE);
+				K210_UART_BAUDRATE, 0);
 }
 
 static int k210_final_init(bool cold_boot)
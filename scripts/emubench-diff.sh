@@ -0,0 +1,145 @@
+#!/usr/bin/env bash
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Compare the console logs of two runs of the emubench payload
+#
+
+function usage()
+{
+	cat <<EOF >&2
+Usage:  $0 [options] <old_log> <new_log>
+
+Options:
+     -h                   Display help or usage
+     -t                   Compare time instead of cycles
+     -n                   Subtract the base.nop loop overhead
+     -a                   List all cases, not just the changed ones
+     -p <percent>         Minimum change to list (Default: 2)
+EOF
+	exit 1;
+}
+
+# Command line options
+METRIC="cycles"
+SUB_NOP="no"
+SHOW_ALL="no"
+THRESHOLD=2
+
+while getopts "htnap:" o; do
+	case "${o}" in
+	h)
+		usage
+		;;
+	t)
+		METRIC="time"
+		;;
+	n)
+		SUB_NOP="yes"
+		;;
+	a)
+		SHOW_ALL="yes"
+		;;
+	p)
+		THRESHOLD=${OPTARG}
+		;;
+	*)
+		usage
+		;;
+	esac
+done
+shift $((OPTIND-1))
+
+if [ $# -ne 2 ]; then
+	echo "Two log files required" >&2
+	usage
+fi
+
+for f in "$1" "$2"; do
+	if [ ! -f "${f}" ]; then
+		echo "The log file ${f} does not exist" >&2
+		usage
+	fi
+done
+
+awk -v metric="${METRIC}" -v sub_nop="${SUB_NOP}" \
+    -v show_all="${SHOW_ALL}" -v threshold="${THRESHOLD}" '
+# Returns the per-op cost of a result line, or -1 for skipped cases
+function cost(line,	n, i, kv, ops, val) {
+	n = split(line, kv, /[ =]/)
+	ops = 0
+	val = -1
+	for (i = 1; i < n; i += 2) {
+		if (kv[i] == "ops")
+			ops = kv[i + 1]
+		else if (kv[i] == metric)
+			val = kv[i + 1]
+	}
+	return (ops > 0 && val >= 0) ? val / ops : -1
+}
+
+function field(line, key,	re) {
+	re = " " key "=[^ ]*"
+	if (!match(line, re))
+		return ""
+	return substr(line, RSTART + length(key) + 2, RLENGTH - length(key) - 2)
+}
+
+{
+	sub(/\r$/, "")
+	if (!sub(/^.*emubench: /, "") || $0 !~ /^name=/)
+		next
+	key = field(" " $0, "name") " " field($0, "mode")
+	if (FILENAME == ARGV[1]) {
+		old[key] = cost($0)
+	} else {
+		new[key] = cost($0)
+		if (!(key in seen)) {
+			seen[key] = 1
+			order[count++] = key
+		}
+	}
+}
+
+END {
+	for (key in old) {
+		if (!(key in seen)) {
+			seen[key] = 1
+			order[count++] = key
+		}
+	}
+
+	printf "%-40s %4s %12s %12s %8s\n", "name", "mode", "old", "new", "delta"
+	for (i = 0; i < count; i++) {
+		key = order[i]
+		split(key, nm, " ")
+		o = (key in old) ? old[key] : -1
+		n = (key in new) ? new[key] : -1
+		if (sub_nop == "yes" && nm[1] != "base.nop" &&
+		    nm[1] !~ /^(ecall|throughput)\./) {
+			nop = "base.nop " nm[2]
+			if (o >= 0 && (nop in old) && old[nop] >= 0)
+				o = (o > old[nop]) ? o - old[nop] : 0
+			if (n >= 0 && (nop in new) && new[nop] >= 0)
+				n = (n > new[nop]) ? n - new[nop] : 0
+		}
+
+		if (o < 0 || n < 0) {
+			printf "%-40s %4s %12s %12s %8s\n", nm[1], nm[2],
+			       (o < 0) ? "-" : sprintf("%.2f", o),
+			       (n < 0) ? "-" : sprintf("%.2f", n),
+			       (o < 0 && n < 0) ? "skip" : "n/a"
+			continue
+		}
+
+		delta = (o > 0) ? 100 * (n - o) / o : 0
+		if (show_all != "yes" && delta < threshold &&
+		    delta > -threshold)
+			continue
+		changed++
+		printf "%-40s %4s %12.2f %12.2f %+7.1f%%\n", nm[1], nm[2],
+		       o, n, delta
+	}
+	printf "%d case(s) with %s change of %s%% or more\n",
+	       changed, metric, threshold
+}' "$1" "$2"
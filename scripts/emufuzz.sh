@@ -0,0 +1,254 @@
+#!/usr/bin/env bash
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Differential fuzzing of the instruction emulators on QEMU
+#
+# Runs the emufuzz payload once on a CPU that implements the emulated
+# extensions and once on a CPU without them, then reports the cases
+# whose state diverges and the emulation slowdown per instruction.
+#
+
+function usage()
+{
+	cat <<EOF >&2
+Usage:  $0 [options] <fw_payload.elf>
+
+The firmware must be built with FW_PAYLOAD_PATH pointing to
+build/platform/generic/firmware/payloads/emufuzz.bin.
+
+Options:
+     -h                   Display help or usage
+     -q <qemu>            QEMU binary (Default: qemu-system-riscv64)
+     -c <cpu>             Base CPU model (Default: rv64)
+     -s <seed>            Seed of the random streams (Default: 1)
+     -n <cases>           Number of cases (Default: 1000)
+     -l <len>             Maximum instructions per case (Default: 8)
+     -d <count>           Dump at most <count> divergent cases (Default: 4)
+     -t <seconds>         Timeout of each QEMU run (Default: 600)
+     -o <dir>             Keep the QEMU logs in <dir>
+     -B                   Skip the per instruction timing
+EOF
+	exit 1;
+}
+
+# Command line options
+QEMU="qemu-system-riscv64"
+CPU="rv64"
+SEED=1
+CASES=1000
+LEN=8
+MAX_DUMPS=4
+TIMEOUT=600
+OUT_DIR=""
+BENCH=1
+
+while getopts "hq:c:s:n:l:d:t:o:B" o; do
+	case "${o}" in
+	h)
+		usage
+		;;
+	q)
+		QEMU=${OPTARG}
+		;;
+	c)
+		CPU=${OPTARG}
+		;;
+	s)
+		SEED=${OPTARG}
+		;;
+	n)
+		CASES=${OPTARG}
+		;;
+	l)
+		LEN=${OPTARG}
+		;;
+	d)
+		MAX_DUMPS=${OPTARG}
+		;;
+	t)
+		TIMEOUT=${OPTARG}
+		;;
+	o)
+		OUT_DIR=${OPTARG}
+		;;
+	B)
+		BENCH=0
+		;;
+	*)
+		usage
+		;;
+	esac
+done
+shift $((OPTIND-1))
+
+if [ $# -ne 1 ]; then
+	echo "Firmware image required" >&2
+	usage
+fi
+
+FW=$1
+if [ ! -f "${FW}" ]; then
+	echo "The firmware image ${FW} does not exist" >&2
+	usage
+fi
+
+if [ -z "${OUT_DIR}" ]; then
+	OUT_DIR=$(mktemp -d)
+	trap 'rm -rf "${OUT_DIR}"' EXIT
+else
+	mkdir -p "${OUT_DIR}"
+fi
+
+# Extensions that OpenSBI emulates when the CPU lacks them
+EXTS="zba zbb zbc zbs zicond zcb zfa zfh zfhmin zvbb zvfh zknd zkne zknh"
+
+function cpu_model()
+{
+	local model="${CPU},v=true,vlen=128"
+	local ext
+
+	for ext in ${EXTS}; do
+		model="${model},${ext}=$1"
+	done
+	echo "${model}"
+}
+
+# run_qemu <native|emulated> <options> <log>
+function run_qemu()
+{
+	local enable="false"
+
+	if [ "$1" == "native" ]; then
+		enable="true"
+	fi
+
+	timeout "${TIMEOUT}" "${QEMU}" -M virt -m 256M -smp 1 -nographic \
+		-bios "${FW}" -cpu "$(cpu_model ${enable})" \
+		-fw_cfg name=opt/org.opensbi.emufuzz,string="$2" \
+		</dev/null >"$3" 2>&1
+	if ! grep -q "emufuzz: end" "$3"; then
+		echo "The $1 run did not finish, see $3" >&2
+		tail -n 20 "$3" >&2
+		exit 1
+	fi
+}
+
+OPTS="seed=${SEED} cases=${CASES} len=${LEN} bench=${BENCH}"
+for cfg in native emulated; do
+	echo "Running ${CASES} cases on the ${cfg} CPU"
+	run_qemu ${cfg} "${OPTS}" "${OUT_DIR}/${cfg}.log"
+done
+
+# Print the numbers of the divergent cases
+DIVERGENT=$(awk '
+{
+	sub(/\r$/, "")
+	if (!sub(/^.*emufuzz: case=/, ""))
+		next
+	n = $1
+	sub(/^[0-9]+ /, "")
+	if (FILENAME == ARGV[1])
+		native[n] = $0
+	else
+		emulated[n] = $0
+}
+
+END {
+	for (n in native)
+		if (!(n in emulated) || native[n] != emulated[n])
+			print n
+	for (n in emulated)
+		if (!(n in native))
+			print n
+}' "${OUT_DIR}/native.log" "${OUT_DIR}/emulated.log" | sort -n)
+
+COUNT=$(echo "${DIVERGENT}" | grep -c .)
+echo "${COUNT} of ${CASES} case(s) diverge"
+
+DUMPS=0
+for n in ${DIVERGENT}; do
+	if [ "${DUMPS}" -ge "${MAX_DUMPS}" ]; then
+		break
+	fi
+	DUMPS=$((DUMPS + 1))
+
+	OPTS="seed=${SEED} cases=0 len=${LEN} dump=${n} bench=0"
+	for cfg in native emulated; do
+		run_qemu ${cfg} "${OPTS}" "${OUT_DIR}/${cfg}-${n}.log"
+	done
+
+	echo
+	echo "Case ${n}:"
+	awk '
+	{
+		sub(/\r$/, "")
+		if (!sub(/^.*emufuzz: dump case=[0-9]+ /, ""))
+			next
+		if ($1 == "insn") {
+			if (FILENAME == ARGV[1])
+				printf "  insn %s\n", $2
+			next
+		}
+		if ($1 != "out")
+			next
+		reg = substr($2, 1, index($2, "=") - 1)
+		val = substr($0, 5)
+		if (FILENAME == ARGV[1])
+			native[reg] = val
+		else if (native[reg] != val)
+			printf "  native   %s\n  emulated %s\n", native[reg],
+			       val
+	}' "${OUT_DIR}/native-${n}.log" "${OUT_DIR}/emulated-${n}.log"
+done
+
+if [ "${BENCH}" -eq 0 ]; then
+	[ "${COUNT}" -eq 0 ]
+	exit
+fi
+
+echo
+awk '
+function field(line, key,	re) {
+	re = " " key "=[^ ]*"
+	if (!match(line, re))
+		return ""
+	return substr(line, RSTART + length(key) + 2, RLENGTH - length(key) - 2)
+}
+
+{
+	sub(/\r$/, "")
+	if (!sub(/^.*emufuzz: /, "") || $0 !~ /^insn=/)
+		next
+	name = field(" " $0, "insn")
+	ops = field($0, "ops")
+	time = field($0, "time")
+	cost = (ops > 0 && time != "") ? time / ops : -1
+	if (FILENAME == ARGV[1]) {
+		native[name] = cost
+		order[count++] = name
+	} else {
+		emulated[name] = cost
+	}
+}
+
+END {
+	printf "%-24s %12s %12s %10s\n", "insn", "native", "emulated",
+	       "slowdown"
+	for (i = 0; i < count; i++) {
+		name = order[i]
+		n = native[name]
+		e = (name in emulated) ? emulated[name] : -1
+		if (n < 0 || e < 0) {
+			printf "%-24s %12s %12s %10s\n", name,
+			       (n < 0) ? "trap" : sprintf("%.4f", n),
+			       (e < 0) ? "trap" : sprintf("%.4f", e), "n/a"
+			continue
+		}
+		printf "%-24s %12.4f %12.4f %9.1fx\n", name, n, e,
+		       (n > 0) ? e / n : 0
+	}
+	printf "Time in timer ticks per instruction\n"
+}' "${OUT_DIR}/native.log" "${OUT_DIR}/emulated.log"
+
+[ "${COUNT}" -eq 0 ]
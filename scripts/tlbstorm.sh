@@ -0,0 +1,116 @@
+#!/usr/bin/env bash
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Remote fence storm on QEMU
+#
+# Runs the tlbstorm payload with different numbers of HARTs and prints
+# the time of the storm per remote fence request.
+#
+
+function usage()
+{
+	cat <<EOF >&2
+Usage:  $0 [options] <fw_payload.elf>
+
+The firmware must be built with FW_PAYLOAD_PATH pointing to
+build/platform/generic/firmware/payloads/tlbstorm.bin.
+
+Options:
+     -h                   Display help or usage
+     -q <qemu>            QEMU binary (Default: qemu-system-riscv64)
+     -c <cpu>             CPU model (Default: rv64)
+     -s "<harts> ..."     Numbers of HARTs to run (Default: "8 16 32 64")
+     -t <seconds>         Timeout of each QEMU run (Default: 600)
+     -o <dir>             Keep the QEMU logs in <dir>
+EOF
+	exit 1;
+}
+
+# Command line options
+QEMU="qemu-system-riscv64"
+CPU="rv64"
+SMP="8 16 32 64"
+TIMEOUT=600
+OUT_DIR=""
+
+while getopts "hq:c:s:t:o:" o; do
+	case "${o}" in
+	h)
+		usage
+		;;
+	q)
+		QEMU=${OPTARG}
+		;;
+	c)
+		CPU=${OPTARG}
+		;;
+	s)
+		SMP=${OPTARG}
+		;;
+	t)
+		TIMEOUT=${OPTARG}
+		;;
+	o)
+		OUT_DIR=${OPTARG}
+		;;
+	*)
+		usage
+		;;
+	esac
+done
+shift $((OPTIND-1))
+
+if [ $# -ne 1 ]; then
+	echo "Firmware image required" >&2
+	usage
+fi
+
+FW=$1
+if [ ! -f "${FW}" ]; then
+	echo "The firmware image ${FW} does not exist" >&2
+	usage
+fi
+
+if [ -z "${OUT_DIR}" ]; then
+	OUT_DIR=$(mktemp -d)
+	trap 'rm -rf "${OUT_DIR}"' EXIT
+else
+	mkdir -p "${OUT_DIR}"
+fi
+
+printf "%6s %10s %8s %14s %14s %10s\n" "harts" "ops" "errors" "time" \
+       "max" "time/op"
+for n in ${SMP}; do
+	LOG="${OUT_DIR}/smp${n}.log"
+	timeout "${TIMEOUT}" "${QEMU}" -M virt -m 256M -smp "${n}" \
+		-nographic -bios "${FW}" -cpu "${CPU}" \
+		</dev/null >"${LOG}" 2>&1
+	if ! grep -q "tlbstorm: end" "${LOG}"; then
+		echo "The run with ${n} HARTs did not finish, see ${LOG}" >&2
+		tail -n 20 "${LOG}" >&2
+		exit 1
+	fi
+
+	awk '
+	function field(line, key,	re) {
+		re = " " key "=[^ ]*"
+		if (!match(line, re))
+			return ""
+		return substr(line, RSTART + length(key) + 2,
+			      RLENGTH - length(key) - 2)
+	}
+
+	{
+		sub(/\r$/, "")
+		if (!sub(/^.*tlbstorm: /, "") || $0 !~ /^harts=/)
+			next
+		line = " " $0
+		ops = field(line, "ops")
+		time = field(line, "time")
+		printf "%6s %10s %8s %14s %14s %10.2f\n", field(line, "harts"),
+		       ops, field(line, "errors"), time, field(line, "max"),
+		       (ops > 0) ? time / ops : 0
+	}' "${LOG}"
+done
+echo "Time in timer ticks"